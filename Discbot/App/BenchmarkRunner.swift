@@ -0,0 +1,344 @@
+//
+//  BenchmarkRunner.swift
+//  Discbot
+//
+//  Headless batch throughput benchmarks against the changer simulator
+//
+
+import Foundation
+
+/// Runs the batch operations over a set of simulated changer scenarios and
+/// writes the results as JSON.
+///
+/// Invoked with `Discbot --benchmark [--output <path>] [--seed <n>] [--scenario <name>]`.
+/// Results depend only on the seed (apart from `wallSeconds`), so two commits
+/// can be compared by diffing their output.
+final class BenchmarkRunner {
+    struct Options {
+        var outputPath: String?
+        var seed: UInt64 = 1
+        var scenarioFilter: String?
+
+        /// Parse benchmark flags; returns nil when `--benchmark` is absent.
+        init?(arguments: [String]) {
+            guard arguments.contains("--benchmark") else { return nil }
+            var iterator = arguments.makeIterator()
+            while let argument = iterator.next() {
+                switch argument {
+                case "--output":
+                    outputPath = iterator.next()
+                case "--seed":
+                    if let value = iterator.next().flatMap(UInt64.init) {
+                        seed = value
+                    }
+                case "--scenario":
+                    scenarioFilter = iterator.next()
+                default:
+                    break
+                }
+            }
+        }
+    }
+
+    struct Scenario {
+        let name: String
+        let configuration: ChangerSimulator.Configuration
+        var operations: [Operation] = Operation.allCases
+        /// When set, runs the real ChangerService over a fault-injecting transport
+        /// and reports recovery latency.
+        var transportFaults: FaultInjectingTransport.Configuration?
+    }
+
+    enum Operation: String, CaseIterable {
+        case imageAll
+        case scanUnknown
+        case loadAll
+    }
+
+    struct Result: Codable {
+        let scenario: String
+        let operation: String
+        let slotCount: Int
+        let attempted: Int
+        let completed: Int
+        let failed: Int
+        let simulatedSeconds: Double
+        let wallSeconds: Double
+        let discsPerHour: Double
+        let robotIdlePercent: Double
+        let driveIdlePercent: Double
+        let bytesRead: Int64
+        let injectedFaults: Int
+        let mainThreadDispatches: Int
+        let mainThreadDispatchesPerDisc: Double
+        // Recovery scenarios only: time from an injected transport fault to the next successful load
+        let transportFaults: Int?
+        let recoveryMeanSeconds: Double?
+        let recoveryP95Seconds: Double?
+        let recoveryMaxSeconds: Double?
+        let unrecoveredFaults: Int?
+    }
+
+    struct Report: Codable {
+        let seed: UInt64
+        let results: [Result]
+    }
+
+    private let options: Options
+    private var pending: [(Scenario, Operation)] = []
+    private var results: [Result] = []
+    private let workDirectory: URL
+
+    // Kept alive for the duration of the current run.
+    private var state: BatchOperationState?
+
+    init(options: Options) {
+        self.options = options
+        self.workDirectory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("discbot-benchmark-\(ProcessInfo.processInfo.processIdentifier)", isDirectory: true)
+    }
+
+    static func scenarios(seed: UInt64) -> [Scenario] {
+        var full = ChangerSimulator.Configuration()
+        full.slotCount = 200
+        full.occupancy = 1.0
+        full.seed = seed
+
+        var sparse = full
+        sparse.occupancy = 0.15
+
+        var mixed = full
+        mixed.occupancy = 0.6
+        mixed.discMix = [(.dvd, 0.5), (.dataCD, 0.25), (.audioCD, 0.2), (.mixedModeCD, 0.05)]
+
+        var highError = full
+        highError.occupancy = 0.6
+        highError.faults = ChangerSimulator.Faults(
+            loadFailureRate: 0.05,
+            ejectFailureRate: 0.03,
+            mountFailureRate: 0.05,
+            readFailureRate: 0.08,
+            discNotAppearingRate: 0.03,
+            exceptionRate: 0.02
+        )
+
+        var recoveryBase = full
+        recoveryBase.occupancy = 0.6
+        let recoveryOperations: [Operation] = [.imageAll, .scanUnknown]
+
+        var timeouts = FaultInjectingTransport.Configuration()
+        timeouts.timeoutRate = 0.03
+        timeouts.lateTimeoutRate = 0.03
+        timeouts.seed = seed
+
+        var unitAttention = FaultInjectingTransport.Configuration()
+        unitAttention.unitAttentionRate = 0.05
+        unitAttention.seed = seed
+
+        var sense = FaultInjectingTransport.Configuration()
+        sense.senseRate = 0.05
+        sense.seed = seed
+
+        var partialStatus = FaultInjectingTransport.Configuration()
+        partialStatus.partialStatusRate = 0.3
+        partialStatus.seed = seed
+
+        return [
+            Scenario(name: "full-200", configuration: full),
+            Scenario(name: "sparse-200", configuration: sparse),
+            Scenario(name: "mixed-dvd-cd", configuration: mixed),
+            Scenario(name: "high-error", configuration: highError),
+            Scenario(name: "recovery-timeouts", configuration: recoveryBase,
+                     operations: recoveryOperations, transportFaults: timeouts),
+            Scenario(name: "recovery-unit-attention", configuration: recoveryBase,
+                     operations: recoveryOperations, transportFaults: unitAttention),
+            Scenario(name: "recovery-sense", configuration: recoveryBase,
+                     operations: recoveryOperations, transportFaults: sense),
+            Scenario(name: "recovery-partial-status", configuration: recoveryBase,
+                     operations: recoveryOperations, transportFaults: partialStatus),
+        ]
+    }
+
+    /// Start the suite. Must be called on the main thread, which must then be left
+    /// running (`dispatchMain()`); the process exits when the suite finishes.
+    func run() {
+        try? FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true, attributes: nil)
+
+        for scenario in Self.scenarios(seed: options.seed) {
+            if let filter = options.scenarioFilter, filter != scenario.name {
+                continue
+            }
+            for operation in scenario.operations {
+                pending.append((scenario, operation))
+            }
+        }
+        runNext()
+    }
+
+    private func runNext() {
+        guard !pending.isEmpty else {
+            finish()
+            return
+        }
+        let (scenario, operation) = pending.removeFirst()
+        run(scenario: scenario, operation: operation) { [weak self] result in
+            self?.results.append(result)
+            // Swift strings are not CVarArg outside Darwin, so the names are interpolated
+            print("\(result.scenario) \(result.operation): " + String(
+                format: "%d/%d ok, %.1f discs/h, robot idle %.1f%%, drive idle %.1f%%, %d main dispatches",
+                result.completed, result.attempted,
+                result.discsPerHour, result.robotIdlePercent, result.driveIdlePercent,
+                result.mainThreadDispatches
+            ))
+            self?.runNext()
+        }
+    }
+
+    private func run(scenario: Scenario, operation: Operation, completion: @escaping (Result) -> Void) {
+        let simulator = ChangerSimulator(configuration: scenario.configuration)
+        let changerService: ChangerServicing
+        let faultInjector: FaultInjectingTransport?
+        if let faults = scenario.transportFaults {
+            let transport = FaultInjectingTransport(
+                base: SimulatedChangerTransport(simulator: simulator),
+                configuration: faults,
+                clock: { simulator.currentTime },
+                sleep: { simulator.sleep($0) }
+            )
+            faultInjector = transport
+            changerService = ChangerService(transport: transport)
+        } else {
+            faultInjector = nil
+            changerService = SimulatedChangerService(simulator: simulator)
+        }
+        let mountService = SimulatedMountService(simulator: simulator)
+        let imagingService = SimulatedImagingService(simulator: simulator)
+        let databasePath = workDirectory.appendingPathComponent("\(scenario.name)-\(operation.rawValue).sqlite").path
+        try? FileManager.default.removeItem(atPath: databasePath)
+        let database = Database(path: databasePath)
+        let catalogService = CatalogService(database: database, musicBrainz: nil)
+        let state = BatchOperationState()
+        state.eventLog = EventLog(database: database, clock: { Date(timeIntervalSince1970: simulator.currentTime) })
+        state.jobQueue = JobQueue(database: database, clock: { Date(timeIntervalSince1970: simulator.currentTime) })
+        state.retrySleep = { simulator.sleep($0) }
+        state.retrySeed = scenario.configuration.seed
+        self.state = state
+
+        // Connecting reads the element map, which a fault may interrupt.
+        for _ in 0..<3 {
+            if (try? changerService.connect()) != nil { break }
+        }
+        let slots = simulator.inventory().slots
+        let startedAt = Date()
+
+        let onComplete = {
+            let stats = simulator.snapshotStatistics()
+            let attempted = state.totalCount
+            let completed = state.completedSlots.count
+            let hours = stats.elapsedSeconds / 3600
+            let recovery = faultInjector?.snapshotStatistics()
+            let latencies = (recovery?.recoveryLatencies ?? []).sorted()
+            completion(Result(
+                scenario: scenario.name,
+                operation: operation.rawValue,
+                slotCount: scenario.configuration.slotCount,
+                attempted: attempted,
+                completed: completed,
+                failed: state.failedSlots.count,
+                simulatedSeconds: stats.elapsedSeconds,
+                wallSeconds: Date().timeIntervalSince(startedAt),
+                discsPerHour: hours > 0 ? Double(completed) / hours : 0,
+                robotIdlePercent: stats.robotIdleFraction * 100,
+                driveIdlePercent: stats.driveIdleFraction * 100,
+                bytesRead: stats.bytesRead,
+                injectedFaults: stats.injectedFaults,
+                mainThreadDispatches: state.mainDispatchCount,
+                mainThreadDispatchesPerDisc: attempted > 0 ? Double(state.mainDispatchCount) / Double(attempted) : 0,
+                transportFaults: recovery?.injectedFaults,
+                recoveryMeanSeconds: latencies.isEmpty ? nil : latencies.reduce(0, +) / Double(latencies.count),
+                recoveryP95Seconds: latencies.isEmpty ? nil : latencies[min(latencies.count - 1, latencies.count * 95 / 100)],
+                recoveryMaxSeconds: latencies.last,
+                unrecoveredFaults: recovery?.unrecoveredFaults
+            ))
+        }
+
+        // The batch runners return without calling back when nothing matches their filter.
+        let eligible: Bool
+        switch operation {
+        case .imageAll:
+            eligible = slots.contains { $0.isFull || $0.isInDrive }
+        case .scanUnknown:
+            eligible = slots.contains { $0.isFull && !$0.isInDrive && $0.discType == .unscanned }
+        case .loadAll:
+            eligible = slots.contains { $0.isFull && !$0.isInDrive }
+        }
+        guard eligible else {
+            DispatchQueue.main.async(execute: onComplete)
+            return
+        }
+
+        switch operation {
+        case .imageAll:
+            state.runImageAll(
+                slots: slots,
+                outputDirectory: workDirectory,
+                driveFallbackSourceSlot: nil,
+                changerService: changerService,
+                mountService: mountService,
+                imagingService: imagingService,
+                catalogService: catalogService,
+                onUpdate: {},
+                onSlotLoaded: { _, _, _ in },
+                onSlotEjected: { _ in },
+                onComplete: onComplete
+            )
+        case .scanUnknown:
+            state.runScanUnknown(
+                slots: slots,
+                driveFallbackSourceSlot: nil,
+                changerService: changerService,
+                mountService: mountService,
+                imagingService: imagingService,
+                catalogService: catalogService,
+                onUpdate: {},
+                onSlotLoaded: { _, _, _ in },
+                onSlotCataloged: { _ in },
+                onSlotEjected: { _ in },
+                onComplete: onComplete
+            )
+        case .loadAll:
+            state.runLoadAll(
+                slots: slots,
+                changerService: changerService,
+                mountService: mountService,
+                onUpdate: {},
+                onSlotLoaded: { _, _, _ in },
+                onSlotEjected: { _ in },
+                onComplete: onComplete
+            )
+        }
+    }
+
+    private func finish() {
+        let report = Report(seed: options.seed, results: results)
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.prettyPrinted, .sortedKeys]
+
+        var exitCode: Int32 = 0
+        do {
+            let data = try encoder.encode(report)
+            if let outputPath = options.outputPath {
+                try data.write(to: URL(fileURLWithPath: outputPath))
+                print("Benchmark results written to \(outputPath)")
+            } else if let json = String(data: data, encoding: .utf8) {
+                print(json)
+            }
+        } catch {
+            print("Benchmark: failed to write results: \(error.localizedDescription)")
+            exitCode = 1
+        }
+
+        try? FileManager.default.removeItem(at: workDirectory)
+        exit(exitCode)
+    }
+}
@@ -0,0 +1,175 @@
+//
+//  ControlCommand.swift
+//  Discbot
+//
+//  Command-line client for a running daemon
+//
+
+import Foundation
+
+/// Sends one request to the daemon's control socket and prints the reply.
+///
+/// Invoked with `Discbot --ctl [--socket <path>] <command>`, where command is one of
+/// `status`, `inventory`, `jobs`, `watch`, `shutdown`, `cancel <job>`, `find <words>`,
+/// `get <slot> <path> [--to <file>]` or `queue image|scan|load [--slots 1,4,10-20] [--output <dir>]`. Replies are printed as
+/// JSON; `watch` prints one event per line until the daemon goes away. Exits 1 when the
+/// daemon reports a failure or cannot be reached, 2 on a usage error.
+struct ControlCommand {
+    static let usage = """
+        usage: Discbot --ctl [--socket <path>] <command>
+          status | inventory | jobs | watch | shutdown
+          queue image|scan|load [--slots 1,4,10-20] [--output <dir>]
+          cancel <job id>
+          find <words>
+          get <slot> <path on disc> [--to <file>]
+        """
+
+    private var socketPath = DaemonRunner.defaultSocketPath
+    private var request: ControlRequest?
+    private var usageError: String?
+
+    /// Parse client flags; returns nil when `--ctl` is absent.
+    init?(arguments: [String]) {
+        guard let start = arguments.firstIndex(of: "--ctl") else { return nil }
+        var words: [String] = []
+        var slots: [Int]?
+        var outputDirectory: String?
+        var destination: String?
+
+        var iterator = arguments[(start + 1)...].makeIterator()
+        while let argument = iterator.next() {
+            switch argument {
+            case "--socket":
+                if let path = iterator.next() { socketPath = path }
+            case "--slots":
+                guard let list = iterator.next(), let parsed = Self.parseSlots(list) else {
+                    usageError = "--slots takes a list like 1,4,10-20"
+                    return
+                }
+                slots = parsed
+            case "--output":
+                outputDirectory = iterator.next().map { URL(fileURLWithPath: $0).standardizedFileURL.path }
+            case "--to":
+                destination = iterator.next().map { URL(fileURLWithPath: $0).standardizedFileURL.path }
+            default:
+                words.append(argument)
+            }
+        }
+
+        guard let command = words.first else {
+            usageError = "missing command"
+            return
+        }
+        switch command {
+        case "status":
+            request = ControlRequest(command: .status)
+        case "inventory":
+            request = ControlRequest(command: .inventory)
+        case "jobs":
+            request = ControlRequest(command: .jobs)
+        case "watch":
+            request = ControlRequest(command: .subscribe)
+        case "shutdown":
+            request = ControlRequest(command: .shutdown)
+        case "cancel":
+            guard words.count > 1, let jobId = Int(words[1]) else {
+                usageError = "cancel takes a job id"
+                return
+            }
+            request = ControlRequest(command: .cancel, jobId: jobId)
+        case "find":
+            guard words.count > 1 else {
+                usageError = "find takes words to look for in file paths"
+                return
+            }
+            request = ControlRequest(command: .findFiles, query: words[1...].joined(separator: " "))
+        case "get":
+            guard words.count > 2, let slot = Int(words[1]) else {
+                usageError = "get takes a slot and a path"
+                return
+            }
+            let path = words[2...].joined(separator: " ")
+            // The daemon writes the copy, so it gets an absolute path (default: here, same name)
+            let name = path.split(separator: "/").last.map(String.init) ?? path
+            request = ControlRequest(
+                command: .getFile,
+                slot: slot,
+                path: path,
+                destination: destination ?? URL(fileURLWithPath: name).standardizedFileURL.path
+            )
+        case "queue":
+            let kinds: [String: ControlJob.Kind] = ["image": .imageAll, "scan": .scanUnknown, "load": .loadAll]
+            guard words.count > 1, let kind = kinds[words[1]] else {
+                usageError = "queue takes image, scan or load"
+                return
+            }
+            request = ControlRequest(command: .queue, job: kind, slots: slots, outputDirectory: outputDirectory)
+        default:
+            usageError = "unknown command \(command)"
+        }
+        request?.id = 1
+    }
+
+    /// Run the command; returns the process exit status.
+    func run() -> Int32 {
+        guard let request = request else {
+            printError("\(usageError ?? "missing command")\n\(Self.usage)")
+            return 2
+        }
+        signal(SIGPIPE, SIG_IGN)
+
+        let channel: ControlChannel
+        do {
+            channel = try ControlChannel.connect(path: socketPath)
+        } catch {
+            printError("Cannot reach daemon at \(socketPath): \(error.localizedDescription)")
+            return 1
+        }
+        guard channel.send(request) else {
+            printError(ControlSocketError.closed.localizedDescription)
+            return 1
+        }
+
+        guard let reply = channel.readLine() else {
+            printError(ControlSocketError.closed.localizedDescription)
+            return 1
+        }
+        let ok = (try? JSONDecoder.control.decode(ControlResponse.self, from: reply))?.ok ?? false
+        printPretty(reply)
+        guard ok else { return 1 }
+
+        if request.command == .subscribe {
+            while let line = channel.readLine() {
+                print(String(decoding: line, as: UTF8.self))
+                fflush(stdout)
+            }
+        }
+        return 0
+    }
+
+    /// "1,4,10-20" -> [1, 4, 10, 11, ..., 20]
+    static func parseSlots(_ list: String) -> [Int]? {
+        var slots: [Int] = []
+        for part in list.split(separator: ",") {
+            let bounds = part.split(separator: "-", maxSplits: 1).map { Int($0.trimmingCharacters(in: .whitespaces)) }
+            guard let first = bounds.first ?? nil else { return nil }
+            let last = bounds.count > 1 ? bounds[1] : first
+            guard let end = last, end >= first else { return nil }
+            slots.append(contentsOf: first...end)
+        }
+        return slots.isEmpty ? nil : slots
+    }
+
+    private func printPretty(_ line: Data) {
+        if let object = try? JSONSerialization.jsonObject(with: line),
+           let pretty = try? JSONSerialization.data(withJSONObject: object, options: [.prettyPrinted, .sortedKeys]) {
+            print(String(decoding: pretty, as: UTF8.self))
+        } else {
+            print(String(decoding: line, as: UTF8.self))
+        }
+    }
+
+    private func printError(_ message: String) {
+        FileHandle.standardError.write(Data((message + "\n").utf8))
+    }
+}
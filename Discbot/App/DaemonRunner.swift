@@ -0,0 +1,742 @@
+//
+//  DaemonRunner.swift
+//  Discbot
+//
+//  Headless service: owns the changer, runs queued batch jobs and serves the control socket
+//
+
+import Foundation
+
+/// Runs the changer without the UI so batch jobs survive logout and can be driven remotely.
+///
+/// Invoked with `Discbot --daemon [--socket <path>] [--output <dir>] [--mirror <dir>]...
+/// [--object-store <dir>] [--sync none|end|chunk] [--cached]
+/// [--verify off|sampled|full] [--database <path>]
+/// [--mock | --simulate [--seed <n>] [--slots <n>] [--time-scale <x>]]`. Clients talk to it
+/// with `Discbot --ctl` (see `ControlCommand`) or any program that writes one JSON
+/// `ControlRequest` per line to the socket. Jobs run one at a time in queue order, using
+/// the same `BatchOperationState` runners as the app. Jobs are also kept in the catalog's
+/// `JobQueue`, so after a crash or SIGTERM the next start resumes them from the slot that
+/// was in progress. All state lives on the main queue; blocking changer calls go to `workQueue`.
+final class DaemonRunner {
+    struct Options {
+        enum Backend: String {
+            case hardware
+            case mock
+            case simulator
+        }
+
+        var socketPath = DaemonRunner.defaultSocketPath
+        /// Default image directory for imageAll jobs that do not name one
+        var outputDirectory: URL?
+        /// Written alongside the output directory by every imageAll job
+        var mirrors: [ImageDestination] = []
+        var writeOptions: ImageWriteOptions = .standard
+        var verifyMode: ImageVerifyMode = .off
+        var databasePath: String?
+        var backend: Backend = .hardware
+        var seed: UInt64 = 1
+        var slotCount = 200
+        /// Simulator only: real seconds slept per simulated second
+        var timeScale: Double = 0
+
+        /// Parse daemon flags; returns nil when `--daemon` is absent.
+        init?(arguments: [String]) {
+            guard arguments.contains("--daemon") else { return nil }
+            var iterator = arguments.makeIterator()
+            while let argument = iterator.next() {
+                switch argument {
+                case "--socket":
+                    if let path = iterator.next() { socketPath = path }
+                case "--output":
+                    outputDirectory = iterator.next().map { URL(fileURLWithPath: $0, isDirectory: true) }
+                case "--mirror":
+                    if let path = iterator.next() {
+                        mirrors.append(ImageDestination(kind: .directory, url: URL(fileURLWithPath: path, isDirectory: true)))
+                    }
+                case "--object-store":
+                    if let path = iterator.next() {
+                        mirrors.append(ImageDestination(kind: .objectStore, url: URL(fileURLWithPath: path, isDirectory: true)))
+                    }
+                case "--sync":
+                    switch iterator.next() {
+                    case "none": writeOptions.durability = .none
+                    case "end": writeOptions.durability = .atEnd
+                    case "chunk": writeOptions.durability = .perChunk
+                    default: break
+                    }
+                case "--cached":
+                    writeOptions.bypassCache = false
+                case "--verify":
+                    if let mode = iterator.next().flatMap(ImageVerifyMode.init(rawValue:)) { verifyMode = mode }
+                case "--database":
+                    databasePath = iterator.next()
+                case "--mock":
+                    backend = .mock
+                case "--simulate":
+                    backend = .simulator
+                case "--seed":
+                    if let value = iterator.next().flatMap(UInt64.init) { seed = value }
+                case "--slots":
+                    if let value = iterator.next().flatMap(Int.init), value > 0 { slotCount = value }
+                case "--time-scale":
+                    if let value = iterator.next().flatMap(Double.init), value >= 0 { timeScale = value }
+                default:
+                    break
+                }
+            }
+        }
+    }
+
+    /// `$DISCBOT_SOCKET`, else `discbot.sock` next to the catalog database
+    static var defaultSocketPath: String {
+        if let path = ProcessInfo.processInfo.environment["DISCBOT_SOCKET"], !path.isEmpty {
+            return path
+        }
+        let fileManager = FileManager.default
+        let base = fileManager.urls(for: .applicationSupportDirectory, in: .userDomainMask).first
+            ?? fileManager.temporaryDirectory
+        let directory = base.appendingPathComponent("Discbot", isDirectory: true)
+        try? fileManager.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        return directory.appendingPathComponent("discbot.sock").path
+    }
+
+    /// Finished jobs kept for `jobs` queries
+    private static let finishedJobHistory = 50
+    /// Minimum spacing of jobProgress events per job
+    private static let progressInterval: TimeInterval = 0.5
+
+    private let options: Options
+    private let server: ControlServer
+    private let workQueue = DispatchQueue(label: "discbot.daemon.work", qos: .userInitiated)
+    /// Copies out of stored images, kept off the main and changer queues
+    private let fileQueue = DispatchQueue(label: "discbot.daemon.files", qos: .utility)
+
+    private let changerService: ChangerServicing
+    private let mountService: MountServicing
+    private let imagingService: ImagingServicing
+    private let catalogService: CatalogService
+    private let eventLog: EventLog?
+    private let jobQueue: JobQueue?
+    private let simulator: ChangerSimulator?
+
+    // Main-queue state
+    private var isConnected = false
+    private var deviceInfo: ChangerService.ChangerDeviceInfo?
+    private var slots: [Slot] = []
+    private var driveHasDisc = false
+    private var driveSourceSlot: Int?
+    private var jobs: [ControlJob] = []
+    private var pendingJobIds: [Int] = []
+    private var nextJobId = 1
+    /// Jobs with a row in the job queue (all of them unless the catalog is unavailable)
+    private var persistedJobIds: Set<Int> = []
+    /// Interrupted jobs found at launch, queued again once the inventory is known
+    private var recoveredJobs: [JobRecord] = []
+    private var activeJob: (id: Int, state: BatchOperationState)?
+    private var lastProgressEvent: Date = .distantPast
+    private var reportedSlots: Set<Int> = []
+    private var subscribers: [ObjectIdentifier: ControlChannel] = [:]
+    private var isShuttingDown = false
+    private var signalSources: [DispatchSourceSignal] = []
+
+    init(options: Options) {
+        self.options = options
+        self.server = ControlServer(path: options.socketPath)
+
+        switch options.backend {
+        case .hardware:
+            #if DISCBOT_NO_HARDWARE
+            preconditionFailure("Built without changer support; HeadlessMode only starts --mock or --simulate")
+            #else
+            simulator = nil
+            changerService = ChangerService.makeDefault()
+            mountService = MountService()
+            imagingService = ImagingService()
+            let database = options.databasePath.map { Database(path: $0) } ?? .shared
+            catalogService = CatalogService(database: database)
+            eventLog = options.databasePath == nil ? .shared : EventLog(database: database)
+            jobQueue = options.databasePath == nil ? .shared : JobQueue(database: database)
+            #endif
+        case .mock:
+            simulator = nil
+            let state = MockChangerState(slotCount: options.slotCount)
+            changerService = MockChangerService(state: state)
+            mountService = MockMountService(state: state)
+            imagingService = MockImagingService()
+            let database = options.databasePath.map { Database(path: $0) } ?? .shared
+            catalogService = CatalogService(database: database, musicBrainz: nil)
+            eventLog = nil
+            jobQueue = JobQueue(database: database)
+        case .simulator:
+            var configuration = ChangerSimulator.Configuration()
+            configuration.slotCount = options.slotCount
+            configuration.seed = options.seed
+            configuration.realTimeScale = options.timeScale
+            let simulator = ChangerSimulator(configuration: configuration)
+            self.simulator = simulator
+            changerService = SimulatedChangerService(simulator: simulator)
+            mountService = SimulatedMountService(simulator: simulator)
+            imagingService = SimulatedImagingService(simulator: simulator)
+            let databasePath = options.databasePath ?? FileManager.default.temporaryDirectory
+                .appendingPathComponent("discbot-daemon-\(ProcessInfo.processInfo.processIdentifier).sqlite").path
+            let database = Database(path: databasePath)
+            catalogService = CatalogService(database: database, musicBrainz: nil)
+            eventLog = EventLog(database: database, clock: { Date(timeIntervalSince1970: simulator.currentTime) })
+            jobQueue = JobQueue(database: database, clock: { Date(timeIntervalSince1970: simulator.currentTime) })
+        }
+    }
+
+    /// Start serving. Must be called on the main thread, which must then be left
+    /// running (`dispatchMain()`); the process exits after `shutdown` or SIGTERM/SIGINT.
+    func run() {
+        // A client that disconnects mid-write must not kill the daemon
+        signal(SIGPIPE, SIG_IGN)
+        for signalNumber in [SIGTERM, SIGINT] {
+            signal(signalNumber, SIG_IGN)
+            let source = DispatchSource.makeSignalSource(signal: signalNumber, queue: .main)
+            source.setEventHandler { [weak self] in self?.beginShutdown() }
+            source.resume()
+            signalSources.append(source)
+        }
+
+        server.onLine = { [weak self] line, channel in self?.handle(line, from: channel) }
+        server.onDisconnect = { [weak self] channel in
+            self?.subscribers.removeValue(forKey: ObjectIdentifier(channel))
+        }
+        do {
+            try server.start()
+        } catch {
+            print("Daemon: cannot listen on \(options.socketPath): \(error.localizedDescription)")
+            exit(1)
+        }
+        print("Daemon: \(options.backend.rawValue) backend, listening on \(options.socketPath)")
+        recoveredJobs = jobQueue?.recoverInterruptedJobs() ?? []
+
+        workQueue.async { [weak self] in
+            guard let self = self else { return }
+            // Connecting reads the element map, which a transient fault may interrupt.
+            var info: ChangerService.ChangerDeviceInfo?
+            for _ in 0..<3 {
+                if (try? self.changerService.connect()) != nil {
+                    info = try? self.changerService.getDeviceInfo()
+                    break
+                }
+            }
+            let connected = self.changerService.isConnected
+            // Timings are learned per optical drive, not per changer
+            self.eventLog?.drive = self.mountService.getDriveIdentity()
+            DispatchQueue.main.async {
+                self.isConnected = connected
+                self.deviceInfo = info
+                print(connected
+                    ? "Daemon: connected to \(info.map { "\($0.vendor) \($0.product)" } ?? "changer")"
+                    : "Daemon: changer not connected")
+                self.refreshInventory {
+                    self.resumeRecoveredJobs()
+                    self.startNextJob()
+                }
+            }
+        }
+    }
+
+    // MARK: - Requests
+
+    private func handle(_ line: Data, from channel: ControlChannel) {
+        let request: ControlRequest
+        do {
+            request = try JSONDecoder.control.decode(ControlRequest.self, from: line)
+        } catch {
+            channel.send(ControlResponse.failure("Malformed request: \(error.localizedDescription)"))
+            return
+        }
+        let reply = { (response: ControlResponse) in
+            var response = response
+            response.id = request.id
+            channel.send(response)
+        }
+
+        switch request.command {
+        case .status:
+            reply(ControlResponse(ok: true, status: status()))
+
+        case .inventory:
+            // The changer is busy during a job; answer from the last refresh then
+            if activeJob != nil || !isConnected {
+                reply(ControlResponse(ok: true, inventory: slots.map(ControlSlot.init)))
+            } else {
+                refreshInventory {
+                    reply(ControlResponse(ok: true, inventory: self.slots.map(ControlSlot.init)))
+                }
+            }
+
+        case .jobs:
+            reply(ControlResponse(ok: true, jobs: jobs))
+
+        case .queue:
+            guard !isShuttingDown else {
+                reply(.failure("Daemon is shutting down"))
+                return
+            }
+            guard let kind = request.job else {
+                reply(.failure("queue needs a job (imageAll, scanUnknown or loadAll)"))
+                return
+            }
+            let outputDirectory = request.outputDirectory ?? options.outputDirectory?.path
+            if kind == .imageAll && outputDirectory == nil {
+                reply(.failure("imageAll needs an outputDirectory (or start the daemon with --output)"))
+                return
+            }
+            let jobOutputDirectory = kind == .imageAll ? outputDirectory : nil
+            var jobId = nextJobId
+            if let persistedId = jobQueue?.createJob(
+                kind: JobRecord.Kind(kind),
+                outputDirectory: jobOutputDirectory,
+                slotIds: request.slots ?? []
+            ) {
+                jobId = Int(persistedId)
+                persistedJobIds.insert(jobId)
+            }
+            let job = ControlJob(
+                id: jobId,
+                kind: kind,
+                slots: request.slots,
+                outputDirectory: jobOutputDirectory,
+                queuedAt: Date()
+            )
+            nextJobId = max(nextJobId, jobId) + 1
+            jobs.append(job)
+            pendingJobIds.append(job.id)
+            reply(ControlResponse(ok: true, job: job))
+            broadcast(.jobQueued, job: job)
+            startNextJob()
+
+        case .cancel:
+            guard let jobId = request.jobId, let index = jobs.firstIndex(where: { $0.id == jobId }) else {
+                reply(.failure("No such job"))
+                return
+            }
+            if let active = activeJob, active.id == jobId {
+                // onComplete reports the final state
+                active.state.cancel()
+            } else if let pending = pendingJobIds.firstIndex(of: jobId) {
+                pendingJobIds.remove(at: pending)
+                jobs[index].state = .cancelled
+                jobs[index].finishedAt = Date()
+                persist(jobId) { $0.finishJob($1, state: .cancelled) }
+                broadcast(.jobFinished, job: jobs[index])
+            }
+            reply(ControlResponse(ok: true, job: jobs[index]))
+
+        case .findFiles:
+            guard let query = request.query, !query.isEmpty else {
+                reply(.failure("findFiles needs a query"))
+                return
+            }
+            // Answered from the catalog alone; the changer is not touched
+            reply(ControlResponse(ok: true, files: catalogService.searchFiles(query).map(ControlFile.init)))
+
+        case .getFile:
+            guard let slot = request.slot, let path = request.path, let destination = request.destination,
+                  destination.hasPrefix("/") else {
+                reply(.failure("getFile needs a slot, a path and an absolute destination"))
+                return
+            }
+            // Reads the stored image only, so it runs alongside whatever the changer is doing
+            fileQueue.async { [catalogService] in
+                do {
+                    let (file, imageURL) = try ImageFileReader.locate(slotId: slot, path: path, catalog: catalogService)
+                    try ImageFileReader.copy(file, from: imageURL, to: URL(fileURLWithPath: destination))
+                    let disc = catalogService.getDisc(slotId: slot) ?? DiscRecord(slotId: slot)
+                    reply(ControlResponse(ok: true, files: [ControlFile(DiscFileHit(disc: disc, file: file))]))
+                } catch {
+                    reply(.failure(error.localizedDescription))
+                }
+            }
+
+        case .subscribe:
+            subscribers[ObjectIdentifier(channel)] = channel
+            reply(ControlResponse(ok: true, status: status()))
+
+        case .shutdown:
+            reply(ControlResponse(ok: true))
+            beginShutdown()
+        }
+    }
+
+    private func status() -> ControlStatus {
+        ControlStatus(
+            backend: options.backend.rawValue,
+            connected: isConnected,
+            vendor: deviceInfo?.vendor,
+            product: deviceInfo?.product,
+            slotCount: slots.count,
+            hasIESlot: changerService.hasIESlot,
+            driveHasDisc: driveHasDisc,
+            driveSourceSlot: driveSourceSlot,
+            activeJobId: activeJob?.id,
+            queuedJobs: pendingJobIds.count
+        )
+    }
+
+    // MARK: - Inventory
+
+    /// Read slot and drive status plus catalog metadata, then call `completion` on main
+    private func refreshInventory(completion: @escaping () -> Void) {
+        guard isConnected else {
+            completion()
+            return
+        }
+        workQueue.async { [weak self] in
+            guard let self = self else { return }
+            let inventory = try? self.changerService.getInventoryStatus()
+            var newSlots = inventory?.slots
+            if let slots = newSlots {
+                let discsBySlot = Dictionary(
+                    self.catalogService.getAllDiscs().map { ($0.slotId, $0) },
+                    uniquingKeysWith: { _, last in last }
+                )
+                let statuses = self.catalogService.getAllBackupStatuses()
+                newSlots = slots.map { slot in
+                    var slot = slot
+                    if let status = statuses[slot.id] {
+                        slot.backupStatus = status
+                    }
+                    if let disc = discsBySlot[slot.id] {
+                        slot.discType = SlotDiscType.from(catalogString: disc.discType)
+                        slot.volumeLabel = disc.volumeLabel
+                    }
+                    return slot
+                }
+            }
+            let discPresent = self.mountService.isDiscPresent()
+
+            DispatchQueue.main.async {
+                if let newSlots = newSlots {
+                    self.slots = newSlots
+                }
+                self.driveHasDisc = discPresent
+                if let source = inventory?.drive.sourceSlot {
+                    self.driveSourceSlot = source
+                } else if !discPresent {
+                    self.driveSourceSlot = nil
+                }
+                if discPresent, let source = self.driveSourceSlot, source > 0, source <= self.slots.count {
+                    self.slots[source - 1].isInDrive = true
+                }
+                completion()
+            }
+        }
+    }
+
+    // MARK: - Jobs
+
+    private func startNextJob() {
+        guard activeJob == nil, !isShuttingDown, isConnected, !pendingJobIds.isEmpty else { return }
+        let jobId = pendingJobIds.removeFirst()
+        guard let index = jobs.firstIndex(where: { $0.id == jobId }) else { return }
+
+        let state = BatchOperationState()
+        state.eventLog = eventLog
+        state.mirrorDestinations = options.mirrors
+        state.writeOptions = options.writeOptions
+        state.verifyMode = options.verifyMode
+        // Image All records its own tasks; the other kinds are recorded from jobDidUpdate
+        if jobs[index].kind == .imageAll, persistedJobIds.contains(jobId) {
+            state.jobQueue = jobQueue
+            state.jobId = Int64(jobId)
+        } else {
+            state.jobQueue = nil
+        }
+        if let simulator = simulator {
+            state.retrySleep = { simulator.sleep($0) }
+            state.retrySeed = options.seed
+        }
+        activeJob = (jobId, state)
+        lastProgressEvent = .distantPast
+        reportedSlots = []
+        jobs[index].state = .running
+        jobs[index].startedAt = Date()
+        broadcast(.jobStarted, job: jobs[index])
+
+        refreshInventory { [weak self] in
+            self?.run(jobId: jobId, state: state)
+        }
+    }
+
+    private func run(jobId: Int, state: BatchOperationState) {
+        guard let job = jobs.first(where: { $0.id == jobId }) else { return }
+        var candidates = slots
+        if let requested = job.slots.map(Set.init) {
+            candidates = candidates.filter { requested.contains($0.id) }
+        }
+
+        // The batch runners return without calling back when nothing matches their filter.
+        let eligible: Bool
+        switch job.kind {
+        case .imageAll:
+            eligible = candidates.contains { $0.isFull || $0.isInDrive }
+        case .scanUnknown:
+            eligible = candidates.contains { $0.isFull && !$0.isInDrive && $0.discType == .unscanned }
+        case .loadAll:
+            eligible = candidates.contains { $0.isFull && !$0.isInDrive }
+        }
+        guard eligible else {
+            finishJob(jobId, state: .failed, error: "No eligible slots")
+            return
+        }
+        if job.kind != .imageAll {
+            let eligibleSlots = candidates.filter {
+                $0.isFull && !$0.isInDrive && (job.kind == .loadAll || $0.discType == .unscanned)
+            }
+            persist(jobId) { $0.beginJob($1, slotIds: eligibleSlots.map(\.id)) }
+        }
+
+        let onUpdate = { [weak self] in self?.jobDidUpdate(jobId) }
+        let onSlotLoaded: (Int, String, String?) -> Void = { _, _, _ in }
+        let onSlotEjected: (Int) -> Void = { _ in }
+        let onComplete = { [weak self] in
+            self?.finishJob(jobId, state: state.isCancelled ? .cancelled : .completed)
+        }
+        let fallbackSourceSlot = slots.first(where: { $0.isInDrive })?.id
+
+        switch job.kind {
+        case .imageAll:
+            let outputDirectory = URL(fileURLWithPath: job.outputDirectory ?? "", isDirectory: true)
+            try? FileManager.default.createDirectory(at: outputDirectory, withIntermediateDirectories: true, attributes: nil)
+            state.runImageAll(
+                slots: candidates,
+                outputDirectory: outputDirectory,
+                driveFallbackSourceSlot: fallbackSourceSlot,
+                changerService: changerService,
+                mountService: mountService,
+                imagingService: imagingService,
+                catalogService: catalogService,
+                onUpdate: onUpdate,
+                onSlotLoaded: onSlotLoaded,
+                onSlotEjected: onSlotEjected,
+                onComplete: onComplete
+            )
+        case .scanUnknown:
+            state.runScanUnknown(
+                slots: candidates,
+                driveFallbackSourceSlot: fallbackSourceSlot,
+                changerService: changerService,
+                mountService: mountService,
+                imagingService: imagingService,
+                catalogService: catalogService,
+                onUpdate: onUpdate,
+                onSlotLoaded: onSlotLoaded,
+                onSlotCataloged: { _ in },
+                onSlotEjected: onSlotEjected,
+                onComplete: onComplete
+            )
+        case .loadAll:
+            state.runLoadAll(
+                slots: candidates,
+                changerService: changerService,
+                mountService: mountService,
+                onUpdate: onUpdate,
+                onSlotLoaded: onSlotLoaded,
+                onSlotEjected: onSlotEjected,
+                onComplete: onComplete
+            )
+        }
+    }
+
+    /// Copy the runner's progress into the job record and stream it, throttled
+    private func jobDidUpdate(_ jobId: Int) {
+        guard let active = activeJob, active.id == jobId,
+              let index = jobs.firstIndex(where: { $0.id == jobId }) else { return }
+        capture(active.state, into: &jobs[index])
+
+        let finishedSlots = jobs[index].completed + jobs[index].failed.map(\.slot)
+        if finishedSlots.count > reportedSlots.count {
+            let job = jobs[index]
+            for slot in finishedSlots where !reportedSlots.contains(slot) {
+                reportedSlots.insert(slot)
+                if job.kind != .imageAll {
+                    let failure = job.failed.first { $0.slot == slot }
+                    persist(jobId) {
+                        $0.finishTask(jobId: $1, slot: slot, state: failure == nil ? .completed : .failed, error: failure?.error)
+                    }
+                }
+                broadcast(.slotFinished, job: job, slot: slot)
+            }
+            return
+        }
+
+        let now = Date()
+        guard now.timeIntervalSince(lastProgressEvent) >= Self.progressInterval else { return }
+        lastProgressEvent = now
+        broadcast(.jobProgress, job: jobs[index])
+    }
+
+    private func finishJob(_ jobId: Int, state finalState: ControlJob.State, error: String? = nil) {
+        guard let index = jobs.firstIndex(where: { $0.id == jobId }) else { return }
+        if let active = activeJob, active.id == jobId {
+            capture(active.state, into: &jobs[index])
+            activeJob = nil
+        }
+        jobs[index].state = finalState
+        jobs[index].error = error
+        jobs[index].currentSlot = nil
+        jobs[index].finishedAt = Date()
+        if isShuttingDown && finalState == .cancelled {
+            // Stopped by shutdown rather than by a client: resume it next launch
+            persist(jobId) { $0.interruptJob($1) }
+        } else {
+            persist(jobId) { $0.finishJob($1, state: JobRecord.State(finalState)) }
+        }
+        broadcast(.jobFinished, job: jobs[index])
+        print("Daemon: job \(jobId) \(finalState.rawValue)"
+            + " (\(jobs[index].completed.count) ok, \(jobs[index].failed.count) failed)")
+        pruneFinishedJobs()
+
+        if isShuttingDown {
+            terminate()
+            return
+        }
+        refreshInventory { [weak self] in
+            self?.startNextJob()
+        }
+    }
+
+    /// Queue the interrupted jobs of the previous run again, reconciled with the inventory
+    private func resumeRecoveredJobs() {
+        let recovered = recoveredJobs
+        recoveredJobs = []
+        for record in recovered {
+            guard let job = jobQueue?.reconcile(record, with: slots) else {
+                print("Daemon: interrupted job \(record.id) has nothing left to do")
+                continue
+            }
+            guard jobQueue?.claim(job) == true else {
+                print("Daemon: interrupted job \(record.id) was taken by another process")
+                continue
+            }
+            let jobId = Int(job.id)
+            let queuedAt = CatalogTimestamp.date(from: job.createdAt) ?? Date()
+            // A job that never began has no tasks and keeps its original scope
+            let pendingSlots = job.tasks.isEmpty ? nil : job.pendingSlotIds
+            let resumed = ControlJob(
+                id: jobId,
+                kind: ControlJob.Kind(job.kind),
+                slots: pendingSlots,
+                outputDirectory: job.outputDirectory,
+                queuedAt: queuedAt
+            )
+            persistedJobIds.insert(jobId)
+            nextJobId = max(nextJobId, jobId + 1)
+            jobs.append(resumed)
+            pendingJobIds.append(jobId)
+            print("Daemon: resuming interrupted job \(jobId)"
+                + (pendingSlots.map { " (\($0.count) slot(s) left)" } ?? ""))
+            broadcast(.jobQueued, job: resumed)
+        }
+    }
+
+    /// Write to the job queue when `jobId` has a row there
+    private func persist(_ jobId: Int, _ body: (JobQueue, Int64) -> Void) {
+        guard let jobQueue = jobQueue, persistedJobIds.contains(jobId) else { return }
+        body(jobQueue, Int64(jobId))
+    }
+
+    private func capture(_ state: BatchOperationState, into job: inout ControlJob) {
+        job.total = state.totalCount
+        job.completed = state.completedSlots
+        job.failed = state.failedSlots.map { ControlJob.Failure(slot: $0.slot, error: $0.error) }
+        job.currentSlot = state.currentSlot > 0 ? state.currentSlot : nil
+        job.progress = state.progress
+        job.statusText = state.statusText
+        if job.kind == .imageAll {
+            job.transferredBytes = state.overallTransferredBytes
+            job.etaSeconds = state.overallETASeconds
+            job.etaMarginSeconds = state.overallETAMarginSeconds
+        }
+    }
+
+    private func pruneFinishedJobs() {
+        let finished = jobs.filter(\.isFinished)
+        guard finished.count > Self.finishedJobHistory else { return }
+        let drop = Set(finished.prefix(finished.count - Self.finishedJobHistory).map(\.id))
+        jobs.removeAll { drop.contains($0.id) }
+    }
+
+    // MARK: - Events
+
+    private func broadcast(_ kind: ControlEvent.Kind, job: ControlJob, slot: Int? = nil) {
+        guard !subscribers.isEmpty else { return }
+        let event = ControlEvent(kind: kind, job: job, slot: slot, at: Date())
+        guard let line = try? JSONEncoder.control.encode(ControlResponse(ok: true, event: event)) else { return }
+        for (key, channel) in subscribers where !channel.send(line) {
+            subscribers.removeValue(forKey: key)
+        }
+    }
+
+    // MARK: - Shutdown
+
+    /// Stop accepting jobs, cancel the running one and exit once it has wound down
+    private func beginShutdown() {
+        guard !isShuttingDown else { return }
+        isShuttingDown = true
+        print("Daemon: shutting down")
+
+        for jobId in pendingJobIds {
+            if let index = jobs.firstIndex(where: { $0.id == jobId }) {
+                jobs[index].state = .cancelled
+                jobs[index].finishedAt = Date()
+                broadcast(.jobFinished, job: jobs[index])
+            }
+        }
+        pendingJobIds.removeAll()
+
+        if let active = activeJob {
+            active.state.cancel()
+        } else {
+            terminate()
+        }
+    }
+
+    private func terminate() {
+        server.stop()
+        eventLog?.flush()
+        for channel in subscribers.values {
+            channel.close()
+        }
+        subscribers.removeAll()
+        exit(0)
+    }
+}
+
+private extension JobRecord.Kind {
+    init(_ kind: ControlJob.Kind) {
+        switch kind {
+        case .imageAll: self = .imageAll
+        case .scanUnknown: self = .scanUnknown
+        case .loadAll: self = .loadAll
+        }
+    }
+}
+
+private extension ControlJob.Kind {
+    init(_ kind: JobRecord.Kind) {
+        switch kind {
+        case .imageAll: self = .imageAll
+        case .scanUnknown: self = .scanUnknown
+        case .loadAll: self = .loadAll
+        }
+    }
+}
+
+private extension JobRecord.State {
+    init(_ state: ControlJob.State) {
+        switch state {
+        case .queued: self = .queued
+        case .running: self = .running
+        case .completed: self = .completed
+        case .cancelled: self = .cancelled
+        case .failed: self = .failed
+        }
+    }
+}
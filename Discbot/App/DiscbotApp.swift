@@ -14,6 +14,9 @@ import Combine
 final class AppSettings: ObservableObject {
     private enum Keys {
         static let mockChangerEnabled = "mockChangerEnabled"
+        static let mirrorDestinations = "mirrorDestinations"
+        static let imageWriteOptions = "imageWriteOptions"
+        static let verifyMode = "verifyMode"
     }
 
     @Published var mockChangerEnabled: Bool {
@@ -22,8 +25,37 @@ final class AppSettings: ObservableObject {
         }
     }
 
+    /// Written alongside the output folder by every Image All run
+    @Published var mirrorDestinations: [ImageDestination] {
+        didSet {
+            let data = try? JSONEncoder().encode(mirrorDestinations)
+            UserDefaults.standard.set(data, forKey: Keys.mirrorDestinations)
+        }
+    }
+
+    /// Cache bypass and sync policy for image files
+    @Published var imageWriteOptions: ImageWriteOptions {
+        didSet {
+            let data = try? JSONEncoder().encode(imageWriteOptions)
+            UserDefaults.standard.set(data, forKey: Keys.imageWriteOptions)
+        }
+    }
+
+    /// Read-back check of each image before its disc is ejected
+    @Published var verifyMode: ImageVerifyMode {
+        didSet {
+            UserDefaults.standard.set(verifyMode.rawValue, forKey: Keys.verifyMode)
+        }
+    }
+
     init() {
         self.mockChangerEnabled = UserDefaults.standard.bool(forKey: Keys.mockChangerEnabled)
+        self.mirrorDestinations = UserDefaults.standard.data(forKey: Keys.mirrorDestinations)
+            .flatMap { try? JSONDecoder().decode([ImageDestination].self, from: $0) } ?? []
+        self.imageWriteOptions = UserDefaults.standard.data(forKey: Keys.imageWriteOptions)
+            .flatMap { try? JSONDecoder().decode(ImageWriteOptions.self, from: $0) } ?? .standard
+        self.verifyMode = UserDefaults.standard.string(forKey: Keys.verifyMode)
+            .flatMap(ImageVerifyMode.init(rawValue:)) ?? .off
     }
 }
 
@@ -53,10 +85,98 @@ private struct SettingsView: View {
                     .foregroundColor(.secondary)
             }
 
+            Divider()
+
+            Text("Image Mirrors")
+                .font(.headline)
+
+            Text("Each image is also written to these destinations from the same read of the disc. A destination that cannot keep up catches up after the disc is ejected.")
+                .font(.caption)
+                .foregroundColor(.secondary)
+                .fixedSize(horizontal: false, vertical: true)
+
+            ForEach(Array(settings.mirrorDestinations.enumerated()), id: \.offset) { index, destination in
+                HStack {
+                    SFSymbol(name: destination.kind == .objectStore ? "shippingbox" : "folder", size: 13)
+                        .foregroundColor(.secondary)
+                    Text(destination.displayName)
+                        .lineLimit(1)
+                        .truncationMode(.middle)
+                    Spacer()
+                    Button("Remove") {
+                        settings.mirrorDestinations.remove(at: index)
+                    }
+                }
+            }
+
+            HStack {
+                Button("Add Folder…") {
+                    addMirror(.directory)
+                }
+                Button("Add Object Store…") {
+                    addMirror(.objectStore)
+                }
+            }
+            .disabled(viewModel.batchState?.isRunning == true)
+
+            Divider()
+
+            Text("Image Files")
+                .font(.headline)
+
+            Toggle(isOn: $settings.imageWriteOptions.bypassCache) {
+                VStack(alignment: .leading, spacing: 2) {
+                    Text("Bypass the file cache")
+                    Text("Data CDs and DVDs are written around the page cache, so imaging does not push other apps' data out of memory.")
+                        .font(.caption)
+                        .foregroundColor(.secondary)
+                        .fixedSize(horizontal: false, vertical: true)
+                }
+            }
+
+            Picker("Sync to disk:", selection: $settings.imageWriteOptions.durability) {
+                ForEach(ImageWriteOptions.Durability.allCases, id: \.self) { durability in
+                    Text(durability.displayName).tag(durability)
+                }
+            }
+            .frame(width: 360)
+            .disabled(viewModel.batchState?.isRunning == true)
+
+            Picker("Verify against disc:", selection: $settings.verifyMode) {
+                ForEach(ImageVerifyMode.allCases, id: \.self) { mode in
+                    Text(mode.displayName).tag(mode)
+                }
+            }
+            .frame(width: 360)
+            .disabled(viewModel.batchState?.isRunning == true)
+
+            Text("Data CDs and DVDs are read back before ejecting and the catalog records each image as verified or mismatched. A mismatched disc is imaged again at the end of the batch.")
+                .font(.caption)
+                .foregroundColor(.secondary)
+                .fixedSize(horizontal: false, vertical: true)
+
             Spacer()
         }
         .padding(20)
-        .frame(width: 520, height: 200)
+        .frame(width: 520, height: 580)
+    }
+
+    private func addMirror(_ kind: ImageDestination.Kind) {
+        let panel = NSOpenPanel()
+        panel.canChooseFiles = false
+        panel.canChooseDirectories = true
+        panel.canCreateDirectories = true
+        panel.allowsMultipleSelection = false
+        panel.prompt = "Add"
+        panel.message = kind == .objectStore
+            ? "Select the folder that stands in for the object store bucket"
+            : "Select a folder to mirror images to"
+
+        guard panel.runModal() == .OK, let url = panel.url else { return }
+        let destination = ImageDestination(kind: kind, url: url)
+        if !settings.mirrorDestinations.contains(destination) {
+            settings.mirrorDestinations.append(destination)
+        }
     }
 }
 
@@ -113,17 +233,24 @@ class AppDelegate: NSObject, NSApplicationDelegate, NSMenuItemValidation {
 
         setupMenuBar()
 
-        // Crash recovery: check if previous session left a disc in the drive
-        if let previousSlot = ChangerViewModel.checkDirtyFlag() {
-            ChangerViewModel.clearDirtyFlag()
+        // Crash recovery: check if previous session left a disc in the drive or a batch unfinished
+        let previousSlot = ChangerViewModel.checkDirtyFlag()
+        ChangerViewModel.clearDirtyFlag()
+        let interruptedJobs = JobQueue.shared.recoverInterruptedJobs().filter { $0.kind == .imageAll }
 
+        if previousSlot != nil || !interruptedJobs.isEmpty {
             crashRecoveryObserver = viewModel.$currentOperation
                 .dropFirst()
                 .filter { $0 == nil }
                 .first()
                 .receive(on: DispatchQueue.main)
                 .sink { [weak self] _ in
-                    self?.showCrashRecoveryAlert(previousSlot: previousSlot)
+                    guard let self = self else { return }
+                    // A resumed batch returns any disc in the drive to its slot itself
+                    if self.offerToResume(interruptedJobs) { return }
+                    if let previousSlot = previousSlot {
+                        self.showCrashRecoveryAlert(previousSlot: previousSlot)
+                    }
                 }
         }
     }
@@ -157,6 +284,11 @@ class AppDelegate: NSObject, NSApplicationDelegate, NSMenuItemValidation {
         return .terminateLater
     }
 
+    func applicationWillTerminate(_ notification: Notification) {
+        // Write out events still waiting for the next batch
+        EventLog.shared.flush()
+    }
+
     private func gracefulShutdown() {
         // Cancel any running operations
         viewModel.batchState?.cancel()
@@ -208,6 +340,41 @@ class AppDelegate: NSObject, NSApplicationDelegate, NSMenuItemValidation {
         }
     }
 
+    /// Reconcile interrupted Image All jobs with the inventory and offer to resume the newest.
+    /// Returns whether a job was resumed.
+    private func offerToResume(_ jobs: [JobRecord]) -> Bool {
+        guard viewModel.isConnected else { return false }
+
+        let resumable = jobs.compactMap { JobQueue.shared.reconcile($0, with: viewModel.slots) }
+        for job in resumable.reversed() {
+            let remaining = job.tasks.isEmpty ? nil : job.pendingSlotIds.count
+            let progress = remaining.map { "\(job.tasks.count - $0) of \(job.tasks.count) slot(s) were finished; \($0) remain." }
+                ?? "It had not started imaging yet."
+
+            let alert = NSAlert()
+            alert.icon = appIcon
+            alert.messageText = "Resume Interrupted Imaging?"
+            alert.informativeText = "Discbot was not shut down cleanly while imaging to \(job.outputDirectory ?? "an unknown folder"). \(progress)\n\nYou can resume with the remaining slots, or discard the job."
+            alert.alertStyle = .informational
+            alert.addButton(withTitle: "Resume")
+            alert.addButton(withTitle: "Discard")
+
+            let resume = alert.runModal() == .alertFirstButtonReturn
+            // The daemon may have picked it up while the alert was open
+            guard JobQueue.shared.claim(job) else { continue }
+            guard resume else {
+                JobQueue.shared.discardJob(job.id)
+                continue
+            }
+            // Any older jobs stay interrupted and are offered again next launch
+            if viewModel.resumeJob(job) { return true }
+            // Hand it back rather than hold a job nothing is running
+            JobQueue.shared.interruptJob(job.id)
+            return false
+        }
+        return false
+    }
+
     private var appIcon: NSImage? {
         if let url = Bundle.main.url(forResource: "AppIcon128", withExtension: "png"),
            let image = NSImage(contentsOf: url) {
@@ -396,7 +563,7 @@ class AppDelegate: NSObject, NSApplicationDelegate, NSMenuItemValidation {
                 .environmentObject(viewModel)
 
             let window = NSWindow(
-                contentRect: NSRect(x: 0, y: 0, width: 520, height: 200),
+                contentRect: NSRect(x: 0, y: 0, width: 520, height: 580),
                 styleMask: [.titled, .closable],
                 backing: .buffered,
                 defer: false
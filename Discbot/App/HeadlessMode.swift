@@ -0,0 +1,37 @@
+//
+//  HeadlessMode.swift
+//  Discbot
+//
+//  Command-line modes that run without the window server
+//
+
+import Foundation
+
+/// The modes that need neither AppKit nor a login session. The app's `main.swift` checks
+/// for them before starting the UI; the `discbot-headless` package executable runs only
+/// these, so they also build and run on Linux against the simulator.
+public enum HeadlessMode {
+    /// Run the mode `arguments` select. Never returns when there is one.
+    public static func runIfRequested(arguments: [String] = CommandLine.arguments) {
+        if let benchmarkOptions = BenchmarkRunner.Options(arguments: arguments) {
+            // Headless benchmark suite against the simulator; exits when done
+            let runner = BenchmarkRunner(options: benchmarkOptions)
+            runner.run()
+            dispatchMain()
+        } else if let daemonOptions = DaemonRunner.Options(arguments: arguments) {
+            #if DISCBOT_NO_HARDWARE
+            if daemonOptions.backend == .hardware {
+                FileHandle.standardError.write(Data("Built without changer support: use --simulate or --mock\n".utf8))
+                exit(64)
+            }
+            #endif
+            // Headless service with a control socket; no window server or login session needed
+            let daemon = DaemonRunner(options: daemonOptions)
+            daemon.run()
+            dispatchMain()
+        } else if let command = ControlCommand(arguments: arguments) {
+            // Client for a running daemon
+            exit(command.run())
+        }
+    }
+}
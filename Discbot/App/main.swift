@@ -8,6 +8,9 @@
 import AppKit
 import SwiftUI
 
+// The benchmark, the daemon and its client never return from here
+HeadlessMode.runIfRequested()
+
 // Create and run the application
 let app = NSApplication.shared
 let delegate = AppDelegate()
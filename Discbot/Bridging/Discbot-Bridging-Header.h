@@ -10,6 +10,12 @@
 
 #include "mchanger.h"
 #include "mount.h"
+#include "discid.h"
+#include "toc.h"
+#include "volinfo.h"
+#include "imagewriter.h"
+#include "isotree.h"
+#include "sha256.h"
 #include <sqlite3.h>
 
 #endif /* Discbot_Bridging_Header_h */
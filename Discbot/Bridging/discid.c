@@ -0,0 +1,210 @@
+/*
+ * discid.c - MusicBrainz and FreeDB/CDDB disc IDs from a CD table of contents
+ */
+
+#include "discid.h"
+#include <string.h>
+
+#define FRAMES_PER_SECOND   75u
+
+/* "%02X%02X%08X" + 99 x "%08X" */
+#define MB_HASH_INPUT_LEN   (2 + 2 + 8 + DISCID_MAX_TRACKS * 8)
+
+/* MARK: - SHA-1 */
+
+typedef struct {
+    uint32_t h[5];
+    uint64_t length;
+    uint8_t block[64];
+    size_t used;
+} sha1_t;
+
+static uint32_t rol32(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+static void sha1_init(sha1_t *s) {
+    s->h[0] = 0x67452301u;
+    s->h[1] = 0xEFCDAB89u;
+    s->h[2] = 0x98BADCFEu;
+    s->h[3] = 0x10325476u;
+    s->h[4] = 0xC3D2E1F0u;
+    s->length = 0;
+    s->used = 0;
+}
+
+static void sha1_block(sha1_t *s, const uint8_t *p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) |
+               ((uint32_t)p[i * 4 + 2] << 8) | (uint32_t)p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = s->h[0], b = s->h[1], c = s->h[2], d = s->h[3], e = s->h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999u;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1u;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDCu;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6u;
+        }
+        uint32_t t = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    s->h[0] += a;
+    s->h[1] += b;
+    s->h[2] += c;
+    s->h[3] += d;
+    s->h[4] += e;
+}
+
+static void sha1_update(sha1_t *s, const uint8_t *data, size_t len) {
+    s->length += len;
+    while (len > 0) {
+        size_t take = 64 - s->used;
+        if (take > len) take = len;
+        memcpy(s->block + s->used, data, take);
+        s->used += take;
+        data += take;
+        len -= take;
+        if (s->used == 64) {
+            sha1_block(s, s->block);
+            s->used = 0;
+        }
+    }
+}
+
+static void sha1_final(sha1_t *s, uint8_t digest[20]) {
+    uint64_t bits = s->length * 8;
+    uint8_t pad = 0x80;
+    sha1_update(s, &pad, 1);
+    pad = 0;
+    while (s->used != 56) {
+        sha1_update(s, &pad, 1);
+    }
+    uint8_t len_be[8];
+    for (int i = 0; i < 8; i++) {
+        len_be[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha1_update(s, len_be, 8);
+
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = (uint8_t)(s->h[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(s->h[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(s->h[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)s->h[i];
+    }
+}
+
+/* MARK: - Encoding */
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/* Write value as `digits` uppercase hex characters. */
+static char *put_hex(char *out, uint32_t value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        out[i] = hex_digits[value & 0xF];
+        value >>= 4;
+    }
+    return out + digits;
+}
+
+/* Base64 with MusicBrainz's URL-safe substitutions: '.' for '+', '_' for '/', '-' for '='. */
+static void encode_mb_base64(const uint8_t digest[20], char out[DISCID_MB_SIZE]) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._";
+    char *p = out;
+    for (int i = 0; i < 20; i += 3) {
+        uint32_t chunk = (uint32_t)digest[i] << 16;
+        int remaining = 20 - i;
+        if (remaining > 1) chunk |= (uint32_t)digest[i + 1] << 8;
+        if (remaining > 2) chunk |= digest[i + 2];
+
+        *p++ = alphabet[(chunk >> 18) & 0x3F];
+        *p++ = alphabet[(chunk >> 12) & 0x3F];
+        *p++ = remaining > 1 ? alphabet[(chunk >> 6) & 0x3F] : '-';
+        *p++ = remaining > 2 ? alphabet[chunk & 0x3F] : '-';
+    }
+    *p = '\0';
+}
+
+/* Sum of the decimal digits of n (the FreeDB per-track checksum). */
+static uint32_t digit_sum(uint32_t n) {
+    uint32_t sum = 0;
+    while (n > 0) {
+        sum += n % 10;
+        n /= 10;
+    }
+    return sum;
+}
+
+/* MARK: - Public API */
+
+int discid_compute(int first_track,
+                   int last_track,
+                   uint32_t leadout_offset,
+                   const uint32_t *track_offsets,
+                   int track_count,
+                   char mb_id[DISCID_MB_SIZE],
+                   char freedb_id[DISCID_FREEDB_SIZE]) {
+    if (!track_offsets || first_track < 1 || last_track > DISCID_MAX_TRACKS ||
+        last_track < first_track || track_count != last_track - first_track + 1) {
+        return -1;
+    }
+    for (int i = 0; i < track_count; i++) {
+        uint32_t next = i + 1 < track_count ? track_offsets[i + 1] : leadout_offset;
+        if (track_offsets[i] >= next) return -1;
+    }
+
+    if (mb_id) {
+        /* Lead-out in slot 0, then tracks 1..99 by track number, zero-padded. */
+        char input[MB_HASH_INPUT_LEN];
+        char *p = input;
+        p = put_hex(p, (uint32_t)first_track, 2);
+        p = put_hex(p, (uint32_t)last_track, 2);
+        p = put_hex(p, leadout_offset, 8);
+        for (int number = 1; number <= DISCID_MAX_TRACKS; number++) {
+            int index = number - first_track;
+            uint32_t offset = (index >= 0 && index < track_count) ? track_offsets[index] : 0;
+            p = put_hex(p, offset, 8);
+        }
+
+        sha1_t sha;
+        uint8_t digest[20];
+        sha1_init(&sha);
+        sha1_update(&sha, (const uint8_t *)input, sizeof(input));
+        sha1_final(&sha, digest);
+        encode_mb_base64(digest, mb_id);
+    }
+
+    if (freedb_id) {
+        uint32_t checksum = 0;
+        for (int i = 0; i < track_count; i++) {
+            checksum += digit_sum(track_offsets[i] / FRAMES_PER_SECOND);
+        }
+        uint32_t length = leadout_offset / FRAMES_PER_SECOND - track_offsets[0] / FRAMES_PER_SECOND;
+        uint32_t id = ((checksum % 255) << 24) | (length << 8) | (uint32_t)track_count;
+        char *end = put_hex(freedb_id, id, 8);
+        *end = '\0';
+        /* FreeDB IDs are conventionally lowercase */
+        for (int i = 0; i < 8; i++) {
+            if (freedb_id[i] >= 'A' && freedb_id[i] <= 'F') freedb_id[i] = (char)(freedb_id[i] - 'A' + 'a');
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * discid.h - MusicBrainz and FreeDB/CDDB disc IDs from a CD table of contents
+ *
+ * Both IDs are computed in one pass with no heap allocation: the SHA-1
+ * input is formatted into a fixed stack buffer, hashed with a built-in
+ * SHA-1, and base64-encoded straight into the MusicBrainz alphabet.
+ * Portable C with no platform dependencies.
+ */
+
+#ifndef DISCID_H
+#define DISCID_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISCID_MAX_TRACKS   99
+#define DISCID_MB_SIZE      29      /* 28 characters + NUL */
+#define DISCID_FREEDB_SIZE  9       /* 8 hex digits + NUL */
+
+/*
+ * Compute both disc IDs.
+ *
+ * Offsets are absolute frame addresses (LBA + 150, the two-second lead-in),
+ * as MusicBrainz defines them. track_offsets[i] is the start of track
+ * first_track + i; track_count must equal last_track - first_track + 1.
+ * Either output may be NULL.
+ *
+ * Returns 0 on success, -1 if the TOC is not a valid audio TOC.
+ */
+int discid_compute(int first_track,
+                   int last_track,
+                   uint32_t leadout_offset,
+                   const uint32_t *track_offsets,
+                   int track_count,
+                   char mb_id[DISCID_MB_SIZE],
+                   char freedb_id[DISCID_FREEDB_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISCID_H */
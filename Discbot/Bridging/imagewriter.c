@@ -0,0 +1,237 @@
+/*
+ * imagewriter.c - Preallocated, cache-bypassing image file writer
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE     /* O_DIRECT */
+#endif
+
+#include "imagewriter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Direct I/O needs buffer addresses, lengths and file offsets aligned to the device block */
+#define WRITE_ALIGNMENT     4096u
+#define DEFAULT_BUFFER_SIZE (1u << 20)
+
+struct imagewriter {
+    int fd;
+    char *path;
+    char *temp_path;
+    imagewriter_options_t options;
+    bool direct;            /* O_DIRECT: every write must be aligned */
+    bool failed;
+    bool committed;
+
+    uint8_t *buffer;        /* WRITE_ALIGNMENT-aligned staging buffer */
+    size_t buffer_size;
+    size_t buffered;
+    uint64_t flushed;       /* Bytes on disk; always a multiple of buffer_size until commit */
+};
+
+/* MARK: - Platform helpers */
+
+/* Reserve size bytes of disk, contiguously if the volume can, without changing the file length. */
+static void preallocate(int fd, uint64_t size) {
+    if (size == 0) return;
+#if defined(__APPLE__)
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        (void)fcntl(fd, F_PREALLOCATE, &store);
+    }
+#elif defined(__linux__)
+    (void)fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)size);
+#else
+    (void)fd;
+#endif
+}
+
+/* Full sync: on macOS fsync only reaches the drive's cache, F_FULLFSYNC reaches the platter. */
+static int full_sync(int fd) {
+#if defined(__APPLE__)
+    if (fcntl(fd, F_FULLFSYNC) == 0) return 0;
+#endif
+    return fsync(fd);
+}
+
+static int open_temp(imagewriter_t *writer) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+    if (writer->options.bypass_cache) {
+        int fd = open(writer->temp_path, flags | O_DIRECT, 0644);
+        if (fd >= 0) {
+            writer->direct = true;
+            return fd;
+        }
+        if (errno != EINVAL) return -1;
+        /* Volume without direct I/O support: fall through to a buffered file */
+    }
+#endif
+    int fd = open(writer->temp_path, flags, 0644);
+#if defined(__APPLE__)
+    if (fd >= 0 && writer->options.bypass_cache) {
+        (void)fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+    return fd;
+}
+
+/* Sync the directory holding path so a rename into it survives a crash. */
+static void sync_parent(const char *path) {
+    char *copy = strdup(path);
+    if (!copy) return;
+    int fd = open(dirname(copy), O_RDONLY);
+    if (fd >= 0) {
+        (void)fsync(fd);
+        close(fd);
+    }
+    free(copy);
+}
+
+/* MARK: - Writing */
+
+static int write_all(imagewriter_t *writer, const uint8_t *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(writer->fd, buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/* Write the staging buffer out. A partial buffer is only flushed at commit. */
+static int flush_buffer(imagewriter_t *writer, bool final) {
+    if (writer->buffered == 0) return 0;
+
+    size_t len = writer->buffered;
+    if (writer->direct && final) {
+        /* Pad the tail to the alignment; commit trims the file back afterwards */
+        size_t padded = (len + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+        memset(writer->buffer + len, 0, padded - len);
+        len = padded;
+    }
+    if (write_all(writer, writer->buffer, len, writer->flushed) != 0) return -1;
+
+    writer->flushed += writer->buffered;
+    writer->buffered = 0;
+    if (!final && writer->options.sync == IMAGEWRITER_SYNC_PER_CHUNK && fsync(writer->fd) != 0) return -1;
+    return 0;
+}
+
+/* MARK: - Public API */
+
+void imagewriter_default_options(imagewriter_options_t *options) {
+    memset(options, 0, sizeof(*options));
+    options->buffer_size = DEFAULT_BUFFER_SIZE;
+    options->sync = IMAGEWRITER_SYNC_AT_END;
+    options->bypass_cache = true;
+}
+
+imagewriter_t *imagewriter_open(const char *path, const imagewriter_options_t *options) {
+    imagewriter_t *writer = calloc(1, sizeof(*writer));
+    if (!writer) return NULL;
+    writer->fd = -1;
+
+    if (options) {
+        writer->options = *options;
+    } else {
+        imagewriter_default_options(&writer->options);
+    }
+    size_t size = writer->options.buffer_size ? writer->options.buffer_size : DEFAULT_BUFFER_SIZE;
+    writer->buffer_size = (size + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+
+    size_t path_len = strlen(path);
+    writer->path = strdup(path);
+    writer->temp_path = malloc(path_len + sizeof(".part"));
+    void *buffer = NULL;
+    if (!writer->path || !writer->temp_path
+        || posix_memalign(&buffer, WRITE_ALIGNMENT, writer->buffer_size) != 0) {
+        imagewriter_close(writer);
+        errno = ENOMEM;
+        return NULL;
+    }
+    writer->buffer = buffer;
+    memcpy(writer->temp_path, path, path_len);
+    memcpy(writer->temp_path + path_len, ".part", sizeof(".part"));
+
+    writer->fd = open_temp(writer);
+    if (writer->fd < 0) {
+        int saved = errno;
+        imagewriter_close(writer);
+        errno = saved;
+        return NULL;
+    }
+    preallocate(writer->fd, writer->options.expected_size);
+    return writer;
+}
+
+int imagewriter_write(imagewriter_t *writer, const void *buf, size_t len) {
+    if (writer->failed || writer->committed) {
+        errno = EBADF;
+        return -1;
+    }
+    const uint8_t *src = buf;
+    while (len > 0) {
+        size_t room = writer->buffer_size - writer->buffered;
+        size_t n = len < room ? len : room;
+        memcpy(writer->buffer + writer->buffered, src, n);
+        writer->buffered += n;
+        src += n;
+        len -= n;
+
+        if (writer->buffered == writer->buffer_size && flush_buffer(writer, false) != 0) {
+            writer->failed = true;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+uint64_t imagewriter_bytes_written(const imagewriter_t *writer) {
+    return writer->flushed + writer->buffered;
+}
+
+int imagewriter_commit(imagewriter_t *writer) {
+    if (writer->failed || writer->committed) {
+        errno = EBADF;
+        return -1;
+    }
+    /* Trimming also releases preallocation beyond an over-estimated size */
+    if (flush_buffer(writer, true) != 0
+        || ftruncate(writer->fd, (off_t)writer->flushed) != 0
+        || (writer->options.sync != IMAGEWRITER_SYNC_NONE && full_sync(writer->fd) != 0)
+        || rename(writer->temp_path, writer->path) != 0) {
+        writer->failed = true;
+        return -1;
+    }
+    writer->committed = true;
+    if (writer->options.sync != IMAGEWRITER_SYNC_NONE) {
+        sync_parent(writer->path);
+    }
+    return 0;
+}
+
+void imagewriter_close(imagewriter_t *writer) {
+    if (!writer) return;
+    if (writer->fd >= 0) {
+        close(writer->fd);
+        if (!writer->committed) {
+            unlink(writer->temp_path);
+        }
+    }
+    free(writer->buffer);
+    free(writer->temp_path);
+    free(writer->path);
+    free(writer);
+}
@@ -0,0 +1,19 @@
+/*
+ * CDiscbot.h - The portable C in Discbot/Bridging, as one module for the Swift package
+ *
+ * The package's counterpart to Discbot-Bridging-Header.h. mchanger and mount.c
+ * are left out: they need IOKit and DiskArbitration, which only the app links.
+ */
+
+#ifndef CDISCBOT_H
+#define CDISCBOT_H
+
+#include "../discid.h"
+#include "../toc.h"
+#include "../volinfo.h"
+#include "../imagewriter.h"
+#include "../isotree.h"
+#include "../sha256.h"
+#include <sqlite3.h>
+
+#endif /* CDISCBOT_H */
@@ -0,0 +1,764 @@
+/*
+ * isotree.c - File tree of an ISO 9660 / Joliet / UDF image without mounting
+ */
+
+#include "isotree.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECTOR_SIZE         2048u
+#define VDS_FIRST_SECTOR    16u
+#define VDS_MAX_SECTORS     64u
+#define UDF_AVDP_SECTOR     256u
+#define MAX_DEPTH           64
+#define MAX_DIRECTORIES     65536u
+#define MAX_DIRECTORY_BYTES (64u << 20)
+#define UDF_MAX_PARTITIONS  8
+
+typedef struct {
+    volinfo_read_fn read_fn;
+    void *ctx;
+} reader_t;
+
+/* UDF logical-to-physical mapping for one partition map entry */
+typedef struct {
+    uint32_t start;                     /* Physical sector of the partition */
+    isotree_extent_t *meta;             /* Metadata partition: extents of the metadata file, else NULL */
+    uint32_t meta_count;
+} udf_partition_t;
+
+typedef struct {
+    const reader_t *rd;
+    isotree_file_fn fn;
+    void *ctx;
+    bool stopped;
+    unsigned directories;
+    uint64_t ancestors[MAX_DEPTH + 1];  /* Byte offset of each directory on the current path */
+
+    char path[ISOTREE_PATH_MAX];
+    isotree_extent_t *extents;
+    uint32_t extent_count;
+    uint32_t extent_cap;
+
+    /* ISO 9660 */
+    uint32_t block_size;
+    bool joliet;
+    bool rock_ridge;
+
+    /* UDF */
+    uint32_t udf_block_size;
+    udf_partition_t partitions[UDF_MAX_PARTITIONS];
+    uint32_t partition_count;
+} walker_t;
+
+/* MARK: - Byte helpers */
+
+static uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t le32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint64_t le64(const uint8_t *p) { return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32); }
+static uint16_t be16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+/* Read len bytes at an arbitrary offset into a new buffer, via the covering sector-aligned span. */
+static uint8_t *read_alloc(const reader_t *rd, uint64_t offset, size_t len) {
+    uint64_t start = offset - (offset % SECTOR_SIZE);
+    uint64_t end = offset + len;
+    size_t span = (size_t)(((end + SECTOR_SIZE - 1) / SECTOR_SIZE) * SECTOR_SIZE - start);
+
+    uint8_t *buf = malloc(span ? span : SECTOR_SIZE);
+    if (!buf) return NULL;
+    long got = rd->read_fn(rd->ctx, start, buf, span);
+    if (got < 0 || (uint64_t)got < (offset - start) + len) {
+        free(buf);
+        return NULL;
+    }
+    if (offset != start) memmove(buf, buf + (offset - start), len);
+    return buf;
+}
+
+/* Days since 1970-01-01 of a proleptic Gregorian date */
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static int64_t unix_time(int64_t year, unsigned month, unsigned day, unsigned hour, unsigned minute, unsigned second, int64_t utc_offset_minutes) {
+    if (month < 1 || month > 12 || day < 1 || day > 31) return 0;
+    return days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - utc_offset_minutes * 60;
+}
+
+/* MARK: - Text decoding */
+
+static size_t put_utf8(char *dst, size_t cap, size_t pos, uint32_t cp) {
+    char tmp[4];
+    size_t n;
+    if (cp == '/') cp = ':';            /* Keep names from splitting paths, as the Finder shows them */
+    if (cp < 0x80) {
+        tmp[0] = (char)cp; n = 1;
+    } else if (cp < 0x800) {
+        tmp[0] = (char)(0xC0 | (cp >> 6));
+        tmp[1] = (char)(0x80 | (cp & 0x3F)); n = 2;
+    } else if (cp < 0x10000) {
+        tmp[0] = (char)(0xE0 | (cp >> 12));
+        tmp[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        tmp[2] = (char)(0x80 | (cp & 0x3F)); n = 3;
+    } else {
+        tmp[0] = (char)(0xF0 | (cp >> 18));
+        tmp[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        tmp[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        tmp[3] = (char)(0x80 | (cp & 0x3F)); n = 4;
+    }
+    if (pos + n >= cap) return pos;     /* Drop characters that do not fit whole */
+    memcpy(dst + pos, tmp, n);
+    return pos + n;
+}
+
+static size_t decode_latin1(char *dst, size_t cap, const uint8_t *src, size_t len) {
+    size_t pos = 0;
+    for (size_t i = 0; i < len && src[i] != 0; i++) {
+        pos = put_utf8(dst, cap, pos, src[i]);
+    }
+    dst[pos] = '\0';
+    return pos;
+}
+
+static size_t decode_utf16be(char *dst, size_t cap, const uint8_t *src, size_t len) {
+    size_t pos = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        uint32_t cp = be16(src + i);
+        if (cp == 0) break;
+        if (cp >= 0xD800 && cp < 0xDC00 && i + 3 < len) {
+            uint32_t lo = be16(src + i + 2);
+            if (lo >= 0xDC00 && lo < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                i += 2;
+            }
+        }
+        pos = put_utf8(dst, cap, pos, cp);
+    }
+    dst[pos] = '\0';
+    return pos;
+}
+
+/* Drop the ";1" version suffix and the trailing dot of extensionless ISO 9660 names */
+static void strip_iso_version(char *name) {
+    char *semicolon = strrchr(name, ';');
+    if (semicolon) *semicolon = '\0';
+    size_t len = strlen(name);
+    if (len > 1 && name[len - 1] == '.') name[len - 1] = '\0';
+}
+
+/* MARK: - Walker */
+
+/* Append "/name" (or "name" at the root) to the path; returns the old length to restore, or -1 if too long. */
+static long push_name(walker_t *w, const char *name) {
+    size_t old = strlen(w->path);
+    size_t name_len = strlen(name);
+    size_t sep = old ? 1 : 0;
+    if (name_len == 0 || old + sep + name_len >= sizeof(w->path)) return -1;
+    if (sep) w->path[old] = '/';
+    memcpy(w->path + old + sep, name, name_len + 1);
+    return (long)old;
+}
+
+static void pop_name(walker_t *w, long old) {
+    w->path[old] = '\0';
+}
+
+static bool add_extent(walker_t *w, uint64_t offset, uint64_t length) {
+    if (length == 0) return true;
+    /* Contiguous runs (as multi-extent ISO files usually are) merge into one */
+    if (w->extent_count > 0) {
+        isotree_extent_t *last = &w->extents[w->extent_count - 1];
+        if (last->offset + last->length == offset) {
+            last->length += length;
+            return true;
+        }
+    }
+    if (w->extent_count == w->extent_cap) {
+        uint32_t cap = w->extent_cap ? w->extent_cap * 2 : 8;
+        isotree_extent_t *grown = realloc(w->extents, cap * sizeof(*grown));
+        if (!grown) return false;
+        w->extents = grown;
+        w->extent_cap = cap;
+    }
+    w->extents[w->extent_count++] = (isotree_extent_t){ offset, length };
+    return true;
+}
+
+/* Count a directory about to be walked at depth; false if it is too deep, too many, or one of its own ancestors */
+static bool enter_directory(walker_t *w, uint64_t offset, int depth) {
+    if (w->stopped || depth > MAX_DEPTH || ++w->directories > MAX_DIRECTORIES) return false;
+    for (int i = 0; i < depth; i++) {
+        if (w->ancestors[i] == offset) return false;
+    }
+    w->ancestors[depth] = offset;
+    return true;
+}
+
+static void emit_file(walker_t *w, uint64_t size, int64_t modified) {
+    if (w->stopped) return;
+    isotree_file_t file = { w->path, size, modified, w->extent_count, w->extents };
+    if (w->fn(w->ctx, &file) != 0) w->stopped = true;
+}
+
+/* MARK: - ISO 9660 / Joliet / Rock Ridge */
+
+static int64_t iso_record_time(const uint8_t *t) {
+    if (t[1] == 0) return 0;
+    return unix_time(1900 + t[0], t[1], t[2], t[3], t[4], t[5], (int64_t)(int8_t)t[6] * 15);
+}
+
+static size_t iso_system_use_start(const uint8_t *rec) {
+    uint8_t name_len = rec[32];
+    return 33u + name_len + (name_len % 2 == 0 ? 1u : 0u);
+}
+
+/*
+ * Rock Ridge name of a directory record. Returns 1 with name set, 0 if the
+ * record has none, -1 if the record is a relocated directory to skip (it is
+ * walked through its placeholder instead). A placeholder's CL entry sets
+ * *relocated to the LBA of the directory it stands for.
+ */
+static int rock_ridge_name(const uint8_t *rec, size_t rec_len, char *name, size_t cap, uint32_t *relocated) {
+    size_t off = iso_system_use_start(rec);
+    size_t pos = 0;
+    bool found = false, name_done = false;
+
+    while (off + 4 <= rec_len) {
+        const uint8_t *entry = rec + off;
+        uint8_t len = entry[2];
+        if (len < 4 || off + len > rec_len) break;
+
+        if (entry[0] == 'R' && entry[1] == 'E') return -1;
+        if (entry[0] == 'S' && entry[1] == 'T') break;
+        if (entry[0] == 'C' && entry[1] == 'L' && len >= 12) {
+            *relocated = le32(entry + 4);
+        }
+        if (entry[0] == 'N' && entry[1] == 'M' && len >= 5 && !name_done) {
+            uint8_t flags = entry[4];
+            if (flags & 0x06) return 0;     /* "." or ".." */
+            for (size_t i = 5; i < len && pos + 1 < cap; i++) {
+                name[pos++] = entry[i] == '/' ? ':' : (char)entry[i];
+            }
+            found = true;
+            name_done = !(flags & 0x01);    /* No continuation */
+        }
+        off += len;
+    }
+    name[pos] = '\0';
+    return found && pos > 0 ? 1 : 0;
+}
+
+static bool iso_name(const walker_t *w, const uint8_t *rec, size_t rec_len, char *name, size_t cap, uint32_t *relocated) {
+    *relocated = 0;
+    if (w->rock_ridge) {
+        int rr = rock_ridge_name(rec, rec_len, name, cap, relocated);
+        if (rr < 0) return false;
+        if (rr > 0) return true;
+    }
+    uint8_t name_len = rec[32];
+    if (w->joliet) {
+        decode_utf16be(name, cap, rec + 33, name_len);
+    } else {
+        decode_latin1(name, cap, rec + 33, name_len);
+    }
+    strip_iso_version(name);
+    return name[0] != '\0';
+}
+
+static void iso_flush_file(walker_t *w, char *pending, uint64_t size, int64_t modified) {
+    if (!pending[0]) return;
+    long old = push_name(w, pending);
+    if (old >= 0) {
+        emit_file(w, size, modified);
+        pop_name(w, old);
+    }
+    pending[0] = '\0';
+    w->extent_count = 0;
+}
+
+/* Data length of the directory at lba, from its own "." record */
+static bool iso_directory_size(const walker_t *w, uint32_t lba, uint32_t *size) {
+    uint8_t *dir = read_alloc(w->rd, (uint64_t)lba * w->block_size, SECTOR_SIZE);
+    if (!dir) return false;
+    bool valid = dir[0] >= 34 && dir[32] == 1 && dir[33] == 0 && (dir[25] & 0x02) && le32(dir + 2) == lba;
+    *size = le32(dir + 10);
+    free(dir);
+    return valid;
+}
+
+static void iso_walk_directory(walker_t *w, uint32_t lba, uint32_t size, int depth) {
+    if (!enter_directory(w, (uint64_t)lba * w->block_size, depth)) return;
+    if (size == 0 || size > MAX_DIRECTORY_BYTES) return;
+
+    uint8_t *dir = read_alloc(w->rd, (uint64_t)lba * w->block_size, size);
+    if (!dir) return;
+
+    /* A file recorded in several extents appears as consecutive records with the same name */
+    char pending[1024] = "";
+    uint64_t pending_size = 0;
+    int64_t pending_time = 0;
+    char name[1024];
+
+    size_t pos = 0;
+    while (pos < size && !w->stopped) {
+        uint8_t rec_len = dir[pos];
+        if (rec_len == 0) {
+            /* Records never cross a sector boundary; the rest of this sector is padding */
+            pos = (pos / SECTOR_SIZE + 1) * SECTOR_SIZE;
+            continue;
+        }
+        if (rec_len < 34 || pos + rec_len > size) break;
+        const uint8_t *rec = dir + pos;
+        pos += rec_len;
+
+        uint8_t name_len = rec[32];
+        if (33u + name_len > rec_len) continue;
+        if (name_len == 1 && (rec[33] == 0 || rec[33] == 1)) continue;     /* "." and ".." */
+
+        uint8_t flags = rec[25];
+        if (flags & 0x04) continue;         /* Associated (resource fork) file */
+        uint32_t relocated;
+        if (!iso_name(w, rec, rec_len, name, sizeof(name), &relocated)) continue;
+
+        uint32_t extent = le32(rec + 2);
+        uint32_t data_len = le32(rec + 10);
+        if (relocated) {
+            /* Rock Ridge moves directories nested past 8 levels and leaves a CL placeholder file here */
+            if (!iso_directory_size(w, relocated, &data_len)) continue;
+            extent = relocated;
+            flags |= 0x02;
+        }
+
+        if (flags & 0x02) {
+            iso_flush_file(w, pending, pending_size, pending_time);
+            long old = push_name(w, name);
+            if (old < 0) continue;
+            iso_walk_directory(w, extent, data_len, depth + 1);
+            pop_name(w, old);
+            continue;
+        }
+
+        if (!pending[0] || strcmp(pending, name) != 0) {
+            iso_flush_file(w, pending, pending_size, pending_time);
+            strncpy(pending, name, sizeof(pending) - 1);
+            pending[sizeof(pending) - 1] = '\0';
+            pending_size = 0;
+            pending_time = iso_record_time(rec + 18);
+        }
+        add_extent(w, (uint64_t)extent * w->block_size, data_len);
+        pending_size += data_len;
+        if (!(flags & 0x80)) {
+            iso_flush_file(w, pending, pending_size, pending_time);
+        }
+    }
+    iso_flush_file(w, pending, pending_size, pending_time);
+    free(dir);
+}
+
+static bool is_joliet_escape(const uint8_t *esc) {
+    return esc[0] == '%' && esc[1] == '/' && (esc[2] == '@' || esc[2] == 'C' || esc[2] == 'E');
+}
+
+/* Rock Ridge is announced by an "SP" entry in the root's "." record */
+static bool has_rock_ridge(const walker_t *w, const uint8_t *root_record) {
+    uint8_t *dir = read_alloc(w->rd, (uint64_t)le32(root_record + 2) * w->block_size, SECTOR_SIZE);
+    if (!dir) return false;
+    bool found = false;
+    uint8_t rec_len = dir[0];
+    if (rec_len >= 34 && dir[32] == 1 && dir[33] == 0) {
+        size_t off = iso_system_use_start(dir);
+        found = off + 7 <= rec_len && dir[off] == 'S' && dir[off + 1] == 'P' && dir[off + 4] == 0xBE && dir[off + 5] == 0xEF;
+    }
+    free(dir);
+    return found;
+}
+
+static uint32_t walk_iso9660(walker_t *w) {
+    uint8_t primary_root[34], joliet_root[34];
+    bool has_primary = false, has_joliet = false;
+    uint32_t primary_block = SECTOR_SIZE, joliet_block = SECTOR_SIZE;
+
+    for (uint32_t lba = VDS_FIRST_SECTOR; lba < VDS_FIRST_SECTOR + VDS_MAX_SECTORS; lba++) {
+        uint8_t *sector = read_alloc(w->rd, (uint64_t)lba * SECTOR_SIZE, SECTOR_SIZE);
+        if (!sector) break;
+        bool done = memcmp(sector + 1, "CD001", 5) != 0 || sector[0] == 255;
+        if (!done && sector[0] == 1 && !has_primary) {
+            memcpy(primary_root, sector + 156, sizeof(primary_root));
+            primary_block = le16(sector + 128);
+            has_primary = true;
+        } else if (!done && sector[0] == 2 && is_joliet_escape(sector + 88) && !has_joliet) {
+            memcpy(joliet_root, sector + 156, sizeof(joliet_root));
+            joliet_block = le16(sector + 128);
+            has_joliet = true;
+        }
+        free(sector);
+        if (done) break;
+    }
+    if (!has_primary) return 0;
+
+    w->block_size = primary_block ? primary_block : SECTOR_SIZE;
+    w->rock_ridge = has_rock_ridge(w, primary_root);
+    const uint8_t *root = primary_root;
+    uint32_t result = VOLINFO_FS_ISO9660;
+    if (!w->rock_ridge && has_joliet) {
+        w->joliet = true;
+        w->block_size = joliet_block ? joliet_block : SECTOR_SIZE;
+        root = joliet_root;
+        result = VOLINFO_FS_JOLIET;
+    }
+    iso_walk_directory(w, le32(root + 2), le32(root + 10), 0);
+    return result;
+}
+
+/* MARK: - UDF */
+
+static bool udf_tag_valid(const uint8_t *tag, uint16_t expected_id) {
+    if (le16(tag) != expected_id) return false;
+    uint8_t sum = 0;
+    for (int i = 0; i < 16; i++) {
+        if (i != 4) sum = (uint8_t)(sum + tag[i]);
+    }
+    return sum == tag[4];
+}
+
+static int64_t udf_time(const uint8_t *t) {
+    uint16_t type_tz = le16(t);
+    int16_t tz = (int16_t)((type_tz & 0x0FFF) << 4) >> 4;     /* Signed 12-bit minutes */
+    if (tz == -2047) tz = 0;                                    /* Unspecified */
+    return unix_time(le16(t + 2), t[4], t[5], t[6], t[7], t[8], tz);
+}
+
+/* OSTA CS0: a compression ID byte (8 or 16) followed by the characters */
+static void udf_name(char *dst, size_t cap, const uint8_t *src, size_t len) {
+    dst[0] = '\0';
+    if (len < 2) return;
+    if (src[0] == 8) {
+        decode_latin1(dst, cap, src + 1, len - 1);
+    } else if (src[0] == 16) {
+        decode_utf16be(dst, cap, src + 1, len - 1);
+    }
+}
+
+/* Byte offset of logical block lbn of partition reference part, or UINT64_MAX */
+static uint64_t udf_offset(const walker_t *w, uint16_t part, uint32_t lbn) {
+    if (part >= w->partition_count) return UINT64_MAX;
+    const udf_partition_t *p = &w->partitions[part];
+    if (!p->meta) {
+        return ((uint64_t)p->start + lbn) * w->udf_block_size;
+    }
+    /* Metadata partition: lbn indexes the metadata file's data */
+    uint64_t want = (uint64_t)lbn * w->udf_block_size;
+    for (uint32_t i = 0; i < p->meta_count; i++) {
+        if (want < p->meta[i].length) return p->meta[i].offset + want;
+        want -= p->meta[i].length;
+    }
+    return UINT64_MAX;
+}
+
+typedef struct {
+    uint8_t file_type;
+    uint64_t size;
+    int64_t modified;
+    bool complete;                      /* Every byte is in a recorded extent */
+} udf_entry_t;
+
+/*
+ * Read the (extended) file entry at part/lbn, leaving its data extents in
+ * w->extents. Holes, extended allocation descriptors and continuation
+ * extents are not supported; such files come back with complete = false.
+ */
+static bool udf_read_entry(walker_t *w, uint16_t part, uint32_t lbn, udf_entry_t *entry) {
+    uint64_t fe_offset = udf_offset(w, part, lbn);
+    if (fe_offset == UINT64_MAX) return false;
+    uint8_t *fe = read_alloc(w->rd, fe_offset, w->udf_block_size);
+    if (!fe) return false;
+
+    bool extended = udf_tag_valid(fe, 266);
+    if (!extended && !udf_tag_valid(fe, 261)) {
+        free(fe);
+        return false;
+    }
+
+    entry->file_type = fe[16 + 11];
+    entry->size = le64(fe + 56);
+    entry->modified = udf_time(fe + (extended ? 92 : 84));
+    entry->complete = true;
+
+    uint32_t l_ea = le32(fe + (extended ? 208 : 168));
+    uint32_t l_ad = le32(fe + (extended ? 212 : 172));
+    uint32_t ad_start = (extended ? 216 : 176) + l_ea;
+    if (ad_start > w->udf_block_size || l_ad > w->udf_block_size - ad_start) {
+        free(fe);
+        return false;
+    }
+
+    w->extent_count = 0;
+    uint64_t remaining = entry->size;
+    const uint8_t *ads = fe + ad_start;
+    switch (le16(fe + 16 + 18) & 0x07) {
+    case 0:     /* short_ad: same partition as the entry */
+    case 1: {   /* long_ad */
+        bool is_long = (le16(fe + 16 + 18) & 0x07) == 1;
+        size_t ad_size = is_long ? 16 : 8;
+        for (size_t off = 0; off + ad_size <= l_ad && remaining > 0; off += ad_size) {
+            uint32_t raw = le32(ads + off);
+            uint32_t length = raw & 0x3FFFFFFF;
+            uint32_t type = raw >> 30;
+            if (length == 0) break;
+            if (type != 0) {
+                entry->complete = false;
+                break;
+            }
+            uint16_t ad_part = is_long ? le16(ads + off + 8) : part;
+            uint64_t offset = udf_offset(w, ad_part, le32(ads + off + 4));
+            if (offset == UINT64_MAX) {
+                entry->complete = false;
+                break;
+            }
+            uint64_t used = length < remaining ? length : remaining;
+            add_extent(w, offset, used);
+            remaining -= used;
+        }
+        break;
+    }
+    case 3:     /* Data embedded in the entry itself */
+        if (entry->size <= l_ad) {
+            add_extent(w, fe_offset + ad_start, entry->size);
+            remaining = 0;
+        }
+        break;
+    default:
+        break;
+    }
+    if (remaining > 0) entry->complete = false;
+    free(fe);
+    return true;
+}
+
+static void udf_walk_directory(walker_t *w, uint16_t part, uint32_t lbn, int depth) {
+    if (!enter_directory(w, udf_offset(w, part, lbn), depth)) return;
+
+    udf_entry_t entry;
+    if (!udf_read_entry(w, part, lbn, &entry) || entry.file_type != 4 || !entry.complete) return;
+    if (entry.size == 0 || entry.size > MAX_DIRECTORY_BYTES) return;
+
+    /* Gather the directory's data before w->extents is reused for its children */
+    size_t size = (size_t)entry.size;
+    uint8_t *dir = malloc(size);
+    if (!dir) return;
+    size_t filled = 0;
+    for (uint32_t i = 0; i < w->extent_count; i++) {
+        uint8_t *chunk = read_alloc(w->rd, w->extents[i].offset, (size_t)w->extents[i].length);
+        if (!chunk) break;
+        memcpy(dir + filled, chunk, (size_t)w->extents[i].length);
+        filled += (size_t)w->extents[i].length;
+        free(chunk);
+    }
+
+    char name[1024];
+    size_t pos = 0;
+    while (pos + 38 <= filled && !w->stopped) {
+        const uint8_t *fid = dir + pos;
+        if (!udf_tag_valid(fid, 257)) break;
+        uint8_t characteristics = fid[18];
+        uint8_t l_fi = fid[19];
+        uint16_t l_iu = le16(fid + 36);
+        size_t fid_len = (38u + l_iu + l_fi + 3u) & ~3u;
+        if (pos + 38 + l_iu + l_fi > filled) break;
+        pos += fid_len;
+
+        if (characteristics & 0x0C) continue;       /* Parent or deleted */
+        udf_name(name, sizeof(name), fid + 38 + l_iu, l_fi);
+        long old = push_name(w, name);
+        if (old < 0) continue;
+
+        uint32_t child_lbn = le32(fid + 20 + 4);
+        uint16_t child_part = le16(fid + 20 + 8);
+        if (characteristics & 0x02) {
+            udf_walk_directory(w, child_part, child_lbn, depth + 1);
+        } else {
+            udf_entry_t child;
+            if (udf_read_entry(w, child_part, child_lbn, &child) && child.file_type == 5 && child.complete) {
+                emit_file(w, child.size, child.modified);
+            }
+        }
+        pop_name(w, old);
+    }
+    free(dir);
+}
+
+/* Metadata partition (UDF 2.50+): the metadata file's extents, read from its file entry */
+static bool udf_load_metadata(walker_t *w, udf_partition_t *meta, uint16_t physical_ref, uint32_t file_lbn) {
+    udf_entry_t entry;
+    if (!udf_read_entry(w, physical_ref, file_lbn, &entry) || !entry.complete || w->extent_count == 0) return false;
+    meta->meta = malloc(w->extent_count * sizeof(isotree_extent_t));
+    if (!meta->meta) return false;
+    memcpy(meta->meta, w->extents, w->extent_count * sizeof(isotree_extent_t));
+    meta->meta_count = w->extent_count;
+    w->extent_count = 0;
+    return true;
+}
+
+static uint32_t walk_udf(walker_t *w) {
+    uint8_t *avdp = read_alloc(w->rd, (uint64_t)UDF_AVDP_SECTOR * SECTOR_SIZE, SECTOR_SIZE);
+    if (!avdp) return 0;
+    bool valid = udf_tag_valid(avdp, 2) && le32(avdp + 12) == UDF_AVDP_SECTOR;
+    uint32_t vds_length = le32(avdp + 16);
+    uint32_t vds_location = le32(avdp + 20);
+    free(avdp);
+    if (!valid) return 0;
+
+    uint32_t vds_sectors = vds_length / SECTOR_SIZE;
+    if (vds_sectors > VDS_MAX_SECTORS) vds_sectors = VDS_MAX_SECTORS;
+
+    struct { uint16_t number; uint32_t start; } descriptors[UDF_MAX_PARTITIONS];
+    uint32_t descriptor_count = 0;
+    uint8_t *lvd = NULL;
+
+    for (uint32_t i = 0; i < vds_sectors; i++) {
+        uint8_t *sector = read_alloc(w->rd, (uint64_t)(vds_location + i) * SECTOR_SIZE, SECTOR_SIZE);
+        if (!sector) break;
+        uint16_t tag_id = le16(sector);
+        bool keep = false;
+        if (udf_tag_valid(sector, tag_id)) {
+            if (tag_id == 5 && descriptor_count < UDF_MAX_PARTITIONS) {
+                descriptors[descriptor_count].number = le16(sector + 22);
+                descriptors[descriptor_count].start = le32(sector + 188);
+                descriptor_count++;
+            } else if (tag_id == 6 && !lvd) {
+                lvd = sector;
+                keep = true;
+            } else if (tag_id == 8) {
+                free(sector);
+                break;
+            }
+        }
+        if (!keep) free(sector);
+    }
+    if (!lvd) return 0;
+
+    w->udf_block_size = le32(lvd + 212);
+    uint32_t fsd_lbn = le32(lvd + 248 + 4);
+    uint16_t fsd_part = le16(lvd + 248 + 8);
+    uint32_t map_table_length = le32(lvd + 264);
+    uint32_t map_count = le32(lvd + 268);
+    if (w->udf_block_size != SECTOR_SIZE || map_table_length > SECTOR_SIZE - 440) {
+        free(lvd);
+        return 0;
+    }
+
+    /* Partition maps, in reference order; metadata maps are resolved once every map is known */
+    struct { uint16_t physical_ref; uint32_t file_lbn; bool is_meta; } pending[UDF_MAX_PARTITIONS];
+    const uint8_t *map = lvd + 440;
+    const uint8_t *maps_end = map + map_table_length;
+    bool supported = true;
+    for (uint32_t i = 0; i < map_count && i < UDF_MAX_PARTITIONS && map + 2 <= maps_end; i++) {
+        uint8_t type = map[0], len = map[1];
+        if (len < 6 || map + len > maps_end) {
+            supported = false;
+            break;
+        }
+        uint16_t number = type == 1 ? le16(map + 4) : (len >= 40 ? le16(map + 38) : 0);
+        bool is_meta = type == 2 && len >= 44 && memcmp(map + 5, "*UDF Metadata Partition", 23) == 0;
+        bool is_virtual = type == 2 && memcmp(map + 5, "*UDF Virtual Partition", 22) == 0;
+        if (is_virtual) {
+            supported = false;
+            break;
+        }
+
+        udf_partition_t *p = &w->partitions[w->partition_count++];
+        memset(p, 0, sizeof(*p));
+        pending[i].is_meta = is_meta;
+        pending[i].file_lbn = is_meta ? le32(map + 40) : 0;
+        pending[i].physical_ref = 0;
+        for (uint32_t d = 0; d < descriptor_count; d++) {
+            if (descriptors[d].number == number) p->start = descriptors[d].start;
+        }
+        map += len;
+    }
+    free(lvd);
+    if (!supported || w->partition_count == 0) return 0;
+
+    for (uint32_t i = 0; i < w->partition_count; i++) {
+        if (!pending[i].is_meta) continue;
+        /* The metadata file lives in the physical partition with the same partition number */
+        uint16_t physical = UINT16_MAX;
+        for (uint32_t j = 0; j < w->partition_count; j++) {
+            if (!pending[j].is_meta && w->partitions[j].start == w->partitions[i].start) physical = (uint16_t)j;
+        }
+        if (physical == UINT16_MAX || !udf_load_metadata(w, &w->partitions[i], physical, pending[i].file_lbn)) {
+            return 0;
+        }
+    }
+
+    uint64_t fsd_offset = udf_offset(w, fsd_part, fsd_lbn);
+    if (fsd_offset == UINT64_MAX) return 0;
+    uint8_t *fsd = read_alloc(w->rd, fsd_offset, SECTOR_SIZE);
+    if (!fsd) return 0;
+    valid = udf_tag_valid(fsd, 256);
+    uint32_t root_lbn = le32(fsd + 400 + 4);
+    uint16_t root_part = le16(fsd + 400 + 8);
+    free(fsd);
+    if (!valid) return 0;
+
+    udf_entry_t root;
+    if (!udf_read_entry(w, root_part, root_lbn, &root) || root.file_type != 4) return 0;
+    udf_walk_directory(w, root_part, root_lbn, 0);
+    return VOLINFO_FS_UDF;
+}
+
+/* MARK: - Public API */
+
+uint32_t isotree_walk(volinfo_read_fn read_fn, void *read_ctx, isotree_file_fn fn, void *ctx) {
+    if (!read_fn || !fn) return 0;
+    reader_t rd = { read_fn, read_ctx };
+
+    walker_t *w = calloc(1, sizeof(*w));
+    if (!w) return 0;
+    w->rd = &rd;
+    w->fn = fn;
+    w->ctx = ctx;
+
+    uint32_t result = walk_udf(w);
+    for (uint32_t i = 0; i < w->partition_count; i++) {
+        free(w->partitions[i].meta);
+    }
+    if (result == 0) {
+        w->path[0] = '\0';
+        w->extent_count = 0;
+        w->directories = 0;
+        result = walk_iso9660(w);
+    }
+
+    free(w->extents);
+    free(w);
+    return result;
+}
+
+static long fd_read(void *ctx, uint64_t offset, void *buf, size_t len) {
+    int fd = *(int *)ctx;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) return done > 0 ? (long)done : -1;
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return (long)done;
+}
+
+uint32_t isotree_walk_path(const char *path, isotree_file_fn fn, void *ctx) {
+    if (!path) return 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    uint32_t result = isotree_walk(fd_read, &fd, fn, ctx);
+    close(fd);
+    return result;
+}
@@ -0,0 +1,54 @@
+/*
+ * isotree.h - File tree of an ISO 9660 / Joliet / UDF image without mounting
+ *
+ * Walks the directory tree through the same read callback as volinfo and
+ * reports every regular file with its path, size, modification time and the
+ * byte ranges (extents) of the image that hold its data. UDF is preferred,
+ * as macOS would mount it; discs without a usable UDF volume fall back to
+ * Rock Ridge names, then Joliet, then plain ISO 9660.
+ * Portable C with no platform dependencies beyond POSIX read/pread.
+ */
+
+#ifndef ISOTREE_H
+#define ISOTREE_H
+
+#include "volinfo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ISOTREE_PATH_MAX    4096
+
+/* A run of file data: length bytes starting at byte offset of the image */
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+} isotree_extent_t;
+
+typedef struct {
+    const char *path;                   /* UTF-8, '/'-separated, no leading slash */
+    uint64_t size;
+    int64_t modified;                   /* Unix seconds (UTC), 0 if unrecorded */
+    uint32_t extent_count;              /* 0 for empty files */
+    const isotree_extent_t *extents;    /* In file order; valid only during the callback */
+} isotree_file_t;
+
+/* Called once per regular file. Return 0 to continue, nonzero to stop the walk. */
+typedef int (*isotree_file_fn)(void *ctx, const isotree_file_t *file);
+
+/*
+ * Walk the tree through a read callback. Returns the VOLINFO_FS_* bit of the
+ * tree that was walked (VOLINFO_FS_UDF, VOLINFO_FS_JOLIET or VOLINFO_FS_ISO9660),
+ * or 0 if no tree could be read. Unreadable directories are skipped.
+ */
+uint32_t isotree_walk(volinfo_read_fn read_fn, void *read_ctx, isotree_file_fn fn, void *ctx);
+
+/* Walk an image file, e.g. a finished .iso. */
+uint32_t isotree_walk_path(const char *path, isotree_file_fn fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ISOTREE_H */
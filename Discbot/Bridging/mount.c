@@ -7,13 +7,17 @@
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <DiskArbitration/DiskArbitration.h>
 #include <IOKit/IOKitLib.h>
 #include <IOKit/storage/IOCDMedia.h>
+#include <IOKit/storage/IOCDMediaBSDClient.h>
 #include <IOKit/storage/IODVDMedia.h>
 #include <IOKit/storage/IOBDMedia.h>
+#include <IOKit/storage/IOStorageDeviceCharacteristics.h>
 
 /* Helper to run a run loop for a given duration */
 static void run_loop_for_seconds(double seconds) {
@@ -49,14 +53,17 @@ static void da_unmount_callback(DADiskRef disk, DADissenterRef dissenter, void *
     ctx->done = true;
 }
 
+/* Media presence poll interval; short so a scan can start reading as soon as the disc spins up */
+#define DISC_POLL_INTERVAL_US 100000
+
 int mount_wait_for_disc(int timeout) {
-    int elapsed = 0;
-    while (elapsed < timeout) {
+    long remaining_us = (long)timeout * 1000000L;
+    while (remaining_us > 0) {
         if (mount_is_disc_present()) {
             return 0;
         }
-        sleep(1);
-        elapsed++;
+        usleep(DISC_POLL_INTERVAL_US);
+        remaining_us -= DISC_POLL_INTERVAL_US;
     }
     return -1;
 }
@@ -146,6 +153,56 @@ char *mount_find_dvd_bsd_name(void) {
     return result;
 }
 
+/* Copy an inquiry string out of the device characteristics, without its space padding */
+static void copy_characteristic(CFDictionaryRef characteristics, CFStringRef key, char *buf, size_t size) {
+    buf[0] = '\0';
+    CFStringRef value = CFDictionaryGetValue(characteristics, key);
+    if (!value || CFGetTypeID(value) != CFStringGetTypeID()
+        || !CFStringGetCString(value, buf, (CFIndex)size, kCFStringEncodingUTF8)) {
+        buf[0] = '\0';
+        return;
+    }
+    size_t len = strlen(buf);
+    while (len > 0 && buf[len - 1] == ' ') {
+        buf[--len] = '\0';
+    }
+}
+
+char *mount_get_drive_identity(void) {
+    io_iterator_t iter;
+    /* DVD and BD drives are CD block storage devices too */
+    kern_return_t kr = IOServiceGetMatchingServices(
+        kIOMasterPortDefault,
+        IOServiceMatching("IOCDBlockStorageDevice"),
+        &iter
+    );
+    if (kr != KERN_SUCCESS) return NULL;
+
+    char *result = NULL;
+    io_object_t service = IOIteratorNext(iter);
+    if (service) {
+        CFTypeRef characteristics = IORegistryEntryCreateCFProperty(
+            service, CFSTR(kIOPropertyDeviceCharacteristicsKey), kCFAllocatorDefault, 0
+        );
+        if (characteristics) {
+            if (CFGetTypeID(characteristics) == CFDictionaryGetTypeID()) {
+                char vendor[64], product[64];
+                copy_characteristic(characteristics, CFSTR(kIOPropertyVendorNameKey), vendor, sizeof(vendor));
+                copy_characteristic(characteristics, CFSTR(kIOPropertyProductNameKey), product, sizeof(product));
+                if (vendor[0] || product[0]) {
+                    char buf[sizeof(vendor) + sizeof(product)];
+                    snprintf(buf, sizeof(buf), "%s%s%s", vendor, vendor[0] && product[0] ? " " : "", product);
+                    result = strdup(buf);
+                }
+            }
+            CFRelease(characteristics);
+        }
+        IOObjectRelease(service);
+    }
+    IOObjectRelease(iter);
+    return result;
+}
+
 bool mount_is_disc_present(void) {
     char *bsd = mount_find_dvd_bsd_name();
     if (bsd) {
@@ -330,3 +387,53 @@ char *mount_get_volume_name(const char *bsd_name) {
     CFRelease(desc);
     return result;
 }
+
+/* Largest full TOC: 99 tracks plus the per-session points of 99 sessions */
+#define TOC_BUFFER_SIZE (4 + 11 * (TOC_MAX_TRACKS + TOC_MAX_SESSIONS * 7))
+
+int mount_read_toc(const char *bsd_name, bool read_codes, toc_t *out) {
+    char dev_path[256];
+    snprintf(dev_path, sizeof(dev_path), "/dev/r%s", bsd_name);
+
+    int fd = open(dev_path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) return -1;
+
+    uint8_t buffer[TOC_BUFFER_SIZE];
+    dk_cd_read_toc_t request;
+    memset(&request, 0, sizeof(request));
+    memset(buffer, 0, sizeof(buffer));
+    request.format = kCDTOCFormatTOC;
+    request.formatAsTime = 1;
+    request.bufferLength = sizeof(buffer);
+    request.buffer = buffer;
+
+    /* Fails on DVD and BD media, which have no CD TOC */
+    if (ioctl(fd, DKIOCCDREADTOC, &request) < 0 || toc_parse_full(buffer, request.bufferLength, out) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (read_codes) {
+        /* Both come from the Q sub-channel; drives without them just fail the ioctl */
+        dk_cd_read_mcn_t mcn;
+        memset(&mcn, 0, sizeof(mcn));
+        if (ioctl(fd, DKIOCCDREADMCN, &mcn) == 0) {
+            memcpy(out->mcn, mcn.mcn, TOC_MCN_SIZE - 1);
+            out->mcn[TOC_MCN_SIZE - 1] = '\0';
+        }
+
+        for (uint8_t i = 0; i < out->track_count; i++) {
+            if (out->tracks[i].is_data) continue;
+            dk_cd_read_isrc_t isrc;
+            memset(&isrc, 0, sizeof(isrc));
+            isrc.track = out->tracks[i].number;
+            if (ioctl(fd, DKIOCCDREADISRC, &isrc) == 0) {
+                memcpy(out->tracks[i].isrc, isrc.isrc, TOC_ISRC_SIZE - 1);
+                out->tracks[i].isrc[TOC_ISRC_SIZE - 1] = '\0';
+            }
+        }
+    }
+
+    close(fd);
+    return 0;
+}
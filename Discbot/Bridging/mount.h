@@ -7,6 +7,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "toc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,12 @@ int mount_wait_for_disc(int timeout);
 /* Find the BSD name of a DVD/CD disc. Caller must free() the result. */
 char *mount_find_dvd_bsd_name(void);
 
+/*
+ * Identify the optical drive from its SCSI inquiry ("vendor product"), with
+ * or without a disc in it. Caller must free() the result; NULL if no drive is found.
+ */
+char *mount_get_drive_identity(void);
+
 /* Check if a disc is present in any optical drive */
 bool mount_is_disc_present(void);
 
@@ -39,6 +46,14 @@ char *mount_get_mount_point(const char *bsd_name);
 /* Get the volume name for a BSD name. Caller must free() the result. */
 char *mount_get_volume_name(const char *bsd_name);
 
+/*
+ * Read the CD table of contents with one ioctl on the raw device (no mount).
+ * With read_codes, also reads the MCN and each audio track's ISRC, which
+ * costs a sub-channel read per track. Returns 0 on success, -1 on failure
+ * or for media without a CD TOC (DVD, BD).
+ */
+int mount_read_toc(const char *bsd_name, bool read_codes, toc_t *out);
+
 #ifdef __cplusplus
 }
 #endif
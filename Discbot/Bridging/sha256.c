@@ -0,0 +1,131 @@
+/*
+ * sha256.c - Streaming SHA-256 for image digests
+ */
+
+#include "sha256.h"
+#include <string.h>
+
+static const uint32_t k[64] = {
+    0x428a2f98u, 0x71374491u, 0xb5c0fbcfu, 0xe9b5dba5u, 0x3956c25bu, 0x59f111f1u, 0x923f82a4u, 0xab1c5ed5u,
+    0xd807aa98u, 0x12835b01u, 0x243185beu, 0x550c7dc3u, 0x72be5d74u, 0x80deb1feu, 0x9bdc06a7u, 0xc19bf174u,
+    0xe49b69c1u, 0xefbe4786u, 0x0fc19dc6u, 0x240ca1ccu, 0x2de92c6fu, 0x4a7484aau, 0x5cb0a9dcu, 0x76f988dau,
+    0x983e5152u, 0xa831c66du, 0xb00327c8u, 0xbf597fc7u, 0xc6e00bf3u, 0xd5a79147u, 0x06ca6351u, 0x14292967u,
+    0x27b70a85u, 0x2e1b2138u, 0x4d2c6dfcu, 0x53380d13u, 0x650a7354u, 0x766a0abbu, 0x81c2c92eu, 0x92722c85u,
+    0xa2bfe8a1u, 0xa81a664bu, 0xc24b8b70u, 0xc76c51a3u, 0xd192e819u, 0xd6990624u, 0xf40e3585u, 0x106aa070u,
+    0x19a4c116u, 0x1e376c08u, 0x2748774cu, 0x34b0bcb5u, 0x391c0cb3u, 0x4ed8aa4au, 0x5b9cca4fu, 0x682e6ff3u,
+    0x748f82eeu, 0x78a5636fu, 0x84c87814u, 0x8cc70208u, 0x90befffau, 0xa4506cebu, 0xbef9a3f7u, 0xc67178f2u,
+};
+
+static uint32_t ror32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void sha256_init(sha256_t *s) {
+    s->h[0] = 0x6a09e667u;
+    s->h[1] = 0xbb67ae85u;
+    s->h[2] = 0x3c6ef372u;
+    s->h[3] = 0xa54ff53au;
+    s->h[4] = 0x510e527fu;
+    s->h[5] = 0x9b05688cu;
+    s->h[6] = 0x1f83d9abu;
+    s->h[7] = 0x5be0cd19u;
+    s->length = 0;
+    s->used = 0;
+}
+
+static void sha256_block(sha256_t *s, const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) |
+               ((uint32_t)p[i * 4 + 2] << 8) | (uint32_t)p[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ror32(w[i - 15], 7) ^ ror32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror32(w[i - 2], 17) ^ ror32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = s->h[0], b = s->h[1], c = s->h[2], d = s->h[3];
+    uint32_t e = s->h[4], f = s->h[5], g = s->h[6], h = s->h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + k[i] + w[i];
+        uint32_t s0 = ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    s->h[0] += a;
+    s->h[1] += b;
+    s->h[2] += c;
+    s->h[3] += d;
+    s->h[4] += e;
+    s->h[5] += f;
+    s->h[6] += g;
+    s->h[7] += h;
+}
+
+void sha256_update(sha256_t *s, const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    s->length += len;
+
+    /* Whole blocks go straight from the caller's buffer; image chunks are
+     * megabytes, so copying them through s->block would double the work. */
+    if (s->used == 0) {
+        while (len >= 64) {
+            sha256_block(s, bytes);
+            bytes += 64;
+            len -= 64;
+        }
+    }
+    while (len > 0) {
+        size_t take = 64 - s->used;
+        if (take > len) take = len;
+        memcpy(s->block + s->used, bytes, take);
+        s->used += take;
+        bytes += take;
+        len -= take;
+        if (s->used == 64) {
+            sha256_block(s, s->block);
+            s->used = 0;
+            while (len >= 64) {
+                sha256_block(s, bytes);
+                bytes += 64;
+                len -= 64;
+            }
+        }
+    }
+}
+
+void sha256_final(sha256_t *s, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bits = s->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t pad_len = (s->used < 56 ? 56 : 120) - s->used;
+    uint8_t len_be[8];
+    for (int i = 0; i < 8; i++) {
+        len_be[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha256_update(s, pad, pad_len);
+    sha256_update(s, len_be, 8);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(s->h[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(s->h[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(s->h[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)s->h[i];
+    }
+}
+
+void sha256_digest(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    sha256_t s;
+    sha256_init(&s);
+    sha256_update(&s, data, len);
+    sha256_final(&s, digest);
+}
@@ -0,0 +1,39 @@
+/*
+ * sha256.h - Streaming SHA-256 for image digests
+ *
+ * Stands in for CommonCrypto's CC_SHA256 so image verification and the
+ * object-store metadata digest build the same way on macOS and Linux.
+ * Portable C with no platform dependencies.
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA256_DIGEST_SIZE  32
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t length;
+    uint8_t block[64];
+    size_t used;
+} sha256_t;
+
+void sha256_init(sha256_t *s);
+void sha256_update(sha256_t *s, const void *data, size_t len);
+void sha256_final(sha256_t *s, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+/* One-shot digest of a buffer. */
+void sha256_digest(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA256_H */
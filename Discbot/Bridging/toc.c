@@ -0,0 +1,153 @@
+/*
+ * toc.c - CD table of contents parsing
+ */
+
+#include "toc.h"
+#include <string.h>
+
+#define TOC_HEADER_SIZE     4u
+#define TOC_DESCRIPTOR_SIZE 11u
+
+#define POINT_FIRST_TRACK   0xA0u
+#define POINT_LAST_TRACK    0xA1u
+#define POINT_LEADOUT       0xA2u
+
+#define CONTROL_DATA        0x04u
+#define CONTROL_COPY        0x02u
+#define CONTROL_EMPHASIS    0x01u
+
+static uint32_t msf_to_lba(uint8_t m, uint8_t s, uint8_t f) {
+    uint32_t frames = ((uint32_t)m * 60u + s) * 75u + f;
+    return frames >= TOC_LEADIN_FRAMES ? frames - TOC_LEADIN_FRAMES : 0;
+}
+
+static toc_session_t *session_for(toc_t *toc, uint8_t number) {
+    for (uint8_t i = 0; i < toc->session_count; i++) {
+        if (toc->sessions[i].number == number) return &toc->sessions[i];
+    }
+    if (toc->session_count >= TOC_MAX_SESSIONS) return NULL;
+
+    toc_session_t *session = &toc->sessions[toc->session_count++];
+    memset(session, 0, sizeof(*session));
+    session->number = number;
+    return session;
+}
+
+int toc_parse_full(const uint8_t *data, size_t len, toc_t *out) {
+    if (!data || !out || len < TOC_HEADER_SIZE) return -1;
+    memset(out, 0, sizeof(*out));
+
+    /* Data length excludes its own two bytes */
+    size_t declared = ((size_t)data[0] << 8 | data[1]) + 2;
+    if (declared > len) return -1;
+    len = declared;
+
+    /* Track descriptors by track number until they can be sorted */
+    toc_track_t by_number[TOC_MAX_TRACKS + 1];
+    bool present[TOC_MAX_TRACKS + 1] = { false };
+
+    for (size_t pos = TOC_HEADER_SIZE; pos + TOC_DESCRIPTOR_SIZE <= len; pos += TOC_DESCRIPTOR_SIZE) {
+        const uint8_t *d = data + pos;
+        uint8_t session_number = d[0];
+        uint8_t adr = d[1] >> 4;
+        uint8_t control = d[1] & 0x0F;
+        uint8_t point = d[3];
+        uint8_t pmin = d[8], psec = d[9], pframe = d[10];
+
+        /* Only mode-1 Q data describes tracks and lead-outs */
+        if (adr != 1) continue;
+
+        toc_session_t *session = session_for(out, session_number);
+        if (!session) return -1;
+
+        if (point >= 1 && point <= TOC_MAX_TRACKS) {
+            toc_track_t *track = &by_number[point];
+            memset(track, 0, sizeof(*track));
+            track->number = point;
+            track->session = session_number;
+            track->control = control;
+            track->is_data = (control & CONTROL_DATA) != 0;
+            track->copy_permitted = (control & CONTROL_COPY) != 0;
+            track->pre_emphasis = !track->is_data && (control & CONTROL_EMPHASIS) != 0;
+            track->start_lba = msf_to_lba(pmin, psec, pframe);
+            present[point] = true;
+        } else if (point == POINT_FIRST_TRACK) {
+            session->first_track = pmin;
+            session->disc_type = psec;
+        } else if (point == POINT_LAST_TRACK) {
+            session->last_track = pmin;
+        } else if (point == POINT_LEADOUT) {
+            session->leadout_lba = msf_to_lba(pmin, psec, pframe);
+        }
+    }
+
+    for (int number = 1; number <= TOC_MAX_TRACKS; number++) {
+        if (!present[number]) continue;
+        toc_track_t *track = &out->tracks[out->track_count++];
+        *track = by_number[number];
+        if (track->is_data) {
+            out->data_track_count++;
+        } else {
+            out->audio_track_count++;
+        }
+    }
+    if (out->track_count == 0) return -1;
+
+    out->first_track = out->tracks[0].number;
+    out->last_track = out->tracks[out->track_count - 1].number;
+
+    /* Sessions in order; the disc's lead-out is the last session's */
+    for (uint8_t i = 1; i < out->session_count; i++) {
+        toc_session_t key = out->sessions[i];
+        int j = i - 1;
+        while (j >= 0 && out->sessions[j].number > key.number) {
+            out->sessions[j + 1] = out->sessions[j];
+            j--;
+        }
+        out->sessions[j + 1] = key;
+    }
+    out->leadout_lba = out->sessions[out->session_count - 1].leadout_lba;
+
+    /* Each track runs to the next track in its session, or to the session's lead-out */
+    for (uint8_t i = 0; i < out->track_count; i++) {
+        toc_track_t *track = &out->tracks[i];
+        uint32_t end = 0;
+        if (i + 1 < out->track_count && out->tracks[i + 1].session == track->session) {
+            end = out->tracks[i + 1].start_lba;
+        } else {
+            for (uint8_t s = 0; s < out->session_count; s++) {
+                if (out->sessions[s].number == track->session) end = out->sessions[s].leadout_lba;
+            }
+        }
+        if (end <= track->start_lba) return -1;
+        track->length_sectors = end - track->start_lba;
+    }
+
+    return 0;
+}
+
+int toc_disc_id_layout(const toc_t *toc,
+                       int *first_track,
+                       int *last_track,
+                       uint32_t *leadout_offset,
+                       uint32_t offsets[TOC_MAX_TRACKS]) {
+    if (!toc || toc->track_count == 0 || toc->audio_track_count == 0) return -1;
+
+    int count = toc->track_count;
+    uint32_t leadout = toc->leadout_lba;
+
+    /* Enhanced CD: drop the trailing data session so the ID matches the audio-only pressing */
+    const toc_track_t *last = &toc->tracks[count - 1];
+    if (count > 1 && last->is_data && last->session != toc->tracks[count - 2].session) {
+        leadout = last->start_lba >= TOC_SESSION_GAP_FRAMES ? last->start_lba - TOC_SESSION_GAP_FRAMES : 0;
+        count--;
+    }
+
+    for (int i = 0; i < count; i++) {
+        offsets[i] = toc->tracks[i].start_lba + TOC_LEADIN_FRAMES;
+    }
+    *first_track = toc->tracks[0].number;
+    *last_track = toc->tracks[count - 1].number;
+    *leadout_offset = leadout + TOC_LEADIN_FRAMES;
+    return count;
+}
@@ -0,0 +1,93 @@
+/*
+ * toc.h - CD table of contents parsing
+ *
+ * Parses the READ TOC/PMA/ATIP "full TOC" response (format 0010b): one
+ * 11-byte Q-channel descriptor per point, covering every session. The
+ * result is a plain struct with tracks, session layout, lead-outs and
+ * audio/data flags. Portable C with no platform dependencies; the device
+ * read lives in mount.c.
+ */
+
+#ifndef TOC_H
+#define TOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TOC_MAX_TRACKS      99
+#define TOC_MAX_SESSIONS    99
+#define TOC_ISRC_SIZE       13      /* 12 characters + NUL */
+#define TOC_MCN_SIZE        14      /* 13 digits + NUL */
+
+/* Frames between sessions that the MusicBrainz disc ID subtracts from an enhanced CD's data track */
+#define TOC_SESSION_GAP_FRAMES  11400u
+/* Two-second lead-in; frame address = LBA + 150 */
+#define TOC_LEADIN_FRAMES       150u
+
+/* CD-ROM disc type from the A0 point (PSEC) */
+#define TOC_DISC_TYPE_CDDA_OR_CDROM 0x00u
+#define TOC_DISC_TYPE_CDI           0x10u
+#define TOC_DISC_TYPE_CDROM_XA      0x20u
+
+typedef struct {
+    uint8_t number;
+    uint8_t session;
+    uint8_t control;                /* Q-channel CONTROL nibble */
+    bool is_data;                   /* CONTROL bit 2: data track */
+    bool copy_permitted;            /* CONTROL bit 1 */
+    bool pre_emphasis;              /* CONTROL bit 0 on audio tracks */
+    uint32_t start_lba;
+    uint32_t length_sectors;        /* Up to the next track or the session's lead-out */
+    char isrc[TOC_ISRC_SIZE];       /* Empty unless read separately */
+} toc_track_t;
+
+typedef struct {
+    uint8_t number;
+    uint8_t first_track;
+    uint8_t last_track;
+    uint8_t disc_type;              /* TOC_DISC_TYPE_* */
+    uint32_t leadout_lba;
+} toc_session_t;
+
+typedef struct {
+    uint8_t first_track;
+    uint8_t last_track;
+    uint8_t track_count;
+    uint8_t audio_track_count;
+    uint8_t data_track_count;
+    uint8_t session_count;
+    uint32_t leadout_lba;           /* Lead-out of the last session */
+    toc_track_t tracks[TOC_MAX_TRACKS];         /* In track-number order */
+    toc_session_t sessions[TOC_MAX_SESSIONS];   /* In session order */
+    char mcn[TOC_MCN_SIZE];         /* Media catalog number (UPC/EAN); empty unless read separately */
+} toc_t;
+
+/*
+ * Parse a full TOC response, including its 4-byte header. Returns 0 on
+ * success, -1 if the data is truncated, has no tracks, or is inconsistent.
+ */
+int toc_parse_full(const uint8_t *data, size_t len, toc_t *out);
+
+/*
+ * Track layout used for the MusicBrainz and FreeDB disc IDs, as frame
+ * addresses (LBA + 150). On an enhanced CD (audio session followed by a
+ * data session) the trailing data track is left out and the lead-out is
+ * moved back to the end of the audio session. Writes up to TOC_MAX_TRACKS
+ * offsets. Returns the number of tracks, or -1 if there is no audio.
+ */
+int toc_disc_id_layout(const toc_t *toc,
+                       int *first_track,
+                       int *last_track,
+                       uint32_t *leadout_offset,
+                       uint32_t offsets[TOC_MAX_TRACKS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOC_H */
@@ -0,0 +1,416 @@
+/*
+ * volinfo.c - Volume label and filesystem detection from raw disc sectors
+ */
+
+#include "volinfo.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECTOR_SIZE         2048u
+#define VDS_FIRST_SECTOR    16u
+#define VDS_MAX_SECTORS     64u
+#define UDF_AVDP_SECTOR     256u
+#define HFS_HEADER_OFFSET   1024u
+#define HFS_MAX_NODE_SIZE   32768u
+
+typedef struct {
+    volinfo_read_fn read_fn;
+    void *ctx;
+} reader_t;
+
+/* MARK: - Byte helpers */
+
+static uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t le32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t be16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+static uint32_t be32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3]; }
+
+/* Read len bytes at an arbitrary offset by reading the covering 2048-byte-aligned span. */
+static int read_range(const reader_t *rd, uint64_t offset, size_t len, uint8_t *out) {
+    uint64_t start = offset - (offset % SECTOR_SIZE);
+    uint64_t end = offset + len;
+    size_t span = (size_t)(((end + SECTOR_SIZE - 1) / SECTOR_SIZE) * SECTOR_SIZE - start);
+
+    uint8_t *buf = malloc(span);
+    if (!buf) return -1;
+
+    long got = rd->read_fn(rd->ctx, start, buf, span);
+    if (got < 0 || (uint64_t)got < (offset - start) + len) {
+        free(buf);
+        return -1;
+    }
+    memcpy(out, buf + (offset - start), len);
+    free(buf);
+    return 0;
+}
+
+static int read_sector(const reader_t *rd, uint32_t lba, uint8_t *out) {
+    return read_range(rd, (uint64_t)lba * SECTOR_SIZE, SECTOR_SIZE, out);
+}
+
+/* MARK: - Text decoding */
+
+static size_t put_utf8(char *dst, size_t cap, size_t pos, uint32_t cp) {
+    char tmp[4];
+    size_t n;
+    if (cp < 0x80) {
+        tmp[0] = (char)cp; n = 1;
+    } else if (cp < 0x800) {
+        tmp[0] = (char)(0xC0 | (cp >> 6));
+        tmp[1] = (char)(0x80 | (cp & 0x3F)); n = 2;
+    } else if (cp < 0x10000) {
+        tmp[0] = (char)(0xE0 | (cp >> 12));
+        tmp[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        tmp[2] = (char)(0x80 | (cp & 0x3F)); n = 3;
+    } else {
+        tmp[0] = (char)(0xF0 | (cp >> 18));
+        tmp[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        tmp[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        tmp[3] = (char)(0x80 | (cp & 0x3F)); n = 4;
+    }
+    if (pos + n >= cap) return pos;     /* Drop characters that do not fit whole */
+    memcpy(dst + pos, tmp, n);
+    return pos + n;
+}
+
+static void trim_trailing(char *s) {
+    size_t len = strlen(s);
+    while (len > 0 && s[len - 1] == ' ') {
+        s[--len] = '\0';
+    }
+}
+
+/* Space-padded ISO 9660 a/d-characters; high bytes are taken as Latin-1. */
+static void decode_latin1(char *dst, size_t cap, const uint8_t *src, size_t len) {
+    size_t pos = 0;
+    for (size_t i = 0; i < len && src[i] != 0; i++) {
+        pos = put_utf8(dst, cap, pos, src[i]);
+    }
+    dst[pos] = '\0';
+    trim_trailing(dst);
+}
+
+/* UCS-2 / UTF-16 big endian, stopping at NUL. */
+static void decode_utf16be(char *dst, size_t cap, const uint8_t *src, size_t len) {
+    size_t pos = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        uint32_t cp = be16(src + i);
+        if (cp == 0) break;
+        if (cp >= 0xD800 && cp < 0xDC00 && i + 3 < len) {
+            uint32_t lo = be16(src + i + 2);
+            if (lo >= 0xDC00 && lo < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                i += 2;
+            }
+        }
+        pos = put_utf8(dst, cap, pos, cp);
+    }
+    dst[pos] = '\0';
+    trim_trailing(dst);
+}
+
+/* Mac OS Roman 0x80-0xFF to Unicode */
+static const uint16_t mac_roman_high[128] = {
+    0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1, 0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+    0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3, 0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+    0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF, 0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+    0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211, 0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+    0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB, 0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+    0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA, 0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+    0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1, 0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+    0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC, 0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7,
+};
+
+static void decode_mac_roman(char *dst, size_t cap, const uint8_t *src, size_t len) {
+    size_t pos = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint32_t cp = src[i] < 0x80 ? src[i] : mac_roman_high[src[i] - 0x80];
+        pos = put_utf8(dst, cap, pos, cp);
+    }
+    dst[pos] = '\0';
+}
+
+/* UDF dstring: compression ID byte, characters, and the used length in the last byte. */
+static void decode_udf_dstring(char *dst, size_t cap, const uint8_t *field, size_t field_len) {
+    size_t used = field[field_len - 1];
+    dst[0] = '\0';
+    if (used < 1 || used > field_len - 1) return;
+
+    if (field[0] == 8) {
+        decode_latin1(dst, cap, field + 1, used - 1);
+    } else if (field[0] == 16) {
+        decode_utf16be(dst, cap, field + 1, used - 1);
+    }
+}
+
+/* MARK: - ISO 9660 / Joliet */
+
+static bool is_joliet_escape(const uint8_t *esc) {
+    return esc[0] == '%' && esc[1] == '/' && (esc[2] == '@' || esc[2] == 'C' || esc[2] == 'E');
+}
+
+static void probe_iso9660(const reader_t *rd, volinfo_t *out, uint64_t *iso_size) {
+    uint8_t sector[SECTOR_SIZE];
+
+    for (uint32_t lba = VDS_FIRST_SECTOR; lba < VDS_FIRST_SECTOR + VDS_MAX_SECTORS; lba++) {
+        if (read_sector(rd, lba, sector) != 0) return;
+        if (memcmp(sector + 1, "CD001", 5) != 0) return;
+
+        uint8_t type = sector[0];
+        if (type == 255) return;    /* Volume descriptor set terminator */
+
+        if (type == 1 && !(out->filesystems & VOLINFO_FS_ISO9660)) {
+            out->filesystems |= VOLINFO_FS_ISO9660;
+            decode_latin1(out->system_id, sizeof(out->system_id), sector + 8, 32);
+            decode_latin1(out->iso_label, sizeof(out->iso_label), sector + 40, 32);
+            decode_latin1(out->publisher, sizeof(out->publisher), sector + 318, 128);
+            decode_latin1(out->application, sizeof(out->application), sector + 574, 128);
+
+            /* Creation date is 16 digits plus a timezone byte; all '0' or NUL means unset */
+            if (sector[813] >= '1' && sector[813] <= '9') {
+                memcpy(out->creation_date, sector + 813, 16);
+                out->creation_date[16] = '\0';
+            }
+
+            uint32_t blocks = le32(sector + 80);
+            uint16_t block_size = le16(sector + 128);
+            out->block_size = block_size;
+            *iso_size = (uint64_t)blocks * block_size;
+        } else if (type == 2 && is_joliet_escape(sector + 88) && !(out->filesystems & VOLINFO_FS_JOLIET)) {
+            out->filesystems |= VOLINFO_FS_JOLIET;
+            decode_utf16be(out->joliet_label, sizeof(out->joliet_label), sector + 40, 32);
+        }
+    }
+}
+
+/* MARK: - UDF */
+
+static bool udf_tag_valid(const uint8_t *tag, uint16_t expected_id) {
+    if (le16(tag) != expected_id) return false;
+    uint8_t sum = 0;
+    for (int i = 0; i < 16; i++) {
+        if (i != 4) sum = (uint8_t)(sum + tag[i]);
+    }
+    return sum == tag[4];
+}
+
+static bool udf_has_nsr(const reader_t *rd) {
+    uint8_t sector[SECTOR_SIZE];
+    bool in_extended_area = false;
+
+    for (uint32_t lba = VDS_FIRST_SECTOR; lba < VDS_FIRST_SECTOR + VDS_MAX_SECTORS; lba++) {
+        if (read_sector(rd, lba, sector) != 0) return false;
+        const uint8_t *id = sector + 1;
+        if (memcmp(id, "BEA01", 5) == 0) {
+            in_extended_area = true;
+        } else if (memcmp(id, "NSR02", 5) == 0 || memcmp(id, "NSR03", 5) == 0) {
+            return in_extended_area;
+        } else if (memcmp(id, "TEA01", 5) == 0) {
+            return false;
+        } else if (memcmp(id, "CD001", 5) != 0 && memcmp(id, "BOOT2", 5) != 0 && memcmp(id, "CDW02", 5) != 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static void probe_udf(const reader_t *rd, volinfo_t *out, uint64_t *udf_size, uint32_t *udf_block_size) {
+    uint8_t sector[SECTOR_SIZE];
+
+    if (!udf_has_nsr(rd)) return;
+    if (read_sector(rd, UDF_AVDP_SECTOR, sector) != 0 || !udf_tag_valid(sector, 2)) return;
+
+    uint32_t vds_length = le32(sector + 16);
+    uint32_t vds_location = le32(sector + 20);
+    uint32_t vds_sectors = vds_length / SECTOR_SIZE;
+    if (vds_sectors > VDS_MAX_SECTORS) vds_sectors = VDS_MAX_SECTORS;
+
+    char pvd_label[VOLINFO_LABEL_MAX] = "";
+    char lvd_label[VOLINFO_LABEL_MAX] = "";
+    uint32_t block_size = SECTOR_SIZE;
+    uint64_t partition_end = 0;
+    bool found = false;
+
+    for (uint32_t i = 0; i < vds_sectors; i++) {
+        if (read_sector(rd, vds_location + i, sector) != 0) break;
+        uint16_t tag_id = le16(sector);
+        if (!udf_tag_valid(sector, tag_id)) continue;
+
+        if (tag_id == 1) {              /* Primary Volume Descriptor */
+            decode_udf_dstring(pvd_label, sizeof(pvd_label), sector + 24, 32);
+            found = true;
+        } else if (tag_id == 5) {       /* Partition Descriptor */
+            uint64_t end = (uint64_t)le32(sector + 188) + le32(sector + 192);
+            if (end > partition_end) partition_end = end;
+        } else if (tag_id == 6) {       /* Logical Volume Descriptor */
+            block_size = le32(sector + 212);
+            decode_udf_dstring(lvd_label, sizeof(lvd_label), sector + 84, 128);
+            found = true;
+        } else if (tag_id == 8) {       /* Terminating Descriptor */
+            break;
+        }
+    }
+
+    if (!found) return;
+    out->filesystems |= VOLINFO_FS_UDF;
+    /* The logical volume identifier is what macOS shows as the volume name */
+    strncpy(out->udf_label, lvd_label[0] ? lvd_label : pvd_label, sizeof(out->udf_label) - 1);
+    *udf_block_size = block_size ? block_size : SECTOR_SIZE;
+    *udf_size = partition_end * (*udf_block_size);
+}
+
+/* MARK: - HFS / HFS+ */
+
+/* Volume name from the first catalog leaf record (the root folder, parent ID 1). */
+static void hfsplus_catalog_name(const reader_t *rd, uint64_t volume_offset, const uint8_t *header, char *dst, size_t cap) {
+    uint32_t block_size = be32(header + 40);
+    uint32_t cat_start = be32(header + 288);
+    uint32_t cat_blocks = be32(header + 292);
+    if (block_size == 0 || cat_blocks == 0) return;
+
+    uint64_t cat_offset = volume_offset + (uint64_t)cat_start * block_size;
+    uint64_t cat_length = (uint64_t)cat_blocks * block_size;
+
+    uint8_t node_header[512];
+    if (cat_length < sizeof(node_header) || read_range(rd, cat_offset, sizeof(node_header), node_header) != 0) return;
+
+    uint32_t first_leaf = be32(node_header + 14 + 10);
+    uint16_t node_size = be16(node_header + 14 + 18);
+    if (node_size < 512 || node_size > HFS_MAX_NODE_SIZE) return;
+    if ((uint64_t)(first_leaf + 1) * node_size > cat_length) return;
+
+    uint8_t *node = malloc(node_size);
+    if (!node) return;
+    if (read_range(rd, cat_offset + (uint64_t)first_leaf * node_size, node_size, node) == 0 && (int8_t)node[8] == -1) {
+        uint16_t record_offset = be16(node + node_size - 2);
+        if (record_offset + 8 <= node_size) {
+            const uint8_t *key = node + record_offset;
+            uint32_t parent_id = be32(key + 2);
+            uint16_t name_length = be16(key + 6);
+            if (parent_id == 1 && record_offset + 8 + (size_t)name_length * 2 <= node_size) {
+                decode_utf16be(dst, cap, key + 8, (size_t)name_length * 2);
+            }
+        }
+    }
+    free(node);
+}
+
+static bool probe_hfs_at(const reader_t *rd, uint64_t volume_offset, volinfo_t *out, uint64_t *hfs_size, uint32_t *hfs_block_size) {
+    uint8_t header[512];
+    if (read_range(rd, volume_offset + HFS_HEADER_OFFSET, sizeof(header), header) != 0) return false;
+
+    if (header[0] == 'B' && header[1] == 'D') {
+        /* Classic HFS master directory block (possibly wrapping an HFS+ volume) */
+        uint8_t name_length = header[36];
+        if (name_length > 27) name_length = 27;
+        decode_mac_roman(out->hfs_label, sizeof(out->hfs_label), header + 37, name_length);
+        out->filesystems |= VOLINFO_FS_HFS;
+        if (header[124] == 'H' && header[125] == '+') {
+            out->filesystems |= VOLINFO_FS_HFSPLUS;
+        }
+        *hfs_block_size = be32(header + 20);
+        *hfs_size = (uint64_t)be16(header + 18) * (*hfs_block_size);
+        return true;
+    }
+
+    if (header[0] == 'H' && (header[1] == '+' || header[1] == 'X')) {
+        out->filesystems |= VOLINFO_FS_HFSPLUS;
+        *hfs_block_size = be32(header + 40);
+        *hfs_size = (uint64_t)be32(header + 44) * (*hfs_block_size);
+        hfsplus_catalog_name(rd, volume_offset, header, out->hfs_label, sizeof(out->hfs_label));
+        return true;
+    }
+
+    return false;
+}
+
+static void probe_hfs(const reader_t *rd, volinfo_t *out, uint64_t *hfs_size, uint32_t *hfs_block_size) {
+    uint8_t block0[512];
+    if (read_range(rd, 0, sizeof(block0), block0) != 0) return;
+
+    /* Hybrid discs carry an Apple partition map: driver descriptor "ER", then "PM" entries */
+    if (block0[0] == 'E' && block0[1] == 'R') {
+        uint32_t map_block_size = be16(block0 + 2);
+        if (map_block_size < 512 || map_block_size > SECTOR_SIZE * 4) map_block_size = 512;
+
+        uint32_t entries = 1;
+        for (uint32_t i = 1; i <= entries && i <= 64; i++) {
+            uint8_t entry[512];
+            if (read_range(rd, (uint64_t)i * map_block_size, sizeof(entry), entry) != 0) return;
+            if (entry[0] != 'P' || entry[1] != 'M') return;
+            entries = be32(entry + 4);
+
+            if (strncmp((const char *)entry + 48, "Apple_HFS", 32) == 0) {
+                uint64_t start = (uint64_t)be32(entry + 8) * map_block_size;
+                if (probe_hfs_at(rd, start, out, hfs_size, hfs_block_size)) return;
+            }
+        }
+        return;
+    }
+
+    probe_hfs_at(rd, 0, out, hfs_size, hfs_block_size);
+}
+
+/* MARK: - Public API */
+
+int volinfo_probe(volinfo_read_fn read_fn, void *ctx, volinfo_t *out) {
+    if (!read_fn || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    reader_t rd = { read_fn, ctx };
+    uint64_t iso_size = 0, udf_size = 0, hfs_size = 0;
+    uint32_t udf_block_size = 0, hfs_block_size = 0;
+
+    probe_iso9660(&rd, out, &iso_size);
+    probe_udf(&rd, out, &udf_size, &udf_block_size);
+    probe_hfs(&rd, out, &hfs_size, &hfs_block_size);
+
+    const char *label = "";
+    if (out->filesystems & VOLINFO_FS_UDF) {
+        label = out->udf_label;
+        out->block_size = udf_block_size;
+        out->volume_size_bytes = udf_size;
+    } else if (out->filesystems & (VOLINFO_FS_HFS | VOLINFO_FS_HFSPLUS)) {
+        label = out->hfs_label;
+        out->block_size = hfs_block_size;
+        out->volume_size_bytes = hfs_size;
+    } else if (out->filesystems & VOLINFO_FS_ISO9660) {
+        out->volume_size_bytes = iso_size;
+    }
+
+    /* Fall back through the other labels when the primary one is blank */
+    if (!label[0]) label = out->joliet_label;
+    if (!label[0]) label = out->iso_label;
+    if (!label[0]) label = out->hfs_label;
+    strncpy(out->volume_label, label, sizeof(out->volume_label) - 1);
+
+    return out->filesystems ? 0 : -1;
+}
+
+static long fd_read(void *ctx, uint64_t offset, void *buf, size_t len) {
+    int fd = *(int *)ctx;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) return done > 0 ? (long)done : -1;
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return (long)done;
+}
+
+int volinfo_probe_fd(int fd, volinfo_t *out) {
+    if (fd < 0) return -1;
+    return volinfo_probe(fd_read, &fd, out);
+}
+
+int volinfo_probe_path(const char *path, volinfo_t *out) {
+    if (!path) return -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    int result = volinfo_probe_fd(fd, out);
+    close(fd);
+    return result;
+}
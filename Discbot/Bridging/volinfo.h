@@ -0,0 +1,71 @@
+/*
+ * volinfo.h - Volume label and filesystem detection from raw disc sectors
+ *
+ * Reads the ISO 9660 / Joliet volume descriptors, the UDF volume
+ * recognition and descriptor sequences, and HFS / HFS+ volume headers
+ * (including Apple partition maps on hybrid discs) without mounting.
+ * Portable C with no platform dependencies beyond POSIX read/pread.
+ */
+
+#ifndef VOLINFO_H
+#define VOLINFO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Filesystems found on the medium (bitmask) */
+#define VOLINFO_FS_ISO9660  0x01u
+#define VOLINFO_FS_JOLIET   0x02u
+#define VOLINFO_FS_UDF      0x04u
+#define VOLINFO_FS_HFS      0x08u
+#define VOLINFO_FS_HFSPLUS  0x10u
+
+#define VOLINFO_LABEL_MAX   256
+
+typedef struct {
+    uint32_t filesystems;               /* VOLINFO_FS_* bits */
+
+    /* Label macOS would show when mounting: UDF, then HFS/HFS+, then Joliet, then ISO 9660. UTF-8. */
+    char volume_label[VOLINFO_LABEL_MAX];
+
+    char iso_label[VOLINFO_LABEL_MAX];
+    char joliet_label[VOLINFO_LABEL_MAX];
+    char udf_label[VOLINFO_LABEL_MAX];
+    char hfs_label[VOLINFO_LABEL_MAX];
+
+    char system_id[VOLINFO_LABEL_MAX];     /* ISO 9660 system identifier */
+    char publisher[VOLINFO_LABEL_MAX];     /* ISO 9660 publisher identifier */
+    char application[VOLINFO_LABEL_MAX];   /* ISO 9660 application identifier */
+    char creation_date[17];                /* ISO 9660 "YYYYMMDDHHMMSScc", empty if unset */
+
+    uint32_t block_size;                /* Logical block size of the primary filesystem */
+    uint64_t volume_size_bytes;         /* Size of the primary filesystem, 0 if unknown */
+} volinfo_t;
+
+/*
+ * Read callback: fill buf with len bytes starting at byte offset.
+ * Offsets and lengths passed by the parser are multiples of 2048, so raw
+ * optical devices can be read directly. Return the number of bytes read,
+ * or -1 on error.
+ */
+typedef long (*volinfo_read_fn)(void *ctx, uint64_t offset, void *buf, size_t len);
+
+/* Probe a medium through a read callback. Returns 0 if any filesystem was recognized, -1 otherwise. */
+int volinfo_probe(volinfo_read_fn read_fn, void *ctx, volinfo_t *out);
+
+/* Probe an open file descriptor (image file or raw device). */
+int volinfo_probe_fd(int fd, volinfo_t *out);
+
+/* Probe a path, e.g. "/dev/rdisk4" or an .iso file. */
+int volinfo_probe_path(const char *path, volinfo_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VOLINFO_H */
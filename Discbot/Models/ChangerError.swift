@@ -9,6 +9,8 @@ import Foundation
 
 enum ChangerError: LocalizedError, Equatable {
     case connectionFailed
+    /// Another Discbot process (the app or the daemon) is connected to the changer
+    case changerInUse(Int32?)
     case notConnected
     case deviceNotFound
     case commandFailed(String)
@@ -20,6 +22,8 @@ enum ChangerError: LocalizedError, Equatable {
     case mountFailed(String)
     case unmountFailed(String)
     case timeout
+    case unitAttention
+    case senseError(String)
     case cancelled
     case imagingFailed(String)
     case metadataFailed(String)
@@ -29,6 +33,8 @@ enum ChangerError: LocalizedError, Equatable {
         switch self {
         case .connectionFailed:
             return "Failed to connect to DVD changer"
+        case .changerInUse(let pid):
+            return "DVD changer is in use by another Discbot process" + (pid.map { " (pid \($0))" } ?? "")
         case .notConnected:
             return "Not connected to DVD changer"
         case .deviceNotFound:
@@ -51,6 +57,10 @@ enum ChangerError: LocalizedError, Equatable {
             return "Unmount failed: \(reason)"
         case .timeout:
             return "Operation timed out"
+        case .unitAttention:
+            return "Changer reported a unit attention (reset or door opened)"
+        case .senseError(let sense):
+            return "SCSI check condition: \(sense)"
         case .cancelled:
             return "Operation was cancelled"
         case .imagingFailed(let reason):
@@ -71,6 +81,7 @@ enum ImagingError: LocalizedError {
     case timeout
     case discNotReady
     case unsupportedDiscType(String)
+    case verificationFailed(Int64)
     case cancelled
 
     var errorDescription: String? {
@@ -89,12 +100,42 @@ enum ImagingError: LocalizedError {
             return "Disc not ready"
         case .unsupportedDiscType(let type):
             return "Unsupported disc type: \(type)"
+        case .verificationFailed(let offset):
+            return "Image does not match the disc at byte \(offset)"
         case .cancelled:
             return "Imaging was cancelled"
         }
     }
 }
 
+/// Serving a file out of a stored image
+enum ImageFileError: LocalizedError {
+    case notIndexed(slot: Int, path: String)
+    case noImage(slot: Int)
+    case imageMissing(String)
+    /// The image on disk is not the one the file index was read from
+    case imageChanged(String)
+    case readFailed(Int32)
+    case writeFailed(URL, Int32)
+
+    var errorDescription: String? {
+        switch self {
+        case .notIndexed(let slot, let path):
+            return "No file \(path) in the index of slot \(slot)"
+        case .noImage(let slot):
+            return "No completed image of slot \(slot)"
+        case .imageMissing(let path):
+            return "Image \(path) is missing"
+        case .imageChanged(let path):
+            return "Image \(path) has changed since it was indexed"
+        case .readFailed(let errno):
+            return "Read failed: errno \(errno)"
+        case .writeFailed(let url, let errno):
+            return "Failed to write to \(url.path): errno \(errno)"
+        }
+    }
+}
+
 enum MetadataError: LocalizedError {
     case networkUnavailable
     case rateLimited
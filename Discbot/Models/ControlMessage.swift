@@ -0,0 +1,218 @@
+//
+//  ControlMessage.swift
+//  Discbot
+//
+//  Requests, replies and events of the daemon's control socket (one JSON object per line)
+//
+
+import Foundation
+
+/// A request from a control client
+struct ControlRequest: Codable {
+    enum Command: String, Codable {
+        case status
+        case inventory
+        case jobs
+        case queue
+        case cancel
+        /// Keep the connection open and stream job events to it
+        case subscribe
+        /// Search the file index of every imaged disc by path
+        case findFiles
+        /// Copy one indexed file out of its disc's stored image; the changer is not used
+        case getFile
+        case shutdown
+    }
+
+    /// Echoed in the reply so clients can match replies to requests
+    var id: Int?
+    var command: Command
+    /// queue: the batch to run
+    var job: ControlJob.Kind?
+    /// queue: only these slots (default: every eligible slot)
+    var slots: [Int]?
+    /// queue imageAll: where images are written (default: the daemon's `--output`)
+    var outputDirectory: String?
+    /// cancel: the job to cancel
+    var jobId: Int?
+    /// findFiles: words to match against file paths
+    var query: String?
+    /// getFile: the slot the disc is cataloged in
+    var slot: Int?
+    /// getFile: the file's path on the disc
+    var path: String?
+    /// getFile: where the copy is written (absolute)
+    var destination: String?
+}
+
+/// A reply to one request, or (with `event` set and no `id`) a streamed event
+struct ControlResponse: Codable {
+    var id: Int?
+    var ok: Bool
+    var error: String?
+    var status: ControlStatus?
+    var inventory: [ControlSlot]?
+    var jobs: [ControlJob]?
+    var job: ControlJob?
+    var files: [ControlFile]?
+    var event: ControlEvent?
+
+    static func failure(_ message: String, id: Int? = nil) -> ControlResponse {
+        ControlResponse(id: id, ok: false, error: message)
+    }
+}
+
+struct ControlStatus: Codable {
+    /// "hardware", "mock" or "simulator"
+    let backend: String
+    let connected: Bool
+    let vendor: String?
+    let product: String?
+    let slotCount: Int
+    let hasIESlot: Bool
+    let driveHasDisc: Bool
+    let driveSourceSlot: Int?
+    let activeJobId: Int?
+    let queuedJobs: Int
+}
+
+struct ControlSlot: Codable {
+    let id: Int
+    let isFull: Bool
+    let isInDrive: Bool
+    /// Catalog name of the disc type ("dvd", "audioCDDA", ...; "unscanned" when unknown)
+    let discType: String
+    let volumeLabel: String?
+    /// "notBackedUp", "backedUp" or "failed"
+    let backupStatus: String
+    let backedUpAt: Date?
+
+    init(_ slot: Slot) {
+        id = slot.id
+        isFull = slot.isFull
+        isInDrive = slot.isInDrive
+        discType = "\(slot.discType)"
+        volumeLabel = slot.volumeLabel
+        switch slot.backupStatus {
+        case .notBackedUp:
+            backupStatus = "notBackedUp"
+            backedUpAt = nil
+        case .backedUp(let date):
+            backupStatus = "backedUp"
+            backedUpAt = date
+        case .failed:
+            backupStatus = "failed"
+            backedUpAt = nil
+        }
+    }
+}
+
+/// A file on an imaged disc, from the catalog's file index
+struct ControlFile: Codable {
+    /// The slot the disc was cataloged in
+    let slot: Int
+    let volumeLabel: String?
+    let path: String
+    let sizeBytes: Int64
+    let modifiedAt: Date?
+
+    init(_ hit: DiscFileHit) {
+        slot = hit.disc.slotId
+        volumeLabel = hit.disc.volumeLabel
+        path = hit.file.path
+        sizeBytes = hit.file.sizeBytes
+        modifiedAt = hit.file.modifiedAt
+    }
+}
+
+/// A batch job queued on the daemon. Jobs run one at a time, in queue order.
+struct ControlJob: Codable {
+    enum Kind: String, Codable {
+        case imageAll
+        case scanUnknown
+        case loadAll
+    }
+
+    enum State: String, Codable {
+        case queued
+        case running
+        case completed
+        case cancelled
+        /// Could not start (not connected, nothing eligible)
+        case failed
+    }
+
+    struct Failure: Codable {
+        let slot: Int
+        let error: String
+    }
+
+    let id: Int
+    let kind: Kind
+    var state: State = .queued
+    /// Requested slots; nil means every eligible slot
+    let slots: [Int]?
+    let outputDirectory: String?
+    var total = 0
+    var completed: [Int] = []
+    var failed: [Failure] = []
+    var currentSlot: Int?
+    /// 0...1 including progress through the current disc
+    var progress: Double = 0
+    var statusText = ""
+    /// Imaging jobs only
+    var transferredBytes: Int64?
+    var etaSeconds: TimeInterval?
+    /// Half-width of the 90% interval around `etaSeconds`
+    var etaMarginSeconds: TimeInterval?
+    var error: String?
+    let queuedAt: Date
+    var startedAt: Date?
+    var finishedAt: Date?
+
+    init(id: Int, kind: Kind, slots: [Int]?, outputDirectory: String?, queuedAt: Date) {
+        self.id = id
+        self.kind = kind
+        self.slots = slots
+        self.outputDirectory = outputDirectory
+        self.queuedAt = queuedAt
+    }
+
+    var isFinished: Bool {
+        state == .completed || state == .cancelled || state == .failed
+    }
+}
+
+struct ControlEvent: Codable {
+    enum Kind: String, Codable {
+        case jobQueued
+        case jobStarted
+        case jobProgress
+        /// A slot finished (completed or failed) within a job
+        case slotFinished
+        case jobFinished
+    }
+
+    let kind: Kind
+    let job: ControlJob
+    let slot: Int?
+    let at: Date
+}
+
+extension JSONEncoder {
+    /// Encoder for control socket lines: compact, ISO 8601 dates
+    static var control: JSONEncoder {
+        let encoder = JSONEncoder()
+        encoder.dateEncodingStrategy = .iso8601
+        encoder.outputFormatting = [.sortedKeys]
+        return encoder
+    }
+}
+
+extension JSONDecoder {
+    static var control: JSONDecoder {
+        let decoder = JSONDecoder()
+        decoder.dateDecodingStrategy = .iso8601
+        return decoder
+    }
+}
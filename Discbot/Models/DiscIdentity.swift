@@ -0,0 +1,94 @@
+//
+//  DiscIdentity.swift
+//  Discbot
+//
+//  What a fast scan learns about a disc from its TOC and volume descriptors alone
+//
+
+import Foundation
+
+struct DiscIdentity: Equatable {
+    let discType: DiscType
+    let toc: DiscTOC?
+    let volumeInfo: VolumeInfo?
+    /// Volume label from the descriptors; nil for audio CDs and unreadable media
+    let label: String?
+    let sizeBytes: Int64?
+    /// Stable 64-bit hash (16 hex digits) of the TOC layout and descriptor fields,
+    /// so a disc can be recognized again after it has moved slots
+    let fingerprint: String
+
+    init(discType: DiscType, toc: DiscTOC?, volumeInfo: VolumeInfo?, sizeBytes: Int64?) {
+        self.discType = discType
+        self.toc = toc
+        self.volumeInfo = volumeInfo
+        self.label = (volumeInfo?.label).flatMap { $0.isEmpty ? nil : $0 }
+        self.sizeBytes = sizeBytes
+        self.fingerprint = Self.fingerprint(discType: discType, toc: toc, volumeInfo: volumeInfo, sizeBytes: sizeBytes)
+    }
+
+    /// Bytes covered by the TOC: 2048-byte sectors on data tracks, 2352 on audio tracks
+    static func sizeBytes(of toc: DiscTOC) -> Int64 {
+        toc.tracks.reduce(Int64(0)) { total, track in
+            total + Int64(track.lengthSectors) * (track.isData ? 2048 : 2352)
+        }
+    }
+
+    private static func fingerprint(
+        discType: DiscType,
+        toc: DiscTOC?,
+        volumeInfo: VolumeInfo?,
+        sizeBytes: Int64?
+    ) -> String {
+        var fields: [String] = ["\(discType)", "\(sizeBytes ?? 0)"]
+        if let toc = toc {
+            fields.append(toc.tracks.map { "\($0.number):\($0.isData ? "d" : "a"):\($0.startLBA)" }.joined(separator: ","))
+            fields.append("\(toc.leadOutLBA)")
+        }
+        if let info = volumeInfo {
+            fields += [
+                "\(info.filesystems.rawValue)",
+                info.label,
+                info.creationDate ?? "",
+                info.systemIdentifier ?? "",
+                info.publisher ?? "",
+                info.application ?? "",
+            ]
+        }
+
+        // FNV-1a
+        var hash: UInt64 = 0xcbf2_9ce4_8422_2325
+        for byte in fields.joined(separator: "|").utf8 {
+            hash ^= UInt64(byte)
+            hash = hash &* 0x0000_0100_0000_01b3
+        }
+        return String(format: "%016llx", hash)
+    }
+}
+
+extension ImagingServicing {
+    /// Identify the disc in the drive without mounting it: the TOC (one ioctl on CDs), then
+    /// the volume descriptors if there is a data track. Falls back to `detectDiscType` and
+    /// `estimateDiscSizeBytes` only when neither can be read.
+    func identifyDisc(bsdName: String) -> DiscIdentity {
+        let toc = readTOC(bsdName: bsdName)
+        let volumeInfo = toc?.discType == .audioCDDA ? nil : readVolumeInfo(bsdName: bsdName)
+
+        let discType: DiscType
+        if let toc = toc {
+            discType = toc.discType
+        } else if let volumeInfo = volumeInfo, volumeInfo.filesystems.contains(.udf) {
+            // No CD TOC but a UDF filesystem: DVD or BD
+            discType = .dvd
+        } else {
+            discType = detectDiscType(bsdName: bsdName)
+        }
+
+        // The TOC covers every track (the descriptors only the data track of a mixed-mode disc)
+        let sizeBytes = toc.map(DiscIdentity.sizeBytes(of:))
+            ?? volumeInfo?.sizeBytes
+            ?? estimateDiscSizeBytes(bsdName: bsdName)
+
+        return DiscIdentity(discType: discType, toc: toc, volumeInfo: volumeInfo, sizeBytes: sizeBytes)
+    }
+}
@@ -0,0 +1,183 @@
+//
+//  DiscTOC.swift
+//  Discbot
+//
+//  CD table of contents: tracks, sessions, lead-out and audio/data layout
+//
+
+import Foundation
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+
+struct DiscTOC: Equatable {
+    struct Track: Equatable {
+        let number: Int
+        let session: Int
+        let isData: Bool
+        let preEmphasis: Bool
+        let copyPermitted: Bool
+        let startLBA: Int
+        let lengthSectors: Int
+        let isrc: String?
+
+        init(
+            number: Int,
+            session: Int = 1,
+            isData: Bool,
+            preEmphasis: Bool = false,
+            copyPermitted: Bool = false,
+            startLBA: Int,
+            lengthSectors: Int,
+            isrc: String? = nil
+        ) {
+            self.number = number
+            self.session = session
+            self.isData = isData
+            self.preEmphasis = preEmphasis
+            self.copyPermitted = copyPermitted
+            self.startLBA = startLBA
+            self.lengthSectors = lengthSectors
+            self.isrc = isrc
+        }
+    }
+
+    struct Session: Equatable {
+        let number: Int
+        let firstTrack: Int
+        let lastTrack: Int
+        let leadOutLBA: Int
+    }
+
+    /// Tracks in track-number order
+    let tracks: [Track]
+    let sessions: [Session]
+    /// Lead-out of the last session
+    let leadOutLBA: Int
+    /// Media catalog number (UPC/EAN), when read and present
+    let mediaCatalogNumber: String?
+
+    init(tracks: [Track], sessions: [Session], leadOutLBA: Int, mediaCatalogNumber: String? = nil) {
+        self.tracks = tracks
+        self.sessions = sessions
+        self.leadOutLBA = leadOutLBA
+        self.mediaCatalogNumber = mediaCatalogNumber
+    }
+
+    init(_ toc: toc_t) {
+        var toc = toc
+        let cTracks = Self.elements(&toc.tracks, count: Int(toc.track_count), of: toc_track_t.self)
+        tracks = cTracks.map { track in
+            var track = track
+            let isrc = Self.string(&track.isrc)
+            return Track(
+                number: Int(track.number),
+                session: Int(track.session),
+                isData: track.is_data,
+                preEmphasis: track.pre_emphasis,
+                copyPermitted: track.copy_permitted,
+                startLBA: Int(track.start_lba),
+                lengthSectors: Int(track.length_sectors),
+                isrc: isrc.isEmpty ? nil : isrc
+            )
+        }
+        sessions = Self.elements(&toc.sessions, count: Int(toc.session_count), of: toc_session_t.self).map {
+            Session(
+                number: Int($0.number),
+                firstTrack: Int($0.first_track),
+                lastTrack: Int($0.last_track),
+                leadOutLBA: Int($0.leadout_lba)
+            )
+        }
+        leadOutLBA = Int(toc.leadout_lba)
+        let mcn = Self.string(&toc.mcn)
+        mediaCatalogNumber = mcn.isEmpty ? nil : mcn
+    }
+
+    /// Read the TOC of the disc in the drive with one ioctl (blocking). `includeCodes` also
+    /// reads the MCN and per-track ISRCs, which takes a sub-channel read per audio track.
+    /// Nil for DVD/BD media and when the drive cannot be read.
+    static func read(bsdName: String, includeCodes: Bool = false) -> DiscTOC? {
+        #if DISCBOT_NO_HARDWARE
+        // The ioctl is in mount.c, which needs IOKit
+        return nil
+        #else
+        var toc = toc_t()
+        guard mount_read_toc(bsdName, includeCodes, &toc) == 0 else { return nil }
+        return DiscTOC(toc)
+        #endif
+    }
+
+    var audioTrackCount: Int {
+        tracks.filter { !$0.isData }.count
+    }
+
+    var dataTrackCount: Int {
+        tracks.filter { $0.isData }.count
+    }
+
+    var discType: DiscType {
+        if dataTrackCount == 0 {
+            return .audioCDDA
+        }
+        return audioTrackCount == 0 ? .dataCD : .mixedModeCD
+    }
+
+    /// MusicBrainz and FreeDB IDs; nil for discs without audio tracks
+    var discIDs: MetadataService.DiscIDs? {
+        var toc = cValue
+        var firstTrack: Int32 = 0
+        var lastTrack: Int32 = 0
+        var leadOut: UInt32 = 0
+        var offsets = [UInt32](repeating: 0, count: Int(TOC_MAX_TRACKS))
+        let count = toc_disc_id_layout(&toc, &firstTrack, &lastTrack, &leadOut, &offsets)
+        guard count > 0 else { return nil }
+
+        return MetadataService.calculateDiscIDs(
+            firstTrack: Int(firstTrack),
+            lastTrack: Int(lastTrack),
+            leadOutOffset: Int(leadOut),
+            trackOffsets: offsets.prefix(Int(count)).map { Int($0) }
+        )
+    }
+
+    // MARK: - C Interop
+
+    /// The layout fields of the C struct, so disc ID rules live in one place (toc.c)
+    private var cValue: toc_t {
+        var toc = toc_t()
+        let tracks = self.tracks.prefix(Int(TOC_MAX_TRACKS))
+        withUnsafeMutableBytes(of: &toc.tracks) { raw in
+            let buffer = raw.bindMemory(to: toc_track_t.self)
+            for (index, track) in tracks.enumerated() {
+                buffer[index].number = UInt8(clamping: track.number)
+                buffer[index].session = UInt8(clamping: track.session)
+                buffer[index].is_data = track.isData
+                buffer[index].start_lba = UInt32(clamping: track.startLBA)
+                buffer[index].length_sectors = UInt32(clamping: track.lengthSectors)
+            }
+        }
+        toc.track_count = UInt8(tracks.count)
+        toc.audio_track_count = UInt8(clamping: tracks.filter { !$0.isData }.count)
+        toc.data_track_count = UInt8(clamping: tracks.filter { $0.isData }.count)
+        toc.first_track = UInt8(clamping: tracks.first?.number ?? 0)
+        toc.last_track = UInt8(clamping: tracks.last?.number ?? 0)
+        toc.leadout_lba = UInt32(clamping: leadOutLBA)
+        return toc
+    }
+
+    /// C fixed-size arrays are imported as tuples
+    private static func elements<T, Element>(_ tuple: inout T, count: Int, of type: Element.Type) -> [Element] {
+        withUnsafeBytes(of: &tuple) { raw in
+            Array(raw.bindMemory(to: Element.self).prefix(count))
+        }
+    }
+
+    private static func string<T>(_ tuple: inout T) -> String {
+        withUnsafePointer(to: &tuple) { pointer in
+            pointer.withMemoryRebound(to: CChar.self, capacity: MemoryLayout<T>.size) {
+                String(cString: $0)
+            }
+        }
+    }
+}
@@ -0,0 +1,35 @@
+//
+//  ImageDestination.swift
+//  Discbot
+//
+//  An extra place disc images are written to alongside the output folder
+//
+
+import Foundation
+
+struct ImageDestination: Codable, Equatable {
+    enum Kind: String, Codable {
+        /// A folder, on this volume or another (external disk, mounted NAS share)
+        case directory
+        /// A local object-store stand-in: the image is stored under its key with a
+        /// `<key>.metadata.json` sidecar carrying size, SHA-256 and content type
+        case objectStore
+    }
+
+    let kind: Kind
+    let url: URL
+
+    /// Where an image named `fileName` ends up in this destination
+    func imageURL(fileName: String) -> URL {
+        url.appendingPathComponent(fileName)
+    }
+
+    var displayName: String {
+        switch kind {
+        case .directory:
+            return url.path
+        case .objectStore:
+            return "\(url.path) (object store)"
+        }
+    }
+}
@@ -0,0 +1,38 @@
+//
+//  ImageVerification.swift
+//  Discbot
+//
+//  Read-back verification of a written image against the disc still in the drive
+//
+
+import Foundation
+
+enum ImageVerifyMode: String, Codable, CaseIterable {
+    /// Record the image as completed without re-reading the disc
+    case off
+    /// Compare the first and last chunks plus an even spread between them
+    case sampled
+    /// Re-read the whole disc; the image's SHA-256 is recorded as well
+    case full
+
+    var displayName: String {
+        switch self {
+        case .off: return "Off"
+        case .sampled: return "Sampled sectors"
+        case .full: return "Whole disc"
+        }
+    }
+}
+
+struct ImageVerificationResult {
+    let mode: ImageVerifyMode
+    let bytesCompared: Int64
+    /// First byte that differs, or the disc's end if it is shorter than the image
+    let mismatchOffset: Int64?
+    /// SHA-256 of the whole image (full mode only)
+    let imageSHA256: String?
+
+    var isVerified: Bool {
+        mismatchOffset == nil
+    }
+}
@@ -0,0 +1,33 @@
+//
+//  ImageWriteOptions.swift
+//  Discbot
+//
+//  How image files are written: page-cache bypass and when data is forced to disk
+//
+
+import Foundation
+
+struct ImageWriteOptions: Codable, Equatable {
+    enum Durability: String, Codable, CaseIterable {
+        /// Leave flushing to the OS; fastest, but a power cut can truncate a finished image
+        case none
+        /// One full sync before the image is renamed into place
+        case atEnd
+        /// Sync every megabyte as well, so an interrupted image never holds unsynced data
+        case perChunk
+
+        var displayName: String {
+            switch self {
+            case .none: return "None"
+            case .atEnd: return "When the image is complete"
+            case .perChunk: return "After every chunk"
+            }
+        }
+    }
+
+    var durability: Durability = .atEnd
+    /// Write around the page cache so imaging a DVD does not evict everything else
+    var bypassCache = true
+
+    static let standard = ImageWriteOptions()
+}
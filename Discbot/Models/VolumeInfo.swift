@@ -0,0 +1,77 @@
+//
+//  VolumeInfo.swift
+//  Discbot
+//
+//  Volume label and filesystem metadata read from raw disc sectors
+//
+
+import Foundation
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+
+struct VolumeInfo: Equatable {
+    struct Filesystems: OptionSet, Equatable {
+        let rawValue: UInt32
+
+        static let iso9660 = Filesystems(rawValue: VOLINFO_FS_ISO9660)
+        static let joliet = Filesystems(rawValue: VOLINFO_FS_JOLIET)
+        static let udf = Filesystems(rawValue: VOLINFO_FS_UDF)
+        static let hfs = Filesystems(rawValue: VOLINFO_FS_HFS)
+        static let hfsPlus = Filesystems(rawValue: VOLINFO_FS_HFSPLUS)
+    }
+
+    let filesystems: Filesystems
+    /// The label macOS would show if the disc were mounted
+    let label: String
+    let systemIdentifier: String?
+    let publisher: String?
+    let application: String?
+    /// ISO 9660 creation timestamp, "YYYYMMDDHHMMSScc"
+    let creationDate: String?
+    let blockSize: Int
+    let sizeBytes: Int64?
+
+    init(filesystems: Filesystems, label: String, sizeBytes: Int64?, blockSize: Int = 2048) {
+        self.filesystems = filesystems
+        self.label = label
+        self.systemIdentifier = nil
+        self.publisher = nil
+        self.application = nil
+        self.creationDate = nil
+        self.blockSize = blockSize
+        self.sizeBytes = sizeBytes
+    }
+
+    init(_ info: volinfo_t) {
+        var info = info
+        filesystems = Filesystems(rawValue: info.filesystems)
+        label = Self.string(&info.volume_label)
+        systemIdentifier = Self.nonEmpty(Self.string(&info.system_id))
+        publisher = Self.nonEmpty(Self.string(&info.publisher))
+        application = Self.nonEmpty(Self.string(&info.application))
+        creationDate = Self.nonEmpty(Self.string(&info.creation_date))
+        blockSize = Int(info.block_size)
+        sizeBytes = info.volume_size_bytes > 0 ? Int64(info.volume_size_bytes) : nil
+    }
+
+    /// Probe a raw device or image file without mounting it (blocking)
+    static func probe(path: String) -> VolumeInfo? {
+        var info = volinfo_t()
+        guard volinfo_probe_path(path, &info) == 0 else { return nil }
+        return VolumeInfo(info)
+    }
+
+    /// C fixed-size char arrays are imported as tuples
+    private static func string<T>(_ tuple: inout T) -> String {
+        withUnsafePointer(to: &tuple) { pointer in
+            pointer.withMemoryRebound(to: CChar.self, capacity: MemoryLayout<T>.size) {
+                String(cString: $0)
+            }
+        }
+    }
+
+    private static func nonEmpty(_ value: String) -> String? {
+        value.isEmpty ? nil : value
+    }
+}
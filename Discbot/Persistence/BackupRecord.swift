@@ -14,7 +14,7 @@ struct BackupRecord {
     let backupSizeBytes: Int64?
     let backupHash: String?
     let backupDate: String
-    let backupStatus: String  // 'completed', 'failed', 'in_progress'
+    let backupStatus: String  // 'completed', 'verified', 'mismatch', 'failed', 'in_progress'
     let errorMessage: String?
 
     init(
@@ -32,21 +32,26 @@ struct BackupRecord {
         self.backupPath = backupPath
         self.backupSizeBytes = backupSizeBytes
         self.backupHash = backupHash
-        self.backupDate = backupDate ?? ISO8601DateFormatter().string(from: Date())
+        self.backupDate = backupDate ?? CatalogTimestamp.string(from: Date())
         self.backupStatus = backupStatus
         self.errorMessage = errorMessage
     }
 
+    /// A usable image, whether or not it was read back against the disc
     var isCompleted: Bool {
-        backupStatus == "completed"
+        backupStatus == "completed" || isVerified
     }
 
+    var isVerified: Bool {
+        backupStatus == "verified"
+    }
+
+    /// The image was written but does not match the disc
     var isFailed: Bool {
-        backupStatus == "failed"
+        backupStatus == "failed" || backupStatus == "mismatch"
     }
 
     var backupDateParsed: Date? {
-        let formatter = ISO8601DateFormatter()
-        return formatter.date(from: backupDate)
+        CatalogTimestamp.date(from: backupDate)
     }
 }
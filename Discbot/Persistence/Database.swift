@@ -6,33 +6,65 @@
 //
 
 import Foundation
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+
+/// Catalog timestamps are stored as ISO 8601 text. ISO8601DateFormatter is
+/// thread-safe, so one instance serves every reader and writer.
+enum CatalogTimestamp {
+    private static let formatter = ISO8601DateFormatter()
+
+    static func string(from date: Date) -> String {
+        formatter.string(from: date)
+    }
+
+    static func date(from string: String) -> Date? {
+        formatter.date(from: string)
+    }
+}
 
 final class Database {
     static let shared = Database()
 
-    private var db: OpaquePointer?
-    private let queue = DispatchQueue(label: "discbot.database", qos: .userInitiated)
+    /// Read-only connections, so catalog reads never wait behind batch writes.
+    private static let readerCount = 2
+
+    private let writer: SQLiteConnection?
+    private let readers: [SQLiteConnection]
+    private let readerLock = NSLock()
+    private var nextReader = 0
+    private let hasSearchIndex: Bool
 
-    private init() {
-        openDatabase()
-        createTables()
+    private convenience init() {
+        self.init(path: Database.defaultPath())
     }
 
-    deinit {
-        if let db = db {
-            sqlite3_close(db)
+    /// Open (creating if needed) a catalog at `path`; used by the benchmark suite to stay off the user's catalog.
+    init(path: String?) {
+        guard let path = path, let writer = Database.openDatabase(at: path) else {
+            writer = nil
+            readers = []
+            hasSearchIndex = false
+            return
+        }
+        self.writer = writer
+        hasSearchIndex = writer.sync { Database.createTables(on: $0) }
+        // Readers open after the schema exists; WAL lets them run alongside the writer.
+        readers = (0..<Self.readerCount).compactMap {
+            SQLiteConnection(path: path, readOnly: true, label: "discbot.database.reader\($0)")
         }
     }
 
     // MARK: - Database Setup
 
-    private func openDatabase() {
+    private static func defaultPath() -> String? {
         let fileManager = FileManager.default
 
         // Get Application Support directory
         guard let appSupport = fileManager.urls(for: .applicationSupportDirectory, in: .userDomainMask).first else {
             print("Database: Failed to get Application Support directory")
-            return
+            return nil
         }
 
         let discbotDir = appSupport.appendingPathComponent("Discbot", isDirectory: true)
@@ -43,24 +75,33 @@ final class Database {
                 try fileManager.createDirectory(at: discbotDir, withIntermediateDirectories: true, attributes: nil)
             } catch {
                 print("Database: Failed to create directory: \(error)")
-                return
+                return nil
             }
         }
 
-        let dbPath = discbotDir.appendingPathComponent("discbot.sqlite").path
+        return discbotDir.appendingPathComponent("discbot.sqlite").path
+    }
+
+    private static func openDatabase(at dbPath: String) -> SQLiteConnection? {
         print("Database: Opening at \(dbPath)")
 
-        if sqlite3_open(dbPath, &db) != SQLITE_OK {
-            print("Database: Failed to open database")
-            if let db = db {
-                print("Database: Error - \(String(cString: sqlite3_errmsg(db)))")
-            }
-            db = nil
+        guard let connection = SQLiteConnection(path: dbPath, readOnly: false, label: "discbot.database") else {
+            return nil
         }
+        // WAL: one fsync per committed transaction, and readers are not blocked by the writer.
+        connection.execute(sql: "PRAGMA journal_mode = WAL;")
+        // SQLite leaves foreign keys unenforced per connection, which would make the ON DELETE CASCADE
+        // clauses (job_tasks, disc_files and through its trigger disc_files_fts) dead. Readers never delete.
+        connection.execute(sql: "PRAGMA foreign_keys = ON;")
+        return connection
     }
 
-    private func createTables() {
-        let createDiscsTable = """
+    /// Schema steps applied in order; step N leaves `PRAGMA user_version` at N.
+    /// Catalogs from before versioning start at 0 and replay step 1 harmlessly.
+    /// Append new steps; never edit one that has shipped.
+    private static let migrations: [String] = [
+        // 1: discs and their backups
+        """
             CREATE TABLE IF NOT EXISTS discs (
                 id INTEGER PRIMARY KEY AUTOINCREMENT,
                 slot_id INTEGER NOT NULL UNIQUE,
@@ -79,9 +120,6 @@ final class Database {
                 metadata_fetched_at TEXT
             );
             CREATE INDEX IF NOT EXISTS idx_discs_slot ON discs(slot_id);
-            """
-
-        let createBackupsTable = """
             CREATE TABLE IF NOT EXISTS backups (
                 id INTEGER PRIMARY KEY AUTOINCREMENT,
                 disc_id INTEGER NOT NULL,
@@ -94,52 +132,284 @@ final class Database {
                 FOREIGN KEY (disc_id) REFERENCES discs(id)
             );
             CREATE INDEX IF NOT EXISTS idx_backups_disc ON backups(disc_id);
-            """
+            """,
+        // 2: latest-completed-backup lookups
+        """
+            DROP INDEX IF EXISTS idx_backups_disc;
+            CREATE INDEX IF NOT EXISTS idx_backups_disc_status_date ON backups(disc_id, backup_status, backup_date);
+            """,
+        // 3: append-only log of timed changer, drive and imaging steps (times are Unix seconds)
+        """
+            CREATE TABLE IF NOT EXISTS events (
+                id INTEGER PRIMARY KEY,
+                slot_id INTEGER,
+                operation TEXT NOT NULL,
+                started_at REAL NOT NULL,
+                ended_at REAL NOT NULL,
+                bytes INTEGER,
+                throughput REAL,
+                result TEXT NOT NULL,
+                error TEXT
+            );
+            CREATE INDEX IF NOT EXISTS idx_events_operation_started ON events(operation, started_at);
+            """,
+        // 4: fast-scan fingerprint, to recognize a disc that has moved slots
+        """
+            ALTER TABLE discs ADD COLUMN fingerprint TEXT;
+            CREATE INDEX IF NOT EXISTS idx_discs_fingerprint ON discs(fingerprint);
+            """,
+        // 5: durable batch job queue, one task per slot, so a crashed run can resume
+        """
+            CREATE TABLE IF NOT EXISTS jobs (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                kind TEXT NOT NULL,
+                state TEXT NOT NULL,
+                output_directory TEXT,
+                created_at TEXT NOT NULL,
+                started_at TEXT,
+                finished_at TEXT,
+                updated_at TEXT NOT NULL
+            );
+            CREATE INDEX IF NOT EXISTS idx_jobs_state ON jobs(state);
+            CREATE TABLE IF NOT EXISTS job_tasks (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                job_id INTEGER NOT NULL,
+                slot_id INTEGER NOT NULL,
+                state TEXT NOT NULL,
+                attempts INTEGER NOT NULL DEFAULT 0,
+                error TEXT,
+                started_at TEXT,
+                finished_at TEXT,
+                UNIQUE (job_id, slot_id),
+                FOREIGN KEY (job_id) REFERENCES jobs(id) ON DELETE CASCADE
+            );
+            """,
+        // 6: file tree of each imaged disc; extents are "offset+length" byte ranges of the backup's image
+        """
+            CREATE TABLE IF NOT EXISTS disc_files (
+                id INTEGER PRIMARY KEY,
+                disc_id INTEGER NOT NULL,
+                backup_id INTEGER,
+                path TEXT NOT NULL,
+                size_bytes INTEGER NOT NULL,
+                modified_at REAL,
+                extents TEXT NOT NULL,
+                FOREIGN KEY (disc_id) REFERENCES discs(id) ON DELETE CASCADE,
+                FOREIGN KEY (backup_id) REFERENCES backups(id)
+            );
+            CREATE INDEX IF NOT EXISTS idx_disc_files_disc_path ON disc_files(disc_id, path);
+            """,
+        // 7: which drive an event ran on and the type of disc it handled, so timings from
+        // different changers and media are not mixed
+        """
+            ALTER TABLE events ADD COLUMN drive TEXT;
+            ALTER TABLE events ADD COLUMN disc_type TEXT;
+            """,
+        // 8: the process that owns each job, so the app and the daemon never reclaim each other's live jobs
+        """
+            ALTER TABLE jobs ADD COLUMN owner_pid INTEGER;
+            ALTER TABLE jobs ADD COLUMN owner_host TEXT;
+            ALTER TABLE jobs ADD COLUMN owner_boot TEXT;
+            """,
+        // 9: the BSD device an event's disc was on; `drive` now names the optical drive rather than the changer
+        """
+            ALTER TABLE events ADD COLUMN device TEXT;
+            """,
+    ]
 
-        execute(sql: createDiscsTable)
-        execute(sql: createBackupsTable)
+    /// Returns whether the full-text search index is available.
+    private static func createTables(on connection: SQLiteConnection) -> Bool {
+        migrate(on: connection)
+        return createSearchIndex(on: connection)
     }
 
-    // MARK: - Helpers
+    private static func migrate(on connection: SQLiteConnection) {
+        var version = 0
+        if let stmt = connection.statement(for: "PRAGMA user_version") {
+            if sqlite3_step(stmt) == SQLITE_ROW {
+                version = Int(sqlite3_column_int(stmt, 0))
+            }
+            sqlite3_reset(stmt)
+        }
+
+        while version < migrations.count {
+            let target = version + 1
+            connection.execute(sql: "BEGIN IMMEDIATE")
+            guard
+                connection.execute(sql: migrations[version]),
+                connection.execute(sql: "PRAGMA user_version = \(target)")
+            else {
+                print("Database: Migration to schema version \(target) failed")
+                connection.execute(sql: "ROLLBACK")
+                return
+            }
+            connection.execute(sql: "COMMIT")
+            version = target
+        }
+    }
+
+    /// Full-text index over every cataloged disc, including discs no longer in the changer.
+    /// Rows share the disc's id; triggers keep it in step with `discs` and `backups`.
+    /// It sits outside `migrations` because FTS5 may be missing from the SQLite build, so it
+    /// is its own one-time step instead: created, wired up and filled in one transaction,
+    /// then left to the triggers on every later open.
+    private static func createSearchIndex(on connection: SQLiteConnection) -> Bool {
+        var existed = false
+        if let stmt = connection.statement(for: "SELECT 1 FROM sqlite_master WHERE name = 'catalog_fts'") {
+            existed = sqlite3_step(stmt) == SQLITE_ROW
+            sqlite3_reset(stmt)
+        }
+        if existed {
+            createFileSearchIndex(on: connection)
+            return true
+        }
 
-    private func execute(sql: String) {
-        guard let db = db else { return }
+        let createIndex = """
+            CREATE VIRTUAL TABLE catalog_fts USING fts5(
+                volume_label, artist, album, year, genre, disc_type, backup_paths,
+                tokenize = 'unicode61 remove_diacritics 2'
+            );
+            """
 
+        connection.execute(sql: "BEGIN IMMEDIATE")
         var errMsg: UnsafeMutablePointer<CChar>?
-        if sqlite3_exec(db, sql, nil, nil, &errMsg) != SQLITE_OK {
+        guard sqlite3_exec(connection.db, createIndex, nil, nil, &errMsg) == SQLITE_OK else {
             if let errMsg = errMsg {
-                print("Database: SQL error - \(String(cString: errMsg))")
+                print("Database: Full-text search unavailable - \(String(cString: errMsg))")
                 sqlite3_free(errMsg)
             }
+            connection.execute(sql: "ROLLBACK")
+            return false
+        }
+
+        let createTriggers = """
+            CREATE TRIGGER discs_fts_insert AFTER INSERT ON discs BEGIN
+                INSERT INTO catalog_fts(rowid, volume_label, artist, album, year, genre, disc_type, backup_paths)
+                VALUES (new.id, new.volume_label, new.artist, new.album, new.year, new.genre, new.disc_type, '');
+            END;
+            CREATE TRIGGER discs_fts_update AFTER UPDATE ON discs BEGIN
+                UPDATE catalog_fts SET
+                    volume_label = new.volume_label, artist = new.artist, album = new.album,
+                    year = new.year, genre = new.genre, disc_type = new.disc_type
+                WHERE rowid = new.id;
+            END;
+            CREATE TRIGGER discs_fts_delete AFTER DELETE ON discs BEGIN
+                DELETE FROM catalog_fts WHERE rowid = old.id;
+            END;
+            CREATE TRIGGER backups_fts_insert AFTER INSERT ON backups BEGIN
+                UPDATE catalog_fts SET backup_paths =
+                    (SELECT group_concat(backup_path, ' ') FROM backups WHERE disc_id = new.disc_id)
+                WHERE rowid = new.disc_id;
+            END;
+            CREATE TRIGGER backups_fts_delete AFTER DELETE ON backups BEGIN
+                UPDATE catalog_fts SET backup_paths =
+                    COALESCE((SELECT group_concat(backup_path, ' ') FROM backups WHERE disc_id = old.disc_id), '')
+                WHERE rowid = old.disc_id;
+            END;
+            """
+
+        // Discs cataloged before the index existed, or while FTS5 was unavailable
+        let backfill = """
+            INSERT INTO catalog_fts(rowid, volume_label, artist, album, year, genre, disc_type, backup_paths)
+            SELECT d.id, d.volume_label, d.artist, d.album, d.year, d.genre, d.disc_type,
+                COALESCE((SELECT group_concat(b.backup_path, ' ') FROM backups b WHERE b.disc_id = d.id), '')
+            FROM discs d;
+            """
+        guard connection.execute(sql: createTriggers), connection.execute(sql: backfill) else {
+            print("Database: Creating the full-text search index failed")
+            connection.execute(sql: "ROLLBACK")
+            return false
+        }
+        connection.execute(sql: "COMMIT")
+        createFileSearchIndex(on: connection)
+        return true
+    }
+
+    /// Full-text index over file paths, stored without a copy of the text (paths stay in `disc_files`).
+    /// The tokenizer splits on '/', '_' and '.', so "q3 pdf" finds TAX_RECORDS_2021/q3.pdf.
+    private static func createFileSearchIndex(on connection: SQLiteConnection) {
+        var existed = false
+        if let stmt = connection.statement(for: "SELECT 1 FROM sqlite_master WHERE name = 'disc_files_fts'") {
+            existed = sqlite3_step(stmt) == SQLITE_ROW
+            sqlite3_reset(stmt)
         }
+
+        let createIndex = """
+            CREATE VIRTUAL TABLE IF NOT EXISTS disc_files_fts USING fts5(
+                path, content = 'disc_files', content_rowid = 'id',
+                tokenize = 'unicode61 remove_diacritics 2'
+            );
+            CREATE TRIGGER IF NOT EXISTS disc_files_fts_insert AFTER INSERT ON disc_files BEGIN
+                INSERT INTO disc_files_fts(rowid, path) VALUES (new.id, new.path);
+            END;
+            CREATE TRIGGER IF NOT EXISTS disc_files_fts_delete AFTER DELETE ON disc_files BEGIN
+                INSERT INTO disc_files_fts(disc_files_fts, rowid, path) VALUES ('delete', old.id, old.path);
+            END;
+            """
+        connection.execute(sql: createIndex)
+
+        // Files indexed while FTS5 was unavailable
+        if !existed {
+            connection.execute(sql: "INSERT INTO disc_files_fts(disc_files_fts) VALUES ('rebuild');")
+        }
+    }
+
+    // MARK: - Helpers
+
+    /// Run `body` on the writer connection, or return `empty` when the catalog is unavailable.
+    private func write<T>(_ empty: T, _ body: (SQLiteConnection) -> T) -> T {
+        guard let writer = writer else { return empty }
+        return writer.sync(body)
+    }
+
+    /// Run `body` on the next reader connection (the writer if none could be opened).
+    private func read<T>(_ empty: T, _ body: (SQLiteConnection) -> T) -> T {
+        guard !readers.isEmpty else { return write(empty, body) }
+        readerLock.lock()
+        let reader = readers[nextReader % readers.count]
+        nextReader += 1
+        readerLock.unlock()
+        return reader.sync(body)
+    }
+
+    /// Group the writes made by `body` into a single transaction, rolled back when it returns false.
+    @discardableResult
+    func transaction(_ body: () -> Bool) -> Bool {
+        guard let writer = writer else { return body() }
+        return writer.transaction { _ -> Bool in body() }
     }
 
     // MARK: - Disc Operations
 
-    func insertOrUpdateDisc(_ disc: DiscRecord) -> Int64? {
-        return queue.sync {
-            guard let db = db else { return nil }
+    /// True when the stored row has MusicBrainz metadata that the incoming record (source ?7) would downgrade
+    private static let keepsOnlineMetadata = "metadata_source = 'musicBrainz' AND ?7 IS NOT 'musicBrainz'"
 
-            let now = ISO8601DateFormatter().string(from: Date())
+    func insertOrUpdateDisc(_ disc: DiscRecord) -> Int64? {
+        return write(nil) { connection in
+            let now = CatalogTimestamp.string(from: Date())
 
             // Check if disc exists
-            if let existing = getDiscSync(slotId: disc.slotId) {
-                // Update existing
+            if let existing = getDiscSync(slotId: disc.slotId, on: connection) {
+                // Update existing. Metadata back-filled from MusicBrainz is kept
+                // unless the new record also comes from MusicBrainz.
                 let sql = """
                     UPDATE discs SET
-                        volume_label = ?,
-                        disc_type = ?,
-                        size_bytes = ?,
-                        artist = COALESCE(?, artist),
-                        album = COALESCE(?, album),
-                        year = COALESCE(?, year),
-                        metadata_source = COALESCE(?, metadata_source),
-                        last_seen_at = ?
-                    WHERE slot_id = ?
+                        volume_label = ?1,
+                        disc_type = ?2,
+                        size_bytes = ?3,
+                        artist = CASE WHEN \(Self.keepsOnlineMetadata) THEN artist ELSE COALESCE(?4, artist) END,
+                        album = CASE WHEN \(Self.keepsOnlineMetadata) THEN album ELSE COALESCE(?5, album) END,
+                        year = CASE WHEN \(Self.keepsOnlineMetadata) THEN year ELSE COALESCE(?6, year) END,
+                        metadata_source = CASE WHEN \(Self.keepsOnlineMetadata) THEN metadata_source
+                            ELSE COALESCE(?7, metadata_source) END,
+                        last_seen_at = ?8,
+                        musicbrainz_disc_id = COALESCE(?10, musicbrainz_disc_id),
+                        track_count = COALESCE(?11, track_count),
+                        fingerprint = COALESCE(?12, fingerprint)
+                    WHERE slot_id = ?9
                     """
 
-                var stmt: OpaquePointer?
-                if sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK {
+                if let stmt = connection.statement(for: sql) {
                     sqlite3_bind_text(stmt, 1, disc.volumeLabel, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     sqlite3_bind_text(stmt, 2, disc.discType, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     if let size = disc.sizeBytes {
@@ -153,20 +423,26 @@ final class Database {
                     sqlite3_bind_text(stmt, 7, disc.metadataSource, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     sqlite3_bind_text(stmt, 8, now, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     sqlite3_bind_int(stmt, 9, Int32(disc.slotId))
+                    sqlite3_bind_text(stmt, 10, disc.musicbrainzDiscId, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    if let trackCount = disc.trackCount {
+                        sqlite3_bind_int(stmt, 11, Int32(trackCount))
+                    } else {
+                        sqlite3_bind_null(stmt, 11)
+                    }
+                    sqlite3_bind_text(stmt, 12, disc.fingerprint, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
 
                     sqlite3_step(stmt)
-                    sqlite3_finalize(stmt)
+                    sqlite3_reset(stmt)
                 }
                 return existing.id
             } else {
                 // Insert new
                 let sql = """
-                    INSERT INTO discs (slot_id, volume_label, disc_type, size_bytes, artist, album, year, metadata_source, first_seen_at, last_seen_at)
-                    VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+                    INSERT INTO discs (slot_id, volume_label, disc_type, size_bytes, artist, album, year, metadata_source, first_seen_at, last_seen_at, musicbrainz_disc_id, track_count, fingerprint)
+                    VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
                     """
 
-                var stmt: OpaquePointer?
-                if sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK {
+                if let stmt = connection.statement(for: sql) {
                     sqlite3_bind_int(stmt, 1, Int32(disc.slotId))
                     sqlite3_bind_text(stmt, 2, disc.volumeLabel, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     sqlite3_bind_text(stmt, 3, disc.discType, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
@@ -181,12 +457,19 @@ final class Database {
                     sqlite3_bind_text(stmt, 8, disc.metadataSource, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     sqlite3_bind_text(stmt, 9, now, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
                     sqlite3_bind_text(stmt, 10, now, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(stmt, 11, disc.musicbrainzDiscId, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    if let trackCount = disc.trackCount {
+                        sqlite3_bind_int(stmt, 12, Int32(trackCount))
+                    } else {
+                        sqlite3_bind_null(stmt, 12)
+                    }
+                    sqlite3_bind_text(stmt, 13, disc.fingerprint, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
 
                     if sqlite3_step(stmt) == SQLITE_DONE {
-                        sqlite3_finalize(stmt)
-                        return sqlite3_last_insert_rowid(db)
+                        sqlite3_reset(stmt)
+                        return sqlite3_last_insert_rowid(connection.db)
                     }
-                    sqlite3_finalize(stmt)
+                    sqlite3_reset(stmt)
                 }
                 return nil
             }
@@ -194,19 +477,16 @@ final class Database {
     }
 
     func getDisc(slotId: Int) -> DiscRecord? {
-        return queue.sync {
-            getDiscSync(slotId: slotId)
+        return read(nil) { connection in
+            getDiscSync(slotId: slotId, on: connection)
         }
     }
 
-    private func getDiscSync(slotId: Int) -> DiscRecord? {
-        guard let db = db else { return nil }
-
+    private func getDiscSync(slotId: Int, on connection: SQLiteConnection) -> DiscRecord? {
         let sql = "SELECT * FROM discs WHERE slot_id = ?"
-        var stmt: OpaquePointer?
 
-        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return nil }
-        defer { sqlite3_finalize(stmt) }
+        guard let stmt = connection.statement(for: sql) else { return nil }
+        defer { sqlite3_reset(stmt) }
 
         sqlite3_bind_int(stmt, 1, Int32(slotId))
 
@@ -216,15 +496,12 @@ final class Database {
     }
 
     func getAllDiscs() -> [DiscRecord] {
-        return queue.sync {
-            guard let db = db else { return [] }
-
+        return read([]) { connection in
             let sql = "SELECT * FROM discs ORDER BY slot_id"
-            var stmt: OpaquePointer?
             var discs: [DiscRecord] = []
 
-            guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return [] }
-            defer { sqlite3_finalize(stmt) }
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
 
             while sqlite3_step(stmt) == SQLITE_ROW {
                 if let disc = discFromStatement(stmt) {
@@ -236,6 +513,179 @@ final class Database {
         }
     }
 
+    // MARK: - MusicBrainz Back-fill
+
+    /// Disc IDs that are cataloged but have never been looked up, with the slots holding them
+    func getPendingMusicBrainzLookups(limit: Int = 500) -> [(discId: String, slotIds: [Int])] {
+        return read([]) { connection in
+            let sql = """
+                SELECT musicbrainz_disc_id, slot_id FROM discs
+                WHERE musicbrainz_disc_id IS NOT NULL AND metadata_fetched_at IS NULL
+                ORDER BY musicbrainz_disc_id
+                LIMIT ?
+                """
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            sqlite3_bind_int(stmt, 1, Int32(limit))
+
+            var pending: [(discId: String, slotIds: [Int])] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                guard let ptr = sqlite3_column_text(stmt, 0) else { continue }
+                let discId = String(cString: ptr)
+                let slotId = Int(sqlite3_column_int(stmt, 1))
+                if pending.last?.discId == discId {
+                    pending[pending.count - 1].slotIds.append(slotId)
+                } else {
+                    pending.append((discId, [slotId]))
+                }
+            }
+            return pending
+        }
+    }
+
+    /// Write a batch of finished lookups in one transaction. Each disc ID is first attached to
+    /// the slots it was read from, then every disc carrying it gets the release (or, for a
+    /// disc MusicBrainz does not know, just the lookup time so it is not retried).
+    func applyMusicBrainzLookups(_ lookups: [MusicBrainzLookup]) {
+        guard !lookups.isEmpty else { return }
+        write(()) { connection in
+            let attachSQL = "UPDATE discs SET musicbrainz_disc_id = ? WHERE slot_id = ?"
+            let updateSQL = """
+                UPDATE discs SET
+                    artist = COALESCE(?2, artist),
+                    album = COALESCE(?3, album),
+                    year = COALESCE(?4, year),
+                    metadata_source = CASE WHEN ?3 IS NULL THEN metadata_source ELSE 'musicBrainz' END,
+                    metadata_fetched_at = ?5
+                WHERE musicbrainz_disc_id = ?1
+                """
+
+            connection.transaction { connection -> Bool in
+                guard
+                    let attach = connection.statement(for: attachSQL),
+                    let update = connection.statement(for: updateSQL)
+                else { return false }
+                defer {
+                    sqlite3_reset(attach)
+                    sqlite3_reset(update)
+                }
+
+                for lookup in lookups {
+                    for slotId in lookup.slotIds {
+                        sqlite3_reset(attach)
+                        sqlite3_bind_text(attach, 1, lookup.discId, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                        sqlite3_bind_int(attach, 2, Int32(slotId))
+                        sqlite3_step(attach)
+                    }
+
+                    sqlite3_reset(update)
+                    sqlite3_clear_bindings(update)
+                    sqlite3_bind_text(update, 1, lookup.discId, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(update, 2, lookup.release?.artist, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(update, 3, lookup.release?.album, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(update, 4, lookup.release?.year, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(update, 5, CatalogTimestamp.string(from: lookup.fetchedAt), -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    if sqlite3_step(update) != SQLITE_DONE {
+                        print("Database: Failed to apply MusicBrainz lookup - \(String(cString: sqlite3_errmsg(connection.db)))")
+                    }
+                }
+                return true
+            }
+        }
+    }
+
+    // MARK: - Search
+
+    /// Ranked catalog matches for `query`; every word must match, the last as a prefix.
+    /// Falls back to substring matching when SQLite was built without FTS5.
+    func searchDiscs(query: String, limit: Int) -> [DiscSearchHit] {
+        return read([]) { connection in
+            let terms = query
+                .components(separatedBy: CharacterSet.alphanumerics.inverted)
+                .filter { !$0.isEmpty }
+            guard !terms.isEmpty else { return [] }
+
+            let sql: String
+            let pattern: String
+            if hasSearchIndex {
+                sql = """
+                    SELECT d.*,
+                        bm25(catalog_fts, 8.0, 4.0, 6.0, 1.0, 2.0, 0.5, 1.0) AS score,
+                        snippet(catalog_fts, -1, '[', ']', '…', 8)
+                    FROM catalog_fts
+                    JOIN discs d ON d.id = catalog_fts.rowid
+                    WHERE catalog_fts MATCH ?
+                    ORDER BY score
+                    LIMIT ?
+                    """
+                pattern = terms.enumerated().map { index, term in
+                    index == terms.count - 1 ? "\"\(term)\"*" : "\"\(term)\""
+                }.joined(separator: " ")
+            } else {
+                sql = """
+                    SELECT d.*, 0.0, NULL FROM discs d
+                    WHERE COALESCE(d.volume_label, '') || ' ' || COALESCE(d.artist, '') || ' ' ||
+                        COALESCE(d.album, '') || ' ' || COALESCE(d.year, '') || ' ' || COALESCE(d.genre, '') LIKE ?
+                    ORDER BY d.last_seen_at DESC
+                    LIMIT ?
+                    """
+                pattern = "%" + terms.joined(separator: "%") + "%"
+            }
+
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            sqlite3_bind_text(stmt, 1, pattern, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+            sqlite3_bind_int(stmt, 2, Int32(limit))
+
+            var hits: [DiscSearchHit] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                guard let disc = discFromStatement(stmt) else { continue }
+                let snippet = sqlite3_column_text(stmt, Self.discColumnCount + 1).map { String(cString: $0) }
+                // bm25 is negative, lower meaning more relevant
+                hits.append(DiscSearchHit(disc: disc, score: -sqlite3_column_double(stmt, Self.discColumnCount), snippet: snippet))
+            }
+            return hits
+        }
+    }
+
+    /// Disc records for the given slots in one query
+    func getDiscs(slotIds: [Int]) -> [DiscRecord] {
+        guard !slotIds.isEmpty else { return [] }
+        return read([]) { connection in
+            let sql = "SELECT * FROM discs WHERE slot_id IN (SELECT value FROM json_each(?)) ORDER BY slot_id"
+            var discs: [DiscRecord] = []
+
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            Self.bindList(stmt, 1, slotIds)
+
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                if let disc = discFromStatement(stmt) {
+                    discs.append(disc)
+                }
+            }
+
+            return discs
+        }
+    }
+
+    /// Bind `values` as one JSON array for `IN (SELECT value FROM json_each(?))`. The SQL
+    /// text is the same for every list length, so the statement cache holds one entry.
+    private static func bindList(_ stmt: OpaquePointer, _ index: Int32, _ values: [Int]) {
+        bindText(stmt, index, "[" + values.map(String.init).joined(separator: ",") + "]")
+    }
+
+    private static func bindList(_ stmt: OpaquePointer, _ index: Int32, _ values: [String]) {
+        let json = (try? JSONEncoder().encode(values)).flatMap { String(data: $0, encoding: .utf8) }
+        bindText(stmt, index, json ?? "[]")
+    }
+
+    /// Columns in `discs`, so values selected after `d.*` can be addressed
+    private static let discColumnCount: Int32 = 16
+
     private func discFromStatement(_ stmt: OpaquePointer?) -> DiscRecord? {
         guard let stmt = stmt else { return nil }
 
@@ -262,24 +712,22 @@ final class Database {
             metadataSource: getString(11),
             firstSeenAt: getString(12),
             lastSeenAt: getString(13),
-            metadataFetchedAt: getString(14)
+            metadataFetchedAt: getString(14),
+            fingerprint: getString(15)
         )
     }
 
     // MARK: - Backup Operations
 
     func insertBackup(_ backup: BackupRecord) -> Int64? {
-        return queue.sync {
-            guard let db = db else { return nil }
-
+        return write(nil) { connection in
             let sql = """
                 INSERT INTO backups (disc_id, backup_path, backup_size_bytes, backup_hash, backup_date, backup_status, error_message)
                 VALUES (?, ?, ?, ?, ?, ?, ?)
                 """
 
-            var stmt: OpaquePointer?
-            guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return nil }
-            defer { sqlite3_finalize(stmt) }
+            guard let stmt = connection.statement(for: sql) else { return nil }
+            defer { sqlite3_reset(stmt) }
 
             sqlite3_bind_int64(stmt, 1, backup.discId)
             sqlite3_bind_text(stmt, 2, backup.backupPath, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
@@ -294,22 +742,19 @@ final class Database {
             sqlite3_bind_text(stmt, 7, backup.errorMessage, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
 
             if sqlite3_step(stmt) == SQLITE_DONE {
-                return sqlite3_last_insert_rowid(db)
+                return sqlite3_last_insert_rowid(connection.db)
             }
             return nil
         }
     }
 
     func getBackups(discId: Int64) -> [BackupRecord] {
-        return queue.sync {
-            guard let db = db else { return [] }
-
+        return read([]) { connection in
             let sql = "SELECT * FROM backups WHERE disc_id = ? ORDER BY backup_date DESC"
-            var stmt: OpaquePointer?
             var backups: [BackupRecord] = []
 
-            guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return [] }
-            defer { sqlite3_finalize(stmt) }
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
 
             sqlite3_bind_int64(stmt, 1, discId)
 
@@ -324,20 +769,17 @@ final class Database {
     }
 
     func getLatestBackup(slotId: Int) -> BackupRecord? {
-        return queue.sync {
-            guard let db = db else { return nil }
-
+        return read(nil) { connection in
             let sql = """
                 SELECT b.* FROM backups b
                 JOIN discs d ON b.disc_id = d.id
-                WHERE d.slot_id = ? AND b.backup_status = 'completed'
+                WHERE d.slot_id = ? AND b.backup_status IN ('completed', 'verified')
                 ORDER BY b.backup_date DESC
                 LIMIT 1
                 """
 
-            var stmt: OpaquePointer?
-            guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return nil }
-            defer { sqlite3_finalize(stmt) }
+            guard let stmt = connection.statement(for: sql) else { return nil }
+            defer { sqlite3_reset(stmt) }
 
             sqlite3_bind_int(stmt, 1, Int32(slotId))
 
@@ -347,23 +789,654 @@ final class Database {
         }
     }
 
-    private func backupFromStatement(_ stmt: OpaquePointer?) -> BackupRecord? {
+    /// Latest completed (or verified) backup of every cataloged disc (nil when it has none), optionally
+    /// limited to `slotIds`, in one grouped query over idx_backups_disc_status_date.
+    func getLatestBackups(slotIds: [Int]? = nil) -> [(slotId: Int, backup: BackupRecord?)] {
+        if let slotIds = slotIds, slotIds.isEmpty { return [] }
+        return read([]) { connection in
+            // SQLite takes the bare b.* columns from the row that supplies MAX(backup_date).
+            var sql = """
+                SELECT b.*, d.slot_id, MAX(b.backup_date) FROM discs d
+                LEFT JOIN backups b ON b.disc_id = d.id AND b.backup_status IN ('completed', 'verified')
+                """
+            if let slotIds = slotIds {
+                sql += "\nWHERE d.slot_id IN (SELECT value FROM json_each(?))"
+            }
+            sql += "\nGROUP BY d.id"
+
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            if let slotIds = slotIds {
+                Self.bindList(stmt, 1, slotIds)
+            }
+
+            var results: [(slotId: Int, backup: BackupRecord?)] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                let slotId = Int(sqlite3_column_int(stmt, 8))
+                let backup = sqlite3_column_type(stmt, 0) != SQLITE_NULL ? backupFromStatement(stmt) : nil
+                results.append((slotId, backup))
+            }
+            return results
+        }
+    }
+
+    /// A `backups` row whose first column is `base`
+    private func backupFromStatement(_ stmt: OpaquePointer?, at base: Int32 = 0) -> BackupRecord? {
         guard let stmt = stmt else { return nil }
 
         func getString(_ col: Int32) -> String? {
-            guard let ptr = sqlite3_column_text(stmt, col) else { return nil }
+            guard let ptr = sqlite3_column_text(stmt, base + col) else { return nil }
             return String(cString: ptr)
         }
 
         return BackupRecord(
-            id: sqlite3_column_int64(stmt, 0),
-            discId: sqlite3_column_int64(stmt, 1),
+            id: sqlite3_column_int64(stmt, base),
+            discId: sqlite3_column_int64(stmt, base + 1),
             backupPath: getString(2) ?? "",
-            backupSizeBytes: sqlite3_column_type(stmt, 3) != SQLITE_NULL ? sqlite3_column_int64(stmt, 3) : nil,
+            backupSizeBytes: sqlite3_column_type(stmt, base + 3) != SQLITE_NULL ? sqlite3_column_int64(stmt, base + 3) : nil,
             backupHash: getString(4),
             backupDate: getString(5) ?? "",
             backupStatus: getString(6) ?? "unknown",
             errorMessage: getString(7)
         )
     }
+
+    // MARK: - File Index
+
+    /// Replace the stored file tree of a disc with `files`, read from the image of `backupId`
+    @discardableResult
+    func replaceDiscFiles(discId: Int64, backupId: Int64?, files: [DiscFileRecord]) -> Bool {
+        return write(false) { connection in
+            connection.transaction { connection -> Bool in
+                guard let delete = connection.statement(for: "DELETE FROM disc_files WHERE disc_id = ?") else {
+                    return false
+                }
+                sqlite3_bind_int64(delete, 1, discId)
+                let deleted = sqlite3_step(delete) == SQLITE_DONE
+                sqlite3_reset(delete)
+                guard deleted else { return false }
+
+                let sql = """
+                    INSERT INTO disc_files (disc_id, backup_id, path, size_bytes, modified_at, extents)
+                    VALUES (?, ?, ?, ?, ?, ?)
+                    """
+                guard let stmt = connection.statement(for: sql) else { return false }
+                defer { sqlite3_reset(stmt) }
+
+                for file in files {
+                    sqlite3_reset(stmt)
+                    sqlite3_bind_int64(stmt, 1, discId)
+                    if let backupId = backupId {
+                        sqlite3_bind_int64(stmt, 2, backupId)
+                    } else {
+                        sqlite3_bind_null(stmt, 2)
+                    }
+                    Self.bindText(stmt, 3, file.path)
+                    sqlite3_bind_int64(stmt, 4, file.sizeBytes)
+                    if let modified = file.modifiedAt {
+                        sqlite3_bind_double(stmt, 5, modified.timeIntervalSince1970)
+                    } else {
+                        sqlite3_bind_null(stmt, 5)
+                    }
+                    Self.bindText(stmt, 6, file.encodedExtents)
+                    guard sqlite3_step(stmt) == SQLITE_DONE else { return false }
+                }
+                return true
+            }
+        }
+    }
+
+    /// Every indexed file of a disc, by path
+    func getDiscFiles(discId: Int64) -> [DiscFileRecord] {
+        return read([]) { connection in
+            let sql = "SELECT * FROM disc_files WHERE disc_id = ? ORDER BY path"
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            sqlite3_bind_int64(stmt, 1, discId)
+
+            var files: [DiscFileRecord] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                files.append(fileFromStatement(stmt, at: 0))
+            }
+            return files
+        }
+    }
+
+    /// The indexed file at `path` on the disc cataloged in `slotId`, with the backup whose image
+    /// holds it. An exact match wins over one that differs only in case.
+    func getDiscFile(slotId: Int, path: String) -> (file: DiscFileRecord, backup: BackupRecord?)? {
+        return read(nil) { connection in
+            let sql = """
+                SELECT f.*, b.* FROM disc_files f
+                JOIN discs d ON d.id = f.disc_id
+                LEFT JOIN backups b ON b.id = f.backup_id
+                WHERE d.slot_id = ?1 AND f.path = ?2 COLLATE NOCASE
+                ORDER BY f.path = ?2 DESC
+                LIMIT 1
+                """
+            guard let stmt = connection.statement(for: sql) else { return nil }
+            defer { sqlite3_reset(stmt) }
+
+            sqlite3_bind_int(stmt, 1, Int32(slotId))
+            Self.bindText(stmt, 2, path)
+
+            guard sqlite3_step(stmt) == SQLITE_ROW else { return nil }
+            let file = fileFromStatement(stmt, at: 0)
+            let backup = sqlite3_column_type(stmt, Self.discFileColumnCount) != SQLITE_NULL
+                ? backupFromStatement(stmt, at: Self.discFileColumnCount)
+                : nil
+            return (file, backup)
+        }
+    }
+
+    /// Files of every cataloged disc whose path matches `query`, best matches first; every
+    /// word must match, the last as a prefix. Falls back to substring matching without FTS5.
+    func searchFiles(query: String, limit: Int) -> [DiscFileHit] {
+        return read([]) { connection in
+            let terms = query
+                .components(separatedBy: CharacterSet.alphanumerics.inverted)
+                .filter { !$0.isEmpty }
+            guard !terms.isEmpty else { return [] }
+
+            let sql: String
+            let pattern: String
+            if hasSearchIndex {
+                // Shorter paths first among equal scores: a directory's own files before deeper ones
+                sql = """
+                    SELECT d.*, f.* FROM disc_files_fts
+                    JOIN disc_files f ON f.id = disc_files_fts.rowid
+                    JOIN discs d ON d.id = f.disc_id
+                    WHERE disc_files_fts MATCH ?
+                    ORDER BY bm25(disc_files_fts), length(f.path)
+                    LIMIT ?
+                    """
+                pattern = terms.enumerated().map { index, term in
+                    index == terms.count - 1 ? "\"\(term)\"*" : "\"\(term)\""
+                }.joined(separator: " ")
+            } else {
+                sql = """
+                    SELECT d.*, f.* FROM disc_files f
+                    JOIN discs d ON d.id = f.disc_id
+                    WHERE f.path LIKE ?
+                    ORDER BY length(f.path), f.path
+                    LIMIT ?
+                    """
+                pattern = "%" + terms.joined(separator: "%") + "%"
+            }
+
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            Self.bindText(stmt, 1, pattern)
+            sqlite3_bind_int(stmt, 2, Int32(limit))
+
+            var hits: [DiscFileHit] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                guard let disc = discFromStatement(stmt) else { continue }
+                hits.append(DiscFileHit(disc: disc, file: fileFromStatement(stmt, at: Self.discColumnCount)))
+            }
+            return hits
+        }
+    }
+
+    /// Columns in `disc_files`
+    private static let discFileColumnCount: Int32 = 7
+
+    /// A `disc_files` row whose first column is `base`
+    private func fileFromStatement(_ stmt: OpaquePointer, at base: Int32) -> DiscFileRecord {
+        DiscFileRecord(
+            id: sqlite3_column_int64(stmt, base),
+            discId: sqlite3_column_int64(stmt, base + 1),
+            backupId: sqlite3_column_type(stmt, base + 2) != SQLITE_NULL ? sqlite3_column_int64(stmt, base + 2) : nil,
+            path: Self.columnText(stmt, base + 3) ?? "",
+            sizeBytes: sqlite3_column_int64(stmt, base + 4),
+            modifiedAt: sqlite3_column_type(stmt, base + 5) != SQLITE_NULL
+                ? Date(timeIntervalSince1970: sqlite3_column_double(stmt, base + 5))
+                : nil,
+            extents: DiscFileRecord.decodeExtents(Self.columnText(stmt, base + 6) ?? "")
+        )
+    }
+
+    // MARK: - Event Log
+
+    /// Append events in one transaction. The log is never updated in place.
+    @discardableResult
+    func insertEvents(_ events: [EventRecord]) -> Bool {
+        guard !events.isEmpty else { return true }
+        return write(false) { connection in
+            let sql = """
+                INSERT INTO events (slot_id, operation, started_at, ended_at, bytes, throughput, result, error, drive, disc_type, device)
+                VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+                """
+
+            return connection.transaction { connection -> Bool in
+                guard let stmt = connection.statement(for: sql) else { return false }
+                defer { sqlite3_reset(stmt) }
+
+                for event in events {
+                    sqlite3_reset(stmt)
+                    sqlite3_clear_bindings(stmt)
+                    if let slotId = event.slotId {
+                        sqlite3_bind_int(stmt, 1, Int32(slotId))
+                    }
+                    sqlite3_bind_text(stmt, 2, event.operation.rawValue, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_double(stmt, 3, event.startedAt.timeIntervalSince1970)
+                    sqlite3_bind_double(stmt, 4, event.endedAt.timeIntervalSince1970)
+                    if let bytes = event.bytes {
+                        sqlite3_bind_int64(stmt, 5, bytes)
+                    }
+                    if let throughput = event.throughput {
+                        sqlite3_bind_double(stmt, 6, throughput)
+                    }
+                    sqlite3_bind_text(stmt, 7, event.result.rawValue, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(stmt, 8, event.error, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(stmt, 9, event.drive, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(stmt, 10, event.discType, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+                    sqlite3_bind_text(stmt, 11, event.device, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+
+                    guard sqlite3_step(stmt) == SQLITE_DONE else {
+                        print("Database: Failed to append event - \(String(cString: sqlite3_errmsg(connection.db)))")
+                        return false
+                    }
+                }
+                return true
+            }
+        }
+    }
+
+    /// The newest `limit` events, oldest first
+    func getRecentEvents(limit: Int) -> [EventRecord] {
+        return read([]) { connection in
+            let sql = """
+                SELECT slot_id, operation, started_at, ended_at, bytes, result, error, drive, disc_type, device
+                FROM (SELECT * FROM events ORDER BY id DESC LIMIT ?)
+                ORDER BY id
+                """
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            sqlite3_bind_int(stmt, 1, Int32(limit))
+
+            var events: [EventRecord] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                guard
+                    let operation = Self.columnText(stmt, 1).flatMap(EventRecord.Operation.init(rawValue:)),
+                    let result = Self.columnText(stmt, 5).flatMap(EventRecord.Result.init(rawValue:))
+                else { continue }
+                let event = EventRecord(
+                    slotId: sqlite3_column_type(stmt, 0) != SQLITE_NULL ? Int(sqlite3_column_int(stmt, 0)) : nil,
+                    operation: operation,
+                    startedAt: Date(timeIntervalSince1970: sqlite3_column_double(stmt, 2)),
+                    endedAt: Date(timeIntervalSince1970: sqlite3_column_double(stmt, 3)),
+                    bytes: sqlite3_column_type(stmt, 4) != SQLITE_NULL ? sqlite3_column_int64(stmt, 4) : nil,
+                    result: result,
+                    error: Self.columnText(stmt, 6),
+                    drive: Self.columnText(stmt, 7),
+                    device: Self.columnText(stmt, 9),
+                    discType: Self.columnText(stmt, 8)
+                )
+                events.append(event)
+            }
+            return events
+        }
+    }
+
+    // MARK: - Job Queue
+
+    // Each method is one job or task state transition, committed as a single transaction.
+
+    /// Queue a job owned by `owner`, with a pending task per slot (slots may be added when it begins).
+    func insertJob(kind: JobRecord.Kind, outputDirectory: String?, slotIds: [Int], owner: JobOwner, at date: Date) -> Int64? {
+        write(nil) { connection in
+            connection.transaction { connection -> Int64? in
+                let now = CatalogTimestamp.string(from: date)
+                let inserted = step("""
+                    INSERT INTO jobs (kind, state, output_directory, created_at, updated_at, owner_pid, owner_host, owner_boot)
+                    VALUES (?1, 'queued', ?2, ?3, ?3, ?4, ?5, ?6)
+                    """, on: connection) { stmt in
+                    Self.bindText(stmt, 1, kind.rawValue)
+                    Self.bindText(stmt, 2, outputDirectory)
+                    Self.bindText(stmt, 3, now)
+                    Self.bindOwner(stmt, 4, owner)
+                }
+                guard inserted else { return nil }
+                let jobId = sqlite3_last_insert_rowid(connection.db)
+                return insertTasks(jobId: jobId, slotIds: slotIds, on: connection) ? jobId : nil
+            }
+        }
+    }
+
+    /// Mark a job running over `slotIds`: missing tasks are added, pending tasks for
+    /// any other slot are skipped, and finished tasks are left alone.
+    @discardableResult
+    func beginJob(_ jobId: Int64, slotIds: [Int], at date: Date) -> Bool {
+        write(false) { connection in
+            connection.transaction { connection -> Bool in
+                let now = CatalogTimestamp.string(from: date)
+                guard insertTasks(jobId: jobId, slotIds: slotIds, on: connection) else { return false }
+                let skipped = step("""
+                    UPDATE job_tasks SET state = 'skipped', error = 'Not eligible when the job started', finished_at = ?2
+                    WHERE job_id = ?1 AND state = 'pending' AND slot_id NOT IN (SELECT value FROM json_each(?3))
+                    """, on: connection) { stmt in
+                    sqlite3_bind_int64(stmt, 1, jobId)
+                    Self.bindText(stmt, 2, now)
+                    Self.bindList(stmt, 3, slotIds)
+                }
+                return skipped && setJobState(jobId, .running, at: now, on: connection)
+            }
+        }
+    }
+
+    /// A task is being attempted (again): running, one more attempt.
+    @discardableResult
+    func beginTask(jobId: Int64, slotId: Int, at date: Date) -> Bool {
+        write(false) { connection in
+            connection.transaction { connection -> Bool in
+                let now = CatalogTimestamp.string(from: date)
+                return step("""
+                    UPDATE job_tasks SET state = 'running', attempts = attempts + 1, error = NULL,
+                        started_at = ?3, finished_at = NULL
+                    WHERE job_id = ?1 AND slot_id = ?2
+                    """, on: connection) { stmt in
+                    sqlite3_bind_int64(stmt, 1, jobId)
+                    sqlite3_bind_int(stmt, 2, Int32(slotId))
+                    Self.bindText(stmt, 3, now)
+                } && touchJob(jobId, at: now, on: connection)
+            }
+        }
+    }
+
+    @discardableResult
+    func finishTask(jobId: Int64, slotId: Int, state: JobTaskRecord.State, error: String?, at date: Date) -> Bool {
+        write(false) { connection in
+            connection.transaction { connection -> Bool in
+                let now = CatalogTimestamp.string(from: date)
+                return step("""
+                    UPDATE job_tasks SET state = ?3, error = ?4, finished_at = ?5
+                    WHERE job_id = ?1 AND slot_id = ?2
+                    """, on: connection) { stmt in
+                    sqlite3_bind_int64(stmt, 1, jobId)
+                    sqlite3_bind_int(stmt, 2, Int32(slotId))
+                    Self.bindText(stmt, 3, state.rawValue)
+                    Self.bindText(stmt, 4, error)
+                    Self.bindText(stmt, 5, now)
+                } && touchJob(jobId, at: now, on: connection)
+            }
+        }
+    }
+
+    /// Skip the given pending tasks, e.g. slots found empty when a job resumes.
+    @discardableResult
+    func skipTasks(jobId: Int64, slotIds: [Int], error: String, at date: Date) -> Bool {
+        guard !slotIds.isEmpty else { return true }
+        return write(false) { connection in
+            connection.transaction { connection -> Bool in
+                let now = CatalogTimestamp.string(from: date)
+                return step("""
+                    UPDATE job_tasks SET state = 'skipped', error = ?2, finished_at = ?3
+                    WHERE job_id = ?1 AND state = 'pending' AND slot_id IN (SELECT value FROM json_each(?4))
+                    """, on: connection) { stmt in
+                    sqlite3_bind_int64(stmt, 1, jobId)
+                    Self.bindText(stmt, 2, error)
+                    Self.bindText(stmt, 3, now)
+                    Self.bindList(stmt, 4, slotIds)
+                } && touchJob(jobId, at: now, on: connection)
+            }
+        }
+    }
+
+    /// Put a job in a final state, or back to interrupted when the process is stopping
+    /// mid-job. A task cut short goes back to pending when the job is interrupted or
+    /// cancelled (it may be resumed); when the job completed or failed it is failed too.
+    @discardableResult
+    func finishJob(_ jobId: Int64, state: JobRecord.State, at date: Date) -> Bool {
+        write(false) { connection in
+            connection.transaction { connection -> Bool in
+                let now = CatalogTimestamp.string(from: date)
+                let resumable = state == .interrupted || state == .cancelled
+                let settled = resumable
+                    ? step("""
+                        UPDATE job_tasks SET state = 'pending' WHERE job_id = ? AND state IN ('running', 'deferred')
+                        """, on: connection) { stmt in
+                        sqlite3_bind_int64(stmt, 1, jobId)
+                    }
+                    : step("""
+                        UPDATE job_tasks SET state = 'failed', error = COALESCE(error, 'Not finished when the job ended'),
+                            finished_at = ?2
+                        WHERE job_id = ?1 AND state IN ('running', 'deferred')
+                        """, on: connection) { stmt in
+                        sqlite3_bind_int64(stmt, 1, jobId)
+                        Self.bindText(stmt, 2, now)
+                    }
+                return settled && setJobState(jobId, state, at: now, finished: state != .interrupted, on: connection)
+            }
+        }
+    }
+
+    /// Owners of the queued and running jobs; nil for jobs queued before owners were recorded
+    func getActiveJobOwners() -> [(jobId: Int64, owner: JobOwner?)] {
+        read([]) { connection in
+            let sql = """
+                SELECT id, owner_pid, owner_host, owner_boot FROM jobs
+                WHERE state IN ('queued', 'running')
+                ORDER BY id
+                """
+            guard let stmt = connection.statement(for: sql) else { return [] }
+            defer { sqlite3_reset(stmt) }
+
+            var owners: [(jobId: Int64, owner: JobOwner?)] = []
+            while sqlite3_step(stmt) == SQLITE_ROW {
+                var owner: JobOwner?
+                if sqlite3_column_type(stmt, 1) != SQLITE_NULL {
+                    owner = JobOwner(
+                        pid: sqlite3_column_int(stmt, 1),
+                        host: Self.columnText(stmt, 2) ?? "",
+                        bootId: Self.columnText(stmt, 3) ?? ""
+                    )
+                }
+                owners.append((sqlite3_column_int64(stmt, 0), owner))
+            }
+            return owners
+        }
+    }
+
+    /// Mark the given queued or running jobs interrupted, returning their running and
+    /// deferred tasks to pending. Callers pass only jobs whose owner is gone.
+    @discardableResult
+    func interruptJobs(ids: [Int64], at date: Date) -> Int {
+        guard !ids.isEmpty else { return 0 }
+        return write(0) { connection in
+            connection.transaction { connection -> Int? in
+                let interrupted = step("""
+                    UPDATE jobs SET state = 'interrupted', updated_at = ?2
+                    WHERE state IN ('queued', 'running') AND id IN (SELECT value FROM json_each(?1))
+                    """, on: connection) { stmt in
+                    Self.bindList(stmt, 1, ids.map { Int($0) })
+                    Self.bindText(stmt, 2, CatalogTimestamp.string(from: date))
+                }
+                guard interrupted else { return nil }
+                let count = Int(sqlite3_changes(connection.db))
+                let reset = step("""
+                    UPDATE job_tasks SET state = 'pending'
+                    WHERE state IN ('running', 'deferred') AND job_id IN (SELECT value FROM json_each(?))
+                    """, on: connection) { stmt in
+                    Self.bindList(stmt, 1, ids.map { Int($0) })
+                }
+                return reset ? count : nil
+            } ?? 0
+        }
+    }
+
+    /// Take an interrupted job for `owner` and queue it again. False when it is no longer
+    /// interrupted, e.g. another process claimed it first.
+    func claimJob(_ jobId: Int64, owner: JobOwner, at date: Date) -> Bool {
+        write(false) { connection in
+            connection.transaction { connection -> Bool in
+                let updated = step("""
+                    UPDATE jobs SET state = 'queued', updated_at = ?2, owner_pid = ?3, owner_host = ?4, owner_boot = ?5
+                    WHERE id = ?1 AND state = 'interrupted'
+                    """, on: connection) { stmt in
+                    sqlite3_bind_int64(stmt, 1, jobId)
+                    Self.bindText(stmt, 2, CatalogTimestamp.string(from: date))
+                    Self.bindOwner(stmt, 3, owner)
+                }
+                return updated && sqlite3_changes(connection.db) == 1
+            }
+        }
+    }
+
+    /// Jobs in any of `states`, oldest first, with their tasks.
+    func getJobs(states: [JobRecord.State]) -> [JobRecord] {
+        guard !states.isEmpty else { return [] }
+        return read([]) { connection in
+            let sql = """
+                SELECT id, kind, state, output_directory, created_at, started_at, finished_at FROM jobs
+                WHERE state IN (SELECT value FROM json_each(?))
+                ORDER BY id
+                """
+            return fetchJobs(sql, on: connection) { stmt in
+                Self.bindList(stmt, 1, states.map(\.rawValue))
+            }
+        }
+    }
+
+    func getJob(id: Int64) -> JobRecord? {
+        read(nil) { connection in
+            let sql = """
+                SELECT id, kind, state, output_directory, created_at, started_at, finished_at FROM jobs
+                WHERE id = ?
+                """
+            return fetchJobs(sql, on: connection) { stmt in
+                sqlite3_bind_int64(stmt, 1, id)
+            }.first
+        }
+    }
+
+    private func fetchJobs(_ sql: String, on connection: SQLiteConnection, bind: (OpaquePointer) -> Void) -> [JobRecord] {
+        guard let stmt = connection.statement(for: sql) else { return [] }
+        bind(stmt)
+
+        var rows: [(id: Int64, kind: JobRecord.Kind, state: JobRecord.State, outputDirectory: String?,
+                    createdAt: String, startedAt: String?, finishedAt: String?)] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            guard
+                let kind = Self.columnText(stmt, 1).flatMap(JobRecord.Kind.init(rawValue:)),
+                let state = Self.columnText(stmt, 2).flatMap(JobRecord.State.init(rawValue:))
+            else { continue }
+            rows.append((
+                sqlite3_column_int64(stmt, 0),
+                kind,
+                state,
+                Self.columnText(stmt, 3),
+                Self.columnText(stmt, 4) ?? "",
+                Self.columnText(stmt, 5),
+                Self.columnText(stmt, 6)
+            ))
+        }
+        sqlite3_reset(stmt)
+
+        let taskSQL = """
+            SELECT slot_id, state, attempts, error, started_at, finished_at FROM job_tasks
+            WHERE job_id = ? ORDER BY id
+            """
+        guard let taskStmt = connection.statement(for: taskSQL) else { return [] }
+        defer { sqlite3_reset(taskStmt) }
+
+        return rows.map { row in
+            sqlite3_reset(taskStmt)
+            sqlite3_bind_int64(taskStmt, 1, row.id)
+            var tasks: [JobTaskRecord] = []
+            while sqlite3_step(taskStmt) == SQLITE_ROW {
+                guard let state = Self.columnText(taskStmt, 1).flatMap(JobTaskRecord.State.init(rawValue:)) else { continue }
+                tasks.append(JobTaskRecord(
+                    slotId: Int(sqlite3_column_int(taskStmt, 0)),
+                    state: state,
+                    attempts: Int(sqlite3_column_int(taskStmt, 2)),
+                    error: Self.columnText(taskStmt, 3),
+                    startedAt: Self.columnText(taskStmt, 4),
+                    finishedAt: Self.columnText(taskStmt, 5)
+                ))
+            }
+            return JobRecord(
+                id: row.id,
+                kind: row.kind,
+                state: row.state,
+                outputDirectory: row.outputDirectory,
+                createdAt: row.createdAt,
+                startedAt: row.startedAt,
+                finishedAt: row.finishedAt,
+                tasks: tasks
+            )
+        }
+    }
+
+    private func insertTasks(jobId: Int64, slotIds: [Int], on connection: SQLiteConnection) -> Bool {
+        let sql = "INSERT OR IGNORE INTO job_tasks (job_id, slot_id, state) VALUES (?, ?, 'pending')"
+        for slotId in slotIds {
+            let inserted = step(sql, on: connection) { stmt in
+                sqlite3_bind_int64(stmt, 1, jobId)
+                sqlite3_bind_int(stmt, 2, Int32(slotId))
+            }
+            guard inserted else { return false }
+        }
+        return true
+    }
+
+    private func setJobState(
+        _ jobId: Int64,
+        _ state: JobRecord.State,
+        at now: String,
+        finished: Bool = false,
+        on connection: SQLiteConnection
+    ) -> Bool {
+        // started_at keeps the first start across resumes; only final states have finished_at
+        step("""
+            UPDATE jobs SET state = ?2, updated_at = ?3,
+                started_at = CASE WHEN ?2 = 'running' THEN COALESCE(started_at, ?3) ELSE started_at END,
+                finished_at = CASE WHEN ?4 THEN ?3 END
+            WHERE id = ?1
+            """, on: connection) { stmt in
+            sqlite3_bind_int64(stmt, 1, jobId)
+            Self.bindText(stmt, 2, state.rawValue)
+            Self.bindText(stmt, 3, now)
+            sqlite3_bind_int(stmt, 4, finished ? 1 : 0)
+        }
+    }
+
+    private func touchJob(_ jobId: Int64, at now: String, on connection: SQLiteConnection) -> Bool {
+        step("UPDATE jobs SET updated_at = ? WHERE id = ?", on: connection) { stmt in
+            Self.bindText(stmt, 1, now)
+            sqlite3_bind_int64(stmt, 2, jobId)
+        }
+    }
+
+    /// Prepare `sql`, let `bind` fill its parameters, and run it to completion.
+    private func step(_ sql: String, on connection: SQLiteConnection, _ bind: (OpaquePointer) -> Void = { _ in }) -> Bool {
+        guard let stmt = connection.statement(for: sql) else { return false }
+        defer { sqlite3_reset(stmt) }
+        bind(stmt)
+        guard sqlite3_step(stmt) == SQLITE_DONE else {
+            print("Database: Job queue update failed - \(String(cString: sqlite3_errmsg(connection.db)))")
+            return false
+        }
+        return true
+    }
+
+    /// Bind an owner's pid, host and boot id to `index` and the two parameters after it
+    private static func bindOwner(_ stmt: OpaquePointer, _ index: Int32, _ owner: JobOwner) {
+        sqlite3_bind_int(stmt, index, owner.pid)
+        bindText(stmt, index + 1, owner.host)
+        bindText(stmt, index + 2, owner.bootId)
+    }
+
+    private static func bindText(_ stmt: OpaquePointer, _ index: Int32, _ value: String?) {
+        sqlite3_bind_text(stmt, index, value, -1, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
+    }
+
+    private static func columnText(_ stmt: OpaquePointer, _ col: Int32) -> String? {
+        guard let ptr = sqlite3_column_text(stmt, col) else { return nil }
+        return String(cString: ptr)
+    }
 }
@@ -0,0 +1,69 @@
+//
+//  DiscFileRecord.swift
+//  Discbot
+//
+//  Model representing one file of an imaged disc in the database
+//
+
+import Foundation
+
+struct DiscFileRecord {
+    /// `length` bytes of file data starting at byte `offset` of the image
+    struct Extent: Equatable {
+        let offset: Int64
+        let length: Int64
+    }
+
+    let id: Int64?
+    let discId: Int64?
+    /// The backup whose image the extents point into
+    let backupId: Int64?
+    /// '/'-separated, relative to the disc's root
+    let path: String
+    let sizeBytes: Int64
+    let modifiedAt: Date?
+    let extents: [Extent]
+
+    init(
+        id: Int64? = nil,
+        discId: Int64? = nil,
+        backupId: Int64? = nil,
+        path: String,
+        sizeBytes: Int64,
+        modifiedAt: Date? = nil,
+        extents: [Extent]
+    ) {
+        self.id = id
+        self.discId = discId
+        self.backupId = backupId
+        self.path = path
+        self.sizeBytes = sizeBytes
+        self.modifiedAt = modifiedAt
+        self.extents = extents
+    }
+
+    var name: String {
+        path.split(separator: "/").last.map(String.init) ?? path
+    }
+
+    /// Extents as stored: "offset+length" pairs separated by commas, e.g. "3000320+18432"
+    var encodedExtents: String {
+        extents.map { "\($0.offset)+\($0.length)" }.joined(separator: ",")
+    }
+
+    static func decodeExtents(_ text: String) -> [Extent] {
+        text.split(separator: ",").compactMap { pair in
+            let parts = pair.split(separator: "+", maxSplits: 1)
+            guard parts.count == 2, let offset = Int64(parts[0]), let length = Int64(parts[1]) else {
+                return nil
+            }
+            return Extent(offset: offset, length: length)
+        }
+    }
+}
+
+/// A file search result
+struct DiscFileHit {
+    let disc: DiscRecord
+    let file: DiscFileRecord
+}
@@ -23,6 +23,8 @@ struct DiscRecord {
     let firstSeenAt: String?
     let lastSeenAt: String?
     let metadataFetchedAt: String?
+    /// Fast-scan fingerprint of the TOC and volume descriptors
+    let fingerprint: String?
 
     init(
         id: Int64? = nil,
@@ -39,7 +41,8 @@ struct DiscRecord {
         metadataSource: String? = nil,
         firstSeenAt: String? = nil,
         lastSeenAt: String? = nil,
-        metadataFetchedAt: String? = nil
+        metadataFetchedAt: String? = nil,
+        fingerprint: String? = nil
     ) {
         self.id = id
         self.slotId = slotId
@@ -56,10 +59,18 @@ struct DiscRecord {
         self.firstSeenAt = firstSeenAt
         self.lastSeenAt = lastSeenAt
         self.metadataFetchedAt = metadataFetchedAt
+        self.fingerprint = fingerprint
     }
 
-    /// Create from DiscMetadata
-    static func from(slotId: Int, metadata: DiscMetadata, discType: DiscType, sizeBytes: Int64?) -> DiscRecord {
+    /// Create from DiscMetadata, plus the track layout and disc ID when the CD TOC was read
+    static func from(
+        slotId: Int,
+        metadata: DiscMetadata,
+        discType: DiscType,
+        sizeBytes: Int64?,
+        toc: DiscTOC? = nil,
+        fingerprint: String? = nil
+    ) -> DiscRecord {
         let sourceString: String
         switch metadata.source {
         case .musicBrainz: sourceString = "musicBrainz"
@@ -68,25 +79,38 @@ struct DiscRecord {
         case .slotNumber: sourceString = "slotNumber"
         }
 
-        let discTypeString: String
-        switch discType {
-        case .audioCDDA: discTypeString = "audioCDDA"
-        case .dataCD: discTypeString = "dataCD"
-        case .mixedModeCD: discTypeString = "mixedModeCD"
-        case .dvd: discTypeString = "dvd"
-        case .unknown: discTypeString = "unknown"
-        }
-
         return DiscRecord(
             slotId: slotId,
             volumeLabel: metadata.album,
-            discType: discTypeString,
+            discType: catalogString(for: discType),
             sizeBytes: sizeBytes,
+            musicbrainzDiscId: toc?.discIDs?.musicBrainz,
             artist: metadata.artist,
             album: metadata.album,
             year: metadata.year,
-            trackCount: metadata.tracks?.count,
-            metadataSource: sourceString
+            trackCount: metadata.tracks?.count ?? toc?.tracks.count,
+            metadataSource: sourceString,
+            fingerprint: fingerprint
         )
     }
+
+    /// How a disc type is stored in `discs.disc_type`
+    static func catalogString(for discType: DiscType) -> String {
+        switch discType {
+        case .audioCDDA: return "audioCDDA"
+        case .dataCD: return "dataCD"
+        case .mixedModeCD: return "mixedModeCD"
+        case .dvd: return "dvd"
+        case .unknown: return "unknown"
+        }
+    }
+}
+
+/// A catalog search result
+struct DiscSearchHit {
+    let disc: DiscRecord
+    /// Relevance; higher is better
+    let score: Double
+    /// Matching text with the hit terms in [brackets]
+    let snippet: String?
 }
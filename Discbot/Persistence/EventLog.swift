@@ -0,0 +1,198 @@
+//
+//  EventLog.swift
+//  Discbot
+//
+//  Buffers timed operation events and appends them to the catalog from a background thread
+//
+
+import Foundation
+
+/// Append-only record of every load, eject, mount, scan and image step.
+///
+/// `record` only appends to an in-memory buffer; a dedicated writer thread drains
+/// it into the `events` table every `batchSize` events or `flushInterval` seconds,
+/// whichever comes first, so the changer and imaging paths never wait on SQLite.
+final class EventLog {
+    static let shared = EventLog(database: .shared)
+
+    private static let batchSize = 64
+    private static let flushInterval: TimeInterval = 2
+
+    private let database: Database
+    /// Time source for event timestamps (the simulator's clock in benchmarks)
+    let clock: () -> Date
+
+    private let condition = NSCondition()
+    private var pending: [EventRecord] = []
+    /// Events taken by the writer but not yet committed
+    private var inFlight = 0
+    private var isStopped = false
+    private var currentDrive: String?
+    private var currentDevice: String?
+    private var discTypes: [Int: String] = [:]
+
+    /// The optical drive events are recorded against, from its inquiry; set once the changer is connected
+    var drive: String? {
+        get {
+            condition.lock()
+            defer { condition.unlock() }
+            return currentDrive
+        }
+        set {
+            condition.lock()
+            currentDrive = newValue
+            condition.unlock()
+        }
+    }
+
+    /// BSD name of the disc last found in the drive
+    var device: String? {
+        get {
+            condition.lock()
+            defer { condition.unlock() }
+            return currentDevice
+        }
+        set {
+            condition.lock()
+            currentDevice = newValue
+            condition.unlock()
+        }
+    }
+
+    /// Stamp later events for `slot` with the catalog type of its disc (nil once it is unknown)
+    func setDiscType(_ type: String?, slot: Int) {
+        condition.lock()
+        discTypes[slot] = type
+        condition.unlock()
+    }
+
+    init(database: Database, clock: @escaping () -> Date = Date.init) {
+        self.database = database
+        self.clock = clock
+
+        let writer = Thread { [weak self] in
+            while let log = self, log.drain() {}
+        }
+        writer.name = "Discbot.EventLog"
+        writer.qualityOfService = .utility
+        writer.start()
+    }
+
+    deinit {
+        condition.lock()
+        isStopped = true
+        let remaining = pending
+        pending = []
+        condition.broadcast()
+        condition.unlock()
+        database.insertEvents(remaining)
+    }
+
+    func record(_ event: EventRecord) {
+        var event = event
+        condition.lock()
+        if event.drive == nil {
+            event.drive = currentDrive
+        }
+        if event.device == nil {
+            event.device = currentDevice
+        }
+        if event.discType == nil, let slot = event.slotId {
+            event.discType = discTypes[slot]
+        }
+        pending.append(event)
+        if pending.count >= Self.batchSize {
+            condition.signal()
+        }
+        condition.unlock()
+    }
+
+    /// Time `body` and record it as `operation`, including failures and cancellations.
+    /// `bytes` is evaluated only when `body` succeeds; `observe` is handed the event as it is recorded.
+    @discardableResult
+    func measure<T>(
+        _ operation: EventRecord.Operation,
+        slot: Int?,
+        bytes: (T) -> Int64? = { _ in nil },
+        observe: ((EventRecord) -> Void)? = nil,
+        _ body: () throws -> T
+    ) rethrows -> T {
+        let startedAt = clock()
+        do {
+            let value = try body()
+            let event = EventRecord(
+                slotId: slot,
+                operation: operation,
+                startedAt: startedAt,
+                endedAt: clock(),
+                bytes: bytes(value),
+                result: .ok
+            )
+            record(event)
+            observe?(event)
+            return value
+        } catch {
+            let event = EventRecord(
+                slotId: slot,
+                operation: operation,
+                startedAt: startedAt,
+                endedAt: clock(),
+                result: Self.isCancellation(error) ? .cancelled : .failed,
+                error: error.localizedDescription
+            )
+            record(event)
+            observe?(event)
+            throw error
+        }
+    }
+
+    private static func isCancellation(_ error: Error) -> Bool {
+        if case ImagingError.cancelled? = error as? ImagingError { return true }
+        return (error as? ChangerError) == .cancelled
+    }
+
+    /// Block until everything recorded so far is in the database (e.g. at quit).
+    func flush() {
+        condition.lock()
+        let batch = pending
+        pending = []
+        condition.unlock()
+        database.insertEvents(batch)
+
+        // Wait out a batch the writer thread already took
+        condition.lock()
+        while inFlight > 0 {
+            condition.wait()
+        }
+        condition.unlock()
+    }
+
+    /// The newest `limit` events, including any still buffered (blocking)
+    func recentEvents(limit: Int) -> [EventRecord] {
+        flush()
+        return database.getRecentEvents(limit: limit)
+    }
+
+    /// Wait for a full batch or the flush interval, then write it. Returns false once stopped.
+    private func drain() -> Bool {
+        condition.lock()
+        let deadline = Date().addingTimeInterval(Self.flushInterval)
+        while !isStopped && pending.count < Self.batchSize && condition.wait(until: deadline) {}
+        if isStopped {
+            condition.unlock()
+            return false
+        }
+        let batch = pending
+        pending = []
+        inFlight += 1
+        condition.unlock()
+
+        database.insertEvents(batch)
+
+        condition.lock()
+        inFlight -= 1
+        condition.broadcast()
+        condition.unlock()
+        return true
+    }
+}
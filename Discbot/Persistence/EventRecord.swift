@@ -0,0 +1,76 @@
+//
+//  EventRecord.swift
+//  Discbot
+//
+//  Model representing one timed changer, drive or imaging step in the event log
+//
+
+import Foundation
+
+struct EventRecord {
+    enum Operation: String {
+        case load
+        case eject
+        case mount
+        case unmount
+        case scan
+        case image
+        case verify
+    }
+
+    enum Result: String {
+        case ok
+        case failed
+        case cancelled
+    }
+
+    let slotId: Int?
+    let operation: Operation
+    let startedAt: Date
+    let endedAt: Date
+    let bytes: Int64?
+    let result: Result
+    let error: String?
+    /// The optical drive the step ran on, from its inquiry ("vendor product"), stamped by the event log
+    var drive: String?
+    /// BSD name of the drive's disc ("disk4") when the step ran, stamped by the event log; it
+    /// changes from disc to disc, so timings are grouped by `drive`
+    var device: String?
+    /// Catalog type of the disc the step handled ("dvd", "dataCD", ...), stamped by the event
+    /// log once the disc has been identified
+    var discType: String?
+
+    init(
+        slotId: Int?,
+        operation: Operation,
+        startedAt: Date,
+        endedAt: Date,
+        bytes: Int64? = nil,
+        result: Result,
+        error: String? = nil,
+        drive: String? = nil,
+        device: String? = nil,
+        discType: String? = nil
+    ) {
+        self.slotId = slotId
+        self.operation = operation
+        self.startedAt = startedAt
+        self.endedAt = endedAt
+        self.bytes = bytes
+        self.result = result
+        self.error = error
+        self.drive = drive
+        self.device = device
+        self.discType = discType
+    }
+
+    var duration: TimeInterval {
+        endedAt.timeIntervalSince(startedAt)
+    }
+
+    /// Bytes per second, when the step moved data and took measurable time
+    var throughput: Double? {
+        guard let bytes = bytes, duration > 0 else { return nil }
+        return Double(bytes) / duration
+    }
+}
@@ -0,0 +1,113 @@
+//
+//  JobQueue.swift
+//  Discbot
+//
+//  Durable record of batch jobs and their per-slot tasks, and the launch-time supervisor that resumes them
+//
+
+import Foundation
+
+/// Batch jobs as the catalog sees them: one row per job, one task per slot.
+///
+/// Every call is a single state transition written synchronously in its own
+/// transaction, so after a crash the tables say exactly which slots finished and
+/// which one was in flight. A handful of small writes per disc costs nothing next
+/// to the minutes each disc takes to image.
+final class JobQueue {
+    static let shared = JobQueue(database: .shared)
+
+    private let database: Database
+    private let clock: () -> Date
+    /// Recorded on every job this queue creates or claims
+    private let owner: JobOwner
+
+    init(database: Database, clock: @escaping () -> Date = Date.init, owner: JobOwner = .current) {
+        self.database = database
+        self.clock = clock
+        self.owner = owner
+    }
+
+    /// Queue a job owned by this process; nil when the catalog is unavailable.
+    func createJob(kind: JobRecord.Kind, outputDirectory: String?, slotIds: [Int] = []) -> Int64? {
+        database.insertJob(kind: kind, outputDirectory: outputDirectory, slotIds: slotIds, owner: owner, at: clock())
+    }
+
+    /// The job is starting (or resuming) over `slotIds`
+    func beginJob(_ jobId: Int64, slotIds: [Int]) {
+        database.beginJob(jobId, slotIds: slotIds, at: clock())
+    }
+
+    func beginTask(jobId: Int64, slot: Int) {
+        database.beginTask(jobId: jobId, slotId: slot, at: clock())
+    }
+
+    func finishTask(jobId: Int64, slot: Int, state: JobTaskRecord.State, error: String? = nil) {
+        database.finishTask(jobId: jobId, slotId: slot, state: state, error: error, at: clock())
+    }
+
+    func finishJob(_ jobId: Int64, state: JobRecord.State) {
+        database.finishJob(jobId, state: state, at: clock())
+    }
+
+    func job(id: Int64) -> JobRecord? {
+        database.getJob(id: id)
+    }
+
+    // MARK: - Supervisor
+
+    /// Jobs left queued or running by a process that has since died, now marked interrupted,
+    /// together with those already interrupted. Jobs whose owner is still running (the app or
+    /// the daemon sharing this catalog) are left alone. Resume one only after `claim`.
+    func recoverInterruptedJobs() -> [JobRecord] {
+        var orphaned: [Int64] = []
+        for (jobId, jobOwner) in database.getActiveJobOwners() {
+            if let jobOwner = jobOwner, jobOwner.isAlive {
+                print("JobQueue: job \(jobId) belongs to running process \(jobOwner.pid), leaving it")
+            } else {
+                orphaned.append(jobId)
+            }
+        }
+        let count = database.interruptJobs(ids: orphaned, at: clock())
+        if count > 0 {
+            print("JobQueue: \(count) job(s) were interrupted by the last shutdown")
+        }
+        return database.getJobs(states: [.interrupted])
+    }
+
+    /// Take an interrupted job before resuming or discarding it. False when another process
+    /// took it first; it must then be left alone.
+    func claim(_ job: JobRecord) -> Bool {
+        database.claimJob(job.id, owner: owner, at: clock())
+    }
+
+    /// Match an interrupted job against the current inventory. Pending slots that are
+    /// now empty are skipped; returns the job still to resume, or nil once nothing is
+    /// left (the job is then marked completed). A job that never began has no tasks
+    /// and resumes with its original request; without an inventory nothing is skipped.
+    func reconcile(_ job: JobRecord, with slots: [Slot]) -> JobRecord? {
+        guard !job.tasks.isEmpty, !slots.isEmpty else { return job }
+
+        let present = Set(slots.filter { $0.isFull || $0.isInDrive }.map(\.id))
+        let missing = job.pendingSlotIds.filter { !present.contains($0) }
+        let isDone = job.pendingSlotIds.count == missing.count
+        let now = clock()
+        let reconciled = database.transaction {
+            database.skipTasks(jobId: job.id, slotIds: missing, error: "Slot was empty when the job resumed", at: now)
+                && (!isDone || database.finishJob(job.id, state: .completed, at: now))
+        }
+        if !reconciled {
+            print("JobQueue: Failed to reconcile job \(job.id) with the inventory")
+        }
+        return isDone ? nil : database.getJob(id: job.id)
+    }
+
+    /// Leave a job for the next launch to resume, e.g. when the daemon is stopped mid-run
+    func interruptJob(_ jobId: Int64) {
+        finishJob(jobId, state: .interrupted)
+    }
+
+    /// Drop an interrupted job without running the rest of it
+    func discardJob(_ jobId: Int64) {
+        finishJob(jobId, state: .cancelled)
+    }
+}
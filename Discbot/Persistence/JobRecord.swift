@@ -0,0 +1,102 @@
+//
+//  JobRecord.swift
+//  Discbot
+//
+//  Models representing a persisted batch job and its per-slot tasks
+//
+
+import Foundation
+
+struct JobRecord {
+    enum Kind: String {
+        case imageAll
+        case scanUnknown
+        case loadAll
+    }
+
+    enum State: String {
+        case queued
+        case running
+        /// Was queued or running when the process died; waiting to be resumed or discarded
+        case interrupted
+        case completed
+        case cancelled
+        case failed
+    }
+
+    let id: Int64
+    let kind: Kind
+    let state: State
+    let outputDirectory: String?
+    let createdAt: String
+    let startedAt: String?
+    let finishedAt: String?
+    /// In the order the slots were queued
+    let tasks: [JobTaskRecord]
+
+    /// Slots still to be done, in queue order
+    var pendingSlotIds: [Int] {
+        tasks.filter { $0.state == .pending }.map(\.slotId)
+    }
+}
+
+struct JobTaskRecord {
+    enum State: String {
+        case pending
+        case running
+        case completed
+        case failed
+        /// Failed transiently; retried at the end of the run
+        case deferred
+        /// Not attempted: the slot was empty or not eligible
+        case skipped
+    }
+
+    let slotId: Int
+    let state: State
+    let attempts: Int
+    let error: String?
+    let startedAt: String?
+    let finishedAt: String?
+}
+
+/// The process that queued or claimed a job. The app and the daemon share the catalog, so a
+/// job is only reclaimed as interrupted once its owner is known to be gone.
+struct JobOwner: Equatable {
+    let pid: Int32
+    let host: String
+    /// Changes on every boot, so a pid reused after a reboot is not mistaken for the owner
+    let bootId: String
+
+    static let current = JobOwner(pid: getpid(), host: currentHost(), bootId: currentBootId())
+
+    /// False when the owner ran on this host in an earlier boot or its pid is gone. An owner
+    /// on another host sharing the catalog cannot be checked and counts as alive.
+    var isAlive: Bool {
+        let current = Self.current
+        guard host == current.host else { return true }
+        guard bootId == current.bootId else { return false }
+        if pid == current.pid { return true }
+        return kill(pid, 0) == 0 || errno == EPERM
+    }
+
+    private static func currentHost() -> String {
+        // gethostname, unlike ProcessInfo.hostName, never waits on DNS
+        var name = [CChar](repeating: 0, count: 256)
+        guard gethostname(&name, name.count - 1) == 0 else { return "" }
+        return String(cString: name)
+    }
+
+    private static func currentBootId() -> String {
+        #if canImport(Darwin)
+        var size = 0
+        guard sysctlbyname("kern.bootsessionuuid", nil, &size, nil, 0) == 0, size > 0 else { return "" }
+        var value = [CChar](repeating: 0, count: size)
+        guard sysctlbyname("kern.bootsessionuuid", &value, &size, nil, 0) == 0 else { return "" }
+        return String(cString: value)
+        #else
+        let bootId = try? String(contentsOfFile: "/proc/sys/kernel/random/boot_id", encoding: .utf8)
+        return bootId?.trimmingCharacters(in: .whitespacesAndNewlines) ?? ""
+        #endif
+    }
+}
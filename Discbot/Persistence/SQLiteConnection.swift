@@ -0,0 +1,124 @@
+//
+//  SQLiteConnection.swift
+//  Discbot
+//
+//  One SQLite connection confined to a serial queue, with its prepared statement cache
+//
+
+import Foundation
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+
+final class SQLiteConnection {
+    let db: OpaquePointer
+
+    private let queue: DispatchQueue
+    private let queueKey = DispatchSpecificKey<Bool>()
+    /// Prepared statements keyed by SQL text; only touched on `queue`.
+    private var statements: [String: OpaquePointer] = [:]
+
+    init?(path: String, readOnly: Bool, label: String) {
+        let access = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)
+        var handle: OpaquePointer?
+        guard sqlite3_open_v2(path, &handle, access | SQLITE_OPEN_NOMUTEX, nil) == SQLITE_OK, let opened = handle else {
+            print("Database: Failed to open database")
+            if let handle = handle {
+                print("Database: Error - \(String(cString: sqlite3_errmsg(handle)))")
+                sqlite3_close(handle)
+            }
+            return nil
+        }
+
+        db = opened
+        queue = DispatchQueue(label: label, qos: .userInitiated)
+        queue.setSpecific(key: queueKey, value: true)
+        sqlite3_busy_timeout(db, 5000)
+    }
+
+    deinit {
+        for stmt in statements.values {
+            sqlite3_finalize(stmt)
+        }
+        sqlite3_close(db)
+    }
+
+    /// Run `body` on the connection's queue. Re-entrant, so writes can nest inside `transaction`.
+    func sync<T>(_ body: (SQLiteConnection) -> T) -> T {
+        if DispatchQueue.getSpecific(key: queueKey) == true {
+            return body(self)
+        }
+        return queue.sync { body(self) }
+    }
+
+    /// Run `body` as one transaction (a single commit). Everything it wrote is rolled back, and
+    /// `failed` returned, when `isCommitted` rejects its result or BEGIN or COMMIT fails.
+    /// Nested calls run in a savepoint, so a failed inner body undoes only its own writes
+    /// and its caller decides about the rest.
+    func transaction<T>(_ body: (SQLiteConnection) -> T, isCommitted: (T) -> Bool, failed: T) -> T {
+        sync { connection in
+            let isNested = sqlite3_get_autocommit(db) == 0
+            guard execute(sql: isNested ? "SAVEPOINT nested" : "BEGIN IMMEDIATE") else {
+                return failed
+            }
+            let result = body(connection)
+            if isCommitted(result), execute(sql: isNested ? "RELEASE nested" : "COMMIT") {
+                return result
+            }
+            if isNested {
+                // ROLLBACK TO leaves the savepoint open
+                execute(sql: "ROLLBACK TO nested")
+                execute(sql: "RELEASE nested")
+            } else {
+                execute(sql: "ROLLBACK")
+            }
+            return failed
+        }
+    }
+
+    /// A transaction whose body returns false on failure
+    func transaction(_ body: (SQLiteConnection) -> Bool) -> Bool {
+        transaction(body, isCommitted: { $0 }, failed: false)
+    }
+
+    /// A transaction whose body returns nil on failure
+    func transaction<T>(_ body: (SQLiteConnection) -> T?) -> T? {
+        transaction(body, isCommitted: { $0 != nil }, failed: nil)
+    }
+
+    /// Cached prepared statement for `sql`, reset and with its bindings cleared.
+    /// Callers reset it again when done so it does not hold a read transaction open.
+    /// Must be called on the connection's queue.
+    func statement(for sql: String) -> OpaquePointer? {
+        if let cached = statements[sql] {
+            sqlite3_reset(cached)
+            sqlite3_clear_bindings(cached)
+            return cached
+        }
+
+        var stmt: OpaquePointer?
+        guard
+            sqlite3_prepare_v3(db, sql, -1, UInt32(SQLITE_PREPARE_PERSISTENT), &stmt, nil) == SQLITE_OK,
+            let prepared = stmt
+        else {
+            print("Database: Failed to prepare statement - \(String(cString: sqlite3_errmsg(db)))")
+            sqlite3_finalize(stmt)
+            return nil
+        }
+        statements[sql] = prepared
+        return prepared
+    }
+
+    @discardableResult
+    func execute(sql: String) -> Bool {
+        var errMsg: UnsafeMutablePointer<CChar>?
+        guard sqlite3_exec(db, sql, nil, nil, &errMsg) == SQLITE_OK else {
+            if let errMsg = errMsg {
+                print("Database: SQL error - \(String(cString: errMsg))")
+                sqlite3_free(errMsg)
+            }
+            return false
+        }
+        return true
+    }
+}
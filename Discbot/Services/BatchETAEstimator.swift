@@ -0,0 +1,374 @@
+//
+//  BatchETAEstimator.swift
+//  Discbot
+//
+//  Predicts the time left in a batch from past load, scan, image and eject timings
+//
+
+import Foundation
+
+/// Learns how long each kind of disc takes from the event log and prices the rest of a batch.
+///
+/// Events are grouped into slot cycles: a load, everything done to that disc, and the eject
+/// that returns it. For each disc type a cycle contributes the time before imaging starts
+/// (robot move, spin-up, identification), the time after imaging (verification aside, the
+/// eject and return move), seconds per byte while imaging and while verifying, and the image
+/// size. A scan contributes its whole cycle. Only the current drive's history is used once it
+/// has enough cycles of its own.
+///
+/// Each remaining slot is priced by its cataloged type and size; a type with too few samples
+/// borrows the figures of all disc types together. Cycles that finish during the run are learned
+/// as they happen. The spread of the samples gives a 90% interval: slot-to-slot variation
+/// averages out over a long batch, while the uncertainty of the learned means does not.
+final class BatchETAEstimator {
+    enum Mode {
+        case image(verify: ImageVerifyMode)
+        case scan
+    }
+
+    struct Estimate {
+        /// Most likely seconds until the batch is done
+        let seconds: TimeInterval
+        /// Half-width of the 90% interval around `seconds`; nil while there is no history to judge by
+        let margin: TimeInterval?
+        /// Bytes still to image, including the rest of the current disc (imaging only)
+        let remainingBytes: Int64?
+    }
+
+    /// Events read back from the log when a batch starts
+    static let historyLimit = 20_000
+    /// Samples a disc type needs before its own figures are used
+    private static let minimumTypeSamples = 3
+    /// Cycles the current drive needs before other drives' history is ignored
+    private static let minimumDriveCycles = 5
+    /// Cycles longer than this are interrupted runs, not timings
+    private static let maximumCycle: TimeInterval = 4 * 3600
+    /// z for a two-sided 90% interval
+    private static let intervalZ = 1.645
+
+    private enum Quantity: String {
+        case preImage
+        case postImage
+        case imageSecondsPerByte
+        case verifySecondsPerByte
+        case imageBytes
+        case scanCycle
+    }
+
+    /// Running mean and variance (Welford)
+    private struct Sample {
+        private(set) var count = 0
+        private(set) var mean = 0.0
+        private var m2 = 0.0
+
+        mutating func add(_ value: Double) {
+            count += 1
+            let delta = value - mean
+            mean += delta / Double(count)
+            m2 += delta * (value - mean)
+        }
+
+        /// One sample says nothing about spread; assume it is rough to half its size
+        var variance: Double {
+            count > 1 ? m2 / Double(count - 1) : (mean * 0.5) * (mean * 0.5)
+        }
+
+        /// Variance of the mean itself
+        var meanVariance: Double {
+            variance / Double(max(count, 1))
+        }
+
+        /// An exactly known value
+        static func constant(_ value: Double) -> Sample {
+            var sample = Sample()
+            sample.add(value)
+            sample.add(value)
+            return sample
+        }
+    }
+
+    /// A slot's events between its load and its eject
+    private struct Cycle {
+        let start: Date
+        var imageStart: Date?
+        var imageEnd: Date?
+        var imageBytes: Int64?
+        var verifySeconds: TimeInterval = 0
+        var verifyBytes: Int64 = 0
+        var scanned = false
+        var failed = false
+    }
+
+    /// Predicted time of one slot, with its spread and the uncertainty of the learned means
+    private struct Cost {
+        var mean = 0.0
+        var variance = 0.0
+        var meanDeviation = 0.0
+
+        mutating func add(_ mean: Double, variance: Double, meanVariance: Double) {
+            self.mean += mean
+            self.variance += variance
+            meanDeviation += meanVariance.squareRoot()
+        }
+    }
+
+    private let mode: Mode
+    private let lock = NSLock()
+    private var samples: [String: Sample] = [:]
+    private var cycles: [Int: Cycle] = [:]
+    private var discTypes: [Int: String] = [:]
+    private var discSizes: [Int: Int64] = [:]
+    private var current: (slot: Int, startedAt: Date)?
+
+    /// `history` is the event log, oldest first; `drive` the optical drive the batch runs on
+    init(mode: Mode, history: [EventRecord], drive: String?) {
+        self.mode = mode
+
+        let ownHistory = drive.map { drive in history.filter { $0.drive == drive } } ?? []
+        var learned = 0
+        for event in ownHistory {
+            learned += learn(event, discType: event.discType) ? 1 : 0
+        }
+        if learned < Self.minimumDriveCycles {
+            samples = [:]
+            cycles = [:]
+            for event in history {
+                learn(event, discType: event.discType)
+            }
+        }
+        cycles = [:]
+    }
+
+    private var isImaging: Bool {
+        if case .image = mode { return true }
+        return false
+    }
+
+    /// Catalog type ("dvd", "dataCD", ...) and size of the disc in a slot, when known
+    func setDisc(slot: Int, type: String?, sizeBytes: Int64?) {
+        lock.lock()
+        defer { lock.unlock() }
+        discTypes[slot] = type
+        discSizes[slot] = sizeBytes
+    }
+
+    /// The batch has moved on to `slot`
+    func beginSlot(_ slot: Int, at date: Date) {
+        lock.lock()
+        current = (slot, date)
+        lock.unlock()
+    }
+
+    func endSlot() {
+        lock.lock()
+        current = nil
+        lock.unlock()
+    }
+
+    /// Learn from a step of the running batch
+    func observe(_ event: EventRecord) {
+        lock.lock()
+        defer { lock.unlock() }
+        learn(event, discType: event.slotId.flatMap { discTypes[$0] })
+    }
+
+    /// Mean time of one scan cycle over every disc type
+    var typicalScanSeconds: TimeInterval? {
+        lock.lock()
+        defer { lock.unlock() }
+        return sample(.scanCycle, type: nil).map { $0.mean }
+    }
+
+    /// Time left for the current slot and `remainingSlots`. `imaging` is the current disc's
+    /// live progress, whose speed stands in until a cycle has been learned.
+    func estimate(remainingSlots: [Int], now: Date, imaging: ImagingProgressInfo? = nil) -> Estimate? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        var total = Cost()
+        var remainingBytes: Int64 = 0
+        var sizesKnown = true
+
+        if let current = current {
+            let type = discTypes[current.slot]
+            let size = imaging?.totalBytes ?? discSizes[current.slot]
+            let elapsed = max(now.timeIntervalSince(current.startedAt), 0)
+            if isImaging, let imaging = imaging, let speed = imaging.speedBytesPerSecond, speed > 0 {
+                let left = max((imaging.totalBytes ?? imaging.bytesTransferred) - imaging.bytesTransferred, 0)
+                remainingBytes += left
+                total.add(Double(left) / speed, variance: 0, meanVariance: 0)
+                if let after = afterImageCost(type: type, size: size) {
+                    total.add(after.mean, variance: after.variance, meanVariance: after.meanDeviation * after.meanDeviation)
+                }
+            } else if let cost = slotCost(type: type, size: size) {
+                if isImaging {
+                    remainingBytes += size ?? Int64(sample(.imageBytes, type: type)?.mean ?? 0)
+                }
+                // Past its expected length a slot is nearly done, not finished
+                let left = max(cost.mean - elapsed, cost.mean * 0.05)
+                total.add(left, variance: cost.variance, meanVariance: cost.meanDeviation * cost.meanDeviation)
+            } else {
+                return nil
+            }
+        }
+
+        for slot in remainingSlots {
+            let type = discTypes[slot]
+            let size = discSizes[slot]
+            if isImaging {
+                if let size = size ?? sample(.imageBytes, type: type).map({ Int64($0.mean) }) ?? imaging?.totalBytes {
+                    remainingBytes += size
+                } else {
+                    sizesKnown = false
+                }
+            }
+            if let cost = slotCost(type: type, size: size) {
+                total.add(cost.mean, variance: cost.variance, meanVariance: cost.meanDeviation * cost.meanDeviation)
+            } else if isImaging, let speed = imaging?.speedBytesPerSecond, speed > 0,
+                      let size = size ?? imaging?.totalBytes {
+                // Nothing learned yet: the current disc's speed, with no move time
+                total.add(Double(size) / speed, variance: 0, meanVariance: 0)
+            } else {
+                return nil
+            }
+        }
+
+        let hasHistory = samples.values.contains { $0.count > 0 }
+        let deviation = (total.variance + total.meanDeviation * total.meanDeviation).squareRoot()
+        return Estimate(
+            seconds: total.mean,
+            margin: hasHistory ? Self.intervalZ * deviation : nil,
+            remainingBytes: isImaging && sizesKnown ? remainingBytes : nil
+        )
+    }
+
+    // MARK: - Learning
+
+    /// Fold one event into the open cycle of its slot. Returns true when it closed a cycle
+    /// that was learned.
+    @discardableResult
+    private func learn(_ event: EventRecord, discType: String?) -> Bool {
+        guard let slot = event.slotId else { return false }
+        if event.operation == .load {
+            cycles[slot] = event.result == .ok ? Cycle(start: event.startedAt) : nil
+            return false
+        }
+        guard var cycle = cycles[slot] else { return false }
+        if event.result != .ok {
+            cycle.failed = true
+        }
+
+        switch event.operation {
+        case .image:
+            cycle.imageStart = event.startedAt
+            cycle.imageEnd = event.endedAt
+            cycle.imageBytes = event.bytes
+        case .verify:
+            cycle.verifySeconds += event.duration
+            cycle.verifyBytes += event.bytes ?? 0
+        case .scan:
+            cycle.scanned = true
+        case .eject:
+            cycles[slot] = nil
+            guard !cycle.failed else { return false }
+            return learn(cycle, endedAt: event.endedAt, discType: discType)
+        case .load, .mount, .unmount:
+            break
+        }
+        cycles[slot] = cycle
+        return false
+    }
+
+    private func learn(_ cycle: Cycle, endedAt: Date, discType: String?) -> Bool {
+        let span = endedAt.timeIntervalSince(cycle.start)
+        guard span > 0, span < Self.maximumCycle else { return false }
+
+        if let imageStart = cycle.imageStart, let imageEnd = cycle.imageEnd, let bytes = cycle.imageBytes, bytes > 0 {
+            add(.preImage, imageStart.timeIntervalSince(cycle.start), type: discType)
+            add(.postImage, max(endedAt.timeIntervalSince(imageEnd) - cycle.verifySeconds, 0), type: discType)
+            add(.imageSecondsPerByte, imageEnd.timeIntervalSince(imageStart) / Double(bytes), type: discType)
+            add(.imageBytes, Double(bytes), type: discType)
+            if cycle.verifyBytes > 0 {
+                add(.verifySecondsPerByte, cycle.verifySeconds / Double(cycle.verifyBytes), type: discType)
+            }
+            return true
+        }
+        if cycle.scanned && cycle.imageStart == nil {
+            add(.scanCycle, span, type: discType)
+            return true
+        }
+        return false
+    }
+
+    private func add(_ quantity: Quantity, _ value: Double, type: String?) {
+        samples[Self.key(quantity, type: nil), default: Sample()].add(value)
+        if let type = type {
+            samples[Self.key(quantity, type: type), default: Sample()].add(value)
+        }
+    }
+
+    // MARK: - Pricing
+
+    /// The type's own sample when it has enough, else every type's
+    private func sample(_ quantity: Quantity, type: String?) -> Sample? {
+        if let type = type, let own = samples[Self.key(quantity, type: type)], own.count >= Self.minimumTypeSamples {
+            return own
+        }
+        guard let pooled = samples[Self.key(quantity, type: nil)], pooled.count > 0 else { return nil }
+        return pooled
+    }
+
+    private func slotCost(type: String?, size: Int64?) -> Cost? {
+        switch mode {
+        case .scan:
+            guard let cycle = sample(.scanCycle, type: type) else { return nil }
+            var cost = Cost()
+            cost.add(cycle.mean, variance: cycle.variance, meanVariance: cycle.meanVariance)
+            return cost
+
+        case .image:
+            guard
+                let pre = sample(.preImage, type: type),
+                let perByte = sample(.imageSecondsPerByte, type: type),
+                let after = afterImageCost(type: type, size: size)
+            else { return nil }
+
+            let knownSize = size.map { Sample.constant(Double($0)) }
+            guard let bytes = knownSize ?? sample(.imageBytes, type: type) else { return nil }
+            var cost = after
+            cost.add(pre.mean, variance: pre.variance, meanVariance: pre.meanVariance)
+            // Var(size × s/B) ≈ s/B² Var(size) + size² Var(s/B)
+            cost.add(
+                bytes.mean * perByte.mean,
+                variance: perByte.mean * perByte.mean * bytes.variance + bytes.mean * bytes.mean * perByte.variance,
+                meanVariance: perByte.mean * perByte.mean * bytes.meanVariance + bytes.mean * bytes.mean * perByte.meanVariance
+            )
+            return cost
+        }
+    }
+
+    /// Verification (when on and the type is verified) plus the eject and return move
+    private func afterImageCost(type: String?, size: Int64?) -> Cost? {
+        guard case .image(let verifyMode) = mode, let post = sample(.postImage, type: type) else { return nil }
+        var cost = Cost()
+        cost.add(post.mean, variance: post.variance, meanVariance: post.meanVariance)
+
+        let verified = type == nil || type == "dataCD" || type == "dvd"
+        guard verifyMode != .off, verified, let perByte = sample(.verifySecondsPerByte, type: type) else {
+            return cost
+        }
+        let imageBytes = size.map(Double.init) ?? sample(.imageBytes, type: type)?.mean ?? 0
+        let sampledBytes = Double(ImageVerifier.chunkSize * ImageVerifier.sampleCount)
+        let compared = verifyMode == .full ? imageBytes : min(imageBytes, sampledBytes)
+        cost.add(
+            compared * perByte.mean,
+            variance: compared * compared * perByte.variance,
+            meanVariance: compared * compared * perByte.meanVariance
+        )
+        return cost
+    }
+
+    private static func key(_ quantity: Quantity, type: String?) -> String {
+        "\(quantity.rawValue):\(type ?? "*")"
+    }
+}
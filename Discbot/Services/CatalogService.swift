@@ -8,9 +8,16 @@
 import Foundation
 
 final class CatalogService {
-    private let database = Database.shared
+    private let database: Database
     private let metadataService = MetadataService()
     private let imagingService = ImagingService()
+    /// Back-fills artist/album for discs with a MusicBrainz disc ID; nil keeps the catalog offline.
+    private let musicBrainz: MusicBrainzService?
+
+    init(database: Database = .shared, musicBrainz: MusicBrainzService? = .shared) {
+        self.database = database
+        self.musicBrainz = musicBrainz
+    }
 
     // MARK: - Disc Operations
 
@@ -19,19 +26,103 @@ final class CatalogService {
         slotId: Int,
         bsdName: String,
         discType: DiscType,
-        sizeBytes: Int64?
+        sizeBytes: Int64?,
+        volumeLabel: String? = nil,
+        toc: DiscTOC? = nil,
+        fingerprint: String? = nil
     ) -> Int64? {
+        let record = discRecord(
+            slotId: slotId,
+            bsdName: bsdName,
+            discType: discType,
+            sizeBytes: sizeBytes,
+            volumeLabel: volumeLabel,
+            toc: toc,
+            fingerprint: fingerprint
+        )
+        let discId = database.insertOrUpdateDisc(record)
+        queueMetadataLookup(for: record)
+        return discId
+    }
+
+    /// Build the catalog record for the disc in the drive without writing it
+    func discRecord(
+        slotId: Int,
+        bsdName: String,
+        discType: DiscType,
+        sizeBytes: Int64?,
+        volumeLabel: String? = nil,
+        toc: DiscTOC? = nil,
+        fingerprint: String? = nil
+    ) -> DiscRecord {
         // Get metadata from MetadataService
-        let metadata = metadataService.resolveMetadata(bsdName: bsdName, slotNumber: slotId)
+        let metadata = metadataService.resolveMetadata(bsdName: bsdName, slotNumber: slotId, volumeLabel: volumeLabel)
 
-        let record = DiscRecord.from(
+        return DiscRecord.from(
             slotId: slotId,
             metadata: metadata,
             discType: discType,
-            sizeBytes: sizeBytes
+            sizeBytes: sizeBytes,
+            toc: toc,
+            fingerprint: fingerprint
         )
+    }
+
+    /// Write a disc and the outcome of imaging it in one transaction (one commit per disc).
+    /// Without `backupPath` only the disc is recorded; with `error` the backup is recorded as failed.
+    /// `verified` is the read-back result: true records 'verified', false 'mismatch', nil (not
+    /// checked) 'completed'. `files`, the image's file tree, replaces the disc's file index
+    /// when the backup succeeded.
+    func recordImagingResult(
+        _ disc: DiscRecord,
+        backupPath: String?,
+        backupSizeBytes: Int64? = nil,
+        backupHash: String? = nil,
+        verified: Bool? = nil,
+        error: String? = nil,
+        files: [DiscFileRecord]? = nil
+    ) {
+        let recorded = database.transaction { () -> Bool in
+            guard let discId = database.insertOrUpdateDisc(disc) else { return false }
+            guard let backupPath = backupPath else { return true }
+            let status: String
+            switch (verified, error) {
+            case (false?, _): status = "mismatch"
+            case (_, _?): status = "failed"
+            case (true?, nil): status = "verified"
+            case (nil, nil): status = "completed"
+            }
+            let backup = BackupRecord(
+                discId: discId,
+                backupPath: backupPath,
+                backupSizeBytes: backupSizeBytes,
+                backupHash: backupHash,
+                backupStatus: status,
+                errorMessage: error
+            )
+            guard let backupId = database.insertBackup(backup) else { return false }
+            // A failed index is rolled back on its own; the backup is still worth keeping
+            if let files = files, backup.isCompleted,
+               !database.replaceDiscFiles(discId: discId, backupId: backupId, files: files) {
+                print("CatalogService: Failed to index files for slot \(disc.slotId)")
+            }
+            return true
+        }
+        if !recorded {
+            print("CatalogService: Failed to record imaging result for slot \(disc.slotId)")
+        }
+        queueMetadataLookup(for: disc)
+    }
 
-        return database.insertOrUpdateDisc(record)
+    /// Look the disc up online in the background; the catalog row is updated when the answer arrives.
+    private func queueMetadataLookup(for disc: DiscRecord) {
+        guard let discId = disc.musicbrainzDiscId, disc.metadataSource != "musicBrainz" else { return }
+        musicBrainz?.enqueue(discId: discId, slotId: disc.slotId)
+    }
+
+    /// Queue lookups for every cataloged disc ID that has not been looked up yet
+    func backfillOnlineMetadata() {
+        musicBrainz?.backfillPending()
     }
 
     /// Get disc record for a slot
@@ -44,6 +135,22 @@ final class CatalogService {
         return database.getAllDiscs()
     }
 
+    /// Search everything ever cataloged (label, artist, album, year, genre, disc type,
+    /// backup paths), best matches first
+    func search(_ query: String, limit: Int = 50) -> [DiscSearchHit] {
+        return database.searchDiscs(query: query, limit: limit)
+    }
+
+    /// Search the file trees of every imaged disc by path, best matches first
+    func searchFiles(_ query: String, limit: Int = 100) -> [DiscFileHit] {
+        return database.searchFiles(query: query, limit: limit)
+    }
+
+    /// The indexed file at `path` on the disc cataloged in `slotId`, with the backup it was indexed from
+    func getIndexedFile(slotId: Int, path: String) -> (file: DiscFileRecord, backup: BackupRecord?)? {
+        return database.getDiscFile(slotId: slotId, path: path)
+    }
+
     // MARK: - Backup Operations
 
     /// Record a successful backup
@@ -90,7 +197,11 @@ final class CatalogService {
 
     /// Get backup status for a slot
     func getBackupStatus(slotId: Int) -> BackupStatus {
-        guard let backup = database.getLatestBackup(slotId: slotId) else {
+        return backupStatus(for: database.getLatestBackup(slotId: slotId))
+    }
+
+    private func backupStatus(for backup: BackupRecord?) -> BackupStatus {
+        guard let backup = backup else {
             return .notBackedUp
         }
 
@@ -113,13 +224,21 @@ final class CatalogService {
 
     /// Get backup statuses for all slots (for batch loading)
     func getAllBackupStatuses() -> [Int: BackupStatus] {
-        let discs = database.getAllDiscs()
-        var statuses: [Int: BackupStatus] = [:]
+        return getBackupStatuses(slotIds: nil)
+    }
 
-        for disc in discs {
-            statuses[disc.slotId] = getBackupStatus(slotId: disc.slotId)
+    /// Backup status of each cataloged disc, or only those in `slotIds`, from a single query
+    func getBackupStatuses(slotIds: [Int]?) -> [Int: BackupStatus] {
+        var statuses: [Int: BackupStatus] = [:]
+        for (slotId, backup) in database.getLatestBackups(slotIds: slotIds) {
+            statuses[slotId] = backupStatus(for: backup)
         }
-
         return statuses
     }
+
+    /// Disc records for the given slots, keyed by slot
+    func getDiscs(slotIds: [Int]) -> [Int: DiscRecord] {
+        let discs = database.getDiscs(slotIds: slotIds)
+        return Dictionary(discs.map { ($0.slotId, $0) }, uniquingKeysWith: { _, last in last })
+    }
 }
@@ -0,0 +1,77 @@
+//
+//  ChangerLock.swift
+//  Discbot
+//
+//  Exclusive lock on the changer, shared by the app and the daemon
+//
+
+import Foundation
+
+/// An advisory `flock` on a file next to the catalog, held while a process is connected to
+/// the changer. The app and the daemon both take it before opening the transport, so two
+/// processes never drive one robot. The kernel releases it when the holder exits, crash or not.
+final class ChangerLock {
+    /// The changer `mchanger_open` picks: the first one attached
+    static let shared = ChangerLock(path: defaultPath(name: "changer"))
+
+    let path: String
+    private var descriptor: Int32 = -1
+    private let lock = NSLock()
+
+    init(path: String) {
+        self.path = path
+    }
+
+    deinit {
+        release()
+    }
+
+    /// Take the lock without waiting; false while another process holds it
+    func acquire() -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        guard descriptor < 0 else { return true }
+
+        let fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0o644)
+        guard fd >= 0 else {
+            print("ChangerLock: cannot open \(path): \(String(cString: strerror(errno)))")
+            return false
+        }
+        guard flock(fd, LOCK_EX | LOCK_NB) == 0 else {
+            close(fd)
+            return false
+        }
+        // For the error shown to the process that finds it taken
+        let pid = "\(getpid())\n"
+        _ = ftruncate(fd, 0)
+        _ = pid.withCString { write(fd, $0, strlen($0)) }
+        descriptor = fd
+        return true
+    }
+
+    func release() {
+        lock.lock()
+        defer { lock.unlock() }
+        guard descriptor >= 0 else { return }
+        _ = ftruncate(descriptor, 0)
+        _ = flock(descriptor, LOCK_UN)
+        close(descriptor)
+        descriptor = -1
+    }
+
+    /// The pid the current holder wrote, if any
+    var holderPid: Int32? {
+        guard let text = try? String(contentsOfFile: path, encoding: .utf8) else { return nil }
+        return Int32(text.trimmingCharacters(in: .whitespacesAndNewlines))
+    }
+
+    /// `<name>.lock` in the Discbot support directory, next to the catalog
+    private static func defaultPath(name: String) -> String {
+        let fileManager = FileManager.default
+        let base = fileManager.urls(for: .applicationSupportDirectory, in: .userDomainMask).first
+            ?? fileManager.temporaryDirectory
+        let directory = base.appendingPathComponent("Discbot", isDirectory: true)
+        try? fileManager.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        return directory.appendingPathComponent("\(name).lock").path
+    }
+}
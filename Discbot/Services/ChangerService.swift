@@ -9,8 +9,11 @@ import Foundation
 
 /// Thread-safe service for communicating with the DVD changer
 final class ChangerService {
-    private var handle: OpaquePointer?
-    private var elementMap: MChangerElementMap?
+    private let transport: ChangerTransport
+    /// Held while connected so the app and the daemon never drive the changer at once
+    private let changerLock: ChangerLock?
+    private var isOpen = false
+    private var layout: ChangerElementLayout?
     private let lock = NSLock()
 
     struct ChangerDeviceInfo {
@@ -30,21 +33,40 @@ final class ChangerService {
         let drive: DriveElementStatus
     }
 
+    init(transport: ChangerTransport, changerLock: ChangerLock? = nil) {
+        self.transport = transport
+        self.changerLock = changerLock
+    }
+
+    #if !DISCBOT_NO_HARDWARE
+    /// Service for the attached changer, through the mchanger library
+    convenience init(changerLock: ChangerLock? = nil) {
+        self.init(transport: MChangerTransport(), changerLock: changerLock)
+    }
+    #endif
+
     /// Connect to the DVD changer (blocking)
     func connect() throws {
         lock.lock()
         defer { lock.unlock() }
 
-        if handle != nil {
+        if isOpen && layout != nil {
             return // Already connected
         }
 
-        guard let h = mchanger_open(nil) else {
-            throw ChangerError.connectionFailed
+        if !isOpen {
+            if let changerLock = changerLock, !changerLock.acquire() {
+                throw ChangerError.changerInUse(changerLock.holderPid)
+            }
+            do {
+                try transport.open()
+            } catch {
+                changerLock?.release()
+                throw ChangerError.connectionFailed
+            }
+            isOpen = true
         }
 
-        handle = h
-
         // Load element map
         try loadElementMapLocked()
     }
@@ -54,15 +76,10 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        if let h = handle {
-            mchanger_close(h)
-            handle = nil
-        }
-
-        if var map = elementMap {
-            mchanger_free_element_map(&map)
-            elementMap = nil
-        }
+        transport.close()
+        changerLock?.release()
+        isOpen = false
+        layout = nil
     }
 
     /// Get device info via INQUIRY (blocking)
@@ -70,48 +87,72 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
 
-        var vendor = [CChar](repeating: 0, count: 64)
-        var product = [CChar](repeating: 0, count: 64)
-        var revision = [CChar](repeating: 0, count: 64)
-
-        let result = mchanger_inquiry(h, &vendor, 64, &product, 64, &revision, 64)
-
-        if result != MCHANGER_OK {
-            throw ChangerError.commandFailed("INQUIRY")
+        return try performLocked(failure: { _ in .commandFailed("INQUIRY") }) {
+            try transport.inquiry()
         }
-
-        return ChangerDeviceInfo(
-            vendor: String(cString: vendor).trimmingCharacters(in: .whitespaces),
-            product: String(cString: product).trimmingCharacters(in: .whitespaces),
-            revision: String(cString: revision).trimmingCharacters(in: .whitespaces)
-        )
     }
 
     /// Load element map (must hold lock)
-    private func loadElementMapLocked() throws {
-        guard let h = handle else {
+    private func loadElementMapLocked(recoversUnitAttention: Bool = true) throws {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
 
-        // Free existing map if any
-        if var map = elementMap {
-            mchanger_free_element_map(&map)
-        }
-
-        var map = MChangerElementMap()
-        let result = mchanger_get_element_map(h, &map)
-
-        if result != MCHANGER_OK {
-            throw ChangerError.commandFailed("GET ELEMENT MAP")
+        layout = nil
+        let map = try performLocked(
+            recoversUnitAttention: recoversUnitAttention,
+            failure: { _ in .commandFailed("GET ELEMENT MAP") }
+        ) {
+            try transport.readElementMap()
+        }
+        layout = map
+
+        print("Element map loaded: \(map.slotAddresses.count) slots, \(map.driveAddresses.count) drives, \(map.ieAddresses.count) I/E slots")
+    }
+
+    /// Run a transport command and map its failure to a ChangerError (must hold lock).
+    ///
+    /// A unit attention means the changer was reset or its door opened, so the element
+    /// map is reloaded and the command is retried once before giving up.
+    private func performLocked<T>(
+        recoversUnitAttention: Bool = true,
+        empty: ChangerError? = nil,
+        busy: ChangerError? = nil,
+        failure: (String) -> ChangerError,
+        _ command: () throws -> T
+    ) throws -> T {
+        do {
+            return try command()
+        } catch ChangerTransportError.checkCondition(let sense) where sense.isUnitAttention && recoversUnitAttention {
+            print("Unit attention (\(sense)), reloading element map and retrying")
+            try loadElementMapLocked(recoversUnitAttention: false)
+            return try performLocked(
+                recoversUnitAttention: false,
+                empty: empty,
+                busy: busy,
+                failure: failure,
+                command
+            )
+        } catch let error as ChangerTransportError {
+            switch error {
+            case .notOpen:
+                throw ChangerError.notConnected
+            case .empty:
+                throw empty ?? failure("empty")
+            case .busy:
+                throw busy ?? failure("busy")
+            case .timeout:
+                throw ChangerError.timeout
+            case .checkCondition(let sense):
+                throw sense.isUnitAttention ? ChangerError.unitAttention : ChangerError.senseError(sense.description)
+            case .failed(let code):
+                throw failure(code)
+            }
         }
-
-        elementMap = map
-
-        print("Element map loaded: \(map.slot_count) slots, \(map.drive_count) drives, \(map.ie_count) I/E slots")
     }
 
     /// Get status of all slots (blocking)
@@ -140,71 +181,59 @@ final class ChangerService {
 
     /// Internal helper - must be called with lock held.
     private func getInventoryStatusLocked() throws -> InventoryStatus {
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
-        guard let map = elementMap else {
+        guard let map = layout else {
             throw ChangerError.commandFailed("No element map")
         }
-        guard let slotAddrs = map.slot_addrs else {
+        guard !map.slotAddresses.isEmpty else {
             throw ChangerError.commandFailed("No slot addresses")
         }
 
-        var slotStatuses: [MChangerElementStatus] = Array(
-            repeating: MChangerElementStatus(),
-            count: Int(map.slot_count)
-        )
-
-        let driveAddr: UInt16 = {
-            guard map.drive_count > 0, let driveAddrs = map.drive_addrs else { return 0 }
-            return driveAddrs[0]
-        }()
-
-        var driveStatus = MChangerElementStatus()
-        var driveSupported = false
-
-        let result = mchanger_get_bulk_status(
-            h,
-            slotAddrs,
-            map.slot_count,
-            driveAddr,
-            &driveStatus,
-            &slotStatuses,
-            &driveSupported
-        )
+        let readStatus = {
+            try self.performLocked(failure: { _ in .commandFailed("READ ELEMENT STATUS (bulk)") }) {
+                try self.transport.readElementStatus()
+            }
+        }
 
-        if result != MCHANGER_OK {
-            throw ChangerError.commandFailed("READ ELEMENT STATUS (bulk)")
+        // Some changers truncate the element list while busy; ask once more before failing.
+        var report = try readStatus()
+        if report.slots.count < map.slotAddresses.count {
+            print("READ ELEMENT STATUS returned \(report.slots.count) of \(map.slotAddresses.count) slots, retrying")
+            report = try readStatus()
+        }
+        guard report.slots.count >= map.slotAddresses.count else {
+            throw ChangerError.commandFailed(
+                "READ ELEMENT STATUS returned \(report.slots.count) of \(map.slotAddresses.count) slots"
+            )
         }
 
         var slots: [Slot] = []
-        slots.reserveCapacity(Int(map.slot_count))
-        for i in 0..<Int(map.slot_count) {
+        slots.reserveCapacity(map.slotAddresses.count)
+        for i in 0..<map.slotAddresses.count {
             let slotNumber = i + 1
-            let st = slotStatuses[i]
+            let st = report.slots[i]
             slots.append(Slot(
                 id: slotNumber,
                 address: st.address,
-                isFull: st.full,
+                isFull: st.isFull,
                 isInDrive: false,
-                hasException: st.except
+                hasException: st.hasException
             ))
         }
 
         // Map drive source address back to a 1-based slot index when available.
         var sourceSlot: Int? = nil
-        if driveSupported && driveStatus.valid_source {
-            for i in 0..<Int(map.slot_count) {
-                if slotAddrs[i] == driveStatus.source_addr {
-                    sourceSlot = i + 1
-                    break
-                }
-            }
+        if let sourceAddress = report.drive?.sourceAddress,
+           let index = map.slotAddresses.firstIndex(of: sourceAddress) {
+            sourceSlot = index + 1
         }
 
+        let driveAddr = map.driveAddresses.first ?? 0
         let drive = DriveElementStatus(
-            isSupported: driveSupported && driveAddr != 0,
-            hasDisc: driveSupported && driveStatus.full,
+            isSupported: report.drive != nil && driveAddr != 0,
+            hasDisc: report.drive?.isFull ?? false,
             sourceSlot: sourceSlot
         )
 
@@ -216,28 +245,23 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
-        guard let map = elementMap else {
+        guard let map = layout else {
             throw ChangerError.commandFailed("No element map")
         }
-        guard slotNumber >= 1 && slotNumber <= map.slot_count else {
+        guard slotNumber >= 1 && slotNumber <= map.slotAddresses.count else {
             throw ChangerError.slotEmpty(slotNumber)
         }
 
         print("Loading slot \(slotNumber) into drive")
-        let result = mchanger_load_slot(h, Int32(slotNumber), 1)
-
-        switch result {
-        case MCHANGER_OK:
-            return
-        case MCHANGER_ERR_EMPTY:
-            throw ChangerError.slotEmpty(slotNumber)
-        case MCHANGER_ERR_BUSY:
-            throw ChangerError.driveNotEmpty
-        default:
-            throw ChangerError.moveFailed("mchanger_load_slot returned \(result)")
+        try performLocked(
+            empty: .slotEmpty(slotNumber),
+            busy: .driveNotEmpty,
+            failure: { .moveFailed("mchanger_load_slot returned \($0)") }
+        ) {
+            try transport.loadSlot(slotNumber)
         }
     }
 
@@ -246,28 +270,23 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
-        guard let map = elementMap else {
+        guard let map = layout else {
             throw ChangerError.commandFailed("No element map")
         }
-        guard slotNumber >= 1 && slotNumber <= map.slot_count else {
+        guard slotNumber >= 1 && slotNumber <= map.slotAddresses.count else {
             throw ChangerError.slotOccupied(slotNumber)
         }
 
         print("Unloading drive to slot \(slotNumber)")
-        let result = mchanger_unload_drive(h, Int32(slotNumber), 1)
-
-        switch result {
-        case MCHANGER_OK:
-            return
-        case MCHANGER_ERR_EMPTY:
-            throw ChangerError.driveEmpty
-        case MCHANGER_ERR_BUSY:
-            throw ChangerError.slotOccupied(slotNumber)
-        default:
-            throw ChangerError.moveFailed("mchanger_unload_drive returned \(result)")
+        try performLocked(
+            empty: .driveEmpty,
+            busy: .slotOccupied(slotNumber),
+            failure: { .moveFailed("mchanger_unload_drive returned \($0)") }
+        ) {
+            try transport.unloadDrive(toSlot: slotNumber)
         }
     }
 
@@ -276,7 +295,7 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard handle != nil else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
 
@@ -289,29 +308,25 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
-        guard let map = elementMap else {
+        guard let map = layout else {
             throw ChangerError.commandFailed("No element map")
         }
-        guard map.ie_count > 0 else {
+        guard !map.ieAddresses.isEmpty else {
             throw ChangerError.commandFailed("Changer has no import/export slot")
         }
-        guard slotNumber >= 1 && slotNumber <= map.slot_count else {
+        guard slotNumber >= 1 && slotNumber <= map.slotAddresses.count else {
             throw ChangerError.slotEmpty(slotNumber)
         }
 
         print("Ejecting slot \(slotNumber) to I/E slot")
-        let result = mchanger_eject(h, Int32(slotNumber), 1)
-
-        switch result {
-        case MCHANGER_OK:
-            return
-        case MCHANGER_ERR_EMPTY:
-            throw ChangerError.slotEmpty(slotNumber)
-        default:
-            throw ChangerError.moveFailed("mchanger_eject returned \(result)")
+        try performLocked(
+            empty: .slotEmpty(slotNumber),
+            failure: { .moveFailed("mchanger_eject returned \($0)") }
+        ) {
+            try transport.exportSlot(slotNumber)
         }
     }
 
@@ -320,31 +335,27 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
-        guard let map = elementMap else {
+        guard let map = layout else {
             throw ChangerError.commandFailed("No element map")
         }
-        guard map.ie_count > 0, let ieAddrs = map.ie_addrs else {
+        guard let ieAddr = map.ieAddresses.first else {
             throw ChangerError.commandFailed("Changer has no import/export slot")
         }
-        guard slotNumber >= 1 && slotNumber <= map.slot_count, let slotAddrs = map.slot_addrs else {
+        guard slotNumber >= 1 && slotNumber <= map.slotAddresses.count else {
             throw ChangerError.slotOccupied(slotNumber)
         }
-        guard let transportAddrs = map.transport_addrs, map.transport_count > 0 else {
+        guard let transportAddr = map.transportAddresses.first else {
             throw ChangerError.commandFailed("No transport element")
         }
 
-        let slotAddr = slotAddrs[slotNumber - 1]
-        let ieAddr = ieAddrs[0]
-        let transport = transportAddrs[0]
+        let slotAddr = map.slotAddresses[slotNumber - 1]
 
-        print("MOVE MEDIUM (import): transport=\(transport), source=\(ieAddr), dest=\(slotAddr)")
-        let result = mchanger_move_medium(h, transport, ieAddr, slotAddr)
-
-        if result != MCHANGER_OK {
-            throw ChangerError.moveFailed("mchanger_move_medium returned \(result)")
+        print("MOVE MEDIUM (import): transport=\(transportAddr), source=\(ieAddr), dest=\(slotAddr)")
+        try performLocked(failure: { .moveFailed("mchanger_move_medium returned \($0)") }) {
+            try transport.moveMedium(transport: transportAddr, source: ieAddr, destination: slotAddr)
         }
     }
 
@@ -353,37 +364,29 @@ final class ChangerService {
         lock.lock()
         defer { lock.unlock() }
 
-        guard let h = handle else {
+        guard isOpen else {
             throw ChangerError.notConnected
         }
-        guard let map = elementMap else {
+        guard let map = layout else {
             throw ChangerError.commandFailed("No element map")
         }
-        guard map.ie_count > 0, let ieAddrs = map.ie_addrs else {
+        guard let ieAddr = map.ieAddresses.first else {
             throw ChangerError.commandFailed("Changer has no import/export slot")
         }
-        guard let driveAddrs = map.drive_addrs, map.drive_count > 0 else {
+        guard let driveAddr = map.driveAddresses.first else {
             throw ChangerError.commandFailed("No drive element")
         }
-        guard let transportAddrs = map.transport_addrs, map.transport_count > 0 else {
+        guard let transportAddr = map.transportAddresses.first else {
             throw ChangerError.commandFailed("No transport element")
         }
 
-        let driveAddr = driveAddrs[0]
-        let ieAddr = ieAddrs[0]
-        let transport = transportAddrs[0]
-
-        print("MOVE MEDIUM (load from I/E): transport=\(transport), source=\(ieAddr), dest=\(driveAddr)")
-        let result = mchanger_move_medium(h, transport, ieAddr, driveAddr)
-
-        if result != MCHANGER_OK {
-            if result == MCHANGER_ERR_EMPTY {
-                throw ChangerError.commandFailed("I/E slot is empty")
-            }
-            if result == MCHANGER_ERR_BUSY {
-                throw ChangerError.driveNotEmpty
-            }
-            throw ChangerError.moveFailed("mchanger_move_medium returned \(result)")
+        print("MOVE MEDIUM (load from I/E): transport=\(transportAddr), source=\(ieAddr), dest=\(driveAddr)")
+        try performLocked(
+            empty: .commandFailed("I/E slot is empty"),
+            busy: .driveNotEmpty,
+            failure: { .moveFailed("mchanger_move_medium returned \($0)") }
+        ) {
+            try transport.moveMedium(transport: transportAddr, source: ieAddr, destination: driveAddr)
         }
     }
 
@@ -391,21 +394,21 @@ final class ChangerService {
     var hasIESlot: Bool {
         lock.lock()
         defer { lock.unlock() }
-        return (elementMap?.ie_count ?? 0) > 0
+        return !(layout?.ieAddresses.isEmpty ?? true)
     }
 
     /// Get slot count
     var slotCount: Int {
         lock.lock()
         defer { lock.unlock() }
-        return Int(elementMap?.slot_count ?? 0)
+        return layout?.slotAddresses.count ?? 0
     }
 
     /// Check if connected
     var isConnected: Bool {
         lock.lock()
         defer { lock.unlock() }
-        return handle != nil
+        return isOpen
     }
 }
 
@@ -0,0 +1,1109 @@
+//
+//  ChangerSimulator.swift
+//  Discbot
+//
+//  Deterministic discrete-event simulation of the changer, drive and imager
+//
+
+import Foundation
+
+// MARK: - Seeded RNG
+
+/// SplitMix64 generator so a simulated run is fully reproducible from its seed.
+struct SeededRandomNumberGenerator: RandomNumberGenerator {
+    private var state: UInt64
+
+    init(seed: UInt64) {
+        self.state = seed
+    }
+
+    mutating func next() -> UInt64 {
+        state &+= 0x9E37_79B9_7F4A_7C15
+        var z = state
+        z = (z ^ (z >> 30)) &* 0xBF58_476D_1CE4_E5B9
+        z = (z ^ (z >> 27)) &* 0x94D0_49BB_1331_11EB
+        return z ^ (z >> 31)
+    }
+}
+
+// MARK: - Simulator
+
+/// Discrete-event model of a carousel changer with a single drive.
+///
+/// All blocking service calls advance a virtual clock instead of sleeping, so a
+/// 200-disc batch completes in well under a second of wall time. Set
+/// `Configuration.realTimeScale` above zero to also sleep a fraction of each
+/// simulated interval (useful when driving the UI).
+final class ChangerSimulator {
+    /// Read speed of a CAV drive grows linearly with radius from `inner` to `outer`.
+    struct ReadCurve {
+        let innerBytesPerSecond: Double
+        let outerBytesPerSecond: Double
+
+        /// Instantaneous throughput at a fraction of the disc's data area.
+        func throughput(atFraction fraction: Double) -> Double {
+            let k = outerBytesPerSecond / innerBytesPerSecond
+            let f = min(max(fraction, 0), 1)
+            return innerBytesPerSecond * (1 + f * (k * k - 1)).squareRoot()
+        }
+
+        /// Seconds needed to read from `start` to `end` (fractions) of a disc holding `totalBytes`.
+        func readDuration(totalBytes: Int64, from start: Double, to end: Double) -> TimeInterval {
+            let k = outerBytesPerSecond / innerBytesPerSecond
+            let c = k * k - 1
+            let span = Double(totalBytes) / innerBytesPerSecond
+            guard c > 1e-9 else { return span * (end - start) }
+            // Closed form of the integral of 1 / sqrt(1 + c*f) over [start, end].
+            return span * 2 * ((1 + end * c).squareRoot() - (1 + start * c).squareRoot()) / c
+        }
+
+        static let dvd16x = ReadCurve(innerBytesPerSecond: 9_000_000, outerBytesPerSecond: 22_000_000)
+        static let dataCD48x = ReadCurve(innerBytesPerSecond: 3_000_000, outerBytesPerSecond: 7_000_000)
+        static let audioCD24x = ReadCurve(innerBytesPerSecond: 1_700_000, outerBytesPerSecond: 4_200_000)
+    }
+
+    /// A kind of disc the simulator can place in a slot.
+    struct DiscKind {
+        let discType: DiscType
+        let sizeRange: ClosedRange<Int64>
+        let spinUpSeconds: ClosedRange<Double>
+        let readCurve: ReadCurve
+
+        static let dvd = DiscKind(
+            discType: .dvd,
+            sizeRange: 3_500_000_000...8_500_000_000,
+            spinUpSeconds: 6...12,
+            readCurve: .dvd16x
+        )
+        static let dataCD = DiscKind(
+            discType: .dataCD,
+            sizeRange: 150_000_000...700_000_000,
+            spinUpSeconds: 4...8,
+            readCurve: .dataCD48x
+        )
+        static let audioCD = DiscKind(
+            discType: .audioCDDA,
+            sizeRange: 250_000_000...800_000_000,
+            spinUpSeconds: 4...8,
+            readCurve: .audioCD24x
+        )
+        static let mixedModeCD = DiscKind(
+            discType: .mixedModeCD,
+            sizeRange: 300_000_000...700_000_000,
+            spinUpSeconds: 5...9,
+            readCurve: .dataCD48x
+        )
+    }
+
+    /// Robot and drive latencies, in seconds.
+    struct Timing {
+        var pickerBaseSeconds: Double = 3.0
+        var pickerSecondsPerSlot: Double = 0.08
+        var loadSeconds: Double = 18.0
+        var ejectSeconds: Double = 14.0
+        var driveReleaseSeconds: Double = 2.0
+        var mountSeconds: Double = 3.0
+        var unmountSeconds: Double = 1.0
+        var probeSeconds: Double = 0.5
+        var descriptorReadSeconds: Double = 0.3
+        var tocReadSeconds: Double = 0.05
+        var pollIntervalSeconds: Double = 1.0
+    }
+
+    /// Per-operation failure probabilities in 0...1.
+    struct Faults {
+        var loadFailureRate: Double = 0
+        var ejectFailureRate: Double = 0
+        var mountFailureRate: Double = 0
+        var readFailureRate: Double = 0
+        var discNotAppearingRate: Double = 0
+        /// Probability that a full slot reports the EXCEPT bit; loads from it fail.
+        var exceptionRate: Double = 0
+
+        static let none = Faults()
+    }
+
+    struct Configuration {
+        var slotCount: Int = 200
+        /// Fraction of slots holding a disc when `occupiedSlots` is nil.
+        var occupancy: Double = 0.6
+        var occupiedSlots: Set<Int>?
+        var discMix: [(kind: DiscKind, weight: Double)] = [
+            (.dvd, 0.45), (.dataCD, 0.25), (.audioCD, 0.25), (.mixedModeCD, 0.05),
+        ]
+        var timing = Timing()
+        var faults = Faults.none
+        var hasIESlot = true
+        var seed: UInt64 = 1
+        /// Real seconds slept per simulated second (0 = pure virtual time).
+        var realTimeScale: Double = 0
+        /// Report disc type and label in the inventory like the mock does, instead of
+        /// `.unscanned` like real hardware.
+        var reportsCatalogMetadata = false
+    }
+
+    /// Accumulated resource usage, in simulated seconds.
+    struct Statistics {
+        var elapsedSeconds: TimeInterval = 0
+        var robotBusySeconds: TimeInterval = 0
+        var driveBusySeconds: TimeInterval = 0
+        var bytesRead: Int64 = 0
+        var loads = 0
+        var ejects = 0
+        var injectedFaults = 0
+
+        var robotIdleFraction: Double {
+            elapsedSeconds > 0 ? max(0, 1 - robotBusySeconds / elapsedSeconds) : 1
+        }
+
+        var driveIdleFraction: Double {
+            elapsedSeconds > 0 ? max(0, 1 - driveBusySeconds / elapsedSeconds) : 1
+        }
+    }
+
+    struct Disc {
+        let serial: Int
+        let kind: DiscKind
+        let volumeName: String
+        let sizeBytes: Int64
+        let spinUpSeconds: Double
+    }
+
+    private struct ScheduledEvent {
+        let time: TimeInterval
+        let sequence: Int
+        let action: () -> Void
+    }
+
+    let configuration: Configuration
+
+    private let lock = NSLock()
+    private var rng: SeededRandomNumberGenerator
+    private var now: TimeInterval = 0
+    private var events: [ScheduledEvent] = []
+    private var eventSequence = 0
+    private var stats = Statistics()
+
+    private var slotDiscs: [Disc?]
+    private var slotExceptions: [Bool]
+    private var pickerPosition = 0          // 0 = drive, 1...slotCount = slots
+    private var driveDisc: Disc?
+    private var driveSourceSlot: Int?
+    private var driveReady = false
+    private var driveMounted = false
+    private var driveBSDName: String?
+    private var ieDisc: Disc?
+    private var discSerial = 1
+
+    init(configuration: Configuration = Configuration()) {
+        self.configuration = configuration
+        var rng = SeededRandomNumberGenerator(seed: configuration.seed)
+
+        var discs: [Disc?] = []
+        var exceptions: [Bool] = []
+        discs.reserveCapacity(configuration.slotCount)
+        exceptions.reserveCapacity(configuration.slotCount)
+        for slot in 1...max(configuration.slotCount, 1) {
+            let isFull: Bool
+            if let occupied = configuration.occupiedSlots {
+                isFull = occupied.contains(slot)
+            } else {
+                isFull = Double.random(in: 0..<1, using: &rng) < configuration.occupancy
+            }
+            guard isFull else {
+                discs.append(nil)
+                exceptions.append(false)
+                continue
+            }
+            let kind = Self.pickKind(from: configuration.discMix, using: &rng)
+            let catalog = MockChangerState.mockDiscCatalog
+            discs.append(Disc(
+                serial: slot,
+                kind: kind,
+                volumeName: "\(catalog[(slot - 1) % catalog.count].volumeName) #\(slot)",
+                sizeBytes: Int64.random(in: kind.sizeRange, using: &rng),
+                spinUpSeconds: Double.random(in: kind.spinUpSeconds, using: &rng)
+            ))
+            exceptions.append(Double.random(in: 0..<1, using: &rng) < configuration.faults.exceptionRate)
+        }
+
+        self.rng = rng
+        self.slotDiscs = discs
+        self.slotExceptions = exceptions
+    }
+
+    private static func pickKind(
+        from mix: [(kind: DiscKind, weight: Double)],
+        using rng: inout SeededRandomNumberGenerator
+    ) -> DiscKind {
+        let total = mix.reduce(0) { $0 + max($1.weight, 0) }
+        guard total > 0 else { return .dvd }
+        var roll = Double.random(in: 0..<total, using: &rng)
+        for entry in mix {
+            roll -= max(entry.weight, 0)
+            if roll < 0 { return entry.kind }
+        }
+        return mix[mix.count - 1].kind
+    }
+
+    // MARK: - Virtual Clock
+
+    /// Current simulated time in seconds since the simulator was created.
+    var currentTime: TimeInterval {
+        lock.lock()
+        defer { lock.unlock() }
+        return now
+    }
+
+    func snapshotStatistics() -> Statistics {
+        lock.lock()
+        defer { lock.unlock() }
+        var snapshot = stats
+        snapshot.elapsedSeconds = now
+        return snapshot
+    }
+
+    /// Advance the clock by `seconds` of simulated time (e.g. a retry backoff).
+    func sleep(_ seconds: TimeInterval) {
+        lock.lock()
+        advanceLocked(by: seconds)
+        lock.unlock()
+        realSleep(seconds)
+    }
+
+    private func scheduleLocked(after delay: TimeInterval, _ action: @escaping () -> Void) {
+        let event = ScheduledEvent(time: now + max(delay, 0), sequence: eventSequence, action: action)
+        eventSequence += 1
+        let index = events.firstIndex { ($0.time, $0.sequence) > (event.time, event.sequence) } ?? events.count
+        events.insert(event, at: index)
+    }
+
+    /// Run every event due up to `now + seconds`, then settle the clock there.
+    private func advanceLocked(by seconds: TimeInterval) {
+        let target = now + max(seconds, 0)
+        while let next = events.first, next.time <= target {
+            events.removeFirst()
+            now = next.time
+            next.action()
+        }
+        now = target
+    }
+
+    /// Advance event by event until `condition` holds or `timeout` elapses. Returns the elapsed time.
+    private func advanceLocked(until condition: () -> Bool, timeout: TimeInterval) -> TimeInterval {
+        let start = now
+        let deadline = now + timeout
+        while !condition() {
+            guard let next = events.first, next.time <= deadline else {
+                now = deadline
+                break
+            }
+            // Callers poll at a fixed interval, so round up to the next poll tick.
+            let poll = configuration.timing.pollIntervalSeconds
+            let ticks = poll > 0 ? ((next.time - now) / poll).rounded(.up) : 0
+            advanceLocked(by: min(max(ticks * poll, next.time - now), deadline - now))
+        }
+        return now - start
+    }
+
+    private func realSleep(_ simulatedSeconds: TimeInterval) {
+        let scale = configuration.realTimeScale
+        guard scale > 0, simulatedSeconds > 0 else { return }
+        Thread.sleep(forTimeInterval: simulatedSeconds * scale)
+    }
+
+    private func roll(_ probability: Double) -> Bool {
+        guard probability > 0 else { return false }
+        let hit = Double.random(in: 0..<1, using: &rng) < probability
+        if hit { stats.injectedFaults += 1 }
+        return hit
+    }
+
+    // MARK: - Robot
+
+    private func travelSecondsLocked(to position: Int) -> TimeInterval {
+        // Carousel: travel the shorter way around.
+        let count = configuration.slotCount + 1
+        let distance = abs(position - pickerPosition)
+        let steps = min(distance, count - distance)
+        return configuration.timing.pickerBaseSeconds + Double(steps) * configuration.timing.pickerSecondsPerSlot
+    }
+
+    private func robotMoveLocked(to position: Int, handling: TimeInterval) -> TimeInterval {
+        let duration = travelSecondsLocked(to: position) + handling
+        advanceLocked(by: duration)
+        stats.robotBusySeconds += duration
+        pickerPosition = position
+        return duration
+    }
+
+    private func validSlot(_ slotNumber: Int) -> Bool {
+        slotNumber >= 1 && slotNumber <= configuration.slotCount
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard validSlot(slotNumber), let disc = slotDiscs[slotNumber - 1] else {
+            throw ChangerError.slotEmpty(slotNumber)
+        }
+        guard driveDisc == nil else {
+            throw ChangerError.driveNotEmpty
+        }
+        if slotExceptions[slotNumber - 1] {
+            elapsed = robotMoveLocked(to: slotNumber, handling: 0)
+            throw ChangerError.moveFailed("element exception")
+        }
+        if roll(configuration.faults.loadFailureRate) {
+            elapsed = robotMoveLocked(to: slotNumber, handling: configuration.timing.loadSeconds / 2)
+            throw ChangerError.moveFailed("simulated pick failure")
+        }
+
+        elapsed = robotMoveLocked(to: slotNumber, handling: configuration.timing.loadSeconds)
+        slotDiscs[slotNumber - 1] = nil
+        driveDisc = disc
+        driveSourceSlot = slotNumber
+        driveReady = false
+        driveMounted = false
+        driveBSDName = nil
+        pickerPosition = 0
+        stats.loads += 1
+
+        // The drive spins up in the background; the robot is free meanwhile.
+        if !roll(configuration.faults.discNotAppearingRate) {
+            let serial = discSerial
+            discSerial += 1
+            stats.driveBusySeconds += disc.spinUpSeconds
+            scheduleLocked(after: disc.spinUpSeconds) { [weak self] in
+                guard let self = self, self.driveDisc?.serial == disc.serial else { return }
+                self.driveReady = true
+                self.driveBSDName = "simdisk\(serial)"
+            }
+        }
+    }
+
+    func ejectToSlot(_ slotNumber: Int) throws {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard validSlot(slotNumber) else {
+            throw ChangerError.slotOccupied(slotNumber)
+        }
+        guard let disc = driveDisc else {
+            throw ChangerError.driveEmpty
+        }
+        guard slotDiscs[slotNumber - 1] == nil else {
+            throw ChangerError.slotOccupied(slotNumber)
+        }
+        if driveMounted {
+            // The drive refuses to release a mounted medium.
+            throw ChangerError.moveFailed("medium removal prevented")
+        }
+
+        advanceLocked(by: configuration.timing.driveReleaseSeconds)
+        stats.driveBusySeconds += configuration.timing.driveReleaseSeconds
+        elapsed = configuration.timing.driveReleaseSeconds
+
+        if roll(configuration.faults.ejectFailureRate) {
+            elapsed += robotMoveLocked(to: 0, handling: configuration.timing.ejectSeconds / 2)
+            throw ChangerError.moveFailed("simulated place failure")
+        }
+
+        pickerPosition = 0
+        elapsed += robotMoveLocked(to: slotNumber, handling: configuration.timing.ejectSeconds)
+        slotDiscs[slotNumber - 1] = disc
+        clearDriveLocked()
+        stats.ejects += 1
+    }
+
+    func unloadToIE(_ slotNumber: Int) throws {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard configuration.hasIESlot else {
+            throw ChangerError.commandFailed("Changer has no import/export slot")
+        }
+        guard validSlot(slotNumber), let disc = slotDiscs[slotNumber - 1] else {
+            throw ChangerError.slotEmpty(slotNumber)
+        }
+        elapsed = robotMoveLocked(to: slotNumber, handling: configuration.timing.ejectSeconds)
+        slotDiscs[slotNumber - 1] = nil
+        ieDisc = disc
+    }
+
+    func importFromIE(_ slotNumber: Int) throws {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard configuration.hasIESlot else {
+            throw ChangerError.commandFailed("Changer has no import/export slot")
+        }
+        guard validSlot(slotNumber), slotDiscs[slotNumber - 1] == nil else {
+            throw ChangerError.slotOccupied(slotNumber)
+        }
+        guard let disc = ieDisc else {
+            throw ChangerError.commandFailed("I/E slot is empty")
+        }
+        elapsed = robotMoveLocked(to: slotNumber, handling: configuration.timing.loadSeconds)
+        slotDiscs[slotNumber - 1] = disc
+        ieDisc = nil
+    }
+
+    func loadFromIE() throws {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard configuration.hasIESlot else {
+            throw ChangerError.commandFailed("Changer has no import/export slot")
+        }
+        guard let disc = ieDisc else {
+            throw ChangerError.commandFailed("I/E slot is empty")
+        }
+        guard driveDisc == nil else {
+            throw ChangerError.driveNotEmpty
+        }
+        elapsed = robotMoveLocked(to: 0, handling: configuration.timing.loadSeconds)
+        ieDisc = nil
+        driveDisc = disc
+        driveSourceSlot = nil
+        driveReady = false
+        let serial = discSerial
+        discSerial += 1
+        stats.loads += 1
+        stats.driveBusySeconds += disc.spinUpSeconds
+        scheduleLocked(after: disc.spinUpSeconds) { [weak self] in
+            guard let self = self, self.driveDisc?.serial == disc.serial else { return }
+            self.driveReady = true
+            self.driveBSDName = "simdisk\(serial)"
+        }
+    }
+
+    func clearIESlot() {
+        lock.lock()
+        defer { lock.unlock() }
+        ieDisc = nil
+    }
+
+    private func clearDriveLocked() {
+        driveDisc = nil
+        driveSourceSlot = nil
+        driveReady = false
+        driveMounted = false
+        driveBSDName = nil
+    }
+
+    func inventory() -> ChangerService.InventoryStatus {
+        lock.lock()
+        defer { lock.unlock() }
+
+        var slots: [Slot] = []
+        slots.reserveCapacity(slotDiscs.count)
+        for (index, disc) in slotDiscs.enumerated() {
+            let reportMetadata = configuration.reportsCatalogMetadata && disc != nil
+            slots.append(Slot(
+                id: index + 1,
+                address: UInt16(index + 1),
+                isFull: disc != nil,
+                isInDrive: false,
+                hasException: slotExceptions[index],
+                discType: reportMetadata ? Self.slotDiscType(for: disc!.kind.discType) : .unscanned,
+                volumeLabel: reportMetadata ? disc!.volumeName : nil
+            ))
+        }
+
+        let drive = ChangerService.DriveElementStatus(
+            isSupported: true,
+            hasDisc: driveDisc != nil,
+            sourceSlot: driveSourceSlot
+        )
+        return ChangerService.InventoryStatus(slots: slots, drive: drive)
+    }
+
+    static func slotDiscType(for discType: DiscType) -> SlotDiscType {
+        switch discType {
+        case .audioCDDA: return .audioCDDA
+        case .dataCD: return .dataCD
+        case .mixedModeCD: return .mixedModeCD
+        case .dvd: return .dvd
+        case .unknown: return .unknown
+        }
+    }
+
+    // MARK: - Drive
+
+    /// Disc currently loaded and spun up under `bsdName`, if any.
+    private func readyDiscLocked(_ bsdName: String) -> Disc? {
+        guard driveReady, driveBSDName == bsdName else { return nil }
+        return driveDisc
+    }
+
+    func waitForDisc(timeout: TimeInterval) throws -> String {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        elapsed = advanceLocked(until: { driveReady && driveBSDName != nil }, timeout: timeout)
+        guard driveReady, let bsdName = driveBSDName else {
+            throw ChangerError.timeout
+        }
+        return bsdName
+    }
+
+    func findDiscBSDName() -> String? {
+        lock.lock()
+        defer { lock.unlock() }
+        return driveReady ? driveBSDName : nil
+    }
+
+    func isDiscPresent() -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return driveReady
+    }
+
+    func mountDisc(bsdName: String) throws -> String {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard let disc = readyDiscLocked(bsdName) else {
+            throw ChangerError.driveEmpty
+        }
+        if driveMounted {
+            return "/Volumes/\(disc.volumeName)"
+        }
+
+        elapsed = configuration.timing.mountSeconds
+        advanceLocked(by: elapsed)
+        stats.driveBusySeconds += elapsed
+
+        // Audio CDs have no filesystem to mount, exactly like the real MountService.
+        if disc.kind.discType == .audioCDDA || roll(configuration.faults.mountFailureRate) {
+            throw ChangerError.mountFailed("No mount point returned")
+        }
+        driveMounted = true
+        return "/Volumes/\(disc.volumeName)"
+    }
+
+    func unmountDisc(bsdName: String) throws {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard readyDiscLocked(bsdName) != nil else {
+            throw ChangerError.driveEmpty
+        }
+        guard driveMounted else { return }
+        elapsed = configuration.timing.unmountSeconds
+        advanceLocked(by: elapsed)
+        stats.driveBusySeconds += elapsed
+        driveMounted = false
+    }
+
+    func isMounted(bsdName: String) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return readyDiscLocked(bsdName) != nil && driveMounted
+    }
+
+    func mountPoint(bsdName: String) -> String? {
+        lock.lock()
+        defer { lock.unlock() }
+        guard let disc = readyDiscLocked(bsdName), driveMounted else { return nil }
+        return "/Volumes/\(disc.volumeName)"
+    }
+
+    func volumeName(bsdName: String) -> String? {
+        lock.lock()
+        defer { lock.unlock() }
+        guard let disc = readyDiscLocked(bsdName) else { return nil }
+        return disc.kind.discType == .audioCDDA ? "Audio CD" : disc.volumeName
+    }
+
+    /// Probe the loaded disc (diskutil-style query); costs `probeSeconds` of drive time.
+    func probe(bsdName: String) -> Disc? {
+        lock.lock()
+        let disc = readyDiscLocked(bsdName)
+        let elapsed = disc != nil ? configuration.timing.probeSeconds : 0
+        advanceLocked(by: elapsed)
+        stats.driveBusySeconds += elapsed
+        lock.unlock()
+        realSleep(elapsed)
+        return disc
+    }
+
+    /// Read the CD table of contents of the loaded disc; nil for DVDs, which have none.
+    func readTOC(bsdName: String) -> DiscTOC? {
+        lock.lock()
+        let disc = readyDiscLocked(bsdName)
+        let elapsed = disc != nil ? configuration.timing.tocReadSeconds : 0
+        advanceLocked(by: elapsed)
+        stats.driveBusySeconds += elapsed
+        lock.unlock()
+        realSleep(elapsed)
+        guard let disc = disc else { return nil }
+        return DiscTOC.simulated(discType: disc.kind.discType, sizeBytes: disc.sizeBytes, serial: disc.serial)
+    }
+
+    /// Read the volume descriptors of the loaded disc; nil for media without a filesystem.
+    func readVolumeDescriptors(bsdName: String) -> Disc? {
+        lock.lock()
+        let disc = readyDiscLocked(bsdName)
+        let elapsed = disc != nil ? configuration.timing.descriptorReadSeconds : 0
+        advanceLocked(by: elapsed)
+        stats.driveBusySeconds += elapsed
+        lock.unlock()
+        realSleep(elapsed)
+        return disc?.kind.discType == .audioCDDA ? nil : disc
+    }
+
+    /// Read `fraction` of the loaded disc's data area starting at `start`.
+    /// Returns the simulated read duration, or throws on an injected media error.
+    func read(bsdName: String, from start: Double, to end: Double) throws -> TimeInterval {
+        lock.lock()
+        var elapsed: TimeInterval = 0
+        defer {
+            lock.unlock()
+            realSleep(elapsed)
+        }
+
+        guard let disc = readyDiscLocked(bsdName) else {
+            throw ImagingError.discNotReady
+        }
+        elapsed = disc.kind.readCurve.readDuration(totalBytes: disc.sizeBytes, from: start, to: end)
+        advanceLocked(by: elapsed)
+        stats.driveBusySeconds += elapsed
+        stats.bytesRead += Int64(Double(disc.sizeBytes) * (end - start))
+        return elapsed
+    }
+
+    /// Decide up front whether (and where) this image attempt hits a media error.
+    func rollReadFailurePoint() -> Double? {
+        lock.lock()
+        defer { lock.unlock() }
+        guard roll(configuration.faults.readFailureRate) else { return nil }
+        return Double.random(in: 0.05..<0.95, using: &rng)
+    }
+}
+
+// MARK: - Simulated TOC
+
+extension DiscTOC {
+    /// A plausible single-session TOC for simulated and mock discs: one data track for
+    /// data CDs, 8-19 audio tracks for audio CDs, and a leading data track on mixed-mode discs.
+    /// Nil for DVDs and unknown media.
+    static func simulated(discType: DiscType, sizeBytes: Int64, serial: Int) -> DiscTOC? {
+        let audioTrackCount = 8 + abs(serial) % 12
+        let dataSectors: Int
+        let audioSectors: Int
+        switch discType {
+        case .dataCD:
+            dataSectors = Int(sizeBytes / 2048)
+            audioSectors = 0
+        case .audioCDDA:
+            dataSectors = 0
+            audioSectors = Int(sizeBytes / 2352)
+        case .mixedModeCD:
+            dataSectors = Int(sizeBytes / 3 / 2048)
+            audioSectors = Int((sizeBytes - sizeBytes / 3) / 2352)
+        case .dvd, .unknown:
+            return nil
+        }
+
+        var tracks: [Track] = []
+        var lba = 0
+        if dataSectors > 0 {
+            tracks.append(Track(number: 1, isData: true, startLBA: 0, lengthSectors: dataSectors))
+            lba = dataSectors
+        }
+        if audioSectors > 0 {
+            // Uneven but deterministic track lengths
+            let weights = (0..<audioTrackCount).map { 3 + (serial &* 7 &+ $0 &* 5) % 5 }
+            let totalWeight = weights.reduce(0, +)
+            var remaining = audioSectors
+            for (index, weight) in weights.enumerated() {
+                let length = index == weights.count - 1 ? remaining : audioSectors * weight / totalWeight
+                tracks.append(Track(number: tracks.count + 1, isData: false, startLBA: lba, lengthSectors: length))
+                lba += length
+                remaining -= length
+            }
+        }
+
+        return DiscTOC(
+            tracks: tracks,
+            sessions: [Session(number: 1, firstTrack: 1, lastTrack: tracks.count, leadOutLBA: lba)],
+            leadOutLBA: lba
+        )
+    }
+}
+
+// MARK: - Simulated Services
+
+final class SimulatedChangerService: ChangerServicing {
+    private let simulator: ChangerSimulator
+    private var connected = false
+
+    init(simulator: ChangerSimulator) {
+        self.simulator = simulator
+    }
+
+    func connect() throws {
+        connected = true
+    }
+
+    func disconnect() {
+        connected = false
+    }
+
+    func getDeviceInfo() throws -> ChangerService.ChangerDeviceInfo {
+        guard connected else { throw ChangerError.notConnected }
+        return ChangerService.ChangerDeviceInfo(vendor: "Discbot", product: "Simulated Changer", revision: "sim")
+    }
+
+    func getSlotStatus() throws -> [Slot] {
+        return try getInventoryStatus().slots
+    }
+
+    func getDriveStatus() throws -> (hasDisc: Bool, sourceSlot: Int?) {
+        let inv = try getInventoryStatus()
+        return (inv.drive.hasDisc, inv.drive.sourceSlot)
+    }
+
+    func getInventoryStatus() throws -> ChangerService.InventoryStatus {
+        guard connected else { throw ChangerError.notConnected }
+        return simulator.inventory()
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        guard connected else { throw ChangerError.notConnected }
+        try simulator.loadSlot(slotNumber)
+    }
+
+    func ejectToSlot(_ slotNumber: Int) throws {
+        guard connected else { throw ChangerError.notConnected }
+        try simulator.ejectToSlot(slotNumber)
+    }
+
+    func unloadToIE(_ slotNumber: Int) throws {
+        guard connected else { throw ChangerError.notConnected }
+        try simulator.unloadToIE(slotNumber)
+    }
+
+    func importFromIE(_ slotNumber: Int) throws {
+        guard connected else { throw ChangerError.notConnected }
+        try simulator.importFromIE(slotNumber)
+    }
+
+    func loadFromIE() throws {
+        guard connected else { throw ChangerError.notConnected }
+        try simulator.loadFromIE()
+    }
+
+    func initializeElementStatus() throws {
+        guard connected else { throw ChangerError.notConnected }
+    }
+
+    var hasIESlot: Bool { simulator.configuration.hasIESlot }
+    var slotCount: Int { simulator.configuration.slotCount }
+    var isConnected: Bool { connected }
+}
+
+/// Element-level transport over the simulator, so the real ChangerService (and its
+/// error mapping) can run without hardware.
+final class SimulatedChangerTransport: ChangerTransport {
+    private let simulator: ChangerSimulator
+    private var isOpen = false
+
+    static let driveAddress: UInt16 = 0x8000
+    static let ieAddress: UInt16 = 0x8100
+    static let transportAddress: UInt16 = 0x8200
+
+    init(simulator: ChangerSimulator) {
+        self.simulator = simulator
+    }
+
+    /// Translate simulator errors into the codes the mchanger library would return.
+    private func forward(_ body: () throws -> Void) throws {
+        guard isOpen else { throw ChangerTransportError.notOpen }
+        do {
+            try body()
+        } catch let error as ChangerError {
+            switch error {
+            case .slotEmpty, .driveEmpty:
+                throw ChangerTransportError.empty
+            case .slotOccupied, .driveNotEmpty:
+                throw ChangerTransportError.busy
+            case .timeout:
+                throw ChangerTransportError.timeout
+            case .moveFailed(let reason), .commandFailed(let reason):
+                throw ChangerTransportError.failed(reason)
+            default:
+                throw ChangerTransportError.failed(error.localizedDescription)
+            }
+        }
+    }
+
+    func open() throws {
+        isOpen = true
+    }
+
+    func close() {
+        isOpen = false
+    }
+
+    func inquiry() throws -> ChangerService.ChangerDeviceInfo {
+        guard isOpen else { throw ChangerTransportError.notOpen }
+        return ChangerService.ChangerDeviceInfo(vendor: "Discbot", product: "Simulated Changer", revision: "sim")
+    }
+
+    func readElementMap() throws -> ChangerElementLayout {
+        guard isOpen else { throw ChangerTransportError.notOpen }
+        let config = simulator.configuration
+        return ChangerElementLayout(
+            slotAddresses: (1...max(config.slotCount, 1)).map { UInt16($0) },
+            driveAddresses: [Self.driveAddress],
+            ieAddresses: config.hasIESlot ? [Self.ieAddress] : [],
+            transportAddresses: [Self.transportAddress]
+        )
+    }
+
+    func readElementStatus() throws -> ChangerElementStatusReport {
+        guard isOpen else { throw ChangerTransportError.notOpen }
+        let inventory = simulator.inventory()
+        let slots = inventory.slots.map {
+            ChangerElementState(address: $0.address, isFull: $0.isFull, hasException: $0.hasException, sourceAddress: nil)
+        }
+        let drive = ChangerElementState(
+            address: Self.driveAddress,
+            isFull: inventory.drive.hasDisc,
+            hasException: false,
+            sourceAddress: inventory.drive.sourceSlot.map { UInt16($0) }
+        )
+        return ChangerElementStatusReport(slots: slots, drive: drive)
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        try forward { try simulator.loadSlot(slotNumber) }
+    }
+
+    func unloadDrive(toSlot slotNumber: Int) throws {
+        try forward { try simulator.ejectToSlot(slotNumber) }
+    }
+
+    func exportSlot(_ slotNumber: Int) throws {
+        try forward { try simulator.unloadToIE(slotNumber) }
+    }
+
+    func moveMedium(transport: UInt16, source: UInt16, destination: UInt16) throws {
+        guard source == Self.ieAddress else {
+            throw ChangerTransportError.failed("unsupported move \(source) -> \(destination)")
+        }
+        if destination == Self.driveAddress {
+            try forward { try simulator.loadFromIE() }
+        } else {
+            try forward { try simulator.importFromIE(Int(destination)) }
+        }
+    }
+}
+
+final class SimulatedMountService: MountServicing {
+    private let simulator: ChangerSimulator
+
+    init(simulator: ChangerSimulator) {
+        self.simulator = simulator
+    }
+
+    func waitForDisc(timeout: TimeInterval = 60) throws -> String {
+        try simulator.waitForDisc(timeout: timeout)
+    }
+
+    func findDiscBSDName() -> String? {
+        simulator.findDiscBSDName()
+    }
+
+    func getDriveIdentity() -> String? {
+        "Discbot Simulated Drive"
+    }
+
+    func isDiscPresent() -> Bool {
+        simulator.isDiscPresent()
+    }
+
+    func mountDisc(bsdName: String, timeout: Int = 30) throws -> String {
+        try simulator.mountDisc(bsdName: bsdName)
+    }
+
+    func unmountDisc(bsdName: String, force: Bool = false) throws {
+        try simulator.unmountDisc(bsdName: bsdName)
+    }
+
+    func ejectDisc(bsdName: String, force: Bool = false) throws {
+        try simulator.unmountDisc(bsdName: bsdName)
+    }
+
+    func isMounted(bsdName: String) -> Bool {
+        simulator.isMounted(bsdName: bsdName)
+    }
+
+    func getMountPoint(bsdName: String) -> String? {
+        simulator.mountPoint(bsdName: bsdName)
+    }
+
+    func getVolumeName(bsdName: String) -> String? {
+        simulator.volumeName(bsdName: bsdName)
+    }
+
+    func waitAndMount(timeout: TimeInterval = 60) throws -> (bsdName: String, mountPoint: String) {
+        let bsdName = try waitForDisc(timeout: timeout)
+        let mountPoint = try mountDisc(bsdName: bsdName)
+        return (bsdName, mountPoint)
+    }
+}
+
+final class SimulatedImagingService: ImagingServicing {
+    private let simulator: ChangerSimulator
+    private let progressSteps: Int
+    private let writesPlaceholderFiles: Bool
+
+    init(simulator: ChangerSimulator, progressSteps: Int = 50, writesPlaceholderFiles: Bool = false) {
+        self.simulator = simulator
+        self.progressSteps = max(progressSteps, 1)
+        self.writesPlaceholderFiles = writesPlaceholderFiles
+    }
+
+    func estimateDiscSizeBytes(bsdName: String) -> Int64? {
+        simulator.probe(bsdName: bsdName)?.sizeBytes
+    }
+
+    func detectDiscType(bsdName: String) -> DiscType {
+        simulator.probe(bsdName: bsdName)?.kind.discType ?? .unknown
+    }
+
+    func readTOC(bsdName: String) -> DiscTOC? {
+        simulator.readTOC(bsdName: bsdName)
+    }
+
+    func readVolumeInfo(bsdName: String) -> VolumeInfo? {
+        guard let disc = simulator.readVolumeDescriptors(bsdName: bsdName) else { return nil }
+        let filesystems: VolumeInfo.Filesystems = disc.kind == .dvd ? [.iso9660, .udf] : [.iso9660, .joliet]
+        return VolumeInfo(filesystems: filesystems, label: disc.volumeName, sizeBytes: disc.sizeBytes)
+    }
+
+    func createImage(
+        bsdName: String,
+        discType: DiscType,
+        outputPath: URL,
+        totalBytes: Int64?,
+        control: ImagingService.ImagingControl?,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> URL {
+        guard simulator.findDiscBSDName() == bsdName else {
+            throw ImagingError.deviceNotFound(bsdName)
+        }
+        if simulator.isMounted(bsdName: bsdName) {
+            // hdiutil cannot open a mounted device for raw reads.
+            throw ImagingError.processFailed(1, "hdiutil failed: Resource busy")
+        }
+
+        let totalSize = totalBytes ?? 0
+        let failurePoint = simulator.rollReadFailurePoint()
+        var readSeconds: TimeInterval = 0
+
+        for step in 1...progressSteps {
+            if control?.isCancelled == true {
+                throw ImagingError.cancelled
+            }
+            while control?.isPaused == true {
+                Thread.sleep(forTimeInterval: 0.05)
+                if control?.isCancelled == true {
+                    throw ImagingError.cancelled
+                }
+            }
+
+            let start = Double(step - 1) / Double(progressSteps)
+            let end = Double(step) / Double(progressSteps)
+            if let failurePoint = failurePoint, failurePoint < end {
+                readSeconds += try simulator.read(bsdName: bsdName, from: start, to: failurePoint)
+                throw ImagingError.readFailed(EIO)
+            }
+            readSeconds += try simulator.read(bsdName: bsdName, from: start, to: end)
+
+            let transferred = Int64(Double(totalSize) * end)
+            let speed = readSeconds > 0 ? Double(transferred) / readSeconds : nil
+            let eta = speed.map { Double(totalSize - transferred) / max($0, 1) }
+            progress(ImagingProgressInfo(
+                fractionCompleted: end,
+                bytesTransferred: transferred,
+                totalBytes: totalBytes,
+                speedBytesPerSecond: speed,
+                etaSeconds: eta
+            ))
+        }
+
+        let isoPath = outputPath.deletingPathExtension().appendingPathExtension("iso")
+        if writesPlaceholderFiles {
+            FileManager.default.createFile(atPath: isoPath.path, contents: "SIMULATED ISO".data(using: .utf8))
+        }
+        return isoPath
+    }
+
+    /// Spends the drive time a re-read would take (all of the disc, or the sampled
+    /// chunks) and always matches; the simulator has no bytes to compare.
+    func verifyImage(
+        bsdName: String,
+        imageURL: URL,
+        mode: ImageVerifyMode,
+        control: ImagingService.ImagingControl?,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> ImageVerificationResult {
+        guard simulator.findDiscBSDName() == bsdName, let totalSize = estimateDiscSizeBytes(bsdName: bsdName) else {
+            throw ImagingError.deviceNotFound(bsdName)
+        }
+        if control?.isCancelled == true {
+            throw ImagingError.cancelled
+        }
+        let bytes = mode == .full
+            ? totalSize
+            : min(Int64(ImageVerifier.chunkOffsets(imageSize: totalSize, mode: mode).count * ImageVerifier.chunkSize), totalSize)
+        let fraction = Double(bytes) / Double(max(totalSize, 1))
+        let readSeconds = try simulator.read(bsdName: bsdName, from: 0, to: fraction)
+        progress(ImagingProgressInfo(
+            fractionCompleted: 1,
+            bytesTransferred: bytes,
+            totalBytes: bytes,
+            speedBytesPerSecond: readSeconds > 0 ? Double(bytes) / readSeconds : nil,
+            etaSeconds: 0
+        ))
+        return ImageVerificationResult(mode: mode, bytesCompared: bytes, mismatchOffset: nil, imageSHA256: nil)
+    }
+}
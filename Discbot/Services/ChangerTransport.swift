@@ -0,0 +1,255 @@
+//
+//  ChangerTransport.swift
+//  Discbot
+//
+//  Command transport beneath ChangerService (mchanger library or a stand-in)
+//
+
+import Foundation
+
+/// SCSI sense key / additional sense code / qualifier from a CHECK CONDITION.
+struct SenseData: Equatable, Codable, CustomStringConvertible {
+    let senseKey: UInt8
+    let asc: UInt8
+    let ascq: UInt8
+
+    var isUnitAttention: Bool { senseKey == 0x06 }
+
+    var description: String {
+        String(format: "sense %02X/%02X/%02X", senseKey, asc, ascq)
+    }
+
+    /// 06/29/00 - power on, reset or bus device reset occurred
+    static let powerOnReset = SenseData(senseKey: 0x06, asc: 0x29, ascq: 0x00)
+    /// 06/28/00 - not ready to ready change (door closed, magazine changed)
+    static let mediumChanged = SenseData(senseKey: 0x06, asc: 0x28, ascq: 0x00)
+    /// 04/15/01 - mechanical positioning error
+    static let positioningError = SenseData(senseKey: 0x04, asc: 0x15, ascq: 0x01)
+    /// 02/04/01 - logical unit is in process of becoming ready
+    static let becomingReady = SenseData(senseKey: 0x02, asc: 0x04, ascq: 0x01)
+}
+
+/// Raw outcome of a transport command, before ChangerService maps it to a ChangerError.
+enum ChangerTransportError: Error, Equatable {
+    case notOpen
+    case empty
+    case busy
+    case timeout
+    case checkCondition(SenseData)
+    case failed(String)
+}
+
+/// Element addresses reported by the changer.
+struct ChangerElementLayout: Equatable, Codable {
+    let slotAddresses: [UInt16]
+    let driveAddresses: [UInt16]
+    let ieAddresses: [UInt16]
+    let transportAddresses: [UInt16]
+}
+
+/// One element from READ ELEMENT STATUS.
+struct ChangerElementState: Equatable, Codable {
+    let address: UInt16
+    let isFull: Bool
+    let hasException: Bool
+    let sourceAddress: UInt16?
+}
+
+struct ChangerElementStatusReport: Equatable, Codable {
+    /// In layout order; may be shorter than the layout when the changer returns partial data.
+    let slots: [ChangerElementState]
+    /// Nil when the changer does not report drive element status.
+    let drive: ChangerElementState?
+}
+
+/// Commands ChangerService issues to the changer. Implementations report failures by
+/// throwing `ChangerTransportError`; calls are serialized by ChangerService.
+protocol ChangerTransport: AnyObject {
+    func open() throws
+    func close()
+    func inquiry() throws -> ChangerService.ChangerDeviceInfo
+    func readElementMap() throws -> ChangerElementLayout
+    func readElementStatus() throws -> ChangerElementStatusReport
+    /// Move from a 1-based storage slot to the first drive.
+    func loadSlot(_ slotNumber: Int) throws
+    /// Move from the first drive to a 1-based storage slot.
+    func unloadDrive(toSlot slotNumber: Int) throws
+    /// Move from a 1-based storage slot to the I/E slot.
+    func exportSlot(_ slotNumber: Int) throws
+    func moveMedium(transport: UInt16, source: UInt16, destination: UInt16) throws
+}
+
+// MARK: - mchanger
+
+#if !DISCBOT_NO_HARDWARE
+/// Transport backed by the mchanger library.
+final class MChangerTransport: ChangerTransport {
+    private var handle: OpaquePointer?
+    private var elementMap: MChangerElementMap?
+
+    private static let statusCodes = (ok: MCHANGER_OK, empty: MCHANGER_ERR_EMPTY, busy: MCHANGER_ERR_BUSY)
+
+    deinit {
+        close()
+    }
+
+    private func check<Code: Equatable>(_ code: Code, in codes: (ok: Code, empty: Code, busy: Code)) throws {
+        switch code {
+        case codes.ok:
+            return
+        case codes.empty:
+            throw ChangerTransportError.empty
+        case codes.busy:
+            throw ChangerTransportError.busy
+        default:
+            throw ChangerTransportError.failed("\(code)")
+        }
+    }
+
+    private func openHandle() throws -> OpaquePointer {
+        guard let h = handle else {
+            throw ChangerTransportError.notOpen
+        }
+        return h
+    }
+
+    func open() throws {
+        if handle != nil {
+            return
+        }
+        guard let h = mchanger_open(nil) else {
+            throw ChangerTransportError.failed("mchanger_open")
+        }
+        handle = h
+    }
+
+    func close() {
+        if let h = handle {
+            mchanger_close(h)
+            handle = nil
+        }
+
+        if var map = elementMap {
+            mchanger_free_element_map(&map)
+            elementMap = nil
+        }
+    }
+
+    func inquiry() throws -> ChangerService.ChangerDeviceInfo {
+        let h = try openHandle()
+
+        var vendor = [CChar](repeating: 0, count: 64)
+        var product = [CChar](repeating: 0, count: 64)
+        var revision = [CChar](repeating: 0, count: 64)
+
+        try check(mchanger_inquiry(h, &vendor, 64, &product, 64, &revision, 64), in: Self.statusCodes)
+
+        return ChangerService.ChangerDeviceInfo(
+            vendor: String(cString: vendor).trimmingCharacters(in: .whitespaces),
+            product: String(cString: product).trimmingCharacters(in: .whitespaces),
+            revision: String(cString: revision).trimmingCharacters(in: .whitespaces)
+        )
+    }
+
+    func readElementMap() throws -> ChangerElementLayout {
+        let h = try openHandle()
+
+        // Free existing map if any
+        if var map = elementMap {
+            mchanger_free_element_map(&map)
+            elementMap = nil
+        }
+
+        var map = MChangerElementMap()
+        try check(mchanger_get_element_map(h, &map), in: Self.statusCodes)
+        elementMap = map
+
+        var slotAddresses: [UInt16] = []
+        if let addrs = map.slot_addrs {
+            slotAddresses = (0..<Int(map.slot_count)).map { addrs[$0] }
+        }
+        var driveAddresses: [UInt16] = []
+        if let addrs = map.drive_addrs {
+            driveAddresses = (0..<Int(map.drive_count)).map { addrs[$0] }
+        }
+        var ieAddresses: [UInt16] = []
+        if let addrs = map.ie_addrs {
+            ieAddresses = (0..<Int(map.ie_count)).map { addrs[$0] }
+        }
+        var transportAddresses: [UInt16] = []
+        if let addrs = map.transport_addrs {
+            transportAddresses = (0..<Int(map.transport_count)).map { addrs[$0] }
+        }
+
+        return ChangerElementLayout(
+            slotAddresses: slotAddresses,
+            driveAddresses: driveAddresses,
+            ieAddresses: ieAddresses,
+            transportAddresses: transportAddresses
+        )
+    }
+
+    func readElementStatus() throws -> ChangerElementStatusReport {
+        let h = try openHandle()
+        guard let map = elementMap, let slotAddrs = map.slot_addrs else {
+            throw ChangerTransportError.failed("No element map")
+        }
+
+        var slotStatuses: [MChangerElementStatus] = Array(
+            repeating: MChangerElementStatus(),
+            count: Int(map.slot_count)
+        )
+
+        let driveAddr: UInt16 = {
+            guard map.drive_count > 0, let driveAddrs = map.drive_addrs else { return 0 }
+            return driveAddrs[0]
+        }()
+
+        var driveStatus = MChangerElementStatus()
+        var driveSupported = false
+
+        try check(mchanger_get_bulk_status(
+            h,
+            slotAddrs,
+            map.slot_count,
+            driveAddr,
+            &driveStatus,
+            &slotStatuses,
+            &driveSupported
+        ), in: Self.statusCodes)
+
+        let slots = slotStatuses.map {
+            ChangerElementState(
+                address: $0.address,
+                isFull: $0.full,
+                hasException: $0.except,
+                sourceAddress: $0.valid_source ? $0.source_addr : nil
+            )
+        }
+        let drive = driveSupported ? ChangerElementState(
+            address: driveAddr,
+            isFull: driveStatus.full,
+            hasException: driveStatus.except,
+            sourceAddress: driveStatus.valid_source ? driveStatus.source_addr : nil
+        ) : nil
+
+        return ChangerElementStatusReport(slots: slots, drive: drive)
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        try check(mchanger_load_slot(try openHandle(), Int32(slotNumber), 1), in: Self.statusCodes)
+    }
+
+    func unloadDrive(toSlot slotNumber: Int) throws {
+        try check(mchanger_unload_drive(try openHandle(), Int32(slotNumber), 1), in: Self.statusCodes)
+    }
+
+    func exportSlot(_ slotNumber: Int) throws {
+        try check(mchanger_eject(try openHandle(), Int32(slotNumber), 1), in: Self.statusCodes)
+    }
+
+    func moveMedium(transport: UInt16, source: UInt16, destination: UInt16) throws {
+        try check(mchanger_move_medium(try openHandle(), transport, source, destination), in: Self.statusCodes)
+    }
+}
+#endif
@@ -0,0 +1,257 @@
+//
+//  ControlSocket.swift
+//  Discbot
+//
+//  Unix-domain socket carrying newline-delimited JSON between the daemon and its clients
+//
+
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#else
+import Glibc
+#endif
+
+enum ControlSocketError: LocalizedError {
+    case pathTooLong(String)
+    case alreadyRunning(String)
+    case systemCall(String, Int32)
+    case closed
+
+    var errorDescription: String? {
+        switch self {
+        case .pathTooLong(let path):
+            return "Socket path is too long: \(path)"
+        case .alreadyRunning(let path):
+            return "Another daemon is already running on \(path)"
+        case .systemCall(let call, let code):
+            return "\(call) failed: \(String(cString: strerror(code)))"
+        case .closed:
+            return "Control socket closed"
+        }
+    }
+}
+
+/// One end of a control connection: writes whole lines, reads whole lines.
+final class ControlChannel {
+    let fd: Int32
+    private let writeLock = NSLock()
+    private var readBuffer = Data()
+    private var closed = false
+
+    init(fd: Int32) {
+        self.fd = fd
+    }
+
+    deinit {
+        close()
+    }
+
+    /// Connect to a listening control socket
+    static func connect(path: String) throws -> ControlChannel {
+        let fd = socket(AF_UNIX, ControlSocketAddress.streamType, 0)
+        guard fd >= 0 else { throw ControlSocketError.systemCall("socket", errno) }
+        var address = try ControlSocketAddress.make(path: path)
+        let result = withUnsafePointer(to: &address) {
+            $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                connectSocket(fd, $0, socklen_t(MemoryLayout<sockaddr_un>.size))
+            }
+        }
+        guard result == 0 else {
+            let code = errno
+            closeDescriptor(fd)
+            throw ControlSocketError.systemCall("connect", code)
+        }
+        return ControlChannel(fd: fd)
+    }
+
+    /// Write `line` plus a newline; false once the peer has gone away
+    @discardableResult
+    func send(_ line: Data) -> Bool {
+        writeLock.lock()
+        defer { writeLock.unlock() }
+        guard !closed else { return false }
+
+        var data = line
+        data.append(0x0A)
+        return data.withUnsafeBytes { raw -> Bool in
+            guard let base = raw.baseAddress else { return true }
+            var offset = 0
+            while offset < raw.count {
+                let written = write(fd, base + offset, raw.count - offset)
+                if written < 0 {
+                    if errno == EINTR { continue }
+                    return false
+                }
+                offset += written
+            }
+            return true
+        }
+    }
+
+    @discardableResult
+    func send<T: Encodable>(_ message: T) -> Bool {
+        guard let data = try? JSONEncoder.control.encode(message) else { return false }
+        return send(data)
+    }
+
+    /// Block until a full line arrives; nil at end of stream
+    func readLine() -> Data? {
+        while true {
+            if let newline = readBuffer.firstIndex(of: 0x0A) {
+                let line = readBuffer[readBuffer.startIndex..<newline]
+                readBuffer.removeSubrange(readBuffer.startIndex...newline)
+                return Data(line)
+            }
+
+            var chunk = [UInt8](repeating: 0, count: 4096)
+            let count = read(fd, &chunk, chunk.count)
+            if count < 0 && errno == EINTR { continue }
+            guard count > 0 else { return nil }
+            readBuffer.append(contentsOf: chunk[0..<count])
+        }
+    }
+
+    func close() {
+        writeLock.lock()
+        defer { writeLock.unlock() }
+        guard !closed else { return }
+        closed = true
+        shutdown(fd, Int32(SHUT_RDWR))
+        closeDescriptor(fd)
+    }
+}
+
+/// Listens on a Unix-domain socket and hands every request line to `onLine`.
+///
+/// Each client gets a reader thread; `onLine` and `onDisconnect` are called on
+/// `handlerQueue` (the main queue by default), so the owner needs no locking of its own.
+/// The socket file is created 0600: only the daemon's user can drive the changer.
+/// A socket another daemon is still listening on is left alone, and `start` fails.
+final class ControlServer {
+    let path: String
+    var onLine: ((Data, ControlChannel) -> Void)?
+    var onDisconnect: ((ControlChannel) -> Void)?
+
+    private let handlerQueue: DispatchQueue
+    private var listenFD: Int32 = -1
+
+    init(path: String, handlerQueue: DispatchQueue = .main) {
+        self.path = path
+        self.handlerQueue = handlerQueue
+    }
+
+    func start() throws {
+        try removeStaleSocket()
+        let fd = socket(AF_UNIX, ControlSocketAddress.streamType, 0)
+        guard fd >= 0 else { throw ControlSocketError.systemCall("socket", errno) }
+
+        var address = try ControlSocketAddress.make(path: path)
+        // bind creates the socket file; the mask keeps it private from the start
+        let previousMask = umask(0o077)
+        let bound = withUnsafePointer(to: &address) {
+            $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                bind(fd, $0, socklen_t(MemoryLayout<sockaddr_un>.size))
+            }
+        }
+        umask(previousMask)
+        guard bound == 0 else {
+            let code = errno
+            closeDescriptor(fd)
+            throw ControlSocketError.systemCall("bind", code)
+        }
+        chmod(path, 0o600)
+        guard listen(fd, 8) == 0 else {
+            let code = errno
+            closeDescriptor(fd)
+            throw ControlSocketError.systemCall("listen", code)
+        }
+
+        listenFD = fd
+        let thread = Thread { [weak self] in self?.acceptLoop(fd) }
+        thread.name = "discbot.control.accept"
+        thread.start()
+    }
+
+    /// Unlink a socket file left by a daemon that died, so bind can succeed. A socket that
+    /// still accepts connections belongs to a running daemon, which must keep it.
+    private func removeStaleSocket() throws {
+        let existing: ControlChannel
+        do {
+            existing = try ControlChannel.connect(path: path)
+        } catch ControlSocketError.systemCall(_, let code) where code == ECONNREFUSED || code == ENOENT {
+            unlink(path)
+            return
+        }
+        existing.close()
+        throw ControlSocketError.alreadyRunning(path)
+    }
+
+    func stop() {
+        guard listenFD >= 0 else { return }
+        shutdown(listenFD, Int32(SHUT_RDWR))
+        closeDescriptor(listenFD)
+        listenFD = -1
+        unlink(path)
+    }
+
+    private func acceptLoop(_ fd: Int32) {
+        while true {
+            let clientFD = accept(fd, nil, nil)
+            if clientFD < 0 {
+                if errno == EINTR { continue }
+                return // listening socket closed by stop()
+            }
+            let channel = ControlChannel(fd: clientFD)
+            let thread = Thread { [weak self] in self?.readLoop(channel) }
+            thread.name = "discbot.control.client"
+            thread.start()
+        }
+    }
+
+    private func readLoop(_ channel: ControlChannel) {
+        while let line = channel.readLine() {
+            guard !line.isEmpty else { continue }
+            handlerQueue.async { [weak self] in
+                self?.onLine?(line, channel)
+            }
+        }
+        handlerQueue.async { [weak self] in
+            channel.close()
+            self?.onDisconnect?(channel)
+        }
+    }
+}
+
+// The channel's own connect/close methods shadow the system calls inside the class
+private func connectSocket(_ fd: Int32, _ address: UnsafePointer<sockaddr>, _ length: socklen_t) -> Int32 {
+    connect(fd, address, length)
+}
+
+private func closeDescriptor(_ fd: Int32) {
+    _ = close(fd)
+}
+
+private enum ControlSocketAddress {
+    #if canImport(Darwin)
+    static let streamType = SOCK_STREAM
+    #else
+    static let streamType = Int32(SOCK_STREAM.rawValue)
+    #endif
+
+    static func make(path: String) throws -> sockaddr_un {
+        var address = sockaddr_un()
+        address.sun_family = sa_family_t(AF_UNIX)
+        let bytes = Array(path.utf8)
+        let capacity = MemoryLayout.size(ofValue: address.sun_path)
+        guard bytes.count < capacity else { throw ControlSocketError.pathTooLong(path) }
+        withUnsafeMutableBytes(of: &address.sun_path) { raw in
+            raw.copyBytes(from: bytes)
+            raw[bytes.count] = 0
+        }
+        #if canImport(Darwin)
+        address.sun_len = UInt8(MemoryLayout<sockaddr_un>.size)
+        #endif
+        return address
+    }
+}
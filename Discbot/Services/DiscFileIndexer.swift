@@ -0,0 +1,70 @@
+//
+//  DiscFileIndexer.swift
+//  Discbot
+//
+//  Lists the files of a finished image from its directory tree
+//
+
+import Foundation
+#if canImport(os)
+import os.log
+#endif
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+
+/// Reads the ISO 9660 / Joliet / UDF directory tree of an image file, without mounting it.
+///
+/// Only the volume descriptors and directory sectors are read, from the image that has just
+/// been written to local disk, so indexing costs no second read of the disc.
+enum DiscFileIndexer {
+    private static let log = OSLog(
+        subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
+        category: "DiscFileIndexer"
+    )
+
+    /// Every regular file in the image at `imageURL` (blocking); nil when the image has no
+    /// directory tree that could be read
+    static func index(imageURL: URL) -> [DiscFileRecord]? {
+        let collector = Collector()
+        let context = UnsafeMutableRawPointer(Unmanaged.passUnretained(collector).toOpaque())
+        let startTime = Date()
+        let filesystem = withExtendedLifetime(collector) {
+            isotree_walk_path(imageURL.path, discFileIndexerVisit, context)
+        }
+        guard filesystem != 0 else {
+            os_log("No directory tree in %{public}@", log: log, type: .info, imageURL.lastPathComponent)
+            return nil
+        }
+
+        os_log(
+            "Indexed %{public}ld files from %{public}@ (%{public}@) in %.2fs",
+            log: log,
+            type: .info,
+            collector.files.count,
+            imageURL.lastPathComponent,
+            VolumeInfo.Filesystems(rawValue: filesystem).contains(.udf) ? "UDF" : "ISO 9660",
+            Date().timeIntervalSince(startTime)
+        )
+        return collector.files
+    }
+
+    fileprivate final class Collector {
+        var files: [DiscFileRecord] = []
+    }
+}
+
+private func discFileIndexerVisit(_ context: UnsafeMutableRawPointer?, _ file: UnsafePointer<isotree_file_t>?) -> Int32 {
+    guard let context = context, let file = file?.pointee, let path = file.path else { return 1 }
+    let collector = Unmanaged<DiscFileIndexer.Collector>.fromOpaque(context).takeUnretainedValue()
+    let extents = UnsafeBufferPointer(start: file.extents, count: Int(file.extent_count)).map {
+        DiscFileRecord.Extent(offset: Int64($0.offset), length: Int64($0.length))
+    }
+    collector.files.append(DiscFileRecord(
+        path: String(cString: path),
+        sizeBytes: Int64(file.size),
+        modifiedAt: file.modified != 0 ? Date(timeIntervalSince1970: TimeInterval(file.modified)) : nil,
+        extents: extents
+    ))
+    return 0
+}
@@ -0,0 +1,229 @@
+//
+//  FaultInjectingTransport.swift
+//  Discbot
+//
+//  Changer transport decorator that injects timeouts, sense data and partial status
+//
+
+import Foundation
+
+/// Wraps another transport and makes some of its commands fail the way real
+/// changers do, either at random (seeded) or from a script of queued faults.
+///
+/// It also measures recovery: the time from each injected fault until the next
+/// successful slot load, i.e. until the batch engine is moving discs again.
+final class FaultInjectingTransport: ChangerTransport {
+    enum Command: String, Codable, CaseIterable {
+        case inquiry
+        case readElementMap
+        case readElementStatus
+        case loadSlot
+        case unloadDrive
+        case exportSlot
+        case moveMedium
+    }
+
+    enum Fault: Equatable {
+        /// The command never reaches the device and the host gives up.
+        case timeout
+        /// The device completes the command but the host times out waiting for status.
+        case lateTimeout
+        /// CHECK CONDITION with the given sense; the command is not executed.
+        case sense(SenseData)
+        /// READ ELEMENT STATUS returns only the first `n` slot elements (random when nil).
+        case partialStatus(Int?)
+    }
+
+    struct Configuration {
+        var timeoutRate: Double = 0
+        var lateTimeoutRate: Double = 0
+        var unitAttentionRate: Double = 0
+        var senseRate: Double = 0
+        var sense = SenseData.positioningError
+        /// Applies to READ ELEMENT STATUS only.
+        var partialStatusRate: Double = 0
+        /// Host-side command timeout charged for each timeout fault.
+        var timeoutSeconds: TimeInterval = 120
+        /// Time for the device to return a CHECK CONDITION.
+        var senseSeconds: TimeInterval = 1
+        var seed: UInt64 = 1
+    }
+
+    struct RecoveryStatistics {
+        var injectedFaults = 0
+        var recoveryLatencies: [TimeInterval] = []
+        /// Faults not followed by any successful load before the run ended.
+        var unrecoveredFaults = 0
+    }
+
+    private let base: ChangerTransport
+    private let configuration: Configuration
+    private let clock: () -> TimeInterval
+    private let sleep: (TimeInterval) -> Void
+
+    private let lock = NSLock()
+    private var rng: SeededRandomNumberGenerator
+    private var scripted: [Command: [Fault]] = [:]
+    private var pendingFaultTimes: [TimeInterval] = []
+    private var stats = RecoveryStatistics()
+
+    /// - Parameters:
+    ///   - clock: Source of "now" for recovery measurements (the simulator's virtual clock in benchmarks).
+    ///   - sleep: How to spend the time a timeout or check condition costs.
+    init(
+        base: ChangerTransport,
+        configuration: Configuration = Configuration(),
+        clock: @escaping () -> TimeInterval = { Date().timeIntervalSinceReferenceDate },
+        sleep: @escaping (TimeInterval) -> Void = { Thread.sleep(forTimeInterval: $0) }
+    ) {
+        self.base = base
+        self.configuration = configuration
+        self.clock = clock
+        self.sleep = sleep
+        self.rng = SeededRandomNumberGenerator(seed: configuration.seed)
+    }
+
+    /// Queue a fault for the next call of `command`, ahead of any random faults.
+    func schedule(_ fault: Fault, on command: Command) {
+        lock.lock()
+        defer { lock.unlock() }
+        scripted[command, default: []].append(fault)
+    }
+
+    func snapshotStatistics() -> RecoveryStatistics {
+        lock.lock()
+        defer { lock.unlock() }
+        var snapshot = stats
+        snapshot.unrecoveredFaults = pendingFaultTimes.count
+        return snapshot
+    }
+
+    // MARK: - Fault Selection
+
+    private func nextFault(for command: Command) -> Fault? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if var queue = scripted[command], !queue.isEmpty {
+            let fault = queue.removeFirst()
+            scripted[command] = queue
+            return fault
+        }
+
+        var candidates: [(rate: Double, fault: Fault)] = [
+            (configuration.timeoutRate, .timeout),
+            (configuration.lateTimeoutRate, .lateTimeout),
+            (configuration.unitAttentionRate, .sense(.powerOnReset)),
+            (configuration.senseRate, .sense(configuration.sense)),
+        ]
+        if command == .readElementStatus {
+            candidates.append((configuration.partialStatusRate, .partialStatus(nil)))
+        }
+
+        var roll = Double.random(in: 0..<1, using: &rng)
+        for candidate in candidates where candidate.rate > 0 {
+            if roll < candidate.rate {
+                return candidate.fault
+            }
+            roll -= candidate.rate
+        }
+        return nil
+    }
+
+    private func recordFault() {
+        let now = clock()
+        lock.lock()
+        stats.injectedFaults += 1
+        pendingFaultTimes.append(now)
+        lock.unlock()
+    }
+
+    private func recordLoadSucceeded() {
+        let now = clock()
+        lock.lock()
+        for faultTime in pendingFaultTimes {
+            stats.recoveryLatencies.append(now - faultTime)
+        }
+        pendingFaultTimes.removeAll()
+        lock.unlock()
+    }
+
+    private func perform<T>(_ command: Command, fault: Fault?, _ body: () throws -> T) throws -> T {
+        switch fault {
+        case nil, .partialStatus?:
+            let value = try body()
+            if command == .loadSlot {
+                recordLoadSucceeded()
+            }
+            return value
+        case .timeout?:
+            recordFault()
+            sleep(configuration.timeoutSeconds)
+            throw ChangerTransportError.timeout
+        case .lateTimeout?:
+            _ = try? body()
+            recordFault()
+            sleep(configuration.timeoutSeconds)
+            throw ChangerTransportError.timeout
+        case .sense(let sense)?:
+            recordFault()
+            sleep(configuration.senseSeconds)
+            throw ChangerTransportError.checkCondition(sense)
+        }
+    }
+
+    // MARK: - ChangerTransport
+
+    func open() throws {
+        try base.open()
+    }
+
+    func close() {
+        base.close()
+    }
+
+    func inquiry() throws -> ChangerService.ChangerDeviceInfo {
+        try perform(.inquiry, fault: nextFault(for: .inquiry)) { try base.inquiry() }
+    }
+
+    func readElementMap() throws -> ChangerElementLayout {
+        try perform(.readElementMap, fault: nextFault(for: .readElementMap)) { try base.readElementMap() }
+    }
+
+    func readElementStatus() throws -> ChangerElementStatusReport {
+        let fault = nextFault(for: .readElementStatus)
+        let report = try perform(.readElementStatus, fault: fault) { try base.readElementStatus() }
+        guard case .partialStatus(let requested)? = fault, !report.slots.isEmpty else {
+            return report
+        }
+
+        recordFault()
+        let kept: Int
+        if let requested = requested {
+            kept = min(max(requested, 0), report.slots.count - 1)
+        } else {
+            lock.lock()
+            kept = Int.random(in: 0..<report.slots.count, using: &rng)
+            lock.unlock()
+        }
+        return ChangerElementStatusReport(slots: Array(report.slots.prefix(kept)), drive: report.drive)
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        try perform(.loadSlot, fault: nextFault(for: .loadSlot)) { try base.loadSlot(slotNumber) }
+    }
+
+    func unloadDrive(toSlot slotNumber: Int) throws {
+        try perform(.unloadDrive, fault: nextFault(for: .unloadDrive)) { try base.unloadDrive(toSlot: slotNumber) }
+    }
+
+    func exportSlot(_ slotNumber: Int) throws {
+        try perform(.exportSlot, fault: nextFault(for: .exportSlot)) { try base.exportSlot(slotNumber) }
+    }
+
+    func moveMedium(transport: UInt16, source: UInt16, destination: UInt16) throws {
+        try perform(.moveMedium, fault: nextFault(for: .moveMedium)) {
+            try base.moveMedium(transport: transport, source: source, destination: destination)
+        }
+    }
+}
@@ -0,0 +1,382 @@
+//
+//  ImageFanOut.swift
+//  Discbot
+//
+//  Writes one stream of disc sectors to the output folder and any number of mirrors at once
+//
+
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#else
+import Glibc
+#endif
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+#if canImport(os)
+import os.log
+#endif
+
+/// Fans the chunks read from the drive out to several destinations.
+///
+/// Every destination has its own writer thread and a queue of at most `queueDepth`
+/// chunks. The primary (the output folder) paces the reader: when its queue is full,
+/// `write` waits. A mirror is never waited for. When its queue fills up it stops taking
+/// chunks and finishes the ones it holds. Once the primary file is complete, the
+/// background catch-up queue copies the rest from it. A slow NAS costs the drive nothing,
+/// and a failed mirror never fails the disc.
+///
+/// Each file goes through the native `imagewriter`: the expected size is reserved up
+/// front, the page cache is bypassed and the file is synced per `ImageWriteOptions`
+/// before it is renamed from `.part` into place.
+final class ImageFanOut {
+    /// 512 sectors of 2048 bytes
+    static let chunkSize = 1 << 20
+    fileprivate static let queueDepth = 16
+    /// Lagging mirrors finish here, one at a time, after the disc has been ejected
+    fileprivate static let catchUpQueue = DispatchQueue(label: "discbot.imaging.catchup", qos: .utility)
+    fileprivate static let log = OSLog(
+        subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
+        category: "ImageFanOut"
+    )
+
+    let primaryURL: URL
+    private let primary: FanOutWriter
+    private let mirrors: [FanOutWriter]
+
+    /// `expectedSize` (from the TOC or the size estimate) is preallocated in every destination.
+    init(
+        primaryURL: URL,
+        mirrors destinations: [ImageDestination],
+        expectedSize: Int64? = nil,
+        options: ImageWriteOptions = .standard
+    ) throws {
+        self.primaryURL = primaryURL
+        primary = try FanOutWriter(url: primaryURL, kind: .directory, expectedSize: expectedSize, options: options)
+        mirrors = destinations.compactMap {
+            Self.openMirror($0, fileName: primaryURL.lastPathComponent, expectedSize: expectedSize, options: options)
+        }
+    }
+
+    /// Hand one chunk to every destination; throws if the primary cannot be written.
+    func write(_ chunk: Data) throws {
+        try primary.enqueue(chunk)
+        for mirror in mirrors {
+            mirror.offer(chunk)
+        }
+    }
+
+    /// Wait for the primary to reach the disk and move it into place, then let the
+    /// mirrors finish in the background. Returns the primary's URL.
+    func finish() throws -> URL {
+        try primary.close()
+        try primary.commit()
+        // Opened now: the next disc with the same label renames its image onto this path
+        let source = mirrors.contains(where: \.isBehind) ? CatchUpSource(url: primaryURL) : nil
+        for mirror in mirrors {
+            Self.catchUpQueue.async {
+                mirror.finish(catchingUpFrom: source)
+            }
+        }
+        return primaryURL
+    }
+
+    /// Stop every writer and remove the partial files.
+    func abort() {
+        primary.abort()
+        for mirror in mirrors {
+            mirror.abort()
+        }
+    }
+
+    /// Copy an image that was written some other way (hdiutil) to `destinations`,
+    /// entirely on the catch-up queue.
+    static func mirror(_ imageURL: URL, to destinations: [ImageDestination], options: ImageWriteOptions = .standard) {
+        guard !destinations.isEmpty else { return }
+        let size = (try? FileManager.default.attributesOfItem(atPath: imageURL.path)[.size] as? NSNumber)?.int64Value
+        for destination in destinations {
+            guard let mirror = openMirror(destination, fileName: imageURL.lastPathComponent, expectedSize: size, options: options) else {
+                continue
+            }
+            mirror.markLagging()
+            let source = CatchUpSource(url: imageURL)
+            catchUpQueue.async {
+                mirror.finish(catchingUpFrom: source)
+            }
+        }
+    }
+
+    /// A mirror whose folder is missing (say, an unmounted share) is skipped rather than
+    /// created, so images never land on the boot volume under /Volumes by mistake.
+    private static func openMirror(
+        _ destination: ImageDestination,
+        fileName: String,
+        expectedSize: Int64?,
+        options: ImageWriteOptions
+    ) -> FanOutWriter? {
+        var isDirectory: ObjCBool = false
+        guard FileManager.default.fileExists(atPath: destination.url.path, isDirectory: &isDirectory), isDirectory.boolValue else {
+            os_log("Skipping mirror %{public}@: folder not found", log: log, type: .error, destination.displayName)
+            return nil
+        }
+        do {
+            return try FanOutWriter(
+                url: destination.imageURL(fileName: fileName),
+                kind: destination.kind,
+                expectedSize: expectedSize,
+                options: options
+            )
+        } catch {
+            os_log(
+                "Skipping mirror %{public}@: %{public}@",
+                log: log,
+                type: .error,
+                destination.displayName,
+                error.localizedDescription
+            )
+            return nil
+        }
+    }
+}
+
+/// A finished image held open for the mirrors catching up from it, so they copy this
+/// image even if another is renamed onto its path meanwhile. Closed with the last mirror.
+private final class CatchUpSource {
+    let descriptor: Int32
+
+    init?(url: URL) {
+        let fd = open(url.path, O_RDONLY)
+        guard fd >= 0 else {
+            os_log("Cannot open %{public}@ to catch mirrors up", log: ImageFanOut.log, type: .error, url.path)
+            return nil
+        }
+        descriptor = fd
+    }
+
+    deinit {
+        _ = close(descriptor)
+    }
+}
+
+/// One destination: an `imagewriter` on a `.part` file, a bounded chunk queue and the
+/// thread draining it.
+private final class FanOutWriter {
+    let url: URL
+    private let kind: ImageDestination.Kind
+    private var file: OpaquePointer?
+
+    private let condition = NSCondition()
+    private var pending: [Data] = []
+    private var isClosing = false
+    private var isDrained = false
+    private var isLagging = false
+    private var failure: Error?
+
+    /// Touched only by the writer thread, then by whoever finishes the file after `close`
+    private var writtenBytes: Int64 = 0
+    private var digest = sha256_t()
+
+    init(url: URL, kind: ImageDestination.Kind, expectedSize: Int64?, options: ImageWriteOptions) throws {
+        self.url = url
+        self.kind = kind
+
+        var nativeOptions = imagewriter_options_t()
+        imagewriter_default_options(&nativeOptions)
+        nativeOptions.expected_size = UInt64(max(expectedSize ?? 0, 0))
+        nativeOptions.buffer_size = ImageFanOut.chunkSize
+        nativeOptions.bypass_cache = options.bypassCache
+        switch options.durability {
+        case .none: nativeOptions.sync = IMAGEWRITER_SYNC_NONE
+        case .atEnd: nativeOptions.sync = IMAGEWRITER_SYNC_AT_END
+        case .perChunk: nativeOptions.sync = IMAGEWRITER_SYNC_PER_CHUNK
+        }
+        file = imagewriter_open(url.path, &nativeOptions)
+        guard file != nil else { throw ImagingError.writeFailed(url) }
+        sha256_init(&digest)
+
+        // The thread holds the writer until the queue is drained and closed
+        let thread = Thread { self.drain() }
+        thread.name = "discbot.imaging.writer"
+        thread.qualityOfService = .userInitiated
+        thread.start()
+    }
+
+    /// Queue a chunk, waiting for room (primary only)
+    func enqueue(_ chunk: Data) throws {
+        condition.lock()
+        defer { condition.unlock() }
+        while pending.count >= ImageFanOut.queueDepth && failure == nil {
+            condition.wait()
+        }
+        if let failure = failure {
+            throw failure
+        }
+        pending.append(chunk)
+        condition.broadcast()
+    }
+
+    /// Queue a chunk if there is room; otherwise fall behind for good (mirrors)
+    func offer(_ chunk: Data) {
+        condition.lock()
+        defer { condition.unlock() }
+        guard !isLagging, failure == nil else { return }
+        guard pending.count < ImageFanOut.queueDepth else {
+            isLagging = true
+            os_log("%{public}@ fell behind; it will catch up after the disc", log: ImageFanOut.log, type: .info, url.path)
+            return
+        }
+        pending.append(chunk)
+        condition.broadcast()
+    }
+
+    func markLagging() {
+        condition.lock()
+        isLagging = true
+        condition.unlock()
+    }
+
+    /// Has skipped chunks that must be copied from the finished primary
+    var isBehind: Bool {
+        condition.lock()
+        defer { condition.unlock() }
+        return isLagging
+    }
+
+    /// Wait until every queued chunk is written and the thread has exited
+    func close() throws {
+        condition.lock()
+        defer { condition.unlock() }
+        isClosing = true
+        condition.broadcast()
+        while !isDrained {
+            condition.wait()
+        }
+        if let failure = failure {
+            throw failure
+        }
+    }
+
+    /// Sync the finished file and move it into place (replacing an older image of the same name)
+    func commit() throws {
+        guard let file = file, imagewriter_commit(file) == 0 else {
+            throw ImagingError.writeFailed(url)
+        }
+        closeFile()
+        if kind == .objectStore {
+            writeMetadata()
+        }
+    }
+
+    func abort() {
+        condition.lock()
+        isClosing = true
+        pending.removeAll()
+        condition.broadcast()
+        while !isDrained {
+            condition.wait()
+        }
+        condition.unlock()
+        closeFile()
+    }
+
+    /// Mirror only, on the catch-up queue: drain, copy whatever was skipped from the
+    /// finished primary, then commit. Failures are logged and the partial file removed.
+    func finish(catchingUpFrom source: CatchUpSource?) {
+        do {
+            try close()
+            if isBehind {
+                guard let source = source else { throw ImagingError.readFailed(ENOENT) }
+                try copyRemainder(from: source.descriptor)
+            }
+            try commit()
+        } catch {
+            os_log(
+                "Mirror %{public}@ failed: %{public}@",
+                log: ImageFanOut.log,
+                type: .error,
+                url.path,
+                error.localizedDescription
+            )
+            closeFile()
+        }
+    }
+
+    /// Releases the writer; an uncommitted `.part` file is removed with it
+    private func closeFile() {
+        guard let file = file else { return }
+        self.file = nil
+        imagewriter_close(file)
+    }
+
+    private func drain() {
+        while true {
+            condition.lock()
+            while pending.isEmpty && !isClosing {
+                condition.wait()
+            }
+            guard !pending.isEmpty else {
+                isDrained = true
+                condition.broadcast()
+                condition.unlock()
+                return
+            }
+            let chunk = pending.removeFirst()
+            condition.broadcast()
+            condition.unlock()
+
+            do {
+                try append(chunk)
+            } catch {
+                condition.lock()
+                failure = error
+                pending.removeAll()
+                condition.broadcast()
+                condition.unlock()
+            }
+        }
+    }
+
+    private func copyRemainder(from source: Int32) throws {
+        var buffer = [UInt8](repeating: 0, count: ImageFanOut.chunkSize)
+        while true {
+            let count = pread(source, &buffer, buffer.count, off_t(writtenBytes))
+            if count < 0 {
+                if errno == EINTR { continue }
+                throw ImagingError.readFailed(errno)
+            }
+            guard count > 0 else { return }
+            try append(Data(buffer[0..<count]))
+        }
+    }
+
+    private func append(_ chunk: Data) throws {
+        try chunk.withUnsafeBytes { raw in
+            guard let base = raw.baseAddress else { return }
+            guard let file = file, imagewriter_write(file, base, raw.count) == 0 else {
+                throw ImagingError.writeFailed(url)
+            }
+            if kind == .objectStore {
+                sha256_update(&digest, base, raw.count)
+            }
+        }
+        writtenBytes += Int64(chunk.count)
+    }
+
+    /// `<key>.metadata.json` beside the object, as an object store would report it
+    private func writeMetadata() {
+        var hash = [UInt8](repeating: 0, count: Int(SHA256_DIGEST_SIZE))
+        sha256_final(&digest, &hash)
+        let metadata: [String: Any] = [
+            "key": url.lastPathComponent,
+            "size": writtenBytes,
+            "sha256": hash.map { String(format: "%02x", $0) }.joined(),
+            "contentType": "application/x-iso9660-image",
+            "storedAt": CatalogTimestamp.string(from: Date()),
+        ]
+        let metadataURL = url.deletingLastPathComponent().appendingPathComponent(url.lastPathComponent + ".metadata.json")
+        if let data = try? JSONSerialization.data(withJSONObject: metadata, options: [.prettyPrinted, .sortedKeys]) {
+            try? data.write(to: metadataURL, options: .atomic)
+        }
+    }
+}
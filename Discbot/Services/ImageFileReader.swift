@@ -0,0 +1,132 @@
+//
+//  ImageFileReader.swift
+//  Discbot
+//
+//  Serves single files out of stored disc images
+//
+
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#else
+import Glibc
+#endif
+#if canImport(os)
+import os.log
+#endif
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+
+/// Reads one file back out of a disc's stored image, so getting it costs a few positional
+/// reads of the .iso instead of a changer move, a spin-up and a mount.
+///
+/// Files are found through the catalog's file index (`disc_files`), which records the byte
+/// ranges of the image holding each file when the disc is imaged. The disc never has to be
+/// in the drive, or in the changer at all.
+enum ImageFileReader {
+    static let bufferSize = 1 << 20
+    private static let log = OSLog(
+        subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
+        category: "ImageFileReader"
+    )
+
+    /// The indexed file at `path` on the disc cataloged in `slotId`, and the image that holds it
+    static func locate(slotId: Int, path: String, catalog: CatalogService) throws -> (file: DiscFileRecord, imageURL: URL) {
+        let relativePath = path.trimmingCharacters(in: CharacterSet(charactersIn: "/"))
+        guard let indexed = catalog.getIndexedFile(slotId: slotId, path: relativePath) else {
+            throw ImageFileError.notIndexed(slot: slotId, path: relativePath)
+        }
+        guard let image = indexed.backup, image.isCompleted else {
+            throw ImageFileError.noImage(slot: slotId)
+        }
+
+        let imageURL = URL(fileURLWithPath: image.backupPath)
+        guard let attributes = try? FileManager.default.attributesOfItem(atPath: imageURL.path) else {
+            throw ImageFileError.imageMissing(imageURL.path)
+        }
+        // A later disc with the same label writes to the same path
+        if let recorded = image.backupSizeBytes, (attributes[.size] as? Int64) != recorded {
+            throw ImageFileError.imageChanged(imageURL.path)
+        }
+        return (indexed.file, imageURL)
+    }
+
+    /// Pass the file's bytes to `body` in order, up to `bufferSize` at a time (blocking)
+    static func read(_ file: DiscFileRecord, from imageURL: URL, _ body: (UnsafeRawBufferPointer) throws -> Void) throws {
+        let fd = open(imageURL.path, O_RDONLY)
+        guard fd >= 0 else { throw ImageFileError.readFailed(errno) }
+        defer { _ = close(fd) }
+
+        var info = stat()
+        guard fstat(fd, &info) == 0 else { throw ImageFileError.readFailed(errno) }
+        let imageSize = Int64(info.st_size)
+        guard file.extents.allSatisfy({ $0.offset >= 0 && $0.offset + $0.length <= imageSize }) else {
+            throw ImageFileError.imageChanged(imageURL.path)
+        }
+
+        var buffer = [UInt8](repeating: 0, count: bufferSize)
+        var remaining = file.sizeBytes
+        for extent in file.extents where remaining > 0 {
+            var position = extent.offset
+            let end = extent.offset + min(extent.length, remaining)
+            while position < end {
+                let wanted = Int(min(Int64(bufferSize), end - position))
+                let count = buffer.withUnsafeMutableBytes { raw in
+                    pread(fd, raw.baseAddress!, wanted, off_t(position))
+                }
+                if count < 0 && errno == EINTR { continue }
+                guard count > 0 else {
+                    throw ImageFileError.readFailed(count < 0 ? errno : EIO)
+                }
+                try buffer.withUnsafeBytes { raw in
+                    try body(UnsafeRawBufferPointer(rebasing: raw[0..<count]))
+                }
+                position += Int64(count)
+                remaining -= Int64(count)
+            }
+        }
+        guard remaining == 0 else {
+            // The extents cover less than the recorded size
+            throw ImageFileError.imageChanged(imageURL.path)
+        }
+    }
+
+    /// Copy the file to `destination` with its recorded modification time (blocking). The copy
+    /// is written beside it and renamed into place once complete, replacing any older file.
+    static func copy(_ file: DiscFileRecord, from imageURL: URL, to destination: URL) throws {
+        let startTime = Date()
+        var options = imagewriter_options_t()
+        imagewriter_default_options(&options)
+        options.expected_size = UInt64(file.sizeBytes)
+        // A file someone asked for is likely to be opened next
+        options.bypass_cache = false
+
+        guard let writer = imagewriter_open(destination.path, &options) else {
+            throw ImageFileError.writeFailed(destination, errno)
+        }
+        defer { imagewriter_close(writer) }
+
+        try read(file, from: imageURL) { chunk in
+            guard imagewriter_write(writer, chunk.baseAddress, chunk.count) == 0 else {
+                throw ImageFileError.writeFailed(destination, errno)
+            }
+        }
+        guard imagewriter_commit(writer) == 0 else {
+            throw ImageFileError.writeFailed(destination, errno)
+        }
+        if let modified = file.modifiedAt {
+            try? FileManager.default.setAttributes([.modificationDate: modified], ofItemAtPath: destination.path)
+        }
+
+        os_log(
+            "Copied %{public}@ (%{public}lld bytes) out of %{public}@ in %.3fs",
+            log: log,
+            type: .info,
+            file.path,
+            file.sizeBytes,
+            imageURL.lastPathComponent,
+            Date().timeIntervalSince(startTime)
+        )
+    }
+}
@@ -0,0 +1,322 @@
+//
+//  ImageVerifier.swift
+//  Discbot
+//
+//  Compares a written image against the disc still in the drive
+//
+
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#else
+import Glibc
+#endif
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
+#if canImport(os)
+import os.log
+#endif
+
+/// Re-reads the disc (all of it, or a sample of chunks) and compares it with the image
+/// file chunk by chunk.
+///
+/// The work is split into two pipelined stages so verification costs little more drive
+/// time than the re-read itself. A reader thread hashes the image file ahead of the drive
+/// into a small queue of per-chunk SHA-256 digests. The calling thread reads the same
+/// chunks from the raw device, hashes them and compares each one with the file's digest.
+/// Both sides bypass the page cache, so the file is checked as it is on disk, not as it
+/// was handed to the kernel.
+final class ImageVerifier {
+    static let chunkSize = ImageFanOut.chunkSize
+    /// Chunks compared in sampled mode, including the first (volume descriptors) and the last
+    static let sampleCount = 64
+    fileprivate static let queueDepth = 8
+    private static let log = OSLog(
+        subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
+        category: "ImageVerifier"
+    )
+
+    /// Compare `imageURL` with `/dev/r<bsdName>` (blocking)
+    static func verify(
+        bsdName: String,
+        imageURL: URL,
+        mode: ImageVerifyMode,
+        control: ImagingService.ImagingControl? = nil,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> ImageVerificationResult {
+        let file = open(imageURL.path, O_RDONLY)
+        guard file >= 0 else { throw ImagingError.readFailed(errno) }
+        defer { _ = close(file) }
+        #if canImport(Darwin)
+        _ = fcntl(file, F_NOCACHE, 1)
+        #endif
+
+        var info = stat()
+        guard fstat(file, &info) == 0 else { throw ImagingError.readFailed(errno) }
+        let imageSize = Int64(info.st_size)
+
+        let device = open("/dev/r\(bsdName)", O_RDONLY)
+        guard device >= 0 else { throw ImagingError.deviceNotFound(bsdName) }
+        defer { _ = close(device) }
+
+        let offsets = chunkOffsets(imageSize: imageSize, mode: mode)
+        let totalBytes = offsets.reduce(Int64(0)) { $0 + chunkLength(at: $1, imageSize: imageSize) }
+        let digester = FileDigester(fd: file, offsets: offsets, imageSize: imageSize, hashesWholeImage: mode == .full)
+        defer { digester.stop() }
+
+        var buffer = [UInt8](repeating: 0, count: chunkSize)
+        var compared: Int64 = 0
+        let startTime = Date()
+        var lastReport = Date.distantPast
+
+        func report(_ fraction: Double) {
+            let elapsed = max(Date().timeIntervalSince(startTime), 0.001)
+            let speed = compared > 0 ? Double(compared) / elapsed : nil
+            progress(ImagingProgressInfo(
+                fractionCompleted: fraction,
+                bytesTransferred: compared,
+                totalBytes: totalBytes,
+                speedBytesPerSecond: speed,
+                etaSeconds: speed.map { max(Double(totalBytes - compared) / $0, 0) }
+            ))
+        }
+
+        func result(mismatchAt offset: Int64?) -> ImageVerificationResult {
+            if let offset = offset {
+                os_log(
+                    "%{public}@ differs from /dev/r%{public}@ at byte %{public}lld",
+                    log: log,
+                    type: .error,
+                    imageURL.lastPathComponent,
+                    bsdName,
+                    offset
+                )
+            }
+            return ImageVerificationResult(
+                mode: mode,
+                bytesCompared: compared,
+                mismatchOffset: offset,
+                imageSHA256: offset == nil ? digester.wholeImageDigest() : nil
+            )
+        }
+
+        for offset in offsets {
+            if control?.isCancelled == true {
+                throw ImagingError.cancelled
+            }
+            while control?.isPaused == true {
+                Thread.sleep(forTimeInterval: 0.1)
+                if control?.isCancelled == true {
+                    throw ImagingError.cancelled
+                }
+            }
+
+            let length = Int(chunkLength(at: offset, imageSize: imageSize))
+            let got = try readDevice(device, into: &buffer, length: length, at: offset)
+            guard got == length else {
+                // The disc ends before the image does
+                return result(mismatchAt: offset + Int64(got))
+            }
+            let discDigest = sha256(buffer, count: length)
+            guard let fileDigest = try digester.next() else {
+                throw ImagingError.readFailed(EIO)
+            }
+            guard discDigest == fileDigest else {
+                let differs = try firstDifference(file: file, disc: buffer, length: length, at: offset)
+                return result(mismatchAt: differs)
+            }
+
+            compared += Int64(length)
+            if Date().timeIntervalSince(lastReport) >= 0.25 {
+                lastReport = Date()
+                report(Double(compared) / Double(max(totalBytes, 1)))
+            }
+        }
+
+        report(1.0)
+        return result(mismatchAt: nil)
+    }
+
+    /// Chunk-aligned offsets to compare: every chunk, or an even spread that always
+    /// includes the first and last chunk
+    static func chunkOffsets(imageSize: Int64, mode: ImageVerifyMode) -> [Int64] {
+        let chunk = Int64(chunkSize)
+        let chunkCount = Int((imageSize + chunk - 1) / chunk)
+        guard chunkCount > 0, mode != .off else { return [] }
+        guard mode == .sampled, chunkCount > sampleCount else {
+            return (0..<chunkCount).map { Int64($0) * chunk }
+        }
+        let indices = Set((0..<sampleCount).map { $0 * (chunkCount - 1) / (sampleCount - 1) })
+        return indices.sorted().map { Int64($0) * chunk }
+    }
+
+    /// Re-read a chunk whose digests differ and find the first byte where the file and the
+    /// disc part. Only runs once per failed verify, so it reads the file directly.
+    private static func firstDifference(file: Int32, disc: [UInt8], length: Int, at offset: Int64) throws -> Int64 {
+        var image = [UInt8](repeating: 0, count: length)
+        var done = 0
+        while done < length {
+            let count = image.withUnsafeMutableBytes { raw in
+                pread(file, raw.baseAddress! + done, length - done, off_t(offset) + off_t(done))
+            }
+            if count < 0 && errno == EINTR { continue }
+            guard count > 0 else { throw ImagingError.readFailed(count < 0 ? errno : EIO) }
+            done += count
+        }
+        let index = (0..<length).first { image[$0] != disc[$0] } ?? 0
+        return offset + Int64(index)
+    }
+
+    private static func chunkLength(at offset: Int64, imageSize: Int64) -> Int64 {
+        min(Int64(chunkSize), imageSize - offset)
+    }
+
+    /// Raw devices only accept whole sectors, so a short tail is read sector-aligned
+    /// and only `length` bytes of it are compared. Returns the bytes available.
+    private static func readDevice(_ device: Int32, into buffer: inout [UInt8], length: Int, at offset: Int64) throws -> Int {
+        let sectorAligned = min((length + 2047) / 2048 * 2048, buffer.count)
+        var done = 0
+        while done < sectorAligned {
+            let count = buffer.withUnsafeMutableBytes { raw in
+                pread(device, raw.baseAddress! + done, sectorAligned - done, off_t(offset) + off_t(done))
+            }
+            if count < 0 {
+                if errno == EINTR { continue }
+                // The image was read from this disc, so every sector it covers should read back
+                throw ImagingError.readFailed(errno)
+            }
+            if count == 0 { break }
+            done += count
+        }
+        return min(done, length)
+    }
+
+    fileprivate static func sha256(_ bytes: UnsafeRawPointer, count: Int) -> [UInt8] {
+        var digest = [UInt8](repeating: 0, count: Int(SHA256_DIGEST_SIZE))
+        sha256_digest(bytes, count, &digest)
+        return digest
+    }
+}
+
+/// The file side of the pipeline: reads and hashes image chunks on its own thread,
+/// staying up to `queueDepth` chunks ahead of the drive.
+private final class FileDigester {
+    private let fd: Int32
+    private let offsets: [Int64]
+    private let imageSize: Int64
+    private let hashesWholeImage: Bool
+
+    private let condition = NSCondition()
+    private var digests: [[UInt8]] = []
+    private var failure: Error?
+    private var isFinished = false
+    private var isStopped = false
+
+    /// Written by the reader thread; read once it has finished
+    private var wholeImage = sha256_t()
+
+    init(fd: Int32, offsets: [Int64], imageSize: Int64, hashesWholeImage: Bool) {
+        self.fd = fd
+        self.offsets = offsets
+        self.imageSize = imageSize
+        self.hashesWholeImage = hashesWholeImage
+        sha256_init(&wholeImage)
+
+        let thread = Thread { self.run() }
+        thread.name = "discbot.imaging.verify"
+        thread.qualityOfService = .userInitiated
+        thread.start()
+    }
+
+    /// Digest of the next chunk, waiting for the reader if it is behind; nil past the end
+    func next() throws -> [UInt8]? {
+        condition.lock()
+        defer { condition.unlock() }
+        while digests.isEmpty && !isFinished && failure == nil {
+            condition.wait()
+        }
+        if let failure = failure {
+            throw failure
+        }
+        guard !digests.isEmpty else { return nil }
+        condition.broadcast()
+        return digests.removeFirst()
+    }
+
+    /// Whole-image SHA-256 once every chunk has been read, else nil
+    func wholeImageDigest() -> String? {
+        condition.lock()
+        while !isFinished && failure == nil {
+            condition.wait()
+        }
+        let complete = isFinished && failure == nil
+        condition.unlock()
+        guard hashesWholeImage, complete else { return nil }
+
+        var digest = [UInt8](repeating: 0, count: Int(SHA256_DIGEST_SIZE))
+        sha256_final(&wholeImage, &digest)
+        return digest.map { String(format: "%02x", $0) }.joined()
+    }
+
+    /// Stop reading ahead and wait for the thread to exit (the caller closes the file next)
+    func stop() {
+        condition.lock()
+        isStopped = true
+        condition.broadcast()
+        while !isFinished && failure == nil {
+            condition.wait()
+        }
+        condition.unlock()
+    }
+
+    private func run() {
+        var buffer = [UInt8](repeating: 0, count: ImageVerifier.chunkSize)
+        for offset in offsets {
+            condition.lock()
+            while digests.count >= ImageVerifier.queueDepth && !isStopped {
+                condition.wait()
+            }
+            let stopped = isStopped
+            condition.unlock()
+            if stopped { break }
+
+            let length = Int(min(Int64(buffer.count), imageSize - offset))
+            var done = 0
+            while done < length {
+                let count = buffer.withUnsafeMutableBytes { raw in
+                    pread(fd, raw.baseAddress! + done, length - done, off_t(offset) + off_t(done))
+                }
+                if count < 0 && errno == EINTR { continue }
+                guard count > 0 else {
+                    fail(ImagingError.readFailed(count < 0 ? errno : EIO))
+                    return
+                }
+                done += count
+            }
+
+            let digest = buffer.withUnsafeBytes { raw -> [UInt8] in
+                if hashesWholeImage {
+                    sha256_update(&wholeImage, raw.baseAddress, length)
+                }
+                return ImageVerifier.sha256(raw.baseAddress!, count: length)
+            }
+            condition.lock()
+            digests.append(digest)
+            condition.broadcast()
+            condition.unlock()
+        }
+
+        condition.lock()
+        isFinished = true
+        condition.broadcast()
+        condition.unlock()
+    }
+
+    private func fail(_ error: Error) {
+        condition.lock()
+        failure = error
+        condition.broadcast()
+        condition.unlock()
+    }
+}
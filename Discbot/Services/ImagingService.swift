@@ -6,8 +6,14 @@
 //
 
 import Foundation
+#if canImport(Darwin)
 import Darwin
+#else
+import Glibc
+#endif
+#if canImport(os)
 import os.log
+#endif
 
 struct ImagingProgressInfo {
     let fractionCompleted: Double
@@ -29,6 +35,10 @@ enum DiscType: Equatable {
 protocol ImagingServicing: AnyObject {
     func estimateDiscSizeBytes(bsdName: String) -> Int64?
     func detectDiscType(bsdName: String) -> DiscType
+    /// CD table of contents from one ioctl; nil for DVDs and unreadable media
+    func readTOC(bsdName: String) -> DiscTOC?
+    /// Volume label and filesystem from the raw volume descriptors, without mounting
+    func readVolumeInfo(bsdName: String) -> VolumeInfo?
     func createImage(
         bsdName: String,
         discType: DiscType,
@@ -37,6 +47,51 @@ protocol ImagingServicing: AnyObject {
         control: ImagingService.ImagingControl?,
         progress: @escaping (ImagingProgressInfo) -> Void
     ) throws -> URL
+    /// Image the disc to `outputPath` and also to every mirror (see `ImageFanOut`),
+    /// writing files as `writeOptions` asks
+    func createImage(
+        bsdName: String,
+        discType: DiscType,
+        outputPath: URL,
+        mirrors: [ImageDestination],
+        writeOptions: ImageWriteOptions,
+        totalBytes: Int64?,
+        control: ImagingService.ImagingControl?,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> URL
+    /// Re-read the disc still in the drive and compare it with `imageURL` (see `ImageVerifier`)
+    func verifyImage(
+        bsdName: String,
+        imageURL: URL,
+        mode: ImageVerifyMode,
+        control: ImagingService.ImagingControl?,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> ImageVerificationResult
+}
+
+extension ImagingServicing {
+    /// Without a single read stream to share, mirrors are copied from the finished image.
+    func createImage(
+        bsdName: String,
+        discType: DiscType,
+        outputPath: URL,
+        mirrors: [ImageDestination],
+        writeOptions: ImageWriteOptions,
+        totalBytes: Int64?,
+        control: ImagingService.ImagingControl?,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> URL {
+        let imageURL = try createImage(
+            bsdName: bsdName,
+            discType: discType,
+            outputPath: outputPath,
+            totalBytes: totalBytes,
+            control: control,
+            progress: progress
+        )
+        ImageFanOut.mirror(imageURL, to: mirrors, options: writeOptions)
+        return imageURL
+    }
 }
 
 final class ImagingService: ImagingServicing {
@@ -143,7 +198,12 @@ final class ImagingService: ImagingServicing {
 
     /// Detect the type of disc in the drive (blocking)
     func detectDiscType(bsdName: String) -> DiscType {
-        // Use diskutil to get media info
+        // The TOC distinguishes audio, data and mixed-mode CDs without a subprocess
+        if let toc = readTOC(bsdName: bsdName) {
+            return toc.discType
+        }
+
+        // Otherwise (DVDs have no CD TOC) use diskutil to get media info
         let process = Process()
         process.executableURL = URL(fileURLWithPath: "/usr/sbin/diskutil")
         process.arguments = ["info", bsdName]
@@ -173,6 +233,26 @@ final class ImagingService: ImagingServicing {
         return .unknown
     }
 
+    /// Read the CD table of contents with one ioctl on the raw device (blocking)
+    func readTOC(bsdName: String) -> DiscTOC? {
+        DiscTOC.read(bsdName: bsdName)
+    }
+
+    /// Read the volume descriptors straight from the raw device (blocking)
+    func readVolumeInfo(bsdName: String) -> VolumeInfo? {
+        guard let info = VolumeInfo.probe(path: "/dev/r\(bsdName)") else {
+            return nil
+        }
+        os_log(
+            "Read volume label '%{public}@' from %{public}@ without mounting",
+            log: Self.log,
+            type: .info,
+            info.label,
+            bsdName
+        )
+        return info
+    }
+
     /// Create an ISO image using hdiutil (blocking)
     func createISOImage(
         bsdName: String,
@@ -323,6 +403,101 @@ final class ImagingService: ImagingServicing {
         return isoPath
     }
 
+    /// Create an ISO image by reading the raw device once and handing every chunk to
+    /// `ImageFanOut`, which writes the output folder and the mirrors in parallel with
+    /// `totalBytes` preallocated (blocking)
+    func createStreamedImage(
+        bsdName: String,
+        outputPath: URL,
+        mirrors: [ImageDestination],
+        writeOptions: ImageWriteOptions = .standard,
+        totalBytes: Int64? = nil,
+        control: ImagingControl? = nil,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> URL {
+        if control?.isCancelled == true {
+            throw ImagingError.cancelled
+        }
+
+        let isoPath = outputPath.deletingPathExtension().appendingPathExtension("iso")
+        let device = open("/dev/r\(bsdName)", O_RDONLY)
+        guard device >= 0 else {
+            throw ImagingError.deviceNotFound(bsdName)
+        }
+        defer { _ = close(device) }
+
+        let fanOut = try ImageFanOut(
+            primaryURL: isoPath,
+            mirrors: mirrors,
+            expectedSize: totalBytes,
+            options: writeOptions
+        )
+        var buffer = [UInt8](repeating: 0, count: ImageFanOut.chunkSize)
+        var transferred: Int64 = 0
+        let startTime = Date()
+        var lastReport = Date.distantPast
+
+        func report(_ fraction: Double) {
+            let elapsed = max(Date().timeIntervalSince(startTime), 0.001)
+            let speed = transferred > 0 ? Double(transferred) / elapsed : nil
+            let eta = totalBytes.flatMap { total in speed.map { max(Double(total - transferred) / $0, 0) } }
+            progress(ImagingProgressInfo(
+                fractionCompleted: fraction,
+                bytesTransferred: transferred,
+                totalBytes: totalBytes,
+                speedBytesPerSecond: speed,
+                etaSeconds: eta
+            ))
+        }
+
+        do {
+            // Read to the end of the device, as hdiutil does; the size is only for progress
+            while true {
+                if control?.isCancelled == true {
+                    throw ImagingError.cancelled
+                }
+                while control?.isPaused == true {
+                    Thread.sleep(forTimeInterval: 0.1)
+                    if control?.isCancelled == true {
+                        throw ImagingError.cancelled
+                    }
+                }
+
+                let count = read(device, &buffer, buffer.count)
+                if count < 0 {
+                    if errno == EINTR { continue }
+                    // Some drives fail reads in the lead-out rather than returning end of file
+                    if let totalBytes = totalBytes, transferred >= totalBytes { break }
+                    throw ImagingError.readFailed(errno)
+                }
+                if count == 0 { break }
+
+                try fanOut.write(Data(buffer[0..<count]))
+                transferred += Int64(count)
+
+                if Date().timeIntervalSince(lastReport) >= 0.25 {
+                    lastReport = Date()
+                    let fraction = totalBytes.map { min(Double(transferred) / Double(max($0, 1)), 1) } ?? 0
+                    report(fraction)
+                }
+            }
+            _ = try fanOut.finish()
+        } catch {
+            fanOut.abort()
+            os_log(
+                "createStreamedImage failed for %{public}@: %{public}@",
+                log: Self.log,
+                type: .error,
+                bsdName,
+                error.localizedDescription
+            )
+            throw error
+        }
+
+        report(1.0)
+        return isoPath
+    }
+
     /// Create a BIN/CUE image for audio CDs (not yet implemented)
     func createBINCUEImage(
         bsdName: String,
@@ -377,6 +552,54 @@ final class ImagingService: ImagingServicing {
             )
         }
     }
+
+    /// Data CDs and DVDs are plain 2048-byte sectors, so they are read straight off the
+    /// raw device and written by our own writer: preallocated, outside the page cache,
+    /// synced per `writeOptions`, with the one read feeding every mirror. Other discs go
+    /// through hdiutil and any mirrors are copied from the image afterwards.
+    func createImage(
+        bsdName: String,
+        discType: DiscType,
+        outputPath: URL,
+        mirrors: [ImageDestination],
+        writeOptions: ImageWriteOptions,
+        totalBytes: Int64? = nil,
+        control: ImagingControl? = nil,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> URL {
+        if discType == .dataCD || discType == .dvd {
+            return try createStreamedImage(
+                bsdName: bsdName,
+                outputPath: outputPath,
+                mirrors: mirrors,
+                writeOptions: writeOptions,
+                totalBytes: totalBytes,
+                control: control,
+                progress: progress
+            )
+        }
+
+        let imageURL = try createImage(
+            bsdName: bsdName,
+            discType: discType,
+            outputPath: outputPath,
+            totalBytes: totalBytes,
+            control: control,
+            progress: progress
+        )
+        ImageFanOut.mirror(imageURL, to: mirrors, options: writeOptions)
+        return imageURL
+    }
+
+    func verifyImage(
+        bsdName: String,
+        imageURL: URL,
+        mode: ImageVerifyMode,
+        control: ImagingControl? = nil,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> ImageVerificationResult {
+        try ImageVerifier.verify(bsdName: bsdName, imageURL: imageURL, mode: mode, control: control, progress: progress)
+    }
 }
 
 // MARK: - Mock Imaging Service
@@ -430,6 +653,19 @@ final class MockImagingService: ImagingServicing {
         return mockDisc(for: bsdName).discType
     }
 
+    func readTOC(bsdName: String) -> DiscTOC? {
+        let disc = mockDisc(for: bsdName)
+        let serial = Int(bsdName.filter { $0.isNumber }) ?? 0
+        return DiscTOC.simulated(discType: disc.discType, sizeBytes: disc.sizeBytes, serial: serial)
+    }
+
+    func readVolumeInfo(bsdName: String) -> VolumeInfo? {
+        let disc = mockDisc(for: bsdName)
+        guard disc.discType != .audioCDDA else { return nil }
+        let filesystems: VolumeInfo.Filesystems = disc.discType == .dvd ? [.iso9660, .udf] : [.iso9660, .joliet]
+        return VolumeInfo(filesystems: filesystems, label: disc.volumeName, sizeBytes: disc.sizeBytes)
+    }
+
     func createImage(
         bsdName: String,
         discType: DiscType,
@@ -482,4 +718,31 @@ final class MockImagingService: ImagingServicing {
 
         return isoPath
     }
+
+    /// Mock discs always match their placeholder images; takes about a second
+    func verifyImage(
+        bsdName: String,
+        imageURL: URL,
+        mode: ImageVerifyMode,
+        control: ImagingService.ImagingControl?,
+        progress: @escaping (ImagingProgressInfo) -> Void
+    ) throws -> ImageVerificationResult {
+        let totalSize = mockDisc(for: bsdName).sizeBytes
+        let steps = 10
+        for i in 1...steps {
+            if control?.isCancelled == true {
+                throw ImagingError.cancelled
+            }
+            Thread.sleep(forTimeInterval: 0.1)
+            let fraction = Double(i) / Double(steps)
+            progress(ImagingProgressInfo(
+                fractionCompleted: fraction,
+                bytesTransferred: Int64(Double(totalSize) * fraction),
+                totalBytes: totalSize,
+                speedBytesPerSecond: nil,
+                etaSeconds: nil
+            ))
+        }
+        return ImageVerificationResult(mode: mode, bytesCompared: totalSize, mismatchOffset: nil, imageSHA256: nil)
+    }
 }
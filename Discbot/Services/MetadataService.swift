@@ -6,104 +6,46 @@
 //
 
 import Foundation
-import CommonCrypto
+#if canImport(CDiscbot)
+import CDiscbot
+#endif
 
 final class MetadataService {
+    #if !DISCBOT_NO_HARDWARE
     private let mountService = MountService()
+    #endif
+    private let musicBrainz: MusicBrainzService
 
-    // MARK: - MusicBrainz API
-
-    private struct MusicBrainzResponse: Codable {
-        let releases: [MBRelease]?
-
-        struct MBRelease: Codable {
-            let id: String
-            let title: String
-            let artistCredit: [ArtistCredit]?
-            let date: String?
-            let country: String?
-
-            enum CodingKeys: String, CodingKey {
-                case id, title, date, country
-                case artistCredit = "artist-credit"
-            }
-        }
-
-        struct ArtistCredit: Codable {
-            let name: String
-            let artist: Artist
-        }
-
-        struct Artist: Codable {
-            let id: String
-            let name: String
-        }
+    init(musicBrainz: MusicBrainzService = .shared) {
+        self.musicBrainz = musicBrainz
     }
 
-    /// Look up metadata from MusicBrainz by disc ID (blocking)
-    func lookupMusicBrainz(discID: String) -> DiscMetadata? {
-        let urlString = "https://musicbrainz.org/ws/2/discid/\(discID)?fmt=json&inc=artists"
-        guard let url = URL(string: urlString) else {
-            return nil
-        }
-
-        var request = URLRequest(url: url)
-        request.setValue("Discbot/1.0 (contact@example.com)", forHTTPHeaderField: "User-Agent")
-        request.setValue("application/json", forHTTPHeaderField: "Accept")
-        request.timeoutInterval = 30
-
-        let semaphore = DispatchSemaphore(value: 0)
-        var resultData: Data?
-        var resultResponse: URLResponse?
-
-        let task = URLSession.shared.dataTask(with: request) { data, response, error in
-            resultData = data
-            resultResponse = response
-            semaphore.signal()
-        }
-        task.resume()
-        semaphore.wait()
-
-        guard let data = resultData,
-              let httpResponse = resultResponse as? HTTPURLResponse,
-              httpResponse.statusCode == 200 else {
-            return nil
-        }
-
-        do {
-            let result = try JSONDecoder().decode(MusicBrainzResponse.self, from: data)
-            guard let release = result.releases?.first else {
-                return nil
-            }
-
-            let artist = release.artistCredit?.first?.name ?? "Unknown Artist"
-            let year = release.date?.prefix(4).description
+    // MARK: - MusicBrainz API
 
-            return DiscMetadata(
-                artist: artist,
-                album: release.title,
-                year: year,
-                tracks: nil,
-                source: .musicBrainz
-            )
-        } catch {
-            return nil
-        }
+    /// Look up metadata from MusicBrainz by disc ID without blocking. Requests are
+    /// rate-limited and cached; `completion` runs on a background queue.
+    func lookupMusicBrainz(discID: String, completion: @escaping (DiscMetadata?) -> Void) {
+        musicBrainz.lookup(discId: discID, completion: completion)
     }
 
     // MARK: - Volume Label Fallback
 
     /// Get volume label for a mounted disc
     func getVolumeLabel(bsdName: String) -> String? {
+        #if DISCBOT_NO_HARDWARE
+        return nil
+        #else
         return mountService.getVolumeName(bsdName: bsdName)
+        #endif
     }
 
     // MARK: - Metadata Resolution
 
-    /// Resolve metadata using all available sources (blocking)
-    func resolveMetadata(bsdName: String, slotNumber: Int) -> DiscMetadata {
+    /// Resolve metadata using all available sources (blocking).
+    /// `volumeLabel` is a label already read from the raw volume descriptors.
+    func resolveMetadata(bsdName: String, slotNumber: Int, volumeLabel: String? = nil) -> DiscMetadata {
         // 1. Try volume label first (works for any mounted disc)
-        if let volumeLabel = getVolumeLabel(bsdName: bsdName), !volumeLabel.isEmpty {
+        if let volumeLabel = volumeLabel ?? getVolumeLabel(bsdName: bsdName), !volumeLabel.isEmpty {
             return DiscMetadata(
                 artist: "Unknown",
                 album: volumeLabel,
@@ -142,38 +84,44 @@ final class MetadataService {
     }
 }
 
-// MARK: - Disc ID Calculation (for future MusicBrainz support)
+// MARK: - Disc ID Calculation
 
 extension MetadataService {
-    /// Calculate MusicBrainz disc ID from CD TOC
-    /// This requires reading the TOC via IOKit ioctls
-    func calculateMusicBrainzDiscID(firstTrack: Int, lastTrack: Int, leadOutOffset: Int, trackOffsets: [Int]) -> String {
-        // Build the hash input
-        var data = ""
-        data += String(format: "%02X", firstTrack)
-        data += String(format: "%02X", lastTrack)
-        data += String(format: "%08X", leadOutOffset)
-
-        // 99 track offsets, pad with zeros
-        for i in 0..<99 {
-            if i < trackOffsets.count {
-                data += String(format: "%08X", trackOffsets[i])
-            } else {
-                data += "00000000"
-            }
-        }
+    /// Disc IDs computed from one CD table of contents
+    struct DiscIDs: Equatable {
+        let musicBrainz: String
+        let freeDB: String
+    }
+
+    /// Calculate the MusicBrainz and FreeDB/CDDB disc IDs from a CD TOC.
+    /// Offsets are frame addresses including the 150-frame lead-in; `trackOffsets`
+    /// holds tracks `firstTrack...lastTrack` in order. Returns nil for an invalid TOC.
+    static func calculateDiscIDs(firstTrack: Int, lastTrack: Int, leadOutOffset: Int, trackOffsets: [Int]) -> DiscIDs? {
+        let offsets = trackOffsets.map { UInt32(clamping: $0) }
+        var mbBuffer = [CChar](repeating: 0, count: Int(DISCID_MB_SIZE))
+        var freeDBBuffer = [CChar](repeating: 0, count: Int(DISCID_FREEDB_SIZE))
+
+        let result = discid_compute(
+            Int32(clamping: firstTrack),
+            Int32(clamping: lastTrack),
+            UInt32(clamping: leadOutOffset),
+            offsets,
+            Int32(clamping: offsets.count),
+            &mbBuffer,
+            &freeDBBuffer
+        )
+        guard result == 0 else { return nil }
+
+        return DiscIDs(musicBrainz: String(cString: mbBuffer), freeDB: String(cString: freeDBBuffer))
+    }
 
-        // SHA-1 hash using CommonCrypto
-        let dataBytes = Array(data.utf8)
-        var hash = [UInt8](repeating: 0, count: Int(CC_SHA1_DIGEST_LENGTH))
-        CC_SHA1(dataBytes, CC_LONG(dataBytes.count), &hash)
-
-        // Base64 encode with MusicBrainz custom alphabet
-        let hashData = Data(hash)
-        let base64 = hashData.base64EncodedString()
-        return base64
-            .replacingOccurrences(of: "+", with: ".")
-            .replacingOccurrences(of: "/", with: "_")
-            .replacingOccurrences(of: "=", with: "-")
+    /// Calculate MusicBrainz disc ID from CD TOC
+    func calculateMusicBrainzDiscID(firstTrack: Int, lastTrack: Int, leadOutOffset: Int, trackOffsets: [Int]) -> String? {
+        Self.calculateDiscIDs(
+            firstTrack: firstTrack,
+            lastTrack: lastTrack,
+            leadOutOffset: leadOutOffset,
+            trackOffsets: trackOffsets
+        )?.musicBrainz
     }
 }
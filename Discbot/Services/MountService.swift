@@ -6,11 +6,15 @@
 //
 
 import Foundation
+#if canImport(os)
 import os.log
+#endif
 
 protocol MountServicing: AnyObject {
     func waitForDisc(timeout: TimeInterval) throws -> String
     func findDiscBSDName() -> String?
+    /// The optical drive's own inquiry ("vendor product"), whether or not it holds a disc
+    func getDriveIdentity() -> String?
     func isDiscPresent() -> Bool
     func mountDisc(bsdName: String, timeout: Int) throws -> String
     func unmountDisc(bsdName: String, force: Bool) throws
@@ -35,6 +39,7 @@ extension MountServicing {
     }
 }
 
+#if !DISCBOT_NO_HARDWARE
 final class MountService {
     private static let log = OSLog(
         subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
@@ -88,6 +93,15 @@ final class MountService {
         return name.isEmpty ? nil : name
     }
 
+    /// Identify the optical drive from its inquiry data
+    func getDriveIdentity() -> String? {
+        let result = mount_get_drive_identity()
+        guard let cStr = result else { return nil }
+        let identity = String(cString: cStr)
+        free(UnsafeMutableRawPointer(mutating: cStr))
+        return identity.isEmpty ? nil : identity
+    }
+
     /// Check if disc is present
     func isDiscPresent() -> Bool {
         return mount_is_disc_present()
@@ -197,6 +211,7 @@ final class MountService {
 }
 
 extension MountService: MountServicing {}
+#endif
 
 // MARK: - Mock Mount Service
 
@@ -223,6 +238,10 @@ final class MockMountService: MountServicing {
         state.snapshotDrive().bsdName
     }
 
+    func getDriveIdentity() -> String? {
+        "Mock Optical Drive"
+    }
+
     func isDiscPresent() -> Bool {
         state.snapshotDrive().hasDisc
     }
@@ -0,0 +1,446 @@
+//
+//  MusicBrainzService.swift
+//  Discbot
+//
+//  Rate-limited, cached MusicBrainz disc ID lookups that run off the imaging path
+//
+
+import Foundation
+#if canImport(FoundationNetworking)
+import FoundationNetworking
+#endif
+
+/// Outcome of looking up one disc ID; `release` is nil when MusicBrainz does not know the disc.
+struct MusicBrainzLookup {
+    struct Release: Codable, Equatable {
+        let artist: String
+        let album: String
+        let year: String?
+
+        var metadata: DiscMetadata {
+            DiscMetadata(artist: artist, album: album, year: year, tracks: nil, source: .musicBrainz)
+        }
+    }
+
+    let discId: String
+    /// Slots the disc ID was read from; the catalog rows to attach it to
+    let slotIds: [Int]
+    let release: Release?
+    let fetchedAt: Date
+}
+
+/// Token bucket: `capacity` requests may go out back to back, then one per `interval`.
+struct TokenBucket {
+    let capacity: Double
+    let interval: TimeInterval
+    private var tokens: Double
+    private var updatedAt: TimeInterval
+
+    init(capacity: Double = 1, interval: TimeInterval, now: TimeInterval) {
+        self.capacity = capacity
+        self.interval = interval
+        tokens = capacity
+        updatedAt = now
+    }
+
+    /// Take a token and return 0, or return how long to wait until one is available.
+    mutating func take(now: TimeInterval) -> TimeInterval {
+        tokens = min(capacity, tokens + max(now - updatedAt, 0) / interval)
+        updatedAt = now
+        guard tokens >= 1 else {
+            return (1 - tokens) * interval
+        }
+        tokens -= 1
+        return 0
+    }
+
+    /// Hold off all requests for `seconds` (a server-requested Retry-After).
+    mutating func pause(for seconds: TimeInterval, now: TimeInterval) {
+        tokens = min(tokens, 0) - seconds / interval
+        updatedAt = now
+    }
+}
+
+/// On-disk cache of lookups, one JSON file per disc ID. Found releases are kept
+/// indefinitely; "not found" answers expire so newly submitted discs are picked up.
+final class MusicBrainzCache {
+    enum Entry {
+        case found(MusicBrainzLookup.Release)
+        case notFound
+    }
+
+    private struct StoredEntry: Codable {
+        let fetchedAt: Date
+        let release: MusicBrainzLookup.Release?
+    }
+
+    private let directory: URL?
+    private let negativeLifetime: TimeInterval
+    private let lock = NSLock()
+    private var entries: [String: StoredEntry] = [:]
+
+    init(directory: URL?, negativeLifetime: TimeInterval) {
+        self.directory = directory
+        self.negativeLifetime = negativeLifetime
+        if let directory = directory {
+            try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        }
+    }
+
+    func entry(for discId: String, now: Date) -> Entry? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if entries[discId] == nil, let url = fileURL(for: discId), let data = try? Data(contentsOf: url) {
+            entries[discId] = try? JSONDecoder().decode(StoredEntry.self, from: data)
+        }
+        guard let stored = entries[discId] else { return nil }
+
+        if let release = stored.release {
+            return .found(release)
+        }
+        return now.timeIntervalSince(stored.fetchedAt) < negativeLifetime ? .notFound : nil
+    }
+
+    func store(_ release: MusicBrainzLookup.Release?, for discId: String, fetchedAt: Date) {
+        let stored = StoredEntry(fetchedAt: fetchedAt, release: release)
+        lock.lock()
+        entries[discId] = stored
+        lock.unlock()
+
+        guard let url = fileURL(for: discId), let data = try? JSONEncoder().encode(stored) else { return }
+        do {
+            try data.write(to: url, options: .atomic)
+        } catch {
+            print("MusicBrainzCache: Failed to write \(url.lastPathComponent): \(error)")
+        }
+    }
+
+    private func fileURL(for discId: String) -> URL? {
+        // Disc IDs use a filename-safe alphabet ([A-Za-z0-9._-]); anything else is not cached on disk.
+        let allowed = CharacterSet.alphanumerics.union(CharacterSet(charactersIn: "._-"))
+        guard !discId.isEmpty, discId.unicodeScalars.allSatisfy(allowed.contains) else { return nil }
+        return directory?.appendingPathComponent(discId + ".json")
+    }
+}
+
+/// Looks up disc IDs against MusicBrainz without blocking the caller.
+///
+/// Requests go out one at a time, no faster than the token bucket allows (MusicBrainz
+/// asks for at most one request per second). Answers, including "not found", are cached
+/// on disk. Lookups queued with `enqueue` are written back to the catalog in batches,
+/// one transaction per batch, and announced with `lookupsAppliedNotification`.
+final class MusicBrainzService {
+    struct Configuration {
+        var baseURL: URL
+        var userAgent = "Discbot/1.0 (contact@example.com)"
+        var requestInterval: TimeInterval = 1
+        var requestTimeout: TimeInterval = 30
+        var negativeCacheLifetime: TimeInterval = 7 * 24 * 3600
+        var cacheDirectory: URL?
+        /// Catalog updates are written once this many lookups finish, or when the queue drains
+        var writeBatchSize = 16
+        /// Attempts per disc ID when the server is busy or unreachable
+        var maxAttempts = 3
+
+        /// musicbrainz.org, unless `DISCBOT_MUSICBRAINZ_URL` or the `musicBrainzBaseURL`
+        /// default points at another server (a mirror, or a local stand-in for testing).
+        static var standard: Configuration {
+            let override = ProcessInfo.processInfo.environment["DISCBOT_MUSICBRAINZ_URL"]
+                ?? UserDefaults.standard.string(forKey: "musicBrainzBaseURL")
+            let baseURL = override.flatMap(URL.init(string:)) ?? URL(string: "https://musicbrainz.org")!
+            let cacheDirectory = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first?
+                .appendingPathComponent("Discbot", isDirectory: true)
+                .appendingPathComponent("MusicBrainz", isDirectory: true)
+            return Configuration(baseURL: baseURL, cacheDirectory: cacheDirectory)
+        }
+    }
+
+    /// Posted after catalog rows are back-filled; `userInfo["slotIds"]` lists the slots touched.
+    static let lookupsAppliedNotification = Notification.Name("MusicBrainzLookupsApplied")
+
+    static let shared = MusicBrainzService(configuration: .standard)
+
+    private struct Request {
+        var slotIds: Set<Int> = []
+        var completions: [(DiscMetadata?) -> Void] = []
+        var writesToCatalog = false
+        var attempts = 0
+    }
+
+    private enum FetchResult {
+        case found(MusicBrainzLookup.Release)
+        case notFound
+        case retry(after: TimeInterval?)
+    }
+
+    private struct MusicBrainzResponse: Codable {
+        let releases: [MBRelease]?
+
+        struct MBRelease: Codable {
+            let id: String
+            let title: String
+            let artistCredit: [ArtistCredit]?
+            let date: String?
+            let country: String?
+
+            enum CodingKeys: String, CodingKey {
+                case id, title, date, country
+                case artistCredit = "artist-credit"
+            }
+        }
+
+        struct ArtistCredit: Codable {
+            let name: String
+            let artist: Artist
+        }
+
+        struct Artist: Codable {
+            let id: String
+            let name: String
+        }
+    }
+
+    let configuration: Configuration
+    private let session: URLSession
+    private let database: Database
+    private let clock: () -> TimeInterval
+    private let cache: MusicBrainzCache
+
+    // Only touched on `queue`
+    private let queue = DispatchQueue(label: "discbot.musicbrainz", qos: .utility)
+    private var order: [String] = []
+    private var requests: [String: Request] = [:]
+    private var inFlight: String?
+    private var wakeScheduled = false
+    private var bucket: TokenBucket
+    private var unwritten: [MusicBrainzLookup] = []
+
+    init(
+        configuration: Configuration,
+        session: URLSession = .shared,
+        database: Database = .shared,
+        clock: @escaping () -> TimeInterval = { ProcessInfo.processInfo.systemUptime }
+    ) {
+        self.configuration = configuration
+        self.session = session
+        self.database = database
+        self.clock = clock
+        cache = MusicBrainzCache(
+            directory: configuration.cacheDirectory,
+            negativeLifetime: configuration.negativeCacheLifetime
+        )
+        bucket = TokenBucket(interval: configuration.requestInterval, now: clock())
+    }
+
+    // MARK: - Public API
+
+    /// Look up `discId`; `completion` runs on the service's queue. Cached answers return without a request.
+    func lookup(discId: String, completion: @escaping (DiscMetadata?) -> Void) {
+        queue.async {
+            self.request(discId) { $0.completions.append(completion) }
+        }
+    }
+
+    /// Look up `discId` and back-fill the disc in `slotId` (and every other disc with that ID).
+    func enqueue(discId: String, slotId: Int) {
+        queue.async {
+            self.request(discId) {
+                $0.slotIds.insert(slotId)
+                $0.writesToCatalog = true
+            }
+        }
+    }
+
+    /// Queue every cataloged disc ID that has not been looked up yet.
+    func backfillPending() {
+        queue.async {
+            for (discId, slotIds) in self.database.getPendingMusicBrainzLookups() {
+                self.request(discId) {
+                    $0.slotIds.formUnion(slotIds)
+                    $0.writesToCatalog = true
+                }
+            }
+        }
+    }
+
+    /// Write finished lookups to the catalog now instead of waiting for a full batch.
+    func flush() {
+        queue.sync { self.writeUnwritten() }
+    }
+
+    // MARK: - Queue
+
+    private func request(_ discId: String, _ update: (inout Request) -> Void) {
+        if requests[discId] == nil {
+            requests[discId] = Request()
+            order.append(discId)
+        }
+        update(&requests[discId]!)
+        pump()
+    }
+
+    /// Answer queued requests from the cache and start the next network request when a token is free.
+    private func pump() {
+        while inFlight == nil, let discId = order.first {
+            if let entry = cache.entry(for: discId, now: Date()) {
+                order.removeFirst()
+                switch entry {
+                case .found(let release): finish(discId, release: release)
+                case .notFound: finish(discId, release: nil)
+                }
+                continue
+            }
+
+            let wait = bucket.take(now: clock())
+            guard wait == 0 else {
+                scheduleWake(after: wait)
+                return
+            }
+            order.removeFirst()
+            inFlight = discId
+            fetch(discId)
+        }
+
+        if inFlight == nil && order.isEmpty {
+            writeUnwritten()
+        }
+    }
+
+    private func scheduleWake(after seconds: TimeInterval) {
+        guard !wakeScheduled else { return }
+        wakeScheduled = true
+        queue.asyncAfter(deadline: .now() + seconds) {
+            self.wakeScheduled = false
+            self.pump()
+        }
+    }
+
+    private func fetch(_ discId: String) {
+        guard let url = lookupURL(discId: discId) else {
+            inFlight = nil
+            finish(discId, release: nil, cacheResult: false)
+            pump()
+            return
+        }
+
+        var request = URLRequest(url: url)
+        request.setValue(configuration.userAgent, forHTTPHeaderField: "User-Agent")
+        request.setValue("application/json", forHTTPHeaderField: "Accept")
+        request.timeoutInterval = configuration.requestTimeout
+
+        session.dataTask(with: request) { data, response, error in
+            let result = self.interpret(data: data, response: response as? HTTPURLResponse, error: error)
+            self.queue.async {
+                self.inFlight = nil
+                self.handle(result, for: discId)
+                self.pump()
+            }
+        }.resume()
+    }
+
+    private func handle(_ result: FetchResult, for discId: String) {
+        switch result {
+        case .found(let release):
+            finish(discId, release: release)
+        case .notFound:
+            finish(discId, release: nil)
+        case .retry(let retryAfter):
+            if let retryAfter = retryAfter {
+                bucket.pause(for: retryAfter, now: clock())
+            }
+            requests[discId]?.attempts += 1
+            if (requests[discId]?.attempts ?? 0) < configuration.maxAttempts {
+                order.append(discId)
+            } else {
+                // Leave the catalog untouched so the next back-fill tries again.
+                finish(discId, release: nil, cacheResult: false)
+            }
+        }
+    }
+
+    private func finish(_ discId: String, release: MusicBrainzLookup.Release?, cacheResult: Bool = true) {
+        guard let request = requests.removeValue(forKey: discId) else { return }
+        let now = Date()
+        if cacheResult {
+            cache.store(release, for: discId, fetchedAt: now)
+        }
+
+        for completion in request.completions {
+            completion(release?.metadata)
+        }
+
+        guard cacheResult, request.writesToCatalog else { return }
+        unwritten.append(MusicBrainzLookup(
+            discId: discId,
+            slotIds: request.slotIds.sorted(),
+            release: release,
+            fetchedAt: now
+        ))
+        if unwritten.count >= configuration.writeBatchSize {
+            writeUnwritten()
+        }
+    }
+
+    private func writeUnwritten() {
+        guard !unwritten.isEmpty else { return }
+        let batch = unwritten
+        unwritten = []
+        database.applyMusicBrainzLookups(batch)
+
+        let slotIds = Array(Set(batch.flatMap(\.slotIds))).sorted()
+        NotificationCenter.default.post(
+            name: Self.lookupsAppliedNotification,
+            object: self,
+            userInfo: ["slotIds": slotIds]
+        )
+    }
+
+    // MARK: - HTTP
+
+    private func lookupURL(discId: String) -> URL? {
+        guard var components = URLComponents(
+            url: configuration.baseURL.appendingPathComponent("ws/2/discid/\(discId)"),
+            resolvingAgainstBaseURL: false
+        ) else {
+            return nil
+        }
+        components.queryItems = [
+            URLQueryItem(name: "fmt", value: "json"),
+            URLQueryItem(name: "inc", value: "artists"),
+        ]
+        return components.url
+    }
+
+    private func interpret(data: Data?, response: HTTPURLResponse?, error: Error?) -> FetchResult {
+        guard let response = response, error == nil else {
+            return .retry(after: nil)
+        }
+
+        switch response.statusCode {
+        case 200:
+            guard
+                let data = data,
+                let decoded = try? JSONDecoder().decode(MusicBrainzResponse.self, from: data)
+            else {
+                return .retry(after: nil)
+            }
+            guard let release = decoded.releases?.first else {
+                return .notFound
+            }
+            return .found(MusicBrainzLookup.Release(
+                artist: release.artistCredit?.first?.name ?? "Unknown Artist",
+                album: release.title,
+                year: release.date.map { String($0.prefix(4)) }
+            ))
+        case 400, 404:
+            // Unknown or malformed disc ID
+            return .notFound
+        case 429, 503:
+            let retryAfter = (response.allHeaderFields["Retry-After"] as? String).flatMap(TimeInterval.init)
+            return .retry(after: retryAfter ?? configuration.requestInterval)
+        default:
+            return .retry(after: nil)
+        }
+    }
+}
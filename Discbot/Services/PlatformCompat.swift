@@ -0,0 +1,77 @@
+//
+//  PlatformCompat.swift
+//  Discbot
+//
+//  Stand-ins for the Apple-only frameworks the headless code touches, so it builds on Linux
+//
+
+import Foundation
+
+#if !canImport(os)
+/// Unified logging is Apple-only; elsewhere log lines go to standard error.
+struct OSLog {
+    let subsystem: String
+    let category: String
+
+    init(subsystem: String, category: String) {
+        self.subsystem = subsystem
+        self.category = category
+    }
+}
+
+struct OSLogType: Equatable {
+    fileprivate let name: String
+
+    static let `default` = OSLogType(name: "default")
+    static let info = OSLogType(name: "info")
+    static let debug = OSLogType(name: "debug")
+    static let error = OSLogType(name: "error")
+    static let fault = OSLogType(name: "fault")
+}
+
+/// Formats `message` the way `os_log` would, ignoring the `{public}`/`{private}` privacy
+/// markers. Every argument is rendered with its own description, which matches what
+/// the `%@`, `%d`, `%ld` and `%lld` conversions used in this codebase print.
+func os_log(_ message: StaticString, log: OSLog, type: OSLogType = .default, _ args: Any...) {
+    var text = ""
+    var remaining = args.makeIterator()
+    var characters = "\(message)".makeIterator()
+    while let character = characters.next() {
+        guard character == "%" else {
+            text.append(character)
+            continue
+        }
+        var conversion = characters.next()
+        if conversion == "%" {
+            text.append("%")
+            continue
+        }
+        if conversion == "{" {
+            while let next = characters.next(), next != "}" {}
+            conversion = characters.next()
+        }
+        // Skip flags, width, precision and length modifiers up to the conversion letter
+        while let current = conversion, "-+ #0123456789.hlqjztL".contains(current) {
+            conversion = characters.next()
+        }
+        if let argument = remaining.next() {
+            text += "\(argument)"
+        }
+    }
+    FileHandle.standardError.write(Data("[\(log.category)] \(type.name): \(text)\n".utf8))
+}
+#endif
+
+#if !canImport(Combine)
+/// Without Combine nothing observes the published properties; they are plain storage.
+protocol ObservableObject: AnyObject {}
+
+@propertyWrapper
+struct Published<Value> {
+    var wrappedValue: Value
+
+    init(wrappedValue: Value) {
+        self.wrappedValue = wrappedValue
+    }
+}
+#endif
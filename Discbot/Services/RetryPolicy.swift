@@ -0,0 +1,209 @@
+//
+//  RetryPolicy.swift
+//  Discbot
+//
+//  Retry rules keyed by error class, with exponential backoff and per-slot budgets
+//
+
+import Foundation
+#if canImport(os)
+import os.log
+#endif
+
+/// Broad failure classes that decide whether (and how) a step is retried.
+enum RetryErrorClass: String, CaseIterable {
+    case busy           // Drive or slot occupied, device or volume busy
+    case timeout        // Disc did not appear, command timed out
+    case unitAttention  // Changer reset or door opened
+    case mediaError     // Read errors while imaging
+    case mount          // Mount/unmount failures other than busy
+    case mechanical     // Picker or SCSI command failures
+    case permanent      // Never retried (empty slot, cancelled, write failure, ...)
+
+    init(_ error: Error) {
+        if let changerError = error as? ChangerError {
+            switch changerError {
+            case .driveNotEmpty, .slotOccupied:
+                self = .busy
+            case .timeout:
+                self = .timeout
+            case .unitAttention:
+                self = .unitAttention
+            case .mountFailed:
+                self = .mount
+            case .unmountFailed(let reason):
+                self = reason.contains("resource busy") ? .busy : .mount
+            case .moveFailed, .commandFailed, .senseError:
+                self = .mechanical
+            case .imagingFailed:
+                self = .mediaError
+            default:
+                self = .permanent
+            }
+        } else if let imagingError = error as? ImagingError {
+            switch imagingError {
+            case .readFailed, .verificationFailed:
+                self = .mediaError
+            case .processFailed(_, let reason):
+                self = RetryErrorClass(hdiutilFailure: reason)
+            case .timeout, .discNotReady, .deviceNotFound:
+                self = .timeout
+            default:
+                self = .permanent
+            }
+        } else {
+            self = .permanent
+        }
+    }
+
+    /// hdiutil exits non-zero for a missing binary or an unwritable destination as well
+    /// as for a bad disc, so only its read errors count against the media.
+    private init(hdiutilFailure reason: String) {
+        let reason = reason.lowercased()
+        if reason.contains("resource busy") {
+            self = .busy
+        } else if reason.contains("input/output error") || reason.contains("read error")
+                    || reason.contains("device not configured") {
+            self = .mediaError
+        } else {
+            self = .permanent
+        }
+    }
+}
+
+struct RetryPolicy {
+    struct Rule {
+        /// Attempts of a single step, including the first (1 = no in-place retry).
+        var maxAttempts: Int
+        var baseDelay: TimeInterval
+        var maxDelay: TimeInterval
+        /// Whether a slot that still fails with this class is queued for the end of the batch.
+        var deferrable: Bool
+    }
+
+    var rules: [RetryErrorClass: Rule]
+    /// Retries (in-place and deferred) allowed per slot over the whole batch.
+    var perSlotBudget: Int
+    /// Passes over the deferred queue after the main pass.
+    var deferredPasses: Int
+    /// Delays are scaled by a random factor in 1 ± jitter.
+    var jitter: Double
+
+    static let standard = RetryPolicy(
+        rules: [
+            .busy: Rule(maxAttempts: 4, baseDelay: 5, maxDelay: 60, deferrable: true),
+            .timeout: Rule(maxAttempts: 2, baseDelay: 10, maxDelay: 60, deferrable: true),
+            .unitAttention: Rule(maxAttempts: 3, baseDelay: 2, maxDelay: 20, deferrable: true),
+            .mediaError: Rule(maxAttempts: 1, baseDelay: 0, maxDelay: 0, deferrable: true),
+            .mount: Rule(maxAttempts: 3, baseDelay: 3, maxDelay: 30, deferrable: true),
+            .mechanical: Rule(maxAttempts: 2, baseDelay: 10, maxDelay: 60, deferrable: true),
+        ],
+        perSlotBudget: 6,
+        deferredPasses: 1,
+        jitter: 0.25
+    )
+
+    /// Fail fast: the behaviour before retries existed.
+    static let none = RetryPolicy(rules: [:], perSlotBudget: 0, deferredPasses: 0, jitter: 0)
+
+    /// Backoff before retry number `attempt` (1-based), before jitter.
+    func delay(for rule: Rule, attempt: Int) -> TimeInterval {
+        let exponent = Double(max(attempt - 1, 0))
+        return min(rule.maxDelay, rule.baseDelay * pow(2, exponent))
+    }
+}
+
+/// Applies a RetryPolicy to the steps of one batch run.
+final class RetryEngine {
+    private static let log = OSLog(
+        subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
+        category: "Retry"
+    )
+
+    let policy: RetryPolicy
+    private let sleep: (TimeInterval) -> Void
+    private let isCancelled: () -> Bool
+
+    private let lock = NSLock()
+    private var rng: SeededRandomNumberGenerator
+    private var retriesUsed: [Int: Int] = [:]
+    private var totalRetriesCount = 0
+
+    init(
+        policy: RetryPolicy,
+        seed: UInt64 = UInt64(Date().timeIntervalSince1970),
+        sleep: @escaping (TimeInterval) -> Void,
+        isCancelled: @escaping () -> Bool
+    ) {
+        self.policy = policy
+        self.rng = SeededRandomNumberGenerator(seed: seed)
+        self.sleep = sleep
+        self.isCancelled = isCancelled
+    }
+
+    var totalRetries: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return totalRetriesCount
+    }
+
+    /// Take one retry from the slot's budget; false when it is spent.
+    private func consumeBudget(slot: Int) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        let used = retriesUsed[slot, default: 0]
+        guard used < policy.perSlotBudget else { return false }
+        retriesUsed[slot] = used + 1
+        totalRetriesCount += 1
+        return true
+    }
+
+    private func jittered(_ delay: TimeInterval) -> TimeInterval {
+        guard delay > 0, policy.jitter > 0 else { return delay }
+        lock.lock()
+        defer { lock.unlock() }
+        return delay * Double.random(in: (1 - policy.jitter)...(1 + policy.jitter), using: &rng)
+    }
+
+    /// Run `body`, retrying in place with backoff while its error class allows it.
+    func run<T>(slot: Int, step: String, _ body: () throws -> T) throws -> T {
+        var attempt = 1
+        while true {
+            do {
+                return try body()
+            } catch {
+                let errorClass = RetryErrorClass(error)
+                guard
+                    let rule = policy.rules[errorClass],
+                    attempt < rule.maxAttempts,
+                    !isCancelled(),
+                    consumeBudget(slot: slot)
+                else {
+                    throw error
+                }
+
+                let delay = jittered(policy.delay(for: rule, attempt: attempt))
+                os_log(
+                    "%{public}@ for slot %{public}d failed (%{public}@), retrying in %.1fs: %{public}@",
+                    log: Self.log,
+                    type: .info,
+                    step,
+                    slot,
+                    errorClass.rawValue,
+                    delay,
+                    error.localizedDescription
+                )
+                sleep(delay)
+                attempt += 1
+            }
+        }
+    }
+
+    /// Whether a slot that failed with `error` should go to the deferred queue.
+    func shouldDefer(slot: Int, error: Error) -> Bool {
+        guard let rule = policy.rules[RetryErrorClass(error)], rule.deferrable, !isCancelled() else {
+            return false
+        }
+        return consumeBudget(slot: slot)
+    }
+}
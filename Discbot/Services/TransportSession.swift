@@ -0,0 +1,269 @@
+//
+//  TransportSession.swift
+//  Discbot
+//
+//  Record and replay changer transport sessions
+//
+
+import Foundation
+
+/// One transport command and its outcome, as stored in a session file.
+struct TransportExchange: Codable, Equatable {
+    let command: FaultInjectingTransport.Command
+    let arguments: [Int]
+    /// "ok", "notOpen", "empty", "busy", "timeout", "checkCondition" or "failed"
+    let outcome: String
+    let sense: SenseData?
+    let message: String?
+    let durationSeconds: Double
+    var deviceInfo: [String]?
+    var layout: ChangerElementLayout?
+    var status: ChangerElementStatusReport?
+
+    fileprivate init(command: FaultInjectingTransport.Command, arguments: [Int], error: Error?, durationSeconds: Double) {
+        self.command = command
+        self.arguments = arguments
+        self.durationSeconds = durationSeconds
+        (outcome, sense, message) = TransportExchange.describe(error)
+    }
+
+    private static func describe(_ error: Error?) -> (String, SenseData?, String?) {
+        guard let error = error else { return ("ok", nil, nil) }
+        switch error as? ChangerTransportError {
+        case .notOpen?: return ("notOpen", nil, nil)
+        case .empty?: return ("empty", nil, nil)
+        case .busy?: return ("busy", nil, nil)
+        case .timeout?: return ("timeout", nil, nil)
+        case .checkCondition(let data)?: return ("checkCondition", data, nil)
+        case .failed(let code)?: return ("failed", nil, code)
+        case nil: return ("failed", nil, error.localizedDescription)
+        }
+    }
+
+    /// The recorded failure, or nil when the command succeeded.
+    fileprivate var error: ChangerTransportError? {
+        switch outcome {
+        case "ok": return nil
+        case "notOpen": return .notOpen
+        case "empty": return .empty
+        case "busy": return .busy
+        case "timeout": return .timeout
+        case "checkCondition": return .checkCondition(sense ?? .positioningError)
+        default: return .failed(message ?? outcome)
+        }
+    }
+}
+
+// MARK: - Recording
+
+/// Passes commands through to another transport and appends each exchange to a
+/// JSON session file that ReplayTransport can play back later.
+final class RecordingTransport: ChangerTransport {
+    private let base: ChangerTransport
+    private let url: URL
+    private var exchanges: [TransportExchange] = []
+
+    init(base: ChangerTransport, url: URL) {
+        self.base = base
+        self.url = url
+    }
+
+    private func record<T>(
+        _ command: FaultInjectingTransport.Command,
+        _ arguments: [Int] = [],
+        _ body: () throws -> T,
+        annotate: (T, inout TransportExchange) -> Void = { _, _ in }
+    ) throws -> T {
+        let started = Date()
+        do {
+            let value = try body()
+            var exchange = TransportExchange(
+                command: command, arguments: arguments, error: nil,
+                durationSeconds: Date().timeIntervalSince(started)
+            )
+            annotate(value, &exchange)
+            exchanges.append(exchange)
+            save()
+            return value
+        } catch {
+            exchanges.append(TransportExchange(
+                command: command, arguments: arguments, error: error,
+                durationSeconds: Date().timeIntervalSince(started)
+            ))
+            save()
+            throw error
+        }
+    }
+
+    /// Rewrite the whole session so it survives a crash mid-batch.
+    private func save() {
+        do {
+            let encoder = JSONEncoder()
+            encoder.outputFormatting = .prettyPrinted
+            try encoder.encode(exchanges).write(to: url, options: .atomic)
+        } catch {
+            print("RecordingTransport: failed to write \(url.path): \(error)")
+        }
+    }
+
+    func open() throws {
+        try base.open()
+    }
+
+    func close() {
+        base.close()
+    }
+
+    func inquiry() throws -> ChangerService.ChangerDeviceInfo {
+        try record(.inquiry, [], { try base.inquiry() }, annotate: { info, exchange in
+            exchange.deviceInfo = [info.vendor, info.product, info.revision]
+        })
+    }
+
+    func readElementMap() throws -> ChangerElementLayout {
+        try record(.readElementMap, [], { try base.readElementMap() }, annotate: { $1.layout = $0 })
+    }
+
+    func readElementStatus() throws -> ChangerElementStatusReport {
+        try record(.readElementStatus, [], { try base.readElementStatus() }, annotate: { $1.status = $0 })
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        try record(.loadSlot, [slotNumber]) { try base.loadSlot(slotNumber) }
+    }
+
+    func unloadDrive(toSlot slotNumber: Int) throws {
+        try record(.unloadDrive, [slotNumber]) { try base.unloadDrive(toSlot: slotNumber) }
+    }
+
+    func exportSlot(_ slotNumber: Int) throws {
+        try record(.exportSlot, [slotNumber]) { try base.exportSlot(slotNumber) }
+    }
+
+    func moveMedium(transport: UInt16, source: UInt16, destination: UInt16) throws {
+        try record(.moveMedium, [Int(transport), Int(source), Int(destination)]) {
+            try base.moveMedium(transport: transport, source: source, destination: destination)
+        }
+    }
+}
+
+// MARK: - Replay
+
+/// Plays a recorded session back in order. A command that differs from the
+/// recording fails with a "replay diverged" error rather than guessing.
+final class ReplayTransport: ChangerTransport {
+    private let lock = NSLock()
+    private let exchanges: [TransportExchange]
+    private var position = 0
+    private let sleep: ((TimeInterval) -> Void)?
+
+    /// - Parameter sleep: When set, called with each exchange's recorded duration so replays keep their timing.
+    init(exchanges: [TransportExchange], sleep: ((TimeInterval) -> Void)? = nil) {
+        self.exchanges = exchanges
+        self.sleep = sleep
+    }
+
+    convenience init(contentsOf url: URL, sleep: ((TimeInterval) -> Void)? = nil) throws {
+        let data = try Data(contentsOf: url)
+        self.init(exchanges: try JSONDecoder().decode([TransportExchange].self, from: data), sleep: sleep)
+    }
+
+    var remainingCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return exchanges.count - position
+    }
+
+    private func next(_ command: FaultInjectingTransport.Command, _ arguments: [Int] = []) throws -> TransportExchange {
+        lock.lock()
+        guard position < exchanges.count else {
+            lock.unlock()
+            throw ChangerTransportError.failed("replay exhausted at \(command.rawValue)")
+        }
+        let exchange = exchanges[position]
+        guard exchange.command == command, exchange.arguments == arguments else {
+            lock.unlock()
+            throw ChangerTransportError.failed(
+                "replay diverged at #\(position): expected \(exchange.command.rawValue)\(exchange.arguments), got \(command.rawValue)\(arguments)"
+            )
+        }
+        position += 1
+        lock.unlock()
+
+        sleep?(exchange.durationSeconds)
+        if let error = exchange.error {
+            throw error
+        }
+        return exchange
+    }
+
+    func open() throws {}
+
+    func close() {}
+
+    func inquiry() throws -> ChangerService.ChangerDeviceInfo {
+        let exchange = try next(.inquiry)
+        guard let info = exchange.deviceInfo, info.count == 3 else {
+            throw ChangerTransportError.failed("replay: INQUIRY without device info")
+        }
+        return ChangerService.ChangerDeviceInfo(vendor: info[0], product: info[1], revision: info[2])
+    }
+
+    func readElementMap() throws -> ChangerElementLayout {
+        guard let layout = try next(.readElementMap).layout else {
+            throw ChangerTransportError.failed("replay: element map missing")
+        }
+        return layout
+    }
+
+    func readElementStatus() throws -> ChangerElementStatusReport {
+        guard let status = try next(.readElementStatus).status else {
+            throw ChangerTransportError.failed("replay: element status missing")
+        }
+        return status
+    }
+
+    func loadSlot(_ slotNumber: Int) throws {
+        _ = try next(.loadSlot, [slotNumber])
+    }
+
+    func unloadDrive(toSlot slotNumber: Int) throws {
+        _ = try next(.unloadDrive, [slotNumber])
+    }
+
+    func exportSlot(_ slotNumber: Int) throws {
+        _ = try next(.exportSlot, [slotNumber])
+    }
+
+    func moveMedium(transport: UInt16, source: UInt16, destination: UInt16) throws {
+        _ = try next(.moveMedium, [Int(transport), Int(source), Int(destination)])
+    }
+}
+
+// MARK: - Launch Options
+
+#if !DISCBOT_NO_HARDWARE
+extension ChangerService {
+    /// Hardware-backed service, optionally recording or replaying its transport.
+    ///
+    /// Launch with `-DiscbotRecordTransport <path>` to record a hardware session or
+    /// `-DiscbotReplayTransport <path>` to drive the app from a recording. The hardware
+    /// services hold `ChangerLock.shared` while connected.
+    static func makeDefault(defaults: UserDefaults = .standard) -> ChangerService {
+        if let path = defaults.string(forKey: "DiscbotReplayTransport") {
+            do {
+                return ChangerService(transport: try ReplayTransport(contentsOf: URL(fileURLWithPath: path)))
+            } catch {
+                print("ChangerService: cannot load replay session \(path): \(error)")
+            }
+        }
+        if let path = defaults.string(forKey: "DiscbotRecordTransport") {
+            return ChangerService(
+                transport: RecordingTransport(base: MChangerTransport(), url: URL(fileURLWithPath: path)),
+                changerLock: .shared
+            )
+        }
+        return ChangerService(changerLock: .shared)
+    }
+}
+#endif
@@ -6,8 +6,12 @@
 //
 
 import Foundation
+#if canImport(Combine)
 import Combine
+#endif
+#if canImport(os)
 import os.log
+#endif
 
 final class BatchOperationState: ObservableObject {
     enum OperationType: Equatable {
@@ -38,14 +42,47 @@ final class BatchOperationState: ObservableObject {
     @Published var overallTransferredBytes: Int64 = 0
     @Published var overallEstimatedTotalBytes: Int64?
     @Published var overallETASeconds: TimeInterval?
+    /// Half-width of the 90% interval around `overallETASeconds`
+    @Published var overallETAMarginSeconds: TimeInterval?
     @Published var averageDiscOperationSeconds: TimeInterval?
 
+    /// Retry rules for Image All; `.none` restores fail-fast behaviour.
+    var retryPolicy: RetryPolicy = .standard
+    /// Extra places Image All writes each image to, fed from the same drive read.
+    var mirrorDestinations: [ImageDestination] = []
+    /// Cache bypass and sync policy for the image files Image All writes.
+    var writeOptions: ImageWriteOptions = .standard
+    /// Read-back check of each data CD and DVD image before the disc is ejected.
+    var verifyMode: ImageVerifyMode = .off
+    /// Overrides how retry backoff waits and seeds its jitter (the benchmark uses the simulator clock).
+    var retrySleep: ((TimeInterval) -> Void)?
+    var retrySeed: UInt64?
+    /// Where load, eject, mount, scan and image timings are logged; nil disables logging.
+    var eventLog: EventLog? = .shared
+    /// Where Image All persists its job and per-slot progress for crash recovery; nil disables it.
+    var jobQueue: JobQueue? = .shared
+    /// Persisted job the run reports to. Set it before running to resume a job;
+    /// otherwise Image All creates one.
+    var jobId: Int64?
+
     private let imagingControl = ImagingService.ImagingControl()
+    /// Learns the running batch's timings; set on the batch thread when a run starts
+    private var etaEstimator: BatchETAEstimator?
     private static let log = OSLog(
         subsystem: Bundle.main.bundleIdentifier ?? "Discbot",
         category: "BatchOperation"
     )
 
+    /// Blocks handed to the main queue by the batch runners (reported by the benchmark suite).
+    var mainDispatchCount: Int {
+        dispatchCountLock.lock()
+        defer { dispatchCountLock.unlock() }
+        return dispatchCount
+    }
+
+    private let dispatchCountLock = NSLock()
+    private var dispatchCount = 0
+
     var progress: Double {
         guard totalCount > 0 else { return 0 }
         return min(1.0, max(0.0, (Double(currentIndex) + imagingProgress) / Double(totalCount)))
@@ -96,10 +133,18 @@ final class BatchOperationState: ObservableObject {
         overallTransferredBytes = 0
         overallEstimatedTotalBytes = nil
         overallETASeconds = nil
+        overallETAMarginSeconds = nil
         averageDiscOperationSeconds = nil
         imagingControl.reset()
     }
 
+    private func onMain(_ block: @escaping () -> Void) {
+        dispatchCountLock.lock()
+        dispatchCount += 1
+        dispatchCountLock.unlock()
+        DispatchQueue.main.async(execute: block)
+    }
+
     private func mountDiscIfAvailable(
         bsdName: String,
         mountService: MountServicing,
@@ -124,6 +169,84 @@ final class BatchOperationState: ObservableObject {
         }
     }
 
+    /// Wait for the loaded disc, and stamp the steps that follow with the device it appeared on
+    private func waitForDisc(_ mountService: MountServicing, timeout: TimeInterval) throws -> String {
+        let bsdName = try mountService.waitForDisc(timeout: timeout)
+        eventLog?.device = bsdName
+        return bsdName
+    }
+
+    /// Run one changer or drive step, logging its timing and outcome to the event log
+    /// and teaching it to the ETA model.
+    private func timed<T>(
+        _ operation: EventRecord.Operation,
+        slot: Int?,
+        bytes: (T) -> Int64? = { _ in nil },
+        _ body: () throws -> T
+    ) rethrows -> T {
+        guard let eventLog = eventLog else { return try body() }
+        let estimator = etaEstimator
+        return try eventLog.measure(operation, slot: slot, bytes: bytes, observe: { estimator?.observe($0) }, body)
+    }
+
+    /// The event log's clock, so ETAs stay in step with the timings they are learned from
+    private var now: Date {
+        eventLog?.clock() ?? Date()
+    }
+
+    /// Start the ETA model for a run from the event log and the catalog's types and sizes of `slotIds`
+    private func startETAEstimator(
+        mode: BatchETAEstimator.Mode,
+        slotIds: [Int],
+        catalogService: CatalogService
+    ) -> BatchETAEstimator {
+        let history = eventLog?.recentEvents(limit: BatchETAEstimator.historyLimit) ?? []
+        let estimator = BatchETAEstimator(mode: mode, history: history, drive: eventLog?.drive)
+        for (slotId, disc) in catalogService.getDiscs(slotIds: slotIds) {
+            estimator.setDisc(slot: slotId, type: disc.discType, sizeBytes: disc.sizeBytes)
+            eventLog?.setDiscType(disc.discType, slot: slotId)
+        }
+        etaEstimator = estimator
+        return estimator
+    }
+
+    /// Publish the ETA between imaging progress reports; an estimate that cannot be made
+    /// yet leaves the last one showing
+    private func publishETA(remainingSlots: [Int], onUpdate: @escaping () -> Void) {
+        guard let estimate = etaEstimator?.estimate(remainingSlots: remainingSlots, now: now) else { return }
+        onMain {
+            self.overallETASeconds = estimate.seconds
+            self.overallETAMarginSeconds = estimate.margin
+            onUpdate()
+        }
+    }
+
+    /// Persist the start of an Image All run, creating its job unless one is being resumed.
+    private func beginJob(slots: [Slot], outputDirectory: URL) {
+        guard let jobQueue = jobQueue else { return }
+        if jobId == nil {
+            jobId = jobQueue.createJob(kind: .imageAll, outputDirectory: outputDirectory.path)
+        }
+        if let jobId = jobId {
+            jobQueue.beginJob(jobId, slotIds: slots.map(\.id))
+        }
+    }
+
+    /// Persist a task transition; `nil` state means the slot is being attempted.
+    private func recordTask(_ slot: Int, _ state: JobTaskRecord.State?, error: String? = nil) {
+        guard let jobQueue = jobQueue, let jobId = jobId else { return }
+        if let state = state {
+            jobQueue.finishTask(jobId: jobId, slot: slot, state: state, error: error)
+        } else {
+            jobQueue.beginTask(jobId: jobId, slot: slot)
+        }
+    }
+
+    private func finishJob(_ state: JobRecord.State) {
+        guard let jobQueue = jobQueue, let jobId = jobId else { return }
+        jobQueue.finishJob(jobId, state: state)
+    }
+
     private func logFailure(_ context: String, slot: Int? = nil, error: Error) {
         if let slot = slot {
             os_log(
@@ -158,7 +281,7 @@ final class BatchOperationState: ObservableObject {
         let occupiedSlots = slots.filter { $0.isFull && !$0.isInDrive }
         guard !occupiedSlots.isEmpty else { return }
 
-        DispatchQueue.main.async { [weak self] in
+        onMain { [weak self] in
             self?.operationType = .loadAll
             self?.isRunning = true
             self?.isCancelled = false
@@ -174,14 +297,14 @@ final class BatchOperationState: ObservableObject {
 
             for slot in occupiedSlots {
                 if self.isCancelled {
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.statusText = "Cancelled after \(self.currentIndex) disc(s)"
                         onUpdate()
                     }
                     break
                 }
 
-                DispatchQueue.main.async {
+                self.onMain {
                     self.currentSlot = slot.id
                     self.statusText = "Loading slot \(slot.id)..."
                     onUpdate()
@@ -189,22 +312,26 @@ final class BatchOperationState: ObservableObject {
 
                 do {
                     // Load disc
-                    try changerService.loadSlot(slot.id)
+                    try self.timed(.load, slot: slot.id) {
+                        try changerService.loadSlot(slot.id)
+                    }
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.statusText = "Waiting for disc..."
                         onUpdate()
                     }
 
                     // Wait for disc and mount (if it has a filesystem)
-                    let bsdName = try mountService.waitForDisc(timeout: 60)
-                    let mountPoint = try mountDiscIfAvailable(
-                        bsdName: bsdName,
-                        mountService: mountService,
-                        allowMountless: false
-                    )
+                    let bsdName = try self.waitForDisc(mountService, timeout: 60)
+                    let mountPoint = try self.timed(.mount, slot: slot.id) {
+                        try self.mountDiscIfAvailable(
+                            bsdName: bsdName,
+                            mountService: mountService,
+                            allowMountless: false
+                        )
+                    }
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         if let mountPoint = mountPoint {
                             self.statusText = "Mounted at \(mountPoint)"
                         } else {
@@ -214,18 +341,22 @@ final class BatchOperationState: ObservableObject {
                         onUpdate()
                     }
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.statusText = "Ejecting slot \(slot.id)..."
                         onUpdate()
                     }
 
                     // Unmount and eject
                     if mountService.isMounted(bsdName: bsdName) {
-                        try mountService.unmountDisc(bsdName: bsdName)
+                        try self.timed(.unmount, slot: slot.id) {
+                            try mountService.unmountDisc(bsdName: bsdName)
+                        }
+                    }
+                    try self.timed(.eject, slot: slot.id) {
+                        try changerService.ejectToSlot(slot.id)
                     }
-                    try changerService.ejectToSlot(slot.id)
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.completedSlots.append(slot.id)
                         onSlotEjected(slot.id)
                         onUpdate()
@@ -233,19 +364,19 @@ final class BatchOperationState: ObservableObject {
 
                 } catch {
                     self.logFailure("batch load", slot: slot.id, error: error)
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.failedSlots.append((slot.id, error.localizedDescription))
                         onUpdate()
                     }
                 }
 
-                DispatchQueue.main.async {
+                self.onMain {
                     self.currentIndex += 1
                     onUpdate()
                 }
             }
 
-            DispatchQueue.main.async {
+            self.onMain {
                 self.isRunning = false
                 if !self.isCancelled {
                     self.statusText = "Complete: \(self.completedSlots.count) successful, \(self.failedSlots.count) failed"
@@ -256,6 +387,36 @@ final class BatchOperationState: ObservableObject {
         }
     }
 
+    /// Outcome of one attempt at imaging a slot.
+    private enum SlotOutcome {
+        case completed
+        case failed
+        case deferred
+        case cancelled
+    }
+
+    /// Mutable state shared by the slots of one Image All run.
+    private final class ImageAllRun {
+        let outputDirectory: URL
+        let retry: RetryEngine
+        var completedBytes: Int64 = 0
+        /// Slots still to come after the current one, in order
+        var pendingSlotIds: [Int] = []
+
+        init(outputDirectory: URL, retry: RetryEngine) {
+            self.outputDirectory = outputDirectory
+            self.retry = retry
+        }
+    }
+
+    /// Sleep for a retry backoff, waking early if the batch is cancelled.
+    private func backoffSleep(_ seconds: TimeInterval) {
+        let deadline = Date().addingTimeInterval(seconds)
+        while !isCancelled && Date() < deadline {
+            Thread.sleep(forTimeInterval: min(0.25, deadline.timeIntervalSinceNow))
+        }
+    }
+
     /// Run batch image operation on background thread
     func runImageAll(
         slots: [Slot],
@@ -273,7 +434,7 @@ final class BatchOperationState: ObservableObject {
         let occupiedSlots = slots.filter { $0.isFull || $0.isInDrive }
         guard !occupiedSlots.isEmpty else { return }
 
-        DispatchQueue.main.async { [weak self] in
+        onMain { [weak self] in
             self?.operationType = .imageAll(outputDirectory: outputDirectory)
             self?.isRunning = true
             self?.isCancelled = false
@@ -290,14 +451,26 @@ final class BatchOperationState: ObservableObject {
             self?.overallTransferredBytes = 0
             self?.overallEstimatedTotalBytes = nil
             self?.overallETASeconds = nil
+            self?.overallETAMarginSeconds = nil
             self?.averageDiscOperationSeconds = nil
             self?.imagingControl.reset()
         }
 
         DispatchQueue.global(qos: .userInitiated).async { [weak self] in
             guard let self = self else { return }
-            var completedBytes: Int64 = 0
-            var knownDiscSizes: [Int64] = []
+            let retry = RetryEngine(
+                policy: self.retryPolicy,
+                seed: self.retrySeed ?? UInt64(Date().timeIntervalSince1970),
+                sleep: self.retrySleep ?? { [weak self] in self?.backoffSleep($0) },
+                isCancelled: { [weak self] in self?.isCancelled ?? true }
+            )
+            let run = ImageAllRun(outputDirectory: outputDirectory, retry: retry)
+            self.beginJob(slots: occupiedSlots, outputDirectory: outputDirectory)
+            _ = self.startETAEstimator(
+                mode: .image(verify: self.verifyMode),
+                slotIds: occupiedSlots.map(\.id),
+                catalogService: catalogService
+            )
 
             // Eject any disc currently in the drive before starting
             do {
@@ -305,13 +478,14 @@ final class BatchOperationState: ObservableObject {
                 if driveStatus?.hasDisc == true {
                     let sourceSlot = driveStatus?.sourceSlot ?? driveFallbackSourceSlot
                     guard let sourceSlot else {
-                        DispatchQueue.main.async {
+                        self.finishJob(.failed)
+                        self.onMain {
                             self.isCancelled = true
                             self.statusText = "Drive contains a disc with unknown source slot. Eject it first, then retry."
                             self.failedSlots.append((0, "Drive not empty (source slot unknown)"))
                             onUpdate()
                         }
-                        DispatchQueue.main.async {
+                        self.onMain {
                             self.isRunning = false
                             self.isPaused = false
                             onUpdate()
@@ -324,7 +498,7 @@ final class BatchOperationState: ObservableObject {
                         try? mountService.unmountDisc(bsdName: bsdName, force: true)
                     }
                     try changerService.ejectToSlot(sourceSlot)
-                    DispatchQueue.main.async {
+                    self.onMain {
                         onSlotEjected(sourceSlot)
                     }
                 }
@@ -333,247 +507,453 @@ final class BatchOperationState: ObservableObject {
                 // Best effort - continue even if eject fails
             }
 
-            for slot in occupiedSlots {
+            let attempt = { (slot: Slot, allowDefer: Bool) -> SlotOutcome in
+                self.attemptImageSlot(
+                    slot,
+                    run: run,
+                    allowDefer: allowDefer,
+                    changerService: changerService,
+                    mountService: mountService,
+                    imagingService: imagingService,
+                    catalogService: catalogService,
+                    onUpdate: onUpdate,
+                    onSlotLoaded: onSlotLoaded,
+                    onSlotEjected: onSlotEjected
+                )
+            }
+
+            var deferredSlots: [Slot] = []
+            var cancelled = false
+
+            for (index, slot) in occupiedSlots.enumerated() {
                 if self.isCancelled {
-                    DispatchQueue.main.async {
-                        self.statusText = "Cancelled after \(self.currentIndex) disc(s)"
-                        onUpdate()
-                    }
+                    cancelled = true
                     break
                 }
 
-                // Track imaging path for failure recording
-                var attemptedOutputPath: URL?
+                run.pendingSlotIds = occupiedSlots[(index + 1)...].map(\.id)
+                // Without deferred passes a deferred slot would never be retried or failed
+                let outcome = attempt(slot, retry.policy.deferredPasses > 0)
+                if outcome == .cancelled || (outcome == .completed && self.isCancelled) {
+                    cancelled = true
+                    break
+                }
+                if outcome == .deferred {
+                    deferredSlots.append(slot)
+                }
 
-                DispatchQueue.main.async {
-                    self.currentSlot = slot.id
-                    self.statusText = "Loading slot \(slot.id)..."
-                    self.imagingProgress = 0
+                self.onMain {
+                    self.currentIndex += 1
+                    self.currentDiscTransferredBytes = 0
+                    self.currentDiscTotalBytes = nil
+                    self.currentDiscSpeedBytesPerSecond = 0
+                    self.currentDiscETASeconds = nil
+                    self.currentDiscName = nil
                     onUpdate()
                 }
+            }
 
-                do {
-                    // Load disc
-                    try changerService.loadSlot(slot.id)
-
-                    DispatchQueue.main.async {
-                        self.statusText = "Waiting for disc..."
-                        onUpdate()
+            // Slots that failed transiently get another go once everything else is done.
+            var pass = 1
+            while !cancelled && !deferredSlots.isEmpty && pass <= retry.policy.deferredPasses {
+                let isLastPass = pass == retry.policy.deferredPasses
+                var stillDeferred: [Slot] = []
+                for (index, slot) in deferredSlots.enumerated() {
+                    if self.isCancelled {
+                        cancelled = true
+                        break
                     }
-
-                    // Wait for disc, detect media type, then mount.
-                    let bsdName = try mountService.waitForDisc(timeout: 60)
-                    let discType = imagingService.detectDiscType(bsdName: bsdName)
-                    let mountPoint = try mountDiscIfAvailable(
-                        bsdName: bsdName,
-                        mountService: mountService,
-                        allowMountless: (discType == .audioCDDA)
-                    )
-
-                    DispatchQueue.main.async {
-                        if mountPoint != nil {
-                            self.statusText = "Mounted, detecting disc type..."
-                        } else {
-                            self.statusText = "Disc ready, detecting disc type..."
-                        }
-                        onSlotLoaded(slot.id, bsdName, mountPoint)
+                    run.pendingSlotIds = deferredSlots[(index + 1)...].map(\.id)
+                    self.onMain {
+                        self.statusText = "Retrying slot \(slot.id)..."
                         onUpdate()
                     }
-
-                    // Get volume name for filename
-                    let volumeName = mountService.getVolumeName(bsdName: bsdName) ?? "Disc_Slot\(slot.id)"
-                    let safeVolumeName = volumeName.replacingOccurrences(of: "/", with: "_")
-                        .replacingOccurrences(of: ":", with: "_")
-                    let estimatedSize = imagingService.estimateDiscSizeBytes(bsdName: bsdName)
-                    if let estimatedSize = estimatedSize {
-                        knownDiscSizes.append(estimatedSize)
+                    let outcome = attempt(slot, !isLastPass)
+                    if outcome == .cancelled || (outcome == .completed && self.isCancelled) {
+                        cancelled = true
+                        break
+                    }
+                    if outcome == .deferred {
+                        stillDeferred.append(slot)
                     }
+                }
+                deferredSlots = stillDeferred
+                pass += 1
+            }
 
-                    // Record disc in catalog
-                    _ = catalogService.recordDisc(
-                        slotId: slot.id,
-                        bsdName: bsdName,
-                        discType: discType,
-                        sizeBytes: estimatedSize
-                    )
+            if cancelled {
+                self.onMain {
+                    self.isCancelled = true
+                    self.isPaused = false
+                    self.statusText = "Cancelled after \(self.currentIndex) disc(s)"
+                    onUpdate()
+                }
+            }
+            self.finishJob(cancelled || self.isCancelled ? .cancelled : .completed)
 
-                    DispatchQueue.main.async {
-                        self.statusText = "Imaging \(safeVolumeName)..."
-                        self.currentDiscName = safeVolumeName
-                        self.currentDiscTransferredBytes = 0
-                        self.currentDiscTotalBytes = estimatedSize
-                        self.currentDiscSpeedBytesPerSecond = 0
-                        self.currentDiscETASeconds = nil
-                        onUpdate()
-                    }
+            self.onMain {
+                self.isRunning = false
+                self.isPaused = false
+                if !self.isCancelled {
+                    let retries = retry.totalRetries
+                    self.statusText = "Complete: \(self.completedSlots.count) imaged, \(self.failedSlots.count) failed"
+                        + (retries > 0 ? " (\(retries) retries)" : "")
+                }
+                onUpdate()
+                onComplete()
+            }
+        }
+    }
 
-                    // Unmount before imaging (hdiutil needs raw access)
-                    if mountService.isMounted(bsdName: bsdName) {
-                        try mountService.unmountDisc(bsdName: bsdName, force: true)
-                    }
+    /// Image one slot, then sort out what happens to it if anything failed:
+    /// cancelled, deferred to the end of the batch, or recorded as failed.
+    private func attemptImageSlot(
+        _ slot: Slot,
+        run: ImageAllRun,
+        allowDefer: Bool,
+        changerService: ChangerServicing,
+        mountService: MountServicing,
+        imagingService: ImagingServicing,
+        catalogService: CatalogService,
+        onUpdate: @escaping () -> Void,
+        onSlotLoaded: @escaping (Int, String, String?) -> Void,
+        onSlotEjected: @escaping (Int) -> Void
+    ) -> SlotOutcome {
+        // Track the disc and imaging path for failure recording
+        var attemptedDisc: DiscRecord?
+        var attemptedImageURL: URL?
+        recordTask(slot.id, nil)
+        etaEstimator?.beginSlot(slot.id, at: now)
+        publishETA(remainingSlots: run.pendingSlotIds, onUpdate: onUpdate)
+        defer { etaEstimator?.endSlot() }
 
-                    // Create image
-                    let outputPath = outputDirectory.appendingPathComponent(safeVolumeName)
-                    attemptedOutputPath = outputPath
-                    let _ = try imagingService.createImage(
-                        bsdName: bsdName,
-                        discType: discType,
-                        outputPath: outputPath,
-                        totalBytes: estimatedSize,
-                        control: self.imagingControl,
-                        progress: { progress in
-                            DispatchQueue.main.async {
-                                self.imagingProgress = progress.fractionCompleted
-                                self.currentDiscTransferredBytes = progress.bytesTransferred
-                                self.currentDiscTotalBytes = progress.totalBytes
-                                self.currentDiscSpeedBytesPerSecond = progress.speedBytesPerSecond ?? 0
-                                self.currentDiscETASeconds = progress.etaSeconds
-
-                                let remainingAfterCurrent = max(self.totalCount - self.currentIndex - 1, 0)
-                                let averageDiscSize = knownDiscSizes.isEmpty ? nil : (knownDiscSizes.reduce(Int64(0), +) / Int64(knownDiscSizes.count))
-                                let estimatedRemaining = averageDiscSize.map { $0 * Int64(remainingAfterCurrent) } ?? 0
-                                let totalEstimate: Int64? = {
-                                    guard let estimatedSize = estimatedSize else { return nil }
-                                    return completedBytes + estimatedSize + estimatedRemaining
-                                }()
-                                let overallTransferred = completedBytes + progress.bytesTransferred
-
-                                self.overallTransferredBytes = overallTransferred
-                                self.overallEstimatedTotalBytes = totalEstimate
-                                if
-                                    let totalEstimate = totalEstimate,
-                                    let speed = progress.speedBytesPerSecond,
-                                    speed > 0
-                                {
-                                    self.overallETASeconds = max(Double(totalEstimate - overallTransferred) / speed, 0)
-                                } else {
-                                    self.overallETASeconds = nil
-                                }
-
-                                let percent = Int(progress.fractionCompleted * 100)
-                                self.statusText = self.isPaused
-                                    ? "Imaging \(safeVolumeName)... paused at \(percent)%"
-                                    : "Imaging \(safeVolumeName)... \(percent)%"
-                                onUpdate()
-                            }
-                        }
-                    )
+        do {
+            try imageSlot(
+                slot,
+                run: run,
+                attemptedDisc: &attemptedDisc,
+                attemptedImageURL: &attemptedImageURL,
+                changerService: changerService,
+                mountService: mountService,
+                imagingService: imagingService,
+                catalogService: catalogService,
+                onUpdate: onUpdate,
+                onSlotLoaded: onSlotLoaded,
+                onSlotEjected: onSlotEjected
+            )
+            recordTask(slot.id, .completed)
+            return .completed
+        } catch {
+            logFailure("batch image", slot: slot.id, error: error)
+            let imagingCancelled: Bool = {
+                guard let imagingError = error as? ImagingError else { return false }
+                if case .cancelled = imagingError {
+                    return true
+                }
+                return false
+            }()
 
-                    completedBytes += estimatedSize ?? 0
+            let changerCancelled: Bool = {
+                guard let changerError = error as? ChangerError else { return false }
+                if case .cancelled = changerError {
+                    return true
+                }
+                return false
+            }()
 
-                    // Record successful backup in catalog
-                    let isoPath = outputPath.appendingPathExtension("iso")
-                    let fileSize = try? FileManager.default.attributesOfItem(atPath: isoPath.path)[.size] as? Int64
-                    catalogService.recordBackupCompleted(
-                        slotId: slot.id,
-                        backupPath: isoPath.path,
-                        backupSizeBytes: fileSize
-                    )
+            if imagingCancelled || changerCancelled || isCancelled {
+                if let disc = attemptedDisc {
+                    catalogService.recordImagingResult(disc, backupPath: nil)
+                }
+                // Not done: a resumed job picks this slot up again
+                recordTask(slot.id, .pending)
+                return .cancelled
+            }
 
-                    DispatchQueue.main.async {
-                        self.statusText = "Ejecting slot \(slot.id)..."
-                        onUpdate()
-                    }
+            let deferred = allowDefer && run.retry.shouldDefer(slot: slot.id, error: error)
+            recordTask(slot.id, deferred ? .deferred : .failed, error: error.localizedDescription)
+            if deferred {
+                onMain {
+                    self.statusText = "Slot \(slot.id) failed, will retry at end of batch: \(error.localizedDescription)"
+                    onUpdate()
+                }
+            } else {
+                onMain {
+                    self.failedSlots.append((slot.id, error.localizedDescription))
+                    onUpdate()
+                }
+            }
 
-                    // Eject disc back to slot
-                    try changerService.ejectToSlot(slot.id)
+            // Record the disc, plus the failed backup if we got far enough to start imaging
+            // and the slot is not coming back for another attempt. Every image that failed
+            // its read-back is recorded, deferred or not, so each bad read stays on file.
+            if let disc = attemptedDisc {
+                var mismatched = false
+                if case ImagingError.verificationFailed? = error as? ImagingError {
+                    mismatched = true
+                }
+                catalogService.recordImagingResult(
+                    disc,
+                    backupPath: deferred && !mismatched ? nil : attemptedImageURL?.path,
+                    verified: mismatched ? false : nil,
+                    error: error.localizedDescription
+                )
+            }
 
-                    DispatchQueue.main.async {
-                        self.completedSlots.append(slot.id)
-                        self.imagingProgress = 0
-                        onSlotEjected(slot.id)
-                        onUpdate()
+            // Try to eject disc if loaded
+            do {
+                if let bsdName = mountService.findDiscBSDName(), mountService.isMounted(bsdName: bsdName) {
+                    try? mountService.unmountDisc(bsdName: bsdName, force: true)
+                }
+                try run.retry.run(slot: slot.id, step: "cleanup eject") {
+                    try timed(.eject, slot: slot.id) {
+                        try changerService.ejectToSlot(slot.id)
                     }
+                }
+                onMain {
+                    onSlotEjected(slot.id)
+                }
+            } catch {
+                logFailure("batch image cleanup eject", slot: slot.id, error: error)
+                // Ignore eject errors
+            }
+            return deferred ? .deferred : .failed
+        }
+    }
 
-                    if self.isCancelled {
-                        DispatchQueue.main.async {
-                            self.statusText = "Cancelled after \(self.currentIndex) disc(s)"
-                            onUpdate()
-                        }
-                        break
-                    }
+    /// Load, catalog, image and return a single slot.
+    private func imageSlot(
+        _ slot: Slot,
+        run: ImageAllRun,
+        attemptedDisc: inout DiscRecord?,
+        attemptedImageURL: inout URL?,
+        changerService: ChangerServicing,
+        mountService: MountServicing,
+        imagingService: ImagingServicing,
+        catalogService: CatalogService,
+        onUpdate: @escaping () -> Void,
+        onSlotLoaded: @escaping (Int, String, String?) -> Void,
+        onSlotEjected: @escaping (Int) -> Void
+    ) throws {
+        let retry = run.retry
+
+        onMain {
+            self.currentSlot = slot.id
+            self.statusText = "Loading slot \(slot.id)..."
+            self.imagingProgress = 0
+            onUpdate()
+        }
 
-                } catch {
-                    self.logFailure("batch image", slot: slot.id, error: error)
-                    let imagingCancelled: Bool = {
-                        guard let imagingError = error as? ImagingError else { return false }
-                        if case .cancelled = imagingError {
-                            return true
-                        }
-                        return false
-                    }()
+        // Load disc
+        try retry.run(slot: slot.id, step: "load") {
+            try timed(.load, slot: slot.id) {
+                try changerService.loadSlot(slot.id)
+            }
+        }
 
-                    let changerCancelled: Bool = {
-                        guard let changerError = error as? ChangerError else { return false }
-                        if case .cancelled = changerError {
-                            return true
-                        }
-                        return false
-                    }()
+        onMain {
+            self.statusText = "Waiting for disc..."
+            onUpdate()
+        }
 
-                    if imagingCancelled || changerCancelled || self.isCancelled {
-                        DispatchQueue.main.async {
-                            self.isCancelled = true
-                            self.isPaused = false
-                            self.statusText = "Cancelled after \(self.currentIndex) disc(s)"
-                            onUpdate()
-                        }
-                        break
-                    }
+        // Wait for disc and detect media type. The TOC gives the CD layout in one ioctl,
+        // and the label comes from the raw volume descriptors when they can be read;
+        // mounting is only the fallback, since hdiutil needs the device unmounted again
+        // before imaging.
+        let bsdName = try retry.run(slot: slot.id, step: "wait for disc") {
+            try waitForDisc(mountService, timeout: 60)
+        }
+        let identity = timed(.scan, slot: slot.id) {
+            imagingService.identifyDisc(bsdName: bsdName)
+        }
+        let discType = identity.discType
+        let mountPoint: String?
+        if identity.volumeInfo != nil || discType == .audioCDDA {
+            mountPoint = mountService.getMountPoint(bsdName: bsdName)
+        } else {
+            mountPoint = try retry.run(slot: slot.id, step: "mount") {
+                try timed(.mount, slot: slot.id) {
+                    try mountDiscIfAvailable(
+                        bsdName: bsdName,
+                        mountService: mountService,
+                        allowMountless: (discType == .audioCDDA)
+                    )
+                }
+            }
+        }
 
-                    DispatchQueue.main.async {
-                        self.failedSlots.append((slot.id, error.localizedDescription))
-                        onUpdate()
-                    }
+        onMain {
+            if mountPoint != nil {
+                self.statusText = "Mounted, detecting disc type..."
+            } else {
+                self.statusText = "Disc ready, detecting disc type..."
+            }
+            onSlotLoaded(slot.id, bsdName, mountPoint)
+            onUpdate()
+        }
 
-                    // Record failed backup if we got far enough to start imaging
-                    if let outputPath = attemptedOutputPath {
-                        catalogService.recordBackupFailed(
-                            slotId: slot.id,
-                            backupPath: outputPath.appendingPathExtension("iso").path,
-                            error: error.localizedDescription
-                        )
-                    }
+        // Get volume name for filename
+        let rawLabel = identity.label
+        let volumeName = rawLabel ?? mountService.getVolumeName(bsdName: bsdName) ?? "Disc_Slot\(slot.id)"
+        let safeVolumeName = volumeName.replacingOccurrences(of: "/", with: "_")
+            .replacingOccurrences(of: ":", with: "_")
+        let estimatedSize = identity.sizeBytes
+        let completedBytes = run.completedBytes
+        let pendingSlotIds = run.pendingSlotIds
+
+        // Catalog record for the disc; written together with the backup once imaging ends
+        let disc = catalogService.discRecord(
+            slotId: slot.id,
+            bsdName: bsdName,
+            discType: discType,
+            sizeBytes: estimatedSize,
+            volumeLabel: rawLabel,
+            toc: identity.toc,
+            fingerprint: identity.fingerprint
+        )
+        attemptedDisc = disc
+        etaEstimator?.setDisc(slot: slot.id, type: disc.discType, sizeBytes: estimatedSize)
+        eventLog?.setDiscType(disc.discType, slot: slot.id)
+
+        onMain {
+            self.statusText = "Imaging \(safeVolumeName)..."
+            self.currentDiscName = safeVolumeName
+            self.currentDiscTransferredBytes = 0
+            self.currentDiscTotalBytes = estimatedSize
+            self.currentDiscSpeedBytesPerSecond = 0
+            self.currentDiscETASeconds = nil
+            onUpdate()
+        }
 
-                    // Try to eject disc if loaded
-                    do {
-                        if let bsdName = mountService.findDiscBSDName(), mountService.isMounted(bsdName: bsdName) {
-                            try? mountService.unmountDisc(bsdName: bsdName, force: true)
-                        }
-                        try changerService.ejectToSlot(slot.id)
-                        DispatchQueue.main.async {
-                            onSlotEjected(slot.id)
-                        }
-                    } catch {
-                        self.logFailure("batch image cleanup eject", slot: slot.id, error: error)
-                        // Ignore eject errors
-                    }
+        // Unmount before imaging (hdiutil needs raw access). On the mount-free path
+        // this only happens when Disk Arbitration auto-mounted the disc.
+        if mountService.isMounted(bsdName: bsdName) {
+            try retry.run(slot: slot.id, step: "unmount") {
+                try timed(.unmount, slot: slot.id) {
+                    try mountService.unmountDisc(bsdName: bsdName, force: true)
                 }
+            }
+        }
 
-                DispatchQueue.main.async {
-                    self.currentIndex += 1
-                    self.currentDiscTransferredBytes = 0
-                    self.currentDiscTotalBytes = nil
-                    self.currentDiscSpeedBytesPerSecond = 0
-                    self.currentDiscETASeconds = nil
-                    self.currentDiscName = nil
-                    onUpdate()
+        // Create image
+        let outputPath = run.outputDirectory.appendingPathComponent(safeVolumeName)
+        // Where every imaging service writes it; a label such as "DISC.V1" loses its last extension
+        attemptedImageURL = outputPath.deletingPathExtension().appendingPathExtension("iso")
+        let imageURL = try timed(.image, slot: slot.id, bytes: { _ in estimatedSize }) {
+            try imagingService.createImage(
+                bsdName: bsdName,
+                discType: discType,
+                outputPath: outputPath,
+                mirrors: mirrorDestinations,
+                writeOptions: writeOptions,
+                totalBytes: estimatedSize,
+                control: imagingControl,
+                progress: { progress in
+                    // The rest of this disc at its live speed, then the pending slots as learned
+                    let estimate = self.etaEstimator?.estimate(remainingSlots: pendingSlotIds, now: self.now, imaging: progress)
+                    self.onMain {
+                        self.imagingProgress = progress.fractionCompleted
+                        self.currentDiscTransferredBytes = progress.bytesTransferred
+                        self.currentDiscTotalBytes = progress.totalBytes
+                        self.currentDiscSpeedBytesPerSecond = progress.speedBytesPerSecond ?? 0
+                        self.currentDiscETASeconds = progress.etaSeconds
+
+                        let overallTransferred = completedBytes + progress.bytesTransferred
+                        self.overallTransferredBytes = overallTransferred
+                        self.overallEstimatedTotalBytes = estimate?.remainingBytes.map { overallTransferred + $0 }
+                        self.overallETASeconds = estimate?.seconds
+                        self.overallETAMarginSeconds = estimate?.margin
+
+                        let percent = Int(progress.fractionCompleted * 100)
+                        self.statusText = self.isPaused
+                            ? "Imaging \(safeVolumeName)... paused at \(percent)%"
+                            : "Imaging \(safeVolumeName)... \(percent)%"
+                        onUpdate()
+                    }
                 }
+            )
+        }
+
+        attemptedImageURL = imageURL
+        run.completedBytes += estimatedSize ?? 0
+        publishETA(remainingSlots: run.pendingSlotIds, onUpdate: onUpdate)
+
+        // Compare the image with the disc while it is still in the drive. Only data CDs and
+        // DVDs are plain sector copies of the raw device; other images are recorded unchecked.
+        var verification: ImageVerificationResult?
+        if verifyMode != .off && (discType == .dataCD || discType == .dvd) {
+            onMain {
+                self.statusText = "Verifying \(safeVolumeName)..."
+                self.imagingProgress = 0
+                onUpdate()
+            }
+            let result = try timed(.verify, slot: slot.id, bytes: { $0.bytesCompared }) {
+                try imagingService.verifyImage(
+                    bsdName: bsdName,
+                    imageURL: imageURL,
+                    mode: verifyMode,
+                    control: imagingControl,
+                    progress: { progress in
+                        self.onMain {
+                            self.imagingProgress = progress.fractionCompleted
+                            let percent = Int(progress.fractionCompleted * 100)
+                            self.statusText = "Verifying \(safeVolumeName)... \(percent)%"
+                            onUpdate()
+                        }
+                    }
+                )
             }
+            // A mismatch is a bad read: the slot is failed or deferred and the catalog records 'mismatch'
+            if let offset = result.mismatchOffset {
+                throw ImagingError.verificationFailed(offset)
+            }
+            verification = result
+        }
 
-            DispatchQueue.main.async {
-                self.isRunning = false
-                self.isPaused = false
-                if !self.isCancelled {
-                    self.statusText = "Complete: \(self.completedSlots.count) imaged, \(self.failedSlots.count) failed"
-                }
+        // List the disc's files from the image just written, so catalog search can find a
+        // file without loading the disc again. Only directory sectors are read, from local disk.
+        var files: [DiscFileRecord]?
+        if discType == .dataCD || discType == .dvd {
+            onMain {
+                self.statusText = "Indexing files on \(safeVolumeName)..."
                 onUpdate()
-                onComplete()
             }
+            files = DiscFileIndexer.index(imageURL: imageURL)
+        }
+
+        // Record the disc, its successful backup and its file index in catalog
+        let fileSize = try? FileManager.default.attributesOfItem(atPath: imageURL.path)[.size] as? Int64
+        catalogService.recordImagingResult(
+            disc,
+            backupPath: imageURL.path,
+            backupSizeBytes: fileSize,
+            backupHash: verification?.imageSHA256,
+            verified: verification.map { $0.isVerified },
+            files: files
+        )
+
+        onMain {
+            self.statusText = "Ejecting slot \(slot.id)..."
+            onUpdate()
+        }
+
+        // Eject disc back to slot
+        try retry.run(slot: slot.id, step: "eject") {
+            try timed(.eject, slot: slot.id) {
+                try changerService.ejectToSlot(slot.id)
+            }
+        }
+
+        onMain {
+            self.completedSlots.append(slot.id)
+            self.imagingProgress = 0
+            onSlotEjected(slot.id)
+            onUpdate()
         }
     }
 
-    /// Scan unknown discs: load, mount, catalog metadata, unmount/eject, repeat.
+    /// Scan unknown discs: load, read TOC and volume descriptors, catalog, eject, repeat.
+    /// Discs are never mounted.
     func runScanUnknown(
         slots: [Slot],
         driveFallbackSourceSlot: Int?,
@@ -590,7 +970,7 @@ final class BatchOperationState: ObservableObject {
         let unknownSlots = slots.filter { $0.isFull && !$0.isInDrive && $0.discType == .unscanned }
         guard !unknownSlots.isEmpty else { return }
 
-        DispatchQueue.main.async { [weak self] in
+        onMain { [weak self] in
             self?.operationType = .scanUnknown
             self?.isRunning = true
             self?.isCancelled = false
@@ -607,6 +987,7 @@ final class BatchOperationState: ObservableObject {
             self?.overallTransferredBytes = 0
             self?.overallEstimatedTotalBytes = nil
             self?.overallETASeconds = nil
+            self?.overallETAMarginSeconds = nil
             self?.averageDiscOperationSeconds = nil
             self?.statusText = "Preparing scan..."
             onUpdate()
@@ -614,21 +995,20 @@ final class BatchOperationState: ObservableObject {
 
         DispatchQueue.global(qos: .userInitiated).async { [weak self] in
             guard let self = self else { return }
-            var completedDurations: [TimeInterval] = []
-
-            func updateScanTiming(currentDiscElapsed: TimeInterval?) {
-                let average = completedDurations.isEmpty
-                    ? nil
-                    : completedDurations.reduce(0, +) / Double(completedDurations.count)
-                let remainingAfterCurrent = max(self.totalCount - self.currentIndex - 1, 0)
-                let eta: TimeInterval? = {
-                    guard let average = average else { return nil }
-                    let currentRemaining = max(average - (currentDiscElapsed ?? 0), 0)
-                    return currentRemaining + (average * Double(remainingAfterCurrent))
-                }()
-                DispatchQueue.main.async {
+            let estimator = self.startETAEstimator(
+                mode: .scan,
+                slotIds: unknownSlots.map(\.id),
+                catalogService: catalogService
+            )
+            var pendingSlotIds: [Int] = []
+
+            func updateScanTiming() {
+                let estimate = estimator.estimate(remainingSlots: pendingSlotIds, now: self.now)
+                let average = estimator.typicalScanSeconds
+                self.onMain {
                     self.averageDiscOperationSeconds = average
-                    self.overallETASeconds = eta
+                    self.overallETASeconds = estimate?.seconds
+                    self.overallETAMarginSeconds = estimate?.margin
                     onUpdate()
                 }
             }
@@ -639,7 +1019,7 @@ final class BatchOperationState: ObservableObject {
                 if driveStatus?.hasDisc == true {
                     let sourceSlot = driveStatus?.sourceSlot ?? driveFallbackSourceSlot
                     guard let sourceSlot else {
-                        DispatchQueue.main.async {
+                        self.onMain {
                             self.isCancelled = true
                             self.statusText = "Drive contains a disc with unknown source slot. Eject it first, then retry."
                             self.failedSlots.append((0, "Drive not empty (source slot unknown)"))
@@ -654,7 +1034,7 @@ final class BatchOperationState: ObservableObject {
                         try? mountService.unmountDisc(bsdName: bsdName, force: true)
                     }
                     try changerService.ejectToSlot(sourceSlot)
-                    DispatchQueue.main.async {
+                    self.onMain {
                         onSlotEjected(sourceSlot)
                     }
                 }
@@ -662,82 +1042,88 @@ final class BatchOperationState: ObservableObject {
                 self.logFailure("initial eject before scan-unknown", error: error)
             }
 
-            for slot in unknownSlots {
+            for (index, slot) in unknownSlots.enumerated() {
                 if self.isCancelled {
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.statusText = "Cancelled after \(self.currentIndex) disc(s)"
                         onUpdate()
                     }
                     break
                 }
 
-                let discStartedAt = Date()
-                updateScanTiming(currentDiscElapsed: 0)
+                pendingSlotIds = unknownSlots[(index + 1)...].map(\.id)
+                estimator.beginSlot(slot.id, at: self.now)
+                updateScanTiming()
 
-                DispatchQueue.main.async {
+                self.onMain {
                     self.currentSlot = slot.id
                     self.statusText = "Loading slot \(slot.id)..."
                     onUpdate()
                 }
 
                 do {
-                    try changerService.loadSlot(slot.id)
+                    try self.timed(.load, slot: slot.id) {
+                        try changerService.loadSlot(slot.id)
+                    }
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.statusText = "Waiting for slot \(slot.id)..."
                         onUpdate()
                     }
-                    updateScanTiming(currentDiscElapsed: Date().timeIntervalSince(discStartedAt))
+                    updateScanTiming()
 
-                    let bsdName = try mountService.waitForDisc(timeout: 90)
-                    let discType = imagingService.detectDiscType(bsdName: bsdName)
-                    let mountPoint = try self.mountDiscIfAvailable(
-                        bsdName: bsdName,
-                        mountService: mountService,
-                        allowMountless: (discType == .audioCDDA)
-                    )
+                    // Fast scan: the TOC and volume descriptors are enough to classify the
+                    // disc, so it is never mounted and goes straight back to its slot.
+                    let bsdName = try self.waitForDisc(mountService, timeout: 90)
+                    let identity = self.timed(.scan, slot: slot.id) {
+                        imagingService.identifyDisc(bsdName: bsdName)
+                    }
 
-                    DispatchQueue.main.async {
-                        if mountPoint != nil {
-                            self.statusText = "Cataloging slot \(slot.id)..."
-                        } else {
-                            self.statusText = "Cataloging slot \(slot.id) (no filesystem mount)..."
-                        }
-                        onSlotLoaded(slot.id, bsdName, mountPoint)
+                    self.onMain {
+                        self.statusText = "Cataloging slot \(slot.id)..."
+                        onSlotLoaded(slot.id, bsdName, nil)
                         onUpdate()
                     }
-                    updateScanTiming(currentDiscElapsed: Date().timeIntervalSince(discStartedAt))
 
-                    let estimatedSize = imagingService.estimateDiscSizeBytes(bsdName: bsdName)
+                    let catalogType = DiscRecord.catalogString(for: identity.discType)
+                    estimator.setDisc(slot: slot.id, type: catalogType, sizeBytes: identity.sizeBytes)
+                    self.eventLog?.setDiscType(catalogType, slot: slot.id)
                     _ = catalogService.recordDisc(
                         slotId: slot.id,
                         bsdName: bsdName,
-                        discType: discType,
-                        sizeBytes: estimatedSize
+                        discType: identity.discType,
+                        sizeBytes: identity.sizeBytes,
+                        volumeLabel: identity.label,
+                        toc: identity.toc,
+                        fingerprint: identity.fingerprint
                     )
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         onSlotCataloged(slot.id)
                         onUpdate()
                     }
 
+                    // Only needed when the system auto-mounted the disc
                     if mountService.isMounted(bsdName: bsdName) {
-                        DispatchQueue.main.async {
+                        self.onMain {
                             self.statusText = "Unmounting slot \(slot.id)..."
                             onUpdate()
                         }
-                        updateScanTiming(currentDiscElapsed: Date().timeIntervalSince(discStartedAt))
-                        try mountService.unmountDisc(bsdName: bsdName, force: true)
+                        try self.timed(.unmount, slot: slot.id) {
+                            try mountService.unmountDisc(bsdName: bsdName, force: true)
+                        }
                     }
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.statusText = "Returning slot \(slot.id)..."
                         onUpdate()
                     }
-                    updateScanTiming(currentDiscElapsed: Date().timeIntervalSince(discStartedAt))
-                    try changerService.ejectToSlot(slot.id)
+                    updateScanTiming()
+                    try self.timed(.eject, slot: slot.id) {
+                        try changerService.ejectToSlot(slot.id)
+                    }
 
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.completedSlots.append(slot.id)
                         onSlotEjected(slot.id)
                         onUpdate()
@@ -745,7 +1131,7 @@ final class BatchOperationState: ObservableObject {
 
                 } catch {
                     self.logFailure("scan unknown", slot: slot.id, error: error)
-                    DispatchQueue.main.async {
+                    self.onMain {
                         self.failedSlots.append((slot.id, error.localizedDescription))
                         onUpdate()
                     }
@@ -756,7 +1142,7 @@ final class BatchOperationState: ObservableObject {
                             try? mountService.unmountDisc(bsdName: bsdName, force: true)
                         }
                         try changerService.ejectToSlot(slot.id)
-                        DispatchQueue.main.async {
+                        self.onMain {
                             onSlotEjected(slot.id)
                             onUpdate()
                         }
@@ -765,16 +1151,16 @@ final class BatchOperationState: ObservableObject {
                     }
                 }
 
-                completedDurations.append(Date().timeIntervalSince(discStartedAt))
-                updateScanTiming(currentDiscElapsed: nil)
+                estimator.endSlot()
+                updateScanTiming()
 
-                DispatchQueue.main.async {
+                self.onMain {
                     self.currentIndex += 1
                     onUpdate()
                 }
             }
 
-            DispatchQueue.main.async {
+            self.onMain {
                 self.isRunning = false
                 if !self.isCancelled {
                     self.statusText = "Complete: \(self.completedSlots.count) cataloged, \(self.failedSlots.count) failed"
@@ -0,0 +1,152 @@
+//
+//  CarouselSlotDiff.swift
+//  Discbot
+//
+//  Decides which carousel slots need redrawing and which shared material each node uses
+//
+
+import Foundation
+
+/// Look of a slot divider; each value maps to one shared material
+enum CarouselDividerStyle: Hashable {
+    case empty
+    case full
+    case hovered
+    case selected
+}
+
+/// Emphasis applied to a disc in its slot; part of the disc material key
+enum CarouselDiscEmphasis: Hashable {
+    case none
+    case hovered
+    case selected
+}
+
+/// Material key for a disc node: one shared geometry per (disc type, emphasis)
+struct CarouselDiscStyle: Hashable {
+    let discType: SlotDiscType
+    let emphasis: CarouselDiscEmphasis
+}
+
+/// Everything the scene draws for one slot. Two equal values render identically,
+/// so a slot whose visual has not changed needs no scene graph work.
+struct CarouselSlotVisual: Equatable {
+    let divider: CarouselDividerStyle
+    /// nil when the slot has no disc sitting in it (empty, or its disc is in the drive)
+    let disc: CarouselDiscStyle?
+
+    init(slot: Slot, isSelected: Bool, isHovered: Bool) {
+        let hasDisc = slot.isFull && !slot.isInDrive
+        if isSelected {
+            divider = .selected
+        } else if isHovered {
+            divider = .hovered
+        } else {
+            divider = hasDisc ? .full : .empty
+        }
+
+        if hasDisc {
+            let emphasis: CarouselDiscEmphasis = isSelected ? .selected : (isHovered ? .hovered : .none)
+            disc = CarouselDiscStyle(discType: slot.discType, emphasis: emphasis)
+        } else {
+            disc = nil
+        }
+    }
+}
+
+/// Target visuals for every slot plus the selection and hover that produced them.
+///
+/// Each mutation returns only the slots whose visual changed, so the scene touches
+/// O(changed) nodes per update rather than O(slots). No SceneKit here: the same
+/// bookkeeping drives any renderer.
+struct CarouselSlotDiff {
+    struct Changes {
+        /// New visual of each slot that changed or appeared
+        var changed: [Int: CarouselSlotVisual] = [:]
+        /// Slots that are no longer in the changer
+        var removed: [Int] = []
+
+        var isEmpty: Bool { changed.isEmpty && removed.isEmpty }
+    }
+
+    private(set) var visuals: [Int: CarouselSlotVisual] = [:]
+    private(set) var selectedSlotId: Int?
+    private(set) var hoveredSlotId: Int?
+    /// Last slot model per id, kept so selection and hover changes can be re-derived
+    private var slots: [Int: Slot] = [:]
+
+    /// Replace the slot models and selection
+    mutating func update(slots newSlots: [Slot], selectedSlotId: Int?) -> Changes {
+        self.selectedSlotId = selectedSlotId
+        var changes = Changes()
+        var seen = Set<Int>()
+        seen.reserveCapacity(newSlots.count)
+
+        for slot in newSlots {
+            seen.insert(slot.id)
+            merge(slot, into: &changes)
+        }
+
+        if seen.count != visuals.count {
+            for id in visuals.keys where !seen.contains(id) {
+                visuals.removeValue(forKey: id)
+                slots.removeValue(forKey: id)
+                changes.removed.append(id)
+            }
+        }
+        return changes
+    }
+
+    /// Merge only the slots that changed; slots not mentioned keep their visual
+    mutating func update(changed changedSlots: [Slot]) -> Changes {
+        var changes = Changes()
+        for slot in changedSlots {
+            merge(slot, into: &changes)
+        }
+        return changes
+    }
+
+    /// Move the selection; at most the previous and new selected slots change
+    mutating func select(_ slotId: Int?) -> Changes {
+        let previous = selectedSlotId
+        selectedSlotId = slotId
+        return refresh([previous, slotId])
+    }
+
+    /// Move the hover; at most the previous and new hovered slots change
+    mutating func hover(_ slotId: Int?) -> Changes {
+        let previous = hoveredSlotId
+        hoveredSlotId = slotId
+        return refresh([previous, slotId])
+    }
+
+    private mutating func refresh(_ ids: [Int?]) -> Changes {
+        var changes = Changes()
+        for case let id? in ids {
+            guard let slot = slots[id] else { continue }
+            let visual = visual(for: slot)
+            if visuals[id] != visual {
+                visuals[id] = visual
+                changes.changed[id] = visual
+            }
+        }
+        return changes
+    }
+
+    private mutating func merge(_ slot: Slot, into changes: inout Changes) {
+        slots[slot.id] = slot
+        let visual = visual(for: slot)
+        if visuals[slot.id] != visual {
+            visuals[slot.id] = visual
+            changes.changed[slot.id] = visual
+        }
+    }
+
+    private func visual(for slot: Slot) -> CarouselSlotVisual {
+        CarouselSlotVisual(
+            slot: slot,
+            isSelected: slot.id == selectedSlotId,
+            isHovered: slot.id == hoveredSlotId
+        )
+    }
+}
@@ -70,9 +70,19 @@ final class ChangerViewModel: ObservableObject {
     @Published var currentBSDName: String?
 
     // Inventory
-    @Published var slots: [Slot] = []
+    @Published var slots: [Slot] = [] {
+        didSet {
+            guard !isApplyingSlotChange, let changes = slotIndex.update(slots) else { return }
+            slotChanges.send(changes)
+        }
+    }
     @Published var selectedSlotId: Int?
     @Published var selectedSlotsForRip: Set<Int> = []
+    private let slotIndex = SlotIndex()
+    /// Slots that actually changed, sent after `slots` is updated. Observers that keep
+    /// their own per-slot state (the carousel) apply these instead of rescanning `slots`.
+    let slotChanges = PassthroughSubject<SlotChangeSet, Never>()
+    private var isApplyingSlotChange = false
 
     // Search and filter
     @Published var searchText: String = ""
@@ -87,32 +97,41 @@ final class ChangerViewModel: ObservableObject {
         case dvds = "DVDs"
         case unscanned = "Unscanned"
         case inDrive = "In Drive"
-    }
 
-    var filteredSlots: [Slot] {
-        var result = slots
-
-        switch slotFilter {
-        case .all: break
-        case .full: result = result.filter { $0.isFull || $0.isInDrive }
-        case .empty: result = result.filter { !$0.isFull && !$0.isInDrive }
-        case .audioCDs: result = result.filter { $0.discType == .audioCDDA }
-        case .dataCDs: result = result.filter { $0.discType == .dataCD }
-        case .dvds: result = result.filter { $0.discType == .dvd }
-        case .unscanned: result = result.filter { $0.discType == .unscanned && $0.isFull }
-        case .inDrive: result = result.filter { $0.isInDrive }
-        }
-
-        if !searchText.isEmpty {
-            let query = searchText.lowercased()
-            result = result.filter {
-                String($0.id).contains(query) ||
-                ($0.volumeLabel?.lowercased().contains(query) ?? false) ||
-                $0.discType.label.lowercased().contains(query)
+        func matches(_ slot: Slot) -> Bool {
+            switch self {
+            case .all: return true
+            case .full: return slot.isFull || slot.isInDrive
+            case .empty: return !slot.isFull && !slot.isInDrive
+            case .audioCDs: return slot.discType == .audioCDDA
+            case .dataCDs: return slot.discType == .dataCD
+            case .dvds: return slot.discType == .dvd
+            case .unscanned: return slot.discType == .unscanned && slot.isFull
+            case .inDrive: return slot.isInDrive
             }
         }
+    }
+
+    /// Change one slot in place. Publishes only if the slot's value changed, and
+    /// `slotChanges` carries just that slot. Ids outside the inventory are ignored.
+    func updateSlot(_ slotId: Int, _ mutate: (inout Slot) -> Void) {
+        guard slotId >= 1, slotId <= slots.count else { return }
+        let position = slotId - 1
+        var slot = slots[position]
+        mutate(&slot)
+        guard slot != slots[position] else { return }
+
+        isApplyingSlotChange = true
+        slots[position] = slot
+        isApplyingSlotChange = false
+        if let changes = slotIndex.update(slot, at: position) {
+            slotChanges.send(changes)
+        }
+    }
 
-        return result
+    /// Slots matching the filter and search text (memoized until either or the inventory changes)
+    var filteredSlots: [Slot] {
+        slotIndex.slots(matching: slotFilter, query: searchText)
     }
 
     var isFiltering: Bool {
@@ -190,7 +209,7 @@ final class ChangerViewModel: ObservableObject {
             self.imagingService = MockImagingService()
         } else {
             self.mockState = nil
-            self.changerService = ChangerService()
+            self.changerService = ChangerService.makeDefault()
             self.mountService = MountService()
             self.imagingService = ImagingService()
         }
@@ -213,6 +232,15 @@ final class ChangerViewModel: ObservableObject {
 
             // Auto-connect on start
             connect()
+
+            // Pick up artist/album back-filled from MusicBrainz, and look up anything still pending.
+            NotificationCenter.default.publisher(for: MusicBrainzService.lookupsAppliedNotification)
+                .compactMap { $0.userInfo?["slotIds"] as? [Int] }
+                .sink { [weak self] slotIds in
+                    self?.refreshCatalogCache(forSlotIds: slotIds)
+                }
+                .store(in: &cancellables)
+            catalogService.backfillOnlineMetadata()
         }
     }
 
@@ -239,6 +267,8 @@ final class ChangerViewModel: ObservableObject {
 
                 // Get device info
                 let info = try self.changerService.getDeviceInfo()
+                // Timings are learned per optical drive, not per changer
+                EventLog.shared.drive = self.mountService.getDriveIdentity()
                 DispatchQueue.main.async {
                     self.deviceVendor = info.vendor
                     self.deviceProduct = info.product
@@ -325,7 +355,7 @@ final class ChangerViewModel: ObservableObject {
             imagingService = MockImagingService()
         } else {
             mockState = nil
-            changerService = ChangerService()
+            changerService = ChangerService.makeDefault()
             mountService = MountService()
             imagingService = ImagingService()
         }
@@ -368,8 +398,8 @@ final class ChangerViewModel: ObservableObject {
             if currentBSDName != nil || driveStatus != .empty {
                 currentBSDName = nil
                 driveStatus = .empty
-                for i in 0..<slots.count {
-                    slots[i].isInDrive = false
+                for slot in slots where slot.isInDrive {
+                    updateSlot(slot.id) { $0.isInDrive = false }
                 }
             }
             return
@@ -385,7 +415,7 @@ final class ChangerViewModel: ObservableObject {
         case .loaded(let sourceSlot, _):
             driveStatus = .loaded(sourceSlot: sourceSlot, mountPoint: mountPoint)
             if sourceSlot > 0, sourceSlot <= slots.count {
-                slots[sourceSlot - 1].isInDrive = true
+                updateSlot(sourceSlot) { $0.isInDrive = true }
             }
         default:
             // Leave loading/ejecting/error states alone; user actions will reconcile.
@@ -449,7 +479,10 @@ final class ChangerViewModel: ObservableObject {
 #endif
 
             DispatchQueue.main.async {
-                self.slots = newSlots
+                // Polling mostly finds nothing new; skip the publish (and every view update) then
+                if newSlots != self.slots {
+                    self.slots = newSlots
+                }
 
                 if discPresent, let bsd = bsdName {
                     // Disc is present - use DiskArbitration info
@@ -471,7 +504,7 @@ final class ChangerViewModel: ObservableObject {
 
                     // Mark slot as in drive if we know the source
                     if sourceSlot > 0 && sourceSlot <= self.slots.count {
-                        self.slots[sourceSlot - 1].isInDrive = true
+                        self.updateSlot(sourceSlot) { $0.isInDrive = true }
                     }
                 } else {
                     // No disc detected
@@ -511,13 +544,11 @@ final class ChangerViewModel: ObservableObject {
         let uniqueSlotIds = Array(Set(slotIds)).sorted()
         guard !uniqueSlotIds.isEmpty else { return }
 
-        var discBySlot: [Int: DiscRecord] = [:]
+        let discBySlot = catalogService.getDiscs(slotIds: uniqueSlotIds)
+        let latestStatuses = catalogService.getBackupStatuses(slotIds: uniqueSlotIds)
         var statusBySlot: [Int: BackupStatus] = [:]
         for slotId in uniqueSlotIds {
-            if let disc = catalogService.getDisc(slotId: slotId) {
-                discBySlot[slotId] = disc
-            }
-            statusBySlot[slotId] = catalogService.getBackupStatus(slotId: slotId)
+            statusBySlot[slotId] = latestStatuses[slotId] ?? .notBackedUp
         }
 
         catalogCacheQueue.sync {
@@ -538,13 +569,14 @@ final class ChangerViewModel: ObservableObject {
         guard applyToVisibleSlots else { return }
         DispatchQueue.main.async {
             for slotId in uniqueSlotIds {
-                guard slotId > 0, slotId <= self.slots.count else { continue }
-                if let status = statusBySlot[slotId] {
-                    self.slots[slotId - 1].backupStatus = status
-                }
-                if let disc = discBySlot[slotId] {
-                    self.slots[slotId - 1].discType = SlotDiscType.from(catalogString: disc.discType)
-                    self.slots[slotId - 1].volumeLabel = disc.volumeLabel
+                self.updateSlot(slotId) { slot in
+                    if let status = statusBySlot[slotId] {
+                        slot.backupStatus = status
+                    }
+                    if let disc = discBySlot[slotId] {
+                        slot.discType = SlotDiscType.from(catalogString: disc.discType)
+                        slot.volumeLabel = disc.volumeLabel
+                    }
                 }
             }
         }
@@ -587,8 +619,10 @@ final class ChangerViewModel: ObservableObject {
                     self.currentBSDName = bsdName
                     self.driveStatus = .loaded(sourceSlot: slot, mountPoint: mountPoint)
                     if slot > 0 && slot <= self.slots.count {
-                        self.slots[slot - 1].isFull = false
-                        self.slots[slot - 1].isInDrive = true
+                        self.updateSlot(slot) {
+                            $0.isFull = false
+                            $0.isInDrive = true
+                        }
                     }
                 }
             },
@@ -601,8 +635,10 @@ final class ChangerViewModel: ObservableObject {
                 DispatchQueue.main.async {
                     guard let self = self else { return }
                     if slot > 0 && slot <= self.slots.count {
-                        self.slots[slot - 1].isInDrive = false
-                        self.slots[slot - 1].isFull = true
+                        self.updateSlot(slot) {
+                            $0.isInDrive = false
+                            $0.isFull = true
+                        }
                     }
                     self.driveStatus = .empty
                     self.currentBSDName = nil
@@ -659,8 +695,10 @@ final class ChangerViewModel: ObservableObject {
 
                 DispatchQueue.main.async {
                     // Update slot status
-                    self.slots[slotNumber - 1].isFull = false
-                    self.slots[slotNumber - 1].isInDrive = true
+                    self.updateSlot(slotNumber) {
+                        $0.isFull = false
+                        $0.isInDrive = true
+                    }
                     self.operationStatusText = "Waiting for disc..."
                 }
 
@@ -821,10 +859,10 @@ final class ChangerViewModel: ObservableObject {
                 DispatchQueue.main.async {
                     // Update state
                     if sourceSlot > 0 && sourceSlot <= self.slots.count {
-                        self.slots[sourceSlot - 1].isInDrive = false
+                        self.updateSlot(sourceSlot) { $0.isInDrive = false }
                     }
                     if targetSlot > 0 && targetSlot <= self.slots.count {
-                        self.slots[targetSlot - 1].isFull = true
+                        self.updateSlot(targetSlot) { $0.isFull = true }
                     }
 
                     self.driveStatus = .empty
@@ -971,8 +1009,10 @@ final class ChangerViewModel: ObservableObject {
                 self.publishCarouselAnimation(.loadFromSlot(slotNumber))
 
                 DispatchQueue.main.async {
-                    self.slots[slotNumber - 1].isFull = false
-                    self.slots[slotNumber - 1].isInDrive = true
+                    self.updateSlot(slotNumber) {
+                        $0.isFull = false
+                        $0.isInDrive = true
+                    }
                     self.operationStatusText = "Waiting for disc..."
                 }
 
@@ -993,14 +1033,16 @@ final class ChangerViewModel: ObservableObject {
                 }
 
                 // 4. Detect disc type and record metadata
-                let discType = self.imagingService.detectDiscType(bsdName: bsdName)
-                let estimatedSize = self.imagingService.estimateDiscSizeBytes(bsdName: bsdName)
+                let identity = self.imagingService.identifyDisc(bsdName: bsdName)
 
                 _ = self.catalogService.recordDisc(
                     slotId: slotNumber,
                     bsdName: bsdName,
-                    discType: discType,
-                    sizeBytes: estimatedSize
+                    discType: identity.discType,
+                    sizeBytes: identity.sizeBytes,
+                    volumeLabel: identity.label,
+                    toc: identity.toc,
+                    fingerprint: identity.fingerprint
                 )
 
                 self.refreshCatalogCache(forSlotIds: [slotNumber])
@@ -1036,8 +1078,10 @@ final class ChangerViewModel: ObservableObject {
                 self.publishCarouselAnimation(.ejectToSlot(slotNumber))
 
                 DispatchQueue.main.async {
-                    self.slots[slotNumber - 1].isInDrive = false
-                    self.slots[slotNumber - 1].isFull = true
+                    self.updateSlot(slotNumber) {
+                        $0.isInDrive = false
+                        $0.isFull = true
+                    }
                     self.driveStatus = .empty
                     self.currentBSDName = nil
                     self.currentOperation = nil
@@ -1085,7 +1129,7 @@ final class ChangerViewModel: ObservableObject {
                 self.publishCarouselAnimation(.ejectFromChamber(slotNumber))
 
                 DispatchQueue.main.async {
-                    self.slots[slotNumber - 1].isFull = false
+                    self.updateSlot(slotNumber) { $0.isFull = false }
                     self.currentOperation = nil
                     self.operationStatusText = "Remove disc from I/E slot"
                 }
@@ -1127,7 +1171,7 @@ final class ChangerViewModel: ObservableObject {
                 try self.changerService.importFromIE(slotNumber)
 
                 DispatchQueue.main.async {
-                    self.slots[slotNumber - 1].isFull = true
+                    self.updateSlot(slotNumber) { $0.isFull = true }
                     self.currentOperation = nil
                 }
 
@@ -1264,7 +1308,7 @@ final class ChangerViewModel: ObservableObject {
                 self.publishCarouselAnimation(.ejectFromChamber(nextSlot))
 
                 DispatchQueue.main.async {
-                    self.slots[nextSlot - 1].isFull = false
+                    self.updateSlot(nextSlot) { $0.isFull = false }
                     self.unloadAllCompleted += 1
 
                     if self.mockState != nil {
@@ -1297,7 +1341,7 @@ final class ChangerViewModel: ObservableObject {
                 DispatchQueue.main.async {
                     // Skip errors and continue to next slot
                     print("Slot \(nextSlot) failed: \(error.localizedDescription ?? "unknown"), skipping...")
-                    self.slots[nextSlot - 1].isFull = false  // Mark as empty since it probably is
+                    self.updateSlot(nextSlot) { $0.isFull = false }  // Mark as empty since it probably is
                     // Continue to next disc
                     self.unloadNextDisc()
                 }
@@ -1305,7 +1349,7 @@ final class ChangerViewModel: ObservableObject {
                 DispatchQueue.main.async {
                     // Skip errors and continue to next slot
                     print("Slot \(nextSlot) failed: \(error.localizedDescription), skipping...")
-                    self.slots[nextSlot - 1].isFull = false
+                    self.updateSlot(nextSlot) { $0.isFull = false }
                     self.unloadNextDisc()
                 }
             }
@@ -1356,8 +1400,10 @@ final class ChangerViewModel: ObservableObject {
                     self.currentBSDName = bsdName
                     self.driveStatus = .loaded(sourceSlot: slot, mountPoint: mountPoint)
                     if slot > 0 && slot <= self.slots.count {
-                        self.slots[slot - 1].isFull = false
-                        self.slots[slot - 1].isInDrive = true
+                        self.updateSlot(slot) {
+                            $0.isFull = false
+                            $0.isInDrive = true
+                        }
                     }
                 }
             },
@@ -1365,8 +1411,10 @@ final class ChangerViewModel: ObservableObject {
                 DispatchQueue.main.async {
                     guard let self = self else { return }
                     if slot > 0 && slot <= self.slots.count {
-                        self.slots[slot - 1].isFull = true
-                        self.slots[slot - 1].isInDrive = false
+                        self.updateSlot(slot) {
+                            $0.isFull = true
+                            $0.isInDrive = false
+                        }
                     }
                     self.driveStatus = .empty
                     self.currentBSDName = nil
@@ -1450,9 +1498,36 @@ final class ChangerViewModel: ObservableObject {
 
         let slotsToRip = slots.filter { selectedSlotsForRip.contains($0.id) && ($0.isFull || $0.isInDrive) }
         guard !slotsToRip.isEmpty else { return }
+        runBatchImaging(slots: slotsToRip, outputDirectory: outputDirectory, jobId: nil)
+    }
+
+    /// Resume an interrupted Image All job over the slots it had not finished.
+    /// Returns false when it cannot start now (not connected, busy, or nothing left).
+    @discardableResult
+    func resumeJob(_ job: JobRecord) -> Bool {
+        guard job.kind == .imageAll, let outputPath = job.outputDirectory else { return false }
+        guard isConnected, currentOperation == nil, batchState?.isRunning != true else { return false }
+
+        // A job that never began has no tasks and covers every occupied slot
+        let pending = job.tasks.isEmpty ? nil : Set(job.pendingSlotIds)
+        let slotsToRip = slots.filter { (pending?.contains($0.id) ?? true) && ($0.isFull || $0.isInDrive) }
+        guard !slotsToRip.isEmpty else { return false }
+        runBatchImaging(
+            slots: slotsToRip,
+            outputDirectory: URL(fileURLWithPath: outputPath, isDirectory: true),
+            jobId: job.id
+        )
+        return true
+    }
+
+    private func runBatchImaging(slots slotsToRip: [Slot], outputDirectory: URL, jobId: Int64?) {
         let slotIdsToRip = slotsToRip.map(\.id)
 
         let state = BatchOperationState()
+        state.jobId = jobId
+        state.mirrorDestinations = settings.mirrorDestinations
+        state.writeOptions = settings.imageWriteOptions
+        state.verifyMode = settings.verifyMode
         DispatchQueue.main.async { [weak self] in
             self?.batchState = state
         }
@@ -1476,8 +1551,10 @@ final class ChangerViewModel: ObservableObject {
                     self.currentBSDName = bsdName
                     self.driveStatus = .loaded(sourceSlot: slot, mountPoint: mountPoint)
                     if slot > 0 && slot <= self.slots.count {
-                        self.slots[slot - 1].isFull = false
-                        self.slots[slot - 1].isInDrive = true
+                        self.updateSlot(slot) {
+                            $0.isFull = false
+                            $0.isInDrive = true
+                        }
                     }
                 }
             },
@@ -1485,8 +1562,10 @@ final class ChangerViewModel: ObservableObject {
                 DispatchQueue.main.async {
                     guard let self = self else { return }
                     if slot > 0 && slot <= self.slots.count {
-                        self.slots[slot - 1].isFull = true
-                        self.slots[slot - 1].isInDrive = false
+                        self.updateSlot(slot) {
+                            $0.isFull = true
+                            $0.isInDrive = false
+                        }
                     }
                     self.driveStatus = .empty
                     self.currentBSDName = nil
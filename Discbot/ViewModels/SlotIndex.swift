@@ -0,0 +1,232 @@
+//
+//  SlotIndex.swift
+//  Discbot
+//
+//  Incrementally maintained filter bitsets and search index over the slot inventory
+//
+
+import Foundation
+
+/// Fixed-size set of slot positions (indexes into the slots array).
+struct SlotBitset: Equatable {
+    private var words: [UInt64]
+
+    init(capacity: Int) {
+        words = Array(repeating: 0, count: (capacity + 63) / 64)
+    }
+
+    subscript(position: Int) -> Bool {
+        get { words[position >> 6] & (UInt64(1) << (position & 63)) != 0 }
+        set {
+            if newValue {
+                words[position >> 6] |= UInt64(1) << (position & 63)
+            } else {
+                words[position >> 6] &= ~(UInt64(1) << (position & 63))
+            }
+        }
+    }
+
+    var isEmpty: Bool {
+        words.allSatisfy { $0 == 0 }
+    }
+
+    mutating func formIntersection(_ other: SlotBitset) {
+        for i in words.indices {
+            words[i] &= other.words[i]
+        }
+    }
+
+    /// Visit set positions in ascending order.
+    func forEachPosition(_ body: (Int) -> Void) {
+        for (wordIndex, word) in words.enumerated() {
+            var remaining = word
+            while remaining != 0 {
+                body((wordIndex << 6) + remaining.trailingZeroBitCount)
+                remaining &= remaining - 1
+            }
+        }
+    }
+}
+
+/// Slots that changed in one inventory update.
+struct SlotChangeSet {
+    /// Index generation after the update.
+    let generation: Int
+    /// New values of the changed slots, in slot order.
+    let slots: [Slot]
+    /// The inventory was replaced (slot count changed); observers should rebuild.
+    let isReset: Bool
+}
+
+/// Answers `filteredSlots` without rescanning the inventory.
+///
+/// Keeps one bitset per filter and an index from every 1-, 2- and 3-character
+/// substring of the lowercased search fields (slot number, volume label, disc type)
+/// to the slots containing it. Only slots that changed are reindexed. Queries of up
+/// to three characters are a single lookup; longer queries intersect their trigrams
+/// and confirm the candidates. The last result is memoized per
+/// (filter, query, generation). Not thread-safe; owned by the main thread.
+final class SlotIndex {
+    typealias Filter = ChangerViewModel.SlotFilter
+
+    private static let maxGramLength = 3
+
+    private(set) var slots: [Slot] = []
+    /// Bumped whenever an indexed slot changes.
+    private(set) var generation = 0
+    /// Generation at which each slot position last changed.
+    private(set) var slotGenerations: [Int] = []
+
+    private var filterBits: [Filter: SlotBitset] = [:]
+    private var gramBits: [String: SlotBitset] = [:]
+    private var slotGrams: [Set<String>] = []
+    private var searchFields: [[String]] = []
+
+    private var cachedKey: (filter: Filter, query: String, generation: Int)?
+    private var cachedResult: [Slot] = []
+
+    /// Reindex the slots that differ from `newSlots`; nil when none do.
+    @discardableResult
+    func update(_ newSlots: [Slot]) -> SlotChangeSet? {
+        guard newSlots.count == slots.count else {
+            rebuild(newSlots)
+            return SlotChangeSet(generation: generation, slots: newSlots, isReset: true)
+        }
+
+        var changed: [Slot] = []
+        for position in newSlots.indices where newSlots[position] != slots[position] {
+            if changed.isEmpty {
+                generation += 1
+            }
+            reindex(newSlots[position], at: position)
+            changed.append(newSlots[position])
+        }
+        return changed.isEmpty ? nil : SlotChangeSet(generation: generation, slots: changed, isReset: false)
+    }
+
+    /// Reindex one slot the caller already knows changed; nil when it did not.
+    @discardableResult
+    func update(_ slot: Slot, at position: Int) -> SlotChangeSet? {
+        guard slots.indices.contains(position), slots[position] != slot else { return nil }
+        generation += 1
+        reindex(slot, at: position)
+        return SlotChangeSet(generation: generation, slots: [slot], isReset: false)
+    }
+
+    func slots(matching filter: Filter, query: String) -> [Slot] {
+        if let key = cachedKey, key.filter == filter, key.query == query, key.generation == generation {
+            return cachedResult
+        }
+
+        let result = evaluate(filter: filter, query: query.lowercased())
+        cachedKey = (filter, query, generation)
+        cachedResult = result
+        return result
+    }
+
+    // MARK: - Evaluation
+
+    private func evaluate(filter: Filter, query: String) -> [Slot] {
+        if filter == .all && query.isEmpty {
+            return slots
+        }
+
+        var candidates = filter == .all ? nil : filterBits[filter]
+        var needsConfirmation = false
+
+        if !query.isEmpty {
+            let characters = Array(query)
+            if characters.count <= Self.maxGramLength {
+                guard let bits = gramBits[query] else { return [] }
+                candidates = intersect(candidates, bits)
+            } else {
+                for start in 0...(characters.count - Self.maxGramLength) {
+                    let gram = String(characters[start..<(start + Self.maxGramLength)])
+                    guard let bits = gramBits[gram] else { return [] }
+                    candidates = intersect(candidates, bits)
+                }
+                needsConfirmation = true
+            }
+        }
+
+        guard let matches = candidates else { return slots }
+
+        var result: [Slot] = []
+        matches.forEachPosition { position in
+            if !needsConfirmation || searchFields[position].contains(where: { $0.contains(query) }) {
+                result.append(slots[position])
+            }
+        }
+        return result
+    }
+
+    private func intersect(_ candidates: SlotBitset?, _ bits: SlotBitset) -> SlotBitset {
+        guard var candidates = candidates else { return bits }
+        candidates.formIntersection(bits)
+        return candidates
+    }
+
+    // MARK: - Maintenance
+
+    private func reindex(_ slot: Slot, at position: Int) {
+        unindex(position: position)
+        slots[position] = slot
+        index(position: position)
+        slotGenerations[position] = generation
+    }
+
+    private func rebuild(_ newSlots: [Slot]) {
+        generation += 1
+        slots = newSlots
+        slotGenerations = Array(repeating: generation, count: newSlots.count)
+        filterBits = [:]
+        for filter in Filter.allCases where filter != .all {
+            filterBits[filter] = SlotBitset(capacity: newSlots.count)
+        }
+        gramBits = [:]
+        slotGrams = Array(repeating: [], count: newSlots.count)
+        searchFields = Array(repeating: [], count: newSlots.count)
+
+        for position in newSlots.indices {
+            index(position: position)
+        }
+    }
+
+    private func index(position: Int) {
+        let slot = slots[position]
+        for filter in Filter.allCases where filter != .all && filter.matches(slot) {
+            filterBits[filter]?[position] = true
+        }
+
+        let fields = [String(slot.id), slot.volumeLabel?.lowercased() ?? "", slot.discType.label.lowercased()]
+        searchFields[position] = fields
+
+        var grams = Set<String>()
+        for field in fields {
+            let characters = Array(field)
+            for length in 1...Self.maxGramLength where length <= characters.count {
+                for start in 0...(characters.count - length) {
+                    grams.insert(String(characters[start..<(start + length)]))
+                }
+            }
+        }
+        for gram in grams {
+            gramBits[gram, default: SlotBitset(capacity: slots.count)][position] = true
+        }
+        slotGrams[position] = grams
+    }
+
+    private func unindex(position: Int) {
+        for filter in Filter.allCases where filter != .all {
+            filterBits[filter]?[position] = false
+        }
+        for gram in slotGrams[position] {
+            gramBits[gram]?[position] = false
+            if gramBits[gram]?.isEmpty == true {
+                gramBits[gram] = nil
+            }
+        }
+        slotGrams[position] = []
+        searchFields[position] = []
+    }
+}
@@ -159,7 +159,7 @@ struct BatchOperationSheet: View {
             HStack {
                 Text("Queue: \(formatBytes(batchState.overallTransferredBytes)) / \(formatBytes(batchState.overallEstimatedTotalBytes))")
                 Spacer()
-                Text("Queue ETA: \(formatDuration(batchState.overallETASeconds))")
+                Text("Queue ETA: \(formatETA(batchState.overallETASeconds, margin: batchState.overallETAMarginSeconds))")
             }
             .font(.caption)
             .foregroundColor(.secondary)
@@ -173,7 +173,7 @@ struct BatchOperationSheet: View {
                     .font(.subheadline)
                     .fontWeight(.medium)
                 Spacer()
-                Text("ETA: \(formatDuration(batchState.overallETASeconds))")
+                Text("ETA: \(formatETA(batchState.overallETASeconds, margin: batchState.overallETAMarginSeconds))")
                     .font(.caption)
                     .foregroundColor(.secondary)
             }
@@ -329,6 +329,13 @@ struct BatchOperationSheet: View {
         return formatter.string(from: seconds) ?? "Unknown"
     }
 
+    /// "1h 20m ± 12m" when the estimate has a 90% interval
+    private func formatETA(_ seconds: TimeInterval?, margin: TimeInterval?) -> String {
+        let eta = formatDuration(seconds)
+        guard seconds != nil, let margin = margin, margin >= 1 else { return eta }
+        return "\(eta) ± \(formatDuration(margin))"
+    }
+
     private var titleText: String {
         switch batchState.operationType {
         case .loadAll:
@@ -21,19 +21,26 @@ class CarouselSceneController {
     private var cameraNode = SCNNode()
 
     // Slot tracking
-    private var slotNodes: [Int: SCNNode] = [:]   // slotId -> slot group node
+    private var slotNodes: [Int: SCNNode] = [:]    // slotId -> slot group node
+    private var dividerNodes: [Int: SCNNode] = [:] // slotId -> divider node
     private var discNodes: [Int: SCNNode] = [:]    // slotId -> disc node
     private var driveDiscNode: SCNNode?
     private var selectedLabelNode: SCNNode?
 
     // State
-    private var highlightedSlotId: Int?
-    private var hoveredSlotId: Int?
+    private var slotDiff = CarouselSlotDiff()
     private(set) var animatingSlotIds: Set<Int> = []
 
+    // Shared geometry: one copy of each shape per material key, reused by every slot
+    private var dividerGeometries: [CarouselDividerStyle: SCNGeometry] = [:]
+    private var discGeometries: [CarouselDiscStyle: SCNGeometry] = [:]
+    private lazy var dividerShape = SCNBox(width: 0.015, height: 0.2, length: 0.12, chamferRadius: 0)
+    private lazy var discShape = SCNTube(innerRadius: discHoleRadius, outerRadius: discRadius, height: discThickness)
+
     // Geometry constants (scene units; 1.5 units = 60mm real)
     private let carouselRadius: CGFloat = 5.0
-    private let slotCount = 200
+    /// Positions around the ring; follows the highest slot id of the changer being shown
+    private var slotCount = 200
     private let discRadius: CGFloat = 1.5       // 60mm
     private let discHoleRadius: CGFloat = 0.1875 // 7.5mm (15mm hole / 2), 12.5% of disc radius
     private let discThickness: CGFloat = 0.015   // 1.2mm (slightly thicker for visibility)
@@ -154,73 +161,99 @@ class CarouselSceneController {
     // MARK: - Build Slots
 
     func buildSlots(slots: [Slot], driveStatus: DriveStatus, selectedSlotId: Int?) {
-        for (_, node) in slotNodes { node.removeFromParentNode() }
-        slotNodes.removeAll()
-        discNodes.removeAll()
         animatingSlotIds.removeAll()
 
+        // Reuse the slot nodes already in the scene; only new slots get a node
+        let count = max(slots.map(\.id).max() ?? 0, 1)
+        let relayout = count != slotCount
+        slotCount = count
+
         for slot in slots {
-            let slotIndex = slot.id - 1
-            let angle = (2.0 * CGFloat.pi * CGFloat(slotIndex)) / CGFloat(slotCount)
+            if let groupNode = slotNodes[slot.id] {
+                if relayout { placeSlotNode(groupNode, slotId: slot.id) }
+                continue
+            }
 
             let groupNode = SCNNode()
             groupNode.name = "slot_\(slot.id)"
+            placeSlotNode(groupNode, slotId: slot.id)
 
-            let x = Float(carouselRadius * cos(angle))
-            let z = Float(carouselRadius * sin(angle))
-            groupNode.position = SCNVector3(x, 0, z)
-            groupNode.eulerAngles = SCNVector3(0, -Float(angle) + Float.pi / 2, 0)
-
-            // Slot divider
-            let divider = SCNBox(width: 0.015, height: 0.2, length: 0.12, chamferRadius: 0)
-            let dividerNode = SCNNode(geometry: divider)
-            dividerNode.geometry?.firstMaterial = slotDividerMaterial(isEmpty: !slot.isFull && !slot.isInDrive, isSelected: slot.id == selectedSlotId)
+            let dividerNode = SCNNode()
             dividerNode.position = SCNVector3(0, 0.1, 0)
             groupNode.addChildNode(dividerNode)
 
-            // Disc
-            if slot.isFull && !slot.isInDrive {
-                let discNode = makeDiscNode(discType: slot.discType)
-                discNode.name = "disc_\(slot.id)"
-                discNode.position = SCNVector3(0, Float(discRadius), 0)
-                groupNode.addChildNode(discNode)
-                discNodes[slot.id] = discNode
-            }
-
             carouselPivotNode.addChildNode(groupNode)
             slotNodes[slot.id] = groupNode
+            dividerNodes[slot.id] = dividerNode
         }
 
+        apply(slotDiff.update(slots: slots, selectedSlotId: selectedSlotId))
+
         updateDriveDisc(driveStatus: driveStatus)
-        if let id = selectedSlotId { highlightSlot(id) }
+        highlightSlot(selectedSlotId)
+    }
+
+    private func placeSlotNode(_ groupNode: SCNNode, slotId: Int) {
+        let slotIndex = slotId - 1
+        let angle = (2.0 * CGFloat.pi * CGFloat(slotIndex)) / CGFloat(slotCount)
+
+        let x = Float(carouselRadius * cos(angle))
+        let z = Float(carouselRadius * sin(angle))
+        groupNode.position = SCNVector3(x, 0, z)
+        groupNode.eulerAngles = SCNVector3(0, -Float(angle) + Float.pi / 2, 0)
     }
 
     // MARK: - State Updates
 
-    func updateSlotStates(slots: [Slot], selectedSlotId: Int?) {
-        for slot in slots {
-            guard let groupNode = slotNodes[slot.id] else { continue }
-            let isSelected = slot.id == selectedSlotId
-            let hasFull = slot.isFull && !slot.isInDrive
+    /// Redraw the given slots (as published by the view model's change stream), and of
+    /// those only the ones whose divider or disc look changed
+    func updateSlotStates(changed slots: [Slot]) {
+        apply(slotDiff.update(changed: slots))
+    }
 
-            if let dividerNode = groupNode.childNodes.first(where: { $0.geometry is SCNBox }) {
-                dividerNode.geometry?.firstMaterial = slotDividerMaterial(isEmpty: !slot.isFull && !slot.isInDrive, isSelected: isSelected)
-            }
+    private func apply(_ changes: CarouselSlotDiff.Changes) {
+        for id in changes.removed {
+            slotNodes.removeValue(forKey: id)?.removeFromParentNode()
+            dividerNodes.removeValue(forKey: id)
+            discNodes.removeValue(forKey: id)
+        }
+        for (id, visual) in changes.changed {
+            apply(visual, toSlot: id)
+        }
+    }
 
-            if hasFull && discNodes[slot.id] == nil && !animatingSlotIds.contains(slot.id) {
-                let discNode = makeDiscNode(discType: slot.discType)
-                discNode.name = "disc_\(slot.id)"
+    private func apply(_ visual: CarouselSlotVisual, toSlot slotId: Int) {
+        guard let groupNode = slotNodes[slotId] else { return }
+        dividerNodes[slotId]?.geometry = dividerGeometry(visual.divider)
+
+        // A disc in flight is owned by its animation; `settleSlot` catches it up afterwards
+        guard !animatingSlotIds.contains(slotId) else { return }
+
+        if let style = visual.disc {
+            let discNode: SCNNode
+            if let existing = discNodes[slotId] {
+                discNode = existing
+                discNode.geometry = discGeometry(style)
+            } else {
+                discNode = makeDiscNode(style: style)
+                discNode.name = "disc_\(slotId)"
                 discNode.position = SCNVector3(0, Float(discRadius), 0)
                 groupNode.addChildNode(discNode)
-                discNodes[slot.id] = discNode
-            } else if !hasFull, let existing = discNodes[slot.id], !animatingSlotIds.contains(slot.id) {
-                existing.removeFromParentNode()
-                discNodes.removeValue(forKey: slot.id)
-            } else if hasFull, let existing = discNodes[slot.id] {
-                updateDiscMaterial(node: existing, discType: slot.discType)
+                discNodes[slotId] = discNode
             }
+            let scale: Float = style.emphasis == .selected ? 1.05 : 1
+            discNode.scale = SCNVector3(scale, scale, scale)
+        } else if let existing = discNodes.removeValue(forKey: slotId) {
+            existing.removeFromParentNode()
+        }
+    }
+
+    /// Bring a slot in line with the latest state once its transfer animation is done
+    private func settleSlot(_ slotId: Int) {
+        animatingSlotIds.remove(slotId)
+        if let visual = slotDiff.visuals[slotId] {
+            apply(visual, toSlot: slotId)
         }
-        highlightedSlotId = selectedSlotId
     }
 
     func updateDriveDisc(driveStatus: DriveStatus) {
@@ -229,7 +262,7 @@ class CarouselSceneController {
 
         switch driveStatus {
         case .loaded(_, _), .loading(_):
-            let disc = makeDiscNode(discType: .unscanned)
+            let disc = makeDiscNode(style: CarouselDiscStyle(discType: .unscanned, emphasis: .none))
             disc.name = "drive_disc"
             disc.position = SCNVector3(0, 0, 0)
             disc.scale = SCNVector3(0.45, 0.45, 0.45)
@@ -248,40 +281,12 @@ class CarouselSceneController {
     // MARK: - Selection & Hover
 
     func highlightSlot(_ slotId: Int?) {
-        // Clear previous
-        if let prevId = highlightedSlotId {
-            if let prevGroup = slotNodes[prevId] {
-                if let divider = prevGroup.childNodes.first(where: { $0.geometry is SCNBox }) {
-                    divider.geometry?.firstMaterial = slotDividerMaterial(isEmpty: discNodes[prevId] == nil, isSelected: false)
-                }
-            }
-            // Remove selected glow from previous disc
-            if let prevDisc = discNodes[prevId] {
-                setDiscEmission(prevDisc, color: NSColor.black)
-                prevDisc.scale = SCNVector3(1, 1, 1)
-            }
-        }
+        apply(slotDiff.select(slotId))
 
         selectedLabelNode?.removeFromParentNode()
         selectedLabelNode = nil
 
-        guard let slotId = slotId, let groupNode = slotNodes[slotId] else {
-            highlightedSlotId = nil
-            return
-        }
-
-        highlightedSlotId = slotId
-
-        // Highlight divider
-        if let divider = groupNode.childNodes.first(where: { $0.geometry is SCNBox }) {
-            divider.geometry?.firstMaterial = slotDividerMaterial(isEmpty: discNodes[slotId] == nil, isSelected: true)
-        }
-
-        // Strong glow on selected disc
-        if let discNode = discNodes[slotId] {
-            setDiscEmission(discNode, color: NSColor(white: 0.4, alpha: 1.0))
-            discNode.scale = SCNVector3(1.05, 1.05, 1.05)
-        }
+        guard let slotId = slotId, let groupNode = slotNodes[slotId] else { return }
 
         // Floating label
         let label = makeLabel("Slot \(slotId)")
@@ -292,31 +297,8 @@ class CarouselSceneController {
     }
 
     func hoverSlot(_ slotId: Int?) {
-        // Unhover previous
-        if let prevId = hoveredSlotId, prevId != highlightedSlotId {
-            if let prevGroup = slotNodes[prevId] {
-                if let divider = prevGroup.childNodes.first(where: { $0.geometry is SCNBox }) {
-                    divider.geometry?.firstMaterial = slotDividerMaterial(isEmpty: discNodes[prevId] == nil, isSelected: false)
-                }
-            }
-            if let prevDisc = discNodes[prevId] {
-                setDiscEmission(prevDisc, color: NSColor.black)
-            }
-        }
-
-        hoveredSlotId = slotId
-
-        guard let slotId = slotId, slotId != highlightedSlotId, let groupNode = slotNodes[slotId] else { return }
-
-        // Hover divider
-        if let divider = groupNode.childNodes.first(where: { $0.geometry is SCNBox }) {
-            divider.geometry?.firstMaterial = slotDividerMaterial(isEmpty: false, isSelected: false, hovered: true)
-        }
-
-        // Subtle glow on hovered disc
-        if let discNode = discNodes[slotId] {
-            setDiscEmission(discNode, color: NSColor(white: 0.2, alpha: 1.0))
-        }
+        guard slotId != slotDiff.hoveredSlotId else { return }
+        apply(slotDiff.hover(slotId))
     }
 
     // MARK: - Rotation
@@ -395,10 +377,13 @@ class CarouselSceneController {
         ])
 
         discNode.runAction(sequence) { [weak self] in
-            self?.discNodes.removeValue(forKey: slotId)
-            self?.animatingSlotIds.remove(slotId)
             DispatchQueue.main.async {
-                self?.showDriveDisc()
+                guard let self = self else { return }
+                if self.discNodes[slotId] === discNode {
+                    self.discNodes.removeValue(forKey: slotId)
+                }
+                self.settleSlot(slotId)
+                self.showDriveDisc()
             }
         }
     }
@@ -425,7 +410,8 @@ class CarouselSceneController {
             }
 
             // Create disc at drive entrance in world space (scene root)
-            let discNode = self.makeDiscNode(discType: .unscanned)
+            self.discNodes.removeValue(forKey: slotId)?.removeFromParentNode()
+            let discNode = self.makeDiscNode(style: CarouselDiscStyle(discType: .unscanned, emphasis: .none))
             discNode.name = "disc_\(slotId)"
             discNode.position = driveStart
             discNode.eulerAngles = SCNVector3(0, 0, Float.pi / 2)
@@ -451,7 +437,9 @@ class CarouselSceneController {
             }
 
             discNode.runAction(SCNAction.sequence([fadeIn, slideOut, reparentToSlot])) { [weak self] in
-                self?.animatingSlotIds.remove(slotId)
+                DispatchQueue.main.async {
+                    self?.settleSlot(slotId)
+                }
             }
             self.discNodes[slotId] = discNode
         }
@@ -493,8 +481,13 @@ class CarouselSceneController {
         ])
 
         discNode.runAction(sequence) { [weak self] in
-            self?.discNodes.removeValue(forKey: slotId)
-            self?.animatingSlotIds.remove(slotId)
+            DispatchQueue.main.async {
+                guard let self = self else { return }
+                if self.discNodes[slotId] === discNode {
+                    self.discNodes.removeValue(forKey: slotId)
+                }
+                self.settleSlot(slotId)
+            }
         }
     }
 
@@ -572,7 +565,7 @@ class CarouselSceneController {
 
     private func showDriveDisc() {
         driveDiscNode?.removeFromParentNode()
-        let disc = makeDiscNode(discType: .unscanned)
+        let disc = makeDiscNode(style: CarouselDiscStyle(discType: .unscanned, emphasis: .none))
         disc.name = "drive_disc"
         disc.position = SCNVector3(0, 0, 0)
         disc.scale = SCNVector3(0.45, 0.45, 0.45)
@@ -582,30 +575,12 @@ class CarouselSceneController {
         driveDiscNode = disc
     }
 
-    private func makeDiscNode(discType: SlotDiscType) -> SCNNode {
-        let tube = SCNTube(innerRadius: discHoleRadius, outerRadius: discRadius, height: discThickness)
-        let mat = discMaterial(for: discType)
-        tube.materials = [mat, mat, mat, mat]
-        let node = SCNNode(geometry: tube)
+    private func makeDiscNode(style: CarouselDiscStyle) -> SCNNode {
+        let node = SCNNode(geometry: discGeometry(style))
         node.eulerAngles = SCNVector3(0, 0, Float.pi / 2)
         return node
     }
 
-    private func updateDiscMaterial(node: SCNNode, discType: SlotDiscType) {
-        let mat = discMaterial(for: discType)
-        if let tube = node.geometry as? SCNTube {
-            tube.materials = [mat, mat, mat, mat]
-        }
-    }
-
-    private func setDiscEmission(_ node: SCNNode, color: NSColor) {
-        if let tube = node.geometry as? SCNTube {
-            for mat in tube.materials {
-                mat.emission.contents = color
-            }
-        }
-    }
-
     private func makeLabel(_ text: String) -> SCNNode {
         let textGeo = SCNText(string: text, extrusionDepth: 0)
         textGeo.font = NSFont.systemFont(ofSize: 0.12, weight: .medium)
@@ -627,6 +602,27 @@ class CarouselSceneController {
         boxNode.geometry?.firstMaterial = shadedMaterial(color: color, edgeBrightness: 0.15)
     }
 
+    // MARK: - Geometry Cache
+
+    /// Copies of a geometry share its vertex data but carry their own materials, so each
+    /// material key costs one small geometry object no matter how many slots use it.
+    private func dividerGeometry(_ style: CarouselDividerStyle) -> SCNGeometry {
+        if let geometry = dividerGeometries[style] { return geometry }
+        let geometry = dividerShape.copy() as! SCNGeometry
+        geometry.materials = [slotDividerMaterial(style: style)]
+        dividerGeometries[style] = geometry
+        return geometry
+    }
+
+    private func discGeometry(_ style: CarouselDiscStyle) -> SCNGeometry {
+        if let geometry = discGeometries[style] { return geometry }
+        let geometry = discShape.copy() as! SCNGeometry
+        let mat = discMaterial(for: style)
+        geometry.materials = [mat, mat, mat, mat]
+        discGeometries[style] = geometry
+        return geometry
+    }
+
     // MARK: - Materials
 
     private func shadedMaterial(color: NSColor, edgeBrightness: Float = 0.25, shininess: CGFloat = 0.3) -> SCNMaterial {
@@ -645,14 +641,19 @@ class CarouselSceneController {
         return mat
     }
 
-    private func discMaterial(for discType: SlotDiscType) -> SCNMaterial {
-        let color = discFillColor(for: discType)
+    private func discMaterial(for style: CarouselDiscStyle) -> SCNMaterial {
+        let color = discFillColor(for: style.discType)
         let mat = SCNMaterial()
         mat.diffuse.contents = color
         mat.specular.contents = NSColor(white: 0.5, alpha: 1.0)
         mat.shininess = 0.6
         mat.lightingModel = .phong
         mat.isDoubleSided = true
+        switch style.emphasis {
+        case .selected: mat.emission.contents = NSColor(white: 0.4, alpha: 1.0)
+        case .hovered:  mat.emission.contents = NSColor(white: 0.2, alpha: 1.0)
+        case .none:     break
+        }
         mat.shaderModifiers = [
             .fragment: """
             float fresnel = pow(1.0 - abs(dot(_surface.normal, normalize(_surface.view))), 2.5);
@@ -662,18 +663,19 @@ class CarouselSceneController {
         return mat
     }
 
-    private func slotDividerMaterial(isEmpty: Bool, isSelected: Bool, hovered: Bool = false) -> SCNMaterial {
+    private func slotDividerMaterial(style: CarouselDividerStyle) -> SCNMaterial {
         let mat = SCNMaterial()
         mat.lightingModel = .phong
         mat.isDoubleSided = true
-        if isSelected {
+        switch style {
+        case .selected:
             mat.diffuse.contents = NSColor.white
             mat.emission.contents = NSColor(white: 0.3, alpha: 1.0)
-        } else if hovered {
+        case .hovered:
             mat.diffuse.contents = NSColor(white: 0.55, alpha: 1.0)
-        } else if isEmpty {
+        case .empty:
             mat.diffuse.contents = NSColor(white: 0.2, alpha: 1.0)
-        } else {
+        case .full:
             mat.diffuse.contents = NSColor(white: 0.35, alpha: 1.0)
         }
         return mat
@@ -29,6 +29,8 @@ struct SFSymbol: View {
         case "circle.dashed": return "○"
         case "server.rack": return "▦"
         case "externaldrive.fill", "externaldrive": return "💾"
+        case "folder.fill", "folder": return "📁"
+        case "shippingbox": return "📦"
         case "arrow.clockwise": return "↻"
         case "arrow.uturn.backward": return "↩"
         case "arrow.right.circle": return "→"
@@ -68,20 +68,17 @@ struct InventoryCarouselView: View {
                 hasBuilt = true
             }
         }
-        .onReceive(viewModel.$slots) { newSlots in
-            guard !newSlots.isEmpty else { return }
-            if !hasBuilt {
+        .onReceive(viewModel.slotChanges) { changes in
+            guard !viewModel.slots.isEmpty else { return }
+            if !hasBuilt || changes.isReset {
                 controller.buildSlots(
-                    slots: newSlots,
+                    slots: viewModel.slots,
                     driveStatus: viewModel.driveStatus,
                     selectedSlotId: viewModel.selectedSlotId
                 )
                 hasBuilt = true
             } else {
-                controller.updateSlotStates(
-                    slots: newSlots,
-                    selectedSlotId: viewModel.selectedSlotId
-                )
+                controller.updateSlotStates(changed: changes.slots)
             }
         }
         .onReceive(viewModel.$selectedSlotId) { newId in
@@ -116,6 +116,7 @@ struct InventoryGridView: View {
                                 isSelectedForRip: viewModel.selectedSlotsForRip.contains(slot.id),
                                 cellSize: CGSize(width: cellW, height: cellH)
                             )
+                            .equatable()
                             .onTapGesture {
                                 handleSlotTap(slot)
                             }
@@ -41,6 +41,7 @@ struct InventoryListView: View {
                     isSelectedForRip: viewModel.selectedSlotsForRip.contains(slot.id),
                     onLoad: (slot.isFull && !slot.isInDrive) ? { viewModel.loadSlotWithEjectIfNeeded(slot.id) } : nil
                 )
+                .equatable()
                 .contentShape(Rectangle())
                 .onTapGesture {
                     viewModel.selectedSlotId = slot.id
@@ -343,6 +344,17 @@ struct SlotRowView: View {
     }
 }
 
+/// Compared with `.equatable()` so a refresh only re-renders rows whose slot or selection changed.
+/// `onLoad` is rebuilt on every parent render, so only its presence is compared.
+extension SlotRowView: Equatable {
+    static func == (lhs: SlotRowView, rhs: SlotRowView) -> Bool {
+        lhs.slot == rhs.slot
+            && lhs.isSelected == rhs.isSelected
+            && lhs.isSelectedForRip == rhs.isSelectedForRip
+            && (lhs.onLoad == nil) == (rhs.onLoad == nil)
+    }
+}
+
 #if DEBUG
 struct InventoryListView_Previews: PreviewProvider {
     static var previews: some View {
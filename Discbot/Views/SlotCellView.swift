@@ -216,6 +216,16 @@ struct SlotCellView: View {
     }
 }
 
+/// Compared with `.equatable()` so a refresh only re-renders cells whose slot or selection changed
+extension SlotCellView: Equatable {
+    static func == (lhs: SlotCellView, rhs: SlotCellView) -> Bool {
+        lhs.slot == rhs.slot
+            && lhs.isSelected == rhs.isSelected
+            && lhs.isSelectedForRip == rhs.isSelectedForRip
+            && lhs.cellSize == rhs.cellSize
+    }
+}
+
 // Tooltip wrapper for macOS 10.15
 struct TooltipView: NSViewRepresentable {
     let tooltip: String
@@ -0,0 +1,53 @@
+// swift-tools-version:5.5
+//
+// The parts of Discbot that need no AppKit or changer hardware: the changer simulator,
+// the batch runners, the catalog and the portable C. It builds on macOS and Linux so
+// they can be tested without a changer. The app itself is built from discbot.xcodeproj.
+
+import PackageDescription
+
+let package = Package(
+    name: "Discbot",
+    platforms: [.macOS(.v10_15)],
+    products: [
+        .executable(name: "discbot-headless", targets: ["discbot-headless"]),
+    ],
+    targets: [
+        .target(
+            name: "CDiscbot",
+            path: "Discbot/Bridging",
+            sources: ["discid.c", "toc.c", "volinfo.c", "isotree.c", "imagewriter.c", "sha256.c"],
+            publicHeadersPath: "include",
+            linkerSettings: [.linkedLibrary("sqlite3")]
+        ),
+        .target(
+            name: "DiscbotCore",
+            dependencies: ["CDiscbot"],
+            path: "Discbot",
+            exclude: ["Bridging", "Resources"],
+            sources: [
+                "Models",
+                "Persistence",
+                "Services",
+                "App/BenchmarkRunner.swift",
+                "App/ControlCommand.swift",
+                "App/DaemonRunner.swift",
+                "App/HeadlessMode.swift",
+                "ViewModels/BatchOperationState.swift",
+                "ViewModels/CarouselSlotDiff.swift",
+            ],
+            // Leaves out mchanger and the DiskArbitration mount service
+            swiftSettings: [.define("DISCBOT_NO_HARDWARE")]
+        ),
+        .executableTarget(
+            name: "discbot-headless",
+            dependencies: ["DiscbotCore"],
+            path: "Sources/discbot-headless"
+        ),
+        .testTarget(
+            name: "DiscbotCoreTests",
+            dependencies: ["DiscbotCore"],
+            path: "Tests/DiscbotCoreTests"
+        ),
+    ]
+)
@@ -0,0 +1,19 @@
+//
+//  main.swift
+//  discbot-headless
+//
+//  Entry point for the Swift package build, which has no UI
+//
+
+import Foundation
+import DiscbotCore
+
+HeadlessMode.runIfRequested()
+
+FileHandle.standardError.write(Data("""
+    usage: discbot-headless --benchmark [--output <path>] [--seed <n>] [--scenario <name>]
+           discbot-headless --daemon (--simulate | --mock) [daemon options]
+           discbot-headless --ctl [--socket <path>] <command>
+
+    """.utf8))
+exit(64)
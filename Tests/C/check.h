@@ -0,0 +1,50 @@
+/*
+ * check.h - Minimal assertions for the portable C tests
+ *
+ * Each test file includes this once, calls its tests from main and
+ * returns check_report(). A failed check prints its location and the
+ * test carries on, so one run shows every failure.
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static int check_count;
+static int check_failures;
+
+#define CHECK(cond) do { \
+    check_count++; \
+    if (!(cond)) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_INT(actual, expected) do { \
+    long long check_a = (long long)(actual), check_e = (long long)(expected); \
+    check_count++; \
+    if (check_a != check_e) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, check_a, check_e); \
+    } \
+} while (0)
+
+#define CHECK_STR(actual, expected) do { \
+    const char *check_a = (actual), *check_e = (expected); \
+    check_count++; \
+    if (strcmp(check_a, check_e) != 0) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, check_a, check_e); \
+    } \
+} while (0)
+
+static int check_report(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, check_count, check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
+
+#endif /* CHECK_H */
@@ -0,0 +1,100 @@
+/*
+ * test_discid.c - MusicBrainz and FreeDB disc IDs against known vectors
+ *
+ * The first two vectors are the ones published with libdiscid and in the
+ * MusicBrainz disc ID documentation; the rest were computed with an
+ * independent implementation (SHA-1 of the hex TOC, MusicBrainz base64).
+ */
+
+#include "check.h"
+#include "../../Discbot/Bridging/discid.h"
+
+typedef struct {
+    const char *name;
+    int first_track;
+    int last_track;
+    uint32_t leadout;
+    uint32_t offsets[DISCID_MAX_TRACKS];
+    const char *mb_id;
+    const char *freedb_id;
+} vector_t;
+
+static const vector_t vectors[] = {
+    {
+        "libdiscid test_put", 1, 10, 206535,
+        { 150, 18901, 39738, 59557, 79152, 100126, 124833, 147278, 166336, 182560 },
+        "Wn8eRBtfLDfM0qjYPdxrz.Zjs_U-", "830abf0a",
+    },
+    {
+        "MusicBrainz documentation", 1, 6, 95462,
+        { 150, 15363, 32314, 46592, 63414, 80489 },
+        "49HHV7Eb8UKF3aQiNmu1GR8vKTY-", "3404f606",
+    },
+    {
+        "single track", 1, 1, 20000,
+        { 150 },
+        "vqTXXJKiuhBULri5fBp9_cTNgIo-", "02010801",
+    },
+    {
+        "first track 3", 3, 5, 60000,
+        { 150, 20000, 40000 },
+        "IeHJ.FDAhjIGiXCM7Vk4j0t8lt8-", "1b031e03",
+    },
+};
+
+static void test_vectors(void) {
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const vector_t *v = &vectors[i];
+        char mb_id[DISCID_MB_SIZE];
+        char freedb_id[DISCID_FREEDB_SIZE];
+        int count = v->last_track - v->first_track + 1;
+        CHECK_INT(discid_compute(v->first_track, v->last_track, v->leadout, v->offsets, count, mb_id, freedb_id), 0);
+        CHECK_STR(mb_id, v->mb_id);
+        CHECK_STR(freedb_id, v->freedb_id);
+    }
+}
+
+static void test_ninety_nine_tracks(void) {
+    uint32_t offsets[DISCID_MAX_TRACKS];
+    for (int i = 0; i < DISCID_MAX_TRACKS; i++) {
+        offsets[i] = 150 + (uint32_t)i * 3000;
+    }
+    char mb_id[DISCID_MB_SIZE];
+    char freedb_id[DISCID_FREEDB_SIZE];
+    CHECK_INT(discid_compute(1, 99, 150 + 99 * 3000, offsets, 99, mb_id, freedb_id), 0);
+    CHECK_STR(mb_id, "pinRQIBabDJDivs6UF.jfPUe3.k-");
+    CHECK_STR(freedb_id, "960f7863");
+}
+
+static void test_either_output_optional(void) {
+    const vector_t *v = &vectors[0];
+    char mb_id[DISCID_MB_SIZE];
+    char freedb_id[DISCID_FREEDB_SIZE];
+    CHECK_INT(discid_compute(1, 10, v->leadout, v->offsets, 10, mb_id, NULL), 0);
+    CHECK_STR(mb_id, v->mb_id);
+    CHECK_INT(discid_compute(1, 10, v->leadout, v->offsets, 10, NULL, freedb_id), 0);
+    CHECK_STR(freedb_id, v->freedb_id);
+}
+
+static void test_invalid_tocs(void) {
+    const uint32_t offsets[] = { 150, 18901, 39738 };
+    char mb_id[DISCID_MB_SIZE];
+
+    CHECK_INT(discid_compute(1, 3, 60000, NULL, 3, mb_id, NULL), -1);
+    CHECK_INT(discid_compute(0, 2, 60000, offsets, 3, mb_id, NULL), -1);         /* No track 0 */
+    CHECK_INT(discid_compute(3, 1, 60000, offsets, 3, mb_id, NULL), -1);         /* Last before first */
+    CHECK_INT(discid_compute(98, 100, 60000, offsets, 3, mb_id, NULL), -1);      /* Past track 99 */
+    CHECK_INT(discid_compute(1, 3, 60000, offsets, 2, mb_id, NULL), -1);         /* Count disagrees */
+    CHECK_INT(discid_compute(1, 3, 39738, offsets, 3, mb_id, NULL), -1);         /* Lead-out inside a track */
+
+    const uint32_t unordered[] = { 150, 39738, 18901 };
+    CHECK_INT(discid_compute(1, 3, 60000, unordered, 3, mb_id, NULL), -1);
+}
+
+int main(void) {
+    test_vectors();
+    test_ninety_nine_tracks();
+    test_either_output_optional();
+    test_invalid_tocs();
+    return check_report("discid");
+}
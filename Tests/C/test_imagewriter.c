@@ -0,0 +1,265 @@
+/*
+ * test_imagewriter.c - imagewriter against files in a scratch directory
+ *
+ * Each test writes a patterned image through the writer and reads the
+ * result back. The scratch directory sits beside the tests rather than in
+ * /tmp, whose tmpfs may refuse O_DIRECT and preallocation; on a volume that
+ * supports both, the unaligned tails below exercise the padding that commit
+ * trims off again.
+ */
+
+#include "check.h"
+#include "../../Discbot/Bridging/imagewriter.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define BUFFER_SIZE (64u * 1024u)
+
+static char directory[] = "imagewriter-XXXXXX";
+static char image_path[64];
+static char part_path[80];
+
+static uint8_t pattern_byte(uint64_t offset) {
+    return (uint8_t)(offset * 31 + (offset >> 11));
+}
+
+static bool exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static long long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_size : -1;
+}
+
+/* Write size bytes of the pattern in chunk-sized pieces, which need not line up with the buffer */
+static int write_pattern(imagewriter_t *writer, uint64_t size, size_t chunk) {
+    uint8_t *buf = malloc(chunk);
+    if (!buf) return -1;
+    int result = 0;
+    for (uint64_t offset = 0; offset < size && result == 0; offset += chunk) {
+        size_t len = size - offset < chunk ? (size_t)(size - offset) : chunk;
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = pattern_byte(offset + i);
+        }
+        result = imagewriter_write(writer, buf, len);
+    }
+    free(buf);
+    return result;
+}
+
+/* The whole file is the pattern, with nothing after it */
+static bool matches_pattern(const char *path, uint64_t size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    bool same = true;
+    uint64_t offset = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (offset >= size || (uint8_t)c != pattern_byte(offset)) {
+            same = false;
+            break;
+        }
+        offset++;
+    }
+    fclose(file);
+    return same && offset == size;
+}
+
+static imagewriter_options_t options_with(imagewriter_sync_t sync, bool bypass_cache) {
+    imagewriter_options_t options;
+    imagewriter_default_options(&options);
+    options.buffer_size = BUFFER_SIZE;
+    options.sync = sync;
+    options.bypass_cache = bypass_cache;
+    return options;
+}
+
+/* MARK: - Tests */
+
+static void test_default_options(void) {
+    imagewriter_options_t options;
+    memset(&options, 0xff, sizeof(options));
+    imagewriter_default_options(&options);
+    CHECK_INT(options.expected_size, 0);
+    CHECK_INT(options.buffer_size, 1u << 20);
+    CHECK_INT(options.sync, IMAGEWRITER_SYNC_AT_END);
+    CHECK(options.bypass_cache);
+}
+
+/* A tail that is not a multiple of the alignment is padded for O_DIRECT and trimmed at commit */
+static void test_commit_writes_exact_size(bool bypass_cache) {
+    const uint64_t sizes[] = { 0, 1, 4095, 4097, BUFFER_SIZE, 3 * BUFFER_SIZE + 1234 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        imagewriter_options_t options = options_with(IMAGEWRITER_SYNC_AT_END, bypass_cache);
+        imagewriter_t *writer = imagewriter_open(image_path, &options);
+        CHECK(writer != NULL);
+        if (!writer) continue;
+
+        CHECK_INT(write_pattern(writer, sizes[i], 5000), 0);
+        CHECK_INT(imagewriter_bytes_written(writer), sizes[i]);
+        CHECK_INT(imagewriter_commit(writer), 0);
+        imagewriter_close(writer);
+
+        CHECK_INT(file_size(image_path), sizes[i]);
+        CHECK(matches_pattern(image_path, sizes[i]));
+        CHECK(!exists(part_path));
+        unlink(image_path);
+    }
+}
+
+static void test_part_file_is_renamed_only_on_commit(void) {
+    /* An older image stays in place until the new one is committed over it */
+    FILE *old = fopen(image_path, "wb");
+    CHECK(old != NULL);
+    if (old) {
+        fputs("old image", old);
+        fclose(old);
+    }
+
+    imagewriter_options_t options = options_with(IMAGEWRITER_SYNC_AT_END, true);
+    imagewriter_t *writer = imagewriter_open(image_path, &options);
+    CHECK(writer != NULL);
+    if (!writer) return;
+    CHECK(exists(part_path));
+
+    CHECK_INT(write_pattern(writer, 2 * BUFFER_SIZE + 7, 8192), 0);
+    CHECK(exists(part_path));
+    CHECK_INT(file_size(image_path), 9);
+
+    CHECK_INT(imagewriter_commit(writer), 0);
+    CHECK(!exists(part_path));
+    CHECK(matches_pattern(image_path, 2 * BUFFER_SIZE + 7));
+
+    /* A committed writer accepts nothing more, and closing it keeps the image */
+    errno = 0;
+    CHECK_INT(imagewriter_write(writer, "x", 1), -1);
+    CHECK_INT(errno, EBADF);
+    CHECK_INT(imagewriter_commit(writer), -1);
+    imagewriter_close(writer);
+    CHECK(matches_pattern(image_path, 2 * BUFFER_SIZE + 7));
+    unlink(image_path);
+}
+
+static void test_close_without_commit_removes_part_file(void) {
+    imagewriter_options_t options = options_with(IMAGEWRITER_SYNC_AT_END, true);
+    options.expected_size = 4 * BUFFER_SIZE;
+    imagewriter_t *writer = imagewriter_open(image_path, &options);
+    CHECK(writer != NULL);
+    if (!writer) return;
+
+    CHECK_INT(write_pattern(writer, BUFFER_SIZE + 100, 4096), 0);
+    CHECK(exists(part_path));
+    imagewriter_close(writer);
+    CHECK(!exists(part_path));
+    CHECK(!exists(image_path));
+}
+
+static void test_open_replaces_stale_part_file(void) {
+    FILE *stale = fopen(part_path, "wb");
+    CHECK(stale != NULL);
+    if (stale) {
+        fputs("left over from a crash, and longer than the new image", stale);
+        fclose(stale);
+    }
+
+    imagewriter_t *writer = imagewriter_open(image_path, NULL);
+    CHECK(writer != NULL);
+    if (!writer) return;
+    CHECK_INT(write_pattern(writer, 10, 10), 0);
+    CHECK_INT(imagewriter_commit(writer), 0);
+    imagewriter_close(writer);
+    CHECK(matches_pattern(image_path, 10));
+    unlink(image_path);
+}
+
+static void test_every_sync_policy(void) {
+    const imagewriter_sync_t policies[] = {
+        IMAGEWRITER_SYNC_NONE, IMAGEWRITER_SYNC_AT_END, IMAGEWRITER_SYNC_PER_CHUNK,
+    };
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        imagewriter_options_t options = options_with(policies[i], true);
+        imagewriter_t *writer = imagewriter_open(image_path, &options);
+        CHECK(writer != NULL);
+        if (!writer) continue;
+
+        const uint64_t size = 5 * BUFFER_SIZE + 512;
+        CHECK_INT(write_pattern(writer, size, 3 * BUFFER_SIZE), 0);
+        CHECK_INT(imagewriter_commit(writer), 0);
+        imagewriter_close(writer);
+        CHECK(matches_pattern(image_path, size));
+        unlink(image_path);
+    }
+}
+
+/* An over-estimated size is reserved up front and released again at commit */
+static void test_preallocation_is_trimmed(void) {
+    const uint64_t expected = 64 * BUFFER_SIZE;
+    const uint64_t size = BUFFER_SIZE / 2 + 3;
+    imagewriter_options_t options = options_with(IMAGEWRITER_SYNC_AT_END, true);
+    options.expected_size = expected;
+    imagewriter_t *writer = imagewriter_open(image_path, &options);
+    CHECK(writer != NULL);
+    if (!writer) return;
+
+    CHECK_INT(write_pattern(writer, size, 1000), 0);
+    CHECK_INT(imagewriter_commit(writer), 0);
+    imagewriter_close(writer);
+
+    struct stat st;
+    CHECK_INT(stat(image_path, &st), 0);
+    CHECK_INT(st.st_size, size);
+    CHECK((uint64_t)st.st_blocks * 512 < expected);
+    CHECK(matches_pattern(image_path, size));
+    unlink(image_path);
+}
+
+static void test_buffer_size_rounds_up_to_alignment(void) {
+    imagewriter_options_t options = options_with(IMAGEWRITER_SYNC_AT_END, true);
+    options.buffer_size = 1000;
+    imagewriter_t *writer = imagewriter_open(image_path, &options);
+    CHECK(writer != NULL);
+    if (!writer) return;
+
+    const uint64_t size = 3 * 4096 + 17;
+    CHECK_INT(write_pattern(writer, size, 777), 0);
+    CHECK_INT(imagewriter_commit(writer), 0);
+    imagewriter_close(writer);
+    CHECK(matches_pattern(image_path, size));
+    unlink(image_path);
+}
+
+static void test_open_failure(void) {
+    char missing[96];
+    snprintf(missing, sizeof(missing), "%s/missing/image.iso", directory);
+    errno = 0;
+    CHECK(imagewriter_open(missing, NULL) == NULL);
+    CHECK_INT(errno, ENOENT);
+}
+
+int main(void) {
+    if (!mkdtemp(directory)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(image_path, sizeof(image_path), "%s/image.iso", directory);
+    snprintf(part_path, sizeof(part_path), "%s.part", image_path);
+
+    test_default_options();
+    test_commit_writes_exact_size(true);
+    test_commit_writes_exact_size(false);
+    test_part_file_is_renamed_only_on_commit();
+    test_close_without_commit_removes_part_file();
+    test_open_replaces_stale_part_file();
+    test_every_sync_policy();
+    test_preallocation_is_trimmed();
+    test_buffer_size_rounds_up_to_alignment();
+    test_open_failure();
+
+    rmdir(directory);
+    return check_report("imagewriter");
+}
@@ -0,0 +1,709 @@
+/*
+ * test_isotree.c - isotree against file trees built in memory
+ *
+ * Each image carries just the structures isotree reads: ISO 9660 volume
+ * descriptors and directory records (with Joliet names or Rock Ridge
+ * system use entries), and a UDF anchor, volume descriptor sequence, file
+ * set descriptor, file entries and file identifier descriptors. File data
+ * is never read, so the extents point at empty sectors.
+ */
+
+#include "check.h"
+#include "../../Discbot/Bridging/isotree.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define SECTOR 2048u
+#define TIME_2001_09_09 1000000000      /* 2001-09-09 01:46:40 UTC, the time every fixture records */
+
+typedef struct {
+    uint8_t *bytes;
+    size_t size;
+} image_t;
+
+static image_t image_new(size_t sectors) {
+    image_t image = { calloc(sectors, SECTOR), sectors * SECTOR };
+    return image;
+}
+
+static uint8_t *sector_at(image_t *image, uint32_t lba) {
+    return image->bytes + (size_t)lba * SECTOR;
+}
+
+static long image_read(void *ctx, uint64_t offset, void *buf, size_t len) {
+    const image_t *image = ctx;
+    if (offset >= image->size) return 0;
+    size_t n = image->size - offset < len ? (size_t)(image->size - offset) : len;
+    memcpy(buf, image->bytes + offset, n);
+    return (long)n;
+}
+
+static void put_le16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_le32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+static void put_le64(uint8_t *p, uint64_t v) { put_le32(p, (uint32_t)v); put_le32(p + 4, (uint32_t)(v >> 32)); }
+static void put_be16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+static void put_be32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (24 - 8 * i)); }
+
+/* ISO 9660 both-byte-order fields */
+static void put_both16(uint8_t *p, uint16_t v) { put_le16(p, v); put_be16(p + 2, v); }
+static void put_both32(uint8_t *p, uint32_t v) { put_le32(p, v); put_be32(p + 4, v); }
+
+/* MARK: - Walk results */
+
+typedef struct {
+    char path[256];
+    uint64_t size;
+    int64_t modified;
+    uint32_t extent_count;
+    isotree_extent_t extents[4];
+} seen_file_t;
+
+typedef struct {
+    seen_file_t files[32];
+    int count;
+    int stop_after;                     /* Stop the walk after this many files; 0 never stops */
+} seen_t;
+
+static int collect(void *ctx, const isotree_file_t *file) {
+    seen_t *seen = ctx;
+    if (seen->count < 32) {
+        seen_file_t *f = &seen->files[seen->count];
+        snprintf(f->path, sizeof(f->path), "%s", file->path);
+        f->size = file->size;
+        f->modified = file->modified;
+        f->extent_count = file->extent_count;
+        for (uint32_t i = 0; i < file->extent_count && i < 4; i++) {
+            f->extents[i] = file->extents[i];
+        }
+    }
+    seen->count++;
+    return seen->stop_after && seen->count >= seen->stop_after;
+}
+
+static const seen_file_t *find(const seen_t *seen, const char *path) {
+    for (int i = 0; i < seen->count && i < 32; i++) {
+        if (strcmp(seen->files[i].path, path) == 0) return &seen->files[i];
+    }
+    return NULL;
+}
+
+static void check_single_extent(const seen_t *seen, const char *path, uint32_t lba, uint64_t size) {
+    const seen_file_t *f = find(seen, path);
+    CHECK(f != NULL);
+    if (!f) return;
+    CHECK_INT(f->size, size);
+    CHECK_INT(f->modified, TIME_2001_09_09);
+    CHECK_INT(f->extent_count, 1);
+    CHECK_INT(f->extents[0].offset, (uint64_t)lba * SECTOR);
+    CHECK_INT(f->extents[0].length, size);
+}
+
+/* MARK: - ISO 9660 builders */
+
+/* Rock Ridge system use entries for one directory record */
+typedef struct {
+    uint8_t bytes[160];
+    size_t len;
+} system_use_t;
+
+static void su_entry(system_use_t *su, const char *signature, const uint8_t *data, size_t data_len) {
+    uint8_t *entry = su->bytes + su->len;
+    entry[0] = (uint8_t)signature[0];
+    entry[1] = (uint8_t)signature[1];
+    entry[2] = (uint8_t)(4 + data_len);
+    entry[3] = 1;
+    if (data_len) memcpy(entry + 4, data, data_len);
+    su->len += 4 + data_len;
+}
+
+static void su_name(system_use_t *su, const char *name, uint8_t flags) {
+    uint8_t data[100] = { flags };
+    memcpy(data + 1, name, strlen(name));
+    su_entry(su, "NM", data, 1 + strlen(name));
+}
+
+static void su_child_link(system_use_t *su, uint32_t lba) {
+    uint8_t data[8];
+    put_both32(data, lba);
+    su_entry(su, "CL", data, sizeof(data));
+}
+
+/* Write one directory record at p; returns its length */
+static size_t put_record(uint8_t *p, uint32_t extent, uint32_t size, uint8_t flags,
+                         const uint8_t *id, size_t id_len, const system_use_t *su) {
+    size_t su_start = 33 + id_len + (id_len % 2 == 0 ? 1 : 0);
+    size_t len = su_start + (su ? su->len : 0);
+    len += len % 2;
+    p[0] = (uint8_t)len;
+    put_both32(p + 2, extent);
+    put_both32(p + 10, size);
+    const uint8_t recorded[7] = { 101, 9, 9, 1, 46, 40, 0 };
+    memcpy(p + 18, recorded, sizeof(recorded));
+    p[25] = flags;
+    put_both16(p + 28, 1);
+    p[32] = (uint8_t)id_len;
+    memcpy(p + 33, id, id_len);
+    if (su) memcpy(p + su_start, su->bytes, su->len);
+    return len;
+}
+
+/* A directory being filled in, one sector long unless a record is placed past it */
+typedef struct {
+    uint8_t *bytes;
+    size_t pos;
+    bool joliet;
+} directory_t;
+
+/* Start a directory at lba with its "." and ".." records; root_su goes on "." (the Rock Ridge SP) */
+static directory_t directory_begin(image_t *image, uint32_t lba, uint32_t parent, const system_use_t *root_su) {
+    directory_t d = { sector_at(image, lba), 0, false };
+    const uint8_t dot = 0, dotdot = 1;
+    d.pos += put_record(d.bytes + d.pos, lba, SECTOR, 0x02, &dot, 1, root_su);
+    d.pos += put_record(d.bytes + d.pos, parent, SECTOR, 0x02, &dotdot, 1, NULL);
+    return d;
+}
+
+/* Reopen the directory at lba to add records after its last one */
+static directory_t directory_reopen(image_t *image, uint32_t lba) {
+    directory_t d = { sector_at(image, lba), 0, false };
+    while (d.bytes[d.pos] != 0) d.pos += d.bytes[d.pos];
+    return d;
+}
+
+/* The record named id (as stored, e.g. "DOCS" or "README.TXT;1") in the directory at lba */
+static uint8_t *find_record(image_t *image, uint32_t lba, const char *id) {
+    uint8_t *dir = sector_at(image, lba);
+    for (size_t pos = 0; dir[pos] != 0; pos += dir[pos]) {
+        if (dir[pos + 32] == strlen(id) && memcmp(dir + pos + 33, id, strlen(id)) == 0) return dir + pos;
+    }
+    fprintf(stderr, "no record \"%s\" in sector %u\n", id, lba);
+    abort();
+}
+
+static void directory_add(directory_t *d, const char *name, uint32_t extent, uint32_t size, uint8_t flags, const system_use_t *su) {
+    uint8_t id[128];
+    size_t id_len = 0;
+    for (size_t i = 0; name[i]; i++) {
+        if (d->joliet) {
+            put_be16(id + id_len, (uint8_t)name[i]);
+            id_len += 2;
+        } else {
+            id[id_len++] = (uint8_t)name[i];
+        }
+    }
+    d->pos += put_record(d->bytes + d->pos, extent, size, flags, id, id_len, su);
+}
+
+static void put_volume_descriptor(image_t *image, uint32_t lba, uint8_t type, uint32_t root_lba, uint32_t root_size) {
+    uint8_t *vd = sector_at(image, lba);
+    vd[0] = type;
+    memcpy(vd + 1, "CD001", 5);
+    vd[6] = 1;
+    put_both16(vd + 128, SECTOR);
+    const uint8_t dot = 0;
+    put_record(vd + 156, root_lba, root_size, 0x02, &dot, 1, NULL);
+    if (type == 2) memcpy(vd + 88, "%/E", 3);
+}
+
+/* Primary volume descriptor, an optional Joliet one, then the terminator */
+static void put_iso(image_t *image, uint32_t root_lba, uint32_t joliet_root_lba) {
+    put_volume_descriptor(image, 16, 1, root_lba, SECTOR);
+    uint32_t next = 17;
+    if (joliet_root_lba) put_volume_descriptor(image, next++, 2, joliet_root_lba, SECTOR);
+    uint8_t *terminator = sector_at(image, next);
+    terminator[0] = 255;
+    memcpy(terminator + 1, "CD001", 5);
+    terminator[6] = 1;
+}
+
+/*
+ * The ISO 9660 tree:
+ *   BIG.BIN         two extents (sectors 31 and 35)
+ *   DOCS/EMPTY      no data
+ *   DOCS/GUIDE.PDF  3000 bytes at sector 33
+ *   README.TXT      100 bytes at sector 30
+ * The Joliet tree (sectors 22-23) names the same files "Read Me.txt" and
+ * "Documents/User Guide.pdf".
+ */
+static image_t plain_image(bool with_joliet) {
+    image_t image = image_new(40);
+    put_iso(&image, 20, with_joliet ? 22 : 0);
+
+    directory_t root = directory_begin(&image, 20, 20, NULL);
+    directory_add(&root, "BIG.BIN;1", 31, SECTOR, 0x80, NULL);
+    directory_add(&root, "BIG.BIN;1", 35, 500, 0x00, NULL);
+    directory_add(&root, "DOCS", 21, SECTOR, 0x02, NULL);
+    directory_add(&root, "README.TXT;1", 30, 100, 0x00, NULL);
+
+    directory_t docs = directory_begin(&image, 21, 20, NULL);
+    directory_add(&docs, "EMPTY.;1", 0, 0, 0x00, NULL);
+    directory_add(&docs, "GUIDE.PDF;1", 33, 3000, 0x00, NULL);
+
+    if (with_joliet) {
+        directory_t jroot = directory_begin(&image, 22, 22, NULL);
+        jroot.joliet = true;
+        directory_add(&jroot, "Documents", 23, SECTOR, 0x02, NULL);
+        directory_add(&jroot, "Read Me.txt;1", 30, 100, 0x00, NULL);
+
+        directory_t jdocs = directory_begin(&image, 23, 22, NULL);
+        jdocs.joliet = true;
+        directory_add(&jdocs, "User Guide.pdf;1", 33, 3000, 0x00, NULL);
+    }
+    return image;
+}
+
+/* MARK: - ISO 9660 / Joliet */
+
+static void test_iso9660(void) {
+    image_t image = plain_image(false);
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_ISO9660);
+    CHECK_INT(seen.count, 4);
+
+    /* Records in directory order, each subdirectory walked where it appears */
+    CHECK_STR(seen.files[0].path, "BIG.BIN");
+    CHECK_STR(seen.files[1].path, "DOCS/EMPTY");
+    CHECK_STR(seen.files[2].path, "DOCS/GUIDE.PDF");
+    CHECK_STR(seen.files[3].path, "README.TXT");
+
+    const seen_file_t *big = find(&seen, "BIG.BIN");
+    CHECK(big != NULL);
+    if (big) {
+        CHECK_INT(big->size, SECTOR + 500);
+        CHECK_INT(big->modified, TIME_2001_09_09);
+        CHECK_INT(big->extent_count, 2);
+        CHECK_INT(big->extents[0].offset, 31 * SECTOR);
+        CHECK_INT(big->extents[0].length, SECTOR);
+        CHECK_INT(big->extents[1].offset, 35 * SECTOR);
+        CHECK_INT(big->extents[1].length, 500);
+    }
+    const seen_file_t *empty = find(&seen, "DOCS/EMPTY");
+    CHECK(empty != NULL);
+    if (empty) {
+        CHECK_INT(empty->size, 0);
+        CHECK_INT(empty->extent_count, 0);
+    }
+    check_single_extent(&seen, "DOCS/GUIDE.PDF", 33, 3000);
+    check_single_extent(&seen, "README.TXT", 30, 100);
+    free(image.bytes);
+}
+
+static void test_multi_extent_file_merges_contiguous_runs(void) {
+    image_t image = image_new(40);
+    put_iso(&image, 20, 0);
+    directory_t root = directory_begin(&image, 20, 20, NULL);
+    directory_add(&root, "SPLIT.DAT;1", 30, SECTOR, 0x80, NULL);
+    directory_add(&root, "SPLIT.DAT;1", 31, SECTOR, 0x80, NULL);
+    directory_add(&root, "SPLIT.DAT;1", 32, 10, 0x00, NULL);
+
+    seen_t seen = { .count = 0 };
+    isotree_walk(image_read, &image, collect, &seen);
+    CHECK_INT(seen.count, 1);
+    check_single_extent(&seen, "SPLIT.DAT", 30, 2 * SECTOR + 10);
+    free(image.bytes);
+}
+
+static void test_joliet(void) {
+    image_t image = plain_image(true);
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_JOLIET);
+    CHECK_INT(seen.count, 2);
+    check_single_extent(&seen, "Documents/User Guide.pdf", 33, 3000);
+    check_single_extent(&seen, "Read Me.txt", 30, 100);
+    free(image.bytes);
+}
+
+/* MARK: - Rock Ridge */
+
+/*
+ * Rock Ridge over the plain tree's sectors, preferred to the Joliet tree:
+ *   a/b/deep.txt         b is relocated: its placeholder in a carries CL -> 24,
+ *                        and the real directory record in rr_moved carries RE
+ *   a long file name.txt one name split over two NM entries
+ *   rr_moved/            holds only the relocated directory, so lists nothing
+ */
+static image_t rock_ridge_image(void) {
+    image_t image = image_new(40);
+    put_iso(&image, 20, 22);
+
+    system_use_t sp = { .len = 0 };
+    const uint8_t sp_data[] = { 0xBE, 0xEF, 0 };
+    su_entry(&sp, "SP", sp_data, sizeof(sp_data));
+    directory_t root = directory_begin(&image, 20, 20, &sp);
+
+    system_use_t su = { .len = 0 };
+    su_name(&su, "a", 0);
+    directory_add(&root, "A", 21, SECTOR, 0x02, &su);
+
+    su = (system_use_t){ .len = 0 };
+    su_name(&su, "a long ", 0x01);
+    su_name(&su, "file name.txt", 0);
+    directory_add(&root, "A_LONG_F.TXT;1", 30, 100, 0x00, &su);
+
+    su = (system_use_t){ .len = 0 };
+    su_name(&su, "rr_moved", 0);
+    directory_add(&root, "RR_MOVED", 23, SECTOR, 0x02, &su);
+
+    directory_t a = directory_begin(&image, 21, 20, NULL);
+    su = (system_use_t){ .len = 0 };
+    su_name(&su, "b", 0);
+    su_child_link(&su, 24);
+    directory_add(&a, "B", 0, 0, 0x00, &su);
+
+    directory_t moved = directory_begin(&image, 23, 20, NULL);
+    su = (system_use_t){ .len = 0 };
+    su_name(&su, "b", 0);
+    su_entry(&su, "RE", NULL, 0);
+    directory_add(&moved, "B", 24, SECTOR, 0x02, &su);
+
+    directory_t b = directory_begin(&image, 24, 23, NULL);
+    su = (system_use_t){ .len = 0 };
+    su_name(&su, "deep.txt", 0);
+    directory_add(&b, "DEEP.TXT;1", 33, 3000, 0x00, &su);
+
+    /* A Joliet tree that must not be used */
+    directory_t jroot = directory_begin(&image, 22, 22, NULL);
+    jroot.joliet = true;
+    directory_add(&jroot, "Joliet.txt;1", 30, 100, 0x00, NULL);
+    return image;
+}
+
+static void test_rock_ridge(void) {
+    image_t image = rock_ridge_image();
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_ISO9660);
+    CHECK_INT(seen.count, 2);
+    check_single_extent(&seen, "a/b/deep.txt", 33, 3000);
+    check_single_extent(&seen, "a long file name.txt", 30, 100);
+    free(image.bytes);
+}
+
+static void test_rock_ridge_relocation_to_missing_directory(void) {
+    image_t image = rock_ridge_image();
+    /* The relocated directory's own "." record is gone, so there is nothing to walk */
+    memset(sector_at(&image, 24), 0, SECTOR);
+
+    seen_t seen = { .count = 0 };
+    isotree_walk(image_read, &image, collect, &seen);
+    CHECK_INT(seen.count, 1);
+    CHECK_STR(seen.files[0].path, "a long file name.txt");
+    free(image.bytes);
+}
+
+/* MARK: - Damaged trees */
+
+static void test_truncated_directory(void) {
+    /* The image ends inside DOCS, so only the root's files are listed */
+    image_t image = plain_image(false);
+    image.size = 21 * SECTOR + 100;
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_ISO9660);
+    CHECK_INT(seen.count, 2);
+    CHECK_STR(seen.files[0].path, "BIG.BIN");
+    CHECK_STR(seen.files[1].path, "README.TXT");
+    free(image.bytes);
+
+    /* A directory whose recorded size runs past the end of the image */
+    image = plain_image(false);
+    put_both32(find_record(&image, 20, "DOCS") + 10, 64 * SECTOR);
+    seen = (seen_t){ .count = 0 };
+    isotree_walk(image_read, &image, collect, &seen);
+    CHECK_INT(seen.count, 2);
+    free(image.bytes);
+
+    /* A record that claims to run past its directory ends the listing there */
+    image = plain_image(false);
+    uint8_t *readme = find_record(&image, 20, "README.TXT;1");
+    readme[0] = 0xFE;
+    put_both32(sector_at(&image, 16) + 156 + 10, (uint32_t)(readme - sector_at(&image, 20)) + 100);
+    seen = (seen_t){ .count = 0 };
+    isotree_walk(image_read, &image, collect, &seen);
+    CHECK_INT(seen.count, 3);
+    CHECK(find(&seen, "README.TXT") == NULL);
+    free(image.bytes);
+}
+
+static void test_looping_directories(void) {
+    image_t image = plain_image(false);
+    /* DOCS links back to the root, and the root to itself */
+    directory_t docs = directory_reopen(&image, 21);
+    directory_add(&docs, "UP", 20, SECTOR, 0x02, NULL);
+    directory_t root = directory_reopen(&image, 20);
+    directory_add(&root, "SELF", 20, SECTOR, 0x02, NULL);
+
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_ISO9660);
+    CHECK_INT(seen.count, 4);
+    free(image.bytes);
+
+    /* A Rock Ridge placeholder that relocates to its own ancestor */
+    image = rock_ridge_image();
+    system_use_t su = { .len = 0 };
+    su_name(&su, "loop", 0);
+    su_child_link(&su, 20);
+    directory_t b = directory_reopen(&image, 24);
+    directory_add(&b, "LOOP", 0, 0, 0x00, &su);
+
+    seen = (seen_t){ .count = 0 };
+    isotree_walk(image_read, &image, collect, &seen);
+    CHECK_INT(seen.count, 2);
+    free(image.bytes);
+}
+
+/* MARK: - UDF */
+
+#define UDF_PARTITION_START 300u
+
+static void udf_tag(uint8_t *tag, uint16_t id, uint32_t location) {
+    put_le16(tag, id);
+    put_le16(tag + 2, 2);
+    put_le32(tag + 12, location);
+    uint8_t sum = 0;
+    for (int i = 0; i < 16; i++) {
+        if (i != 4) sum = (uint8_t)(sum + tag[i]);
+    }
+    tag[4] = sum;
+}
+
+static uint8_t *udf_block(image_t *image, uint32_t lbn) {
+    return sector_at(image, UDF_PARTITION_START + lbn);
+}
+
+static void udf_timestamp(uint8_t *t) {
+    put_le16(t, 0x1000);                /* Local time, UTC offset 0 */
+    put_le16(t + 2, 2001);
+    const uint8_t rest[] = { 9, 9, 1, 46, 40 };
+    memcpy(t + 4, rest, sizeof(rest));
+}
+
+typedef struct {
+    uint32_t length;
+    uint32_t lbn;
+} udf_ad_t;
+
+enum { UDF_SHORT_AD = 0, UDF_LONG_AD = 1, UDF_EMBEDDED = 3 };
+
+/* A file entry (tag 261) or extended file entry (tag 266) at partition block lbn */
+static void put_udf_entry(image_t *image, uint32_t lbn, bool extended, uint8_t file_type, uint64_t size,
+                          int ad_type, const udf_ad_t *ads, int ad_count, const uint8_t *embedded) {
+    uint8_t *fe = udf_block(image, lbn);
+    fe[16 + 11] = file_type;
+    put_le16(fe + 16 + 18, (uint16_t)ad_type);
+    put_le64(fe + 56, size);
+    udf_timestamp(fe + (extended ? 92 : 84));
+
+    uint8_t *area = fe + (extended ? 216 : 176);
+    uint32_t l_ad = 0;
+    if (ad_type == UDF_EMBEDDED) {
+        memcpy(area, embedded, (size_t)size);
+        l_ad = (uint32_t)size;
+    } else {
+        for (int i = 0; i < ad_count; i++) {
+            put_le32(area + l_ad, ads[i].length);
+            put_le32(area + l_ad + 4, ads[i].lbn);
+            l_ad += ad_type == UDF_LONG_AD ? 16 : 8;
+        }
+    }
+    put_le32(fe + (extended ? 212 : 172), l_ad);
+    udf_tag(fe, extended ? 266 : 261, lbn);
+}
+
+/* A file identifier descriptor at p; returns its padded length */
+static size_t put_fid(uint8_t *p, uint8_t characteristics, uint32_t icb_lbn, const char *name) {
+    size_t name_len = name ? strlen(name) : 0;
+    uint8_t l_fi = name ? (uint8_t)(1 + name_len) : 0;
+    put_le16(p + 16, 1);
+    p[18] = characteristics;
+    p[19] = l_fi;
+    put_le32(p + 20, SECTOR);
+    put_le32(p + 24, icb_lbn);
+    if (name) {
+        p[38] = 8;
+        memcpy(p + 39, name, name_len);
+    }
+    udf_tag(p, 257, 0);
+    return (38u + l_fi + 3u) & ~3u;
+}
+
+/*
+ * The UDF tree, in a partition starting at sector 300:
+ *   block 0  file set descriptor, root at block 1
+ *   block 1  root file entry, its directory data in block 2
+ *   block 3  movie.vob: 5000 bytes in two short_ads (blocks 10 and 20)
+ *   block 4  VIDEO_TS extended file entry, directory data in block 5 via a long_ad
+ *   block 6  VIDEO_TS/VTS_01_0.IFO, 12 bytes embedded in its extended file entry
+ * Block 7 holds "loop", a directory entry whose data points back at the root's.
+ */
+static image_t udf_image(void) {
+    image_t image = image_new(UDF_PARTITION_START + 24);
+
+    uint32_t vds = 64;                          /* Clear of the ISO 9660 sectors a bridge test copies in */
+    uint8_t *anchor = sector_at(&image, 256);
+    put_le32(anchor + 16, 4 * SECTOR);
+    put_le32(anchor + 20, vds);
+    udf_tag(anchor, 2, 256);
+
+    uint8_t *pd = sector_at(&image, vds);
+    put_le16(pd + 22, 0);
+    put_le32(pd + 188, UDF_PARTITION_START);
+    udf_tag(pd, 5, vds);
+
+    uint8_t *lvd = sector_at(&image, vds + 1);
+    put_le32(lvd + 212, SECTOR);
+    put_le32(lvd + 248, SECTOR);
+    put_le32(lvd + 252, 0);                     /* File set descriptor at block 0 */
+    put_le32(lvd + 264, 6);
+    put_le32(lvd + 268, 1);
+    lvd[440] = 1;                               /* Type 1 map to partition 0 */
+    lvd[441] = 6;
+    put_le16(lvd + 442, 1);
+    put_le16(lvd + 444, 0);
+    udf_tag(lvd, 6, vds + 1);
+
+    udf_tag(sector_at(&image, vds + 2), 8, vds + 2);
+
+    uint8_t *fsd = udf_block(&image, 0);
+    put_le32(fsd + 400, SECTOR);
+    put_le32(fsd + 404, 1);
+    udf_tag(fsd, 256, 0);
+
+    uint8_t *dir = udf_block(&image, 2);
+    size_t len = put_fid(dir, 0x08, 1, NULL);
+    len += put_fid(dir + len, 0x00, 3, "movie.vob");
+    len += put_fid(dir + len, 0x02, 4, "VIDEO_TS");
+    len += put_fid(dir + len, 0x02, 7, "loop");
+    udf_ad_t root_data = { (uint32_t)len, 2 };
+    put_udf_entry(&image, 1, false, 4, len, UDF_SHORT_AD, &root_data, 1, NULL);
+
+    udf_ad_t movie[] = { { 2 * SECTOR, 10 }, { 904, 20 } };
+    put_udf_entry(&image, 3, false, 5, 2 * SECTOR + 904, UDF_SHORT_AD, movie, 2, NULL);
+
+    dir = udf_block(&image, 5);
+    len = put_fid(dir, 0x08, 1, NULL);
+    len += put_fid(dir + len, 0x00, 6, "VTS_01_0.IFO");
+    udf_ad_t video_ts_data = { (uint32_t)len, 5 };
+    put_udf_entry(&image, 4, true, 4, len, UDF_LONG_AD, &video_ts_data, 1, NULL);
+
+    const uint8_t ifo[12] = "DVDVIDEO-VTS";
+    put_udf_entry(&image, 6, true, 5, sizeof(ifo), UDF_EMBEDDED, NULL, 0, ifo);
+
+    /* Same directory data as the root, so walking it would list the root again */
+    put_udf_entry(&image, 7, false, 4, root_data.length, UDF_SHORT_AD, &root_data, 1, NULL);
+    return image;
+}
+
+static void test_udf(void) {
+    image_t image = udf_image();
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_UDF);
+
+    /*
+     * "loop" has its own file entry, so it is walked once (listing the root's
+     * children under loop/) but never into itself a second time.
+     */
+    const seen_file_t *movie = find(&seen, "movie.vob");
+    CHECK(movie != NULL);
+    if (movie) {
+        CHECK_INT(movie->size, 2 * SECTOR + 904);
+        CHECK_INT(movie->modified, TIME_2001_09_09);
+        CHECK_INT(movie->extent_count, 2);
+        CHECK_INT(movie->extents[0].offset, (UDF_PARTITION_START + 10) * SECTOR);
+        CHECK_INT(movie->extents[0].length, 2 * SECTOR);
+        CHECK_INT(movie->extents[1].offset, (UDF_PARTITION_START + 20) * SECTOR);
+        CHECK_INT(movie->extents[1].length, 904);
+    }
+    const seen_file_t *ifo = find(&seen, "VIDEO_TS/VTS_01_0.IFO");
+    CHECK(ifo != NULL);
+    if (ifo) {
+        CHECK_INT(ifo->size, 12);
+        CHECK_INT(ifo->modified, TIME_2001_09_09);
+        CHECK_INT(ifo->extent_count, 1);
+        CHECK_INT(ifo->extents[0].offset, (UDF_PARTITION_START + 6) * SECTOR + 216);
+        CHECK_INT(ifo->extents[0].length, 12);
+    }
+    CHECK(find(&seen, "loop/movie.vob") != NULL);
+    CHECK(find(&seen, "loop/VIDEO_TS/VTS_01_0.IFO") != NULL);
+    CHECK_INT(seen.count, 4);
+    free(image.bytes);
+}
+
+static void test_udf_directory_pointing_at_ancestor(void) {
+    image_t image = udf_image();
+    /* Re-point the "loop" entry at the root's own file entry */
+    uint8_t *dir = udf_block(&image, 2);
+    size_t loop_fid = 40 + 48 + 48;     /* After the parent, movie.vob and VIDEO_TS identifiers */
+    put_le32(dir + loop_fid + 24, 1);
+    udf_tag(dir + loop_fid, 257, 0);
+
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_UDF);
+    CHECK_INT(seen.count, 2);
+    CHECK(find(&seen, "movie.vob") != NULL);
+    CHECK(find(&seen, "VIDEO_TS/VTS_01_0.IFO") != NULL);
+    free(image.bytes);
+}
+
+static void test_udf_bad_checksum_falls_back_to_iso(void) {
+    image_t image = udf_image();
+    image_t iso = plain_image(false);
+    memcpy(image.bytes, iso.bytes, iso.size);
+    free(iso.bytes);
+    udf_block(&image, 1)[4] ^= 0xFF;        /* Root file entry */
+
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &image, collect, &seen), VOLINFO_FS_ISO9660);
+    CHECK_INT(seen.count, 4);
+    free(image.bytes);
+}
+
+/* MARK: - API */
+
+static void test_stop_and_blank(void) {
+    image_t image = plain_image(false);
+    seen_t seen = { .count = 0, .stop_after = 2 };
+    isotree_walk(image_read, &image, collect, &seen);
+    CHECK_INT(seen.count, 2);
+    free(image.bytes);
+
+    image_t blank = image_new(300);
+    seen = (seen_t){ .count = 0 };
+    CHECK_INT(isotree_walk(image_read, &blank, collect, &seen), 0);
+    CHECK_INT(seen.count, 0);
+    free(blank.bytes);
+
+    CHECK_INT(isotree_walk(NULL, NULL, collect, &seen), 0);
+}
+
+static void test_walk_path(void) {
+    image_t image = plain_image(true);
+    char path[] = "/tmp/isotree-test-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    CHECK_INT(write(fd, image.bytes, image.size), (long long)image.size);
+    close(fd);
+
+    seen_t seen = { .count = 0 };
+    CHECK_INT(isotree_walk_path(path, collect, &seen), VOLINFO_FS_JOLIET);
+    CHECK_INT(seen.count, 2);
+    CHECK_INT(isotree_walk_path("/nonexistent/discbot.iso", collect, &seen), 0);
+    unlink(path);
+    free(image.bytes);
+}
+
+int main(void) {
+    test_iso9660();
+    test_multi_extent_file_merges_contiguous_runs();
+    test_joliet();
+    test_rock_ridge();
+    test_rock_ridge_relocation_to_missing_directory();
+    test_truncated_directory();
+    test_looping_directories();
+    test_udf();
+    test_udf_directory_pointing_at_ancestor();
+    test_udf_bad_checksum_falls_back_to_iso();
+    test_stop_and_blank();
+    test_walk_path();
+    return check_report("isotree");
+}
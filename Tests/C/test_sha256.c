@@ -0,0 +1,83 @@
+/*
+ * test_sha256.c - SHA-256 against the FIPS 180-2 vectors
+ *
+ * Also checks that feeding the same bytes in uneven pieces, which takes
+ * the partial-block and direct-block paths in turn, gives the same digest.
+ */
+
+#include "check.h"
+#include "../../Discbot/Bridging/sha256.h"
+
+static void hex(const uint8_t digest[SHA256_DIGEST_SIZE], char out[SHA256_DIGEST_SIZE * 2 + 1]) {
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        snprintf(out + i * 2, 3, "%02x", digest[i]);
+    }
+}
+
+static void test_vectors(void) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    char text[SHA256_DIGEST_SIZE * 2 + 1];
+
+    sha256_digest("", 0, digest);
+    hex(digest, text);
+    CHECK_STR(text, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    sha256_digest("abc", 3, digest);
+    hex(digest, text);
+    CHECK_STR(text, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    const char *two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    sha256_digest(two_blocks, strlen(two_blocks), digest);
+    hex(digest, text);
+    CHECK_STR(text, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+static void test_million_a(void) {
+    static uint8_t a[1000000];
+    memset(a, 'a', sizeof(a));
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    char text[SHA256_DIGEST_SIZE * 2 + 1];
+
+    sha256_digest(a, sizeof(a), digest);
+    hex(digest, text);
+    CHECK_STR(text, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    sha256_t s;
+    sha256_init(&s);
+    size_t offset = 0, piece = 1;
+    while (offset < sizeof(a)) {
+        size_t take = piece < sizeof(a) - offset ? piece : sizeof(a) - offset;
+        sha256_update(&s, a + offset, take);
+        offset += take;
+        piece = piece * 3 + 7;
+    }
+    sha256_final(&s, digest);
+    hex(digest, text);
+    CHECK_STR(text, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+static void test_padding_boundaries(void) {
+    /* Lengths around the 56-byte mark, where the length no longer fits in
+     * the final block, against one-shot digests of the same bytes. */
+    uint8_t data[130];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 7 + 1);
+    }
+    for (size_t len = 50; len <= 130; len++) {
+        uint8_t whole[SHA256_DIGEST_SIZE], split[SHA256_DIGEST_SIZE];
+        sha256_digest(data, len, whole);
+        sha256_t s;
+        sha256_init(&s);
+        sha256_update(&s, data, len / 3);
+        sha256_update(&s, data + len / 3, len - len / 3);
+        sha256_final(&s, split);
+        CHECK(memcmp(whole, split, sizeof(whole)) == 0);
+    }
+}
+
+int main(void) {
+    test_vectors();
+    test_million_a();
+    test_padding_boundaries();
+    return check_report("sha256");
+}
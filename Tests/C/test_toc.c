@@ -0,0 +1,155 @@
+/*
+ * test_toc.c - Full TOC parsing and the disc ID track layout
+ *
+ * The blobs are READ TOC/PMA/ATIP format 0010b responses laid out as a
+ * drive returns them: the 4-byte header, then one 11-byte descriptor per
+ * line (session, ADR/CONTROL, TNO, POINT, MIN/SEC/FRAME, ZERO, PMIN/PSEC/PFRAME).
+ */
+
+#include "check.h"
+#include "../../Discbot/Bridging/discid.h"
+#include "../../Discbot/Bridging/toc.h"
+
+/* The MusicBrainz documentation disc: six audio tracks, track 3 with pre-emphasis */
+static const uint8_t audio_cd[] = {
+    0x00, 0x65, 0x01, 0x01,
+    0x01, 0x10, 0x00, 0xa0, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x01, 0x10, 0x00, 0xa1, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00,
+    0x01, 0x10, 0x00, 0xa2, 0x00, 0x00, 0x00, 0x00, 0x15, 0x0c, 0x3e,
+    0x01, 0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+    0x01, 0x10, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x03, 0x18, 0x3f,
+    0x01, 0x11, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x07, 0x0a, 0x40,
+    0x01, 0x10, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x15, 0x11,
+    0x01, 0x10, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x05, 0x27,
+    0x01, 0x10, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x11, 0x35, 0x0e,
+};
+
+/* Enhanced CD: two audio tracks, mode-5 B0/C0 pointers, then a CD-ROM XA data session */
+static const uint8_t enhanced_cd[] = {
+    0x00, 0x7b, 0x01, 0x02,
+    0x01, 0x10, 0x00, 0xa0, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x01, 0x10, 0x00, 0xa1, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00,
+    0x01, 0x10, 0x00, 0xa2, 0x00, 0x00, 0x00, 0x00, 0x08, 0x31, 0x3f,
+    0x01, 0x12, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+    0x01, 0x10, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x04, 0x0c, 0x01,
+    0x01, 0x50, 0x00, 0xb0, 0x00, 0x00, 0x00, 0x00, 0x0b, 0x13, 0x3f,
+    0x01, 0x50, 0x00, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x02, 0x14, 0x00, 0xa0, 0x00, 0x00, 0x00, 0x00, 0x03, 0x20, 0x00,
+    0x02, 0x14, 0x00, 0xa1, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00,
+    0x02, 0x14, 0x00, 0xa2, 0x00, 0x00, 0x00, 0x00, 0x0d, 0x14, 0x00,
+    0x02, 0x14, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0b, 0x15, 0x3f,
+};
+
+/* Single-session data CD */
+static const uint8_t data_cd[] = {
+    0x00, 0x2e, 0x01, 0x01,
+    0x01, 0x14, 0x00, 0xa0, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x01, 0x14, 0x00, 0xa1, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x01, 0x14, 0x00, 0xa2, 0x00, 0x00, 0x00, 0x00, 0x42, 0x28, 0x00,
+    0x01, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+};
+
+static toc_t toc;
+
+static void test_audio_cd(void) {
+    CHECK_INT(toc_parse_full(audio_cd, sizeof(audio_cd), &toc), 0);
+    CHECK_INT(toc.first_track, 1);
+    CHECK_INT(toc.last_track, 6);
+    CHECK_INT(toc.track_count, 6);
+    CHECK_INT(toc.audio_track_count, 6);
+    CHECK_INT(toc.data_track_count, 0);
+    CHECK_INT(toc.session_count, 1);
+    CHECK_INT(toc.leadout_lba, 95462 - 150);
+    CHECK_INT(toc.tracks[0].start_lba, 0);
+    CHECK_INT(toc.tracks[1].start_lba, 15363 - 150);
+    CHECK_INT(toc.tracks[0].length_sectors, 15363 - 150);
+    CHECK_INT(toc.tracks[5].length_sectors, 95462 - 80489);
+    CHECK(toc.tracks[2].pre_emphasis);
+    CHECK(!toc.tracks[1].pre_emphasis);
+    CHECK(!toc.tracks[0].is_data);
+
+    int first, last;
+    uint32_t leadout, offsets[TOC_MAX_TRACKS];
+    int count = toc_disc_id_layout(&toc, &first, &last, &leadout, offsets);
+    CHECK_INT(count, 6);
+    CHECK_INT(leadout, 95462);
+    CHECK_INT(offsets[5], 80489);
+
+    char mb_id[DISCID_MB_SIZE];
+    CHECK_INT(discid_compute(first, last, leadout, offsets, count, mb_id, NULL), 0);
+    CHECK_STR(mb_id, "49HHV7Eb8UKF3aQiNmu1GR8vKTY-");
+}
+
+static void test_enhanced_cd(void) {
+    CHECK_INT(toc_parse_full(enhanced_cd, sizeof(enhanced_cd), &toc), 0);
+    CHECK_INT(toc.track_count, 3);
+    CHECK_INT(toc.audio_track_count, 2);
+    CHECK_INT(toc.data_track_count, 1);
+    CHECK_INT(toc.session_count, 2);
+    CHECK_INT(toc.sessions[0].first_track, 1);
+    CHECK_INT(toc.sessions[0].last_track, 2);
+    CHECK_INT(toc.sessions[0].leadout_lba, 39738 - 150);
+    CHECK_INT(toc.sessions[1].first_track, 3);
+    CHECK_INT(toc.sessions[1].disc_type, TOC_DISC_TYPE_CDROM_XA);
+    CHECK_INT(toc.leadout_lba, 60000 - 150);
+    CHECK(toc.tracks[0].copy_permitted);
+    CHECK(toc.tracks[2].is_data);
+    CHECK_INT(toc.tracks[2].session, 2);
+    /* Audio tracks stop at their own session's lead-out, not at the data track */
+    CHECK_INT(toc.tracks[1].length_sectors, 39738 - 18901);
+    CHECK_INT(toc.tracks[2].length_sectors, 60000 - 51138);
+
+    int first, last;
+    uint32_t leadout, offsets[TOC_MAX_TRACKS];
+    int count = toc_disc_id_layout(&toc, &first, &last, &leadout, offsets);
+    CHECK_INT(count, 2);
+    CHECK_INT(first, 1);
+    CHECK_INT(last, 2);
+    CHECK_INT(leadout, 51138 - TOC_SESSION_GAP_FRAMES);
+
+    char mb_id[DISCID_MB_SIZE];
+    CHECK_INT(discid_compute(first, last, leadout, offsets, count, mb_id, NULL), 0);
+    CHECK_STR(mb_id, "MS0ykA8iqhwhwey1JFwbNd4IIqE-");
+}
+
+static void test_data_cd(void) {
+    CHECK_INT(toc_parse_full(data_cd, sizeof(data_cd), &toc), 0);
+    CHECK_INT(toc.track_count, 1);
+    CHECK_INT(toc.data_track_count, 1);
+    CHECK_INT(toc.audio_track_count, 0);
+    CHECK_INT(toc.tracks[0].length_sectors, 300000 - 150);
+
+    int first, last;
+    uint32_t leadout, offsets[TOC_MAX_TRACKS];
+    CHECK_INT(toc_disc_id_layout(&toc, &first, &last, &leadout, offsets), -1);
+}
+
+static void test_malformed(void) {
+    CHECK_INT(toc_parse_full(NULL, 0, &toc), -1);
+    CHECK_INT(toc_parse_full(audio_cd, 3, &toc), -1);
+    /* Header claims more descriptors than were returned */
+    CHECK_INT(toc_parse_full(audio_cd, sizeof(audio_cd) - 11, &toc), -1);
+    /* Header only: no tracks */
+    const uint8_t empty[] = { 0x00, 0x02, 0x01, 0x01 };
+    CHECK_INT(toc_parse_full(empty, sizeof(empty), &toc), -1);
+
+    /* Lead-out before the last track starts */
+    uint8_t bad[sizeof(audio_cd)];
+    memcpy(bad, audio_cd, sizeof(bad));
+    bad[4 + 2 * 11 + 8] = 0x01;
+    CHECK_INT(toc_parse_full(bad, sizeof(bad), &toc), -1);
+
+    /* A longer buffer than the header declares is fine: the rest is ignored */
+    uint8_t padded[sizeof(audio_cd) + 7] = { 0 };
+    memcpy(padded, audio_cd, sizeof(audio_cd));
+    CHECK_INT(toc_parse_full(padded, sizeof(padded), &toc), 0);
+    CHECK_INT(toc.track_count, 6);
+}
+
+int main(void) {
+    test_audio_cd();
+    test_enhanced_cd();
+    test_data_cd();
+    test_malformed();
+    return check_report("toc");
+}
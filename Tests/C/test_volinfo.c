@@ -0,0 +1,353 @@
+/*
+ * test_volinfo.c - volinfo against images built in memory
+ *
+ * Each image carries just the structures volinfo reads: ISO 9660 and
+ * Joliet volume descriptors, a UDF bridge (NSR area, anchor and volume
+ * descriptor sequence), an Apple partition map with an HFS+ volume, and
+ * a classic HFS master directory block.
+ */
+
+#include "check.h"
+#include "../../Discbot/Bridging/volinfo.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define SECTOR 2048u
+
+typedef struct {
+    uint8_t *bytes;
+    size_t size;
+} image_t;
+
+static image_t image_new(size_t sectors) {
+    image_t image = { calloc(sectors, SECTOR), sectors * SECTOR };
+    return image;
+}
+
+static uint8_t *sector_at(image_t *image, uint32_t lba) {
+    return image->bytes + (size_t)lba * SECTOR;
+}
+
+static long image_read(void *ctx, uint64_t offset, void *buf, size_t len) {
+    const image_t *image = ctx;
+    if (offset >= image->size) return 0;
+    size_t n = image->size - offset < len ? (size_t)(image->size - offset) : len;
+    memcpy(buf, image->bytes + offset, n);
+    return (long)n;
+}
+
+static void put_le16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_le32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+static void put_be16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+static void put_be32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (24 - 8 * i)); }
+
+/* Space-padded a-characters */
+static void put_padded(uint8_t *p, size_t len, const char *s) {
+    memset(p, ' ', len);
+    memcpy(p, s, strlen(s));
+}
+
+/* ASCII as UTF-16BE, space padded like a Joliet identifier */
+static void put_utf16be(uint8_t *p, size_t len, const char *s) {
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        put_be16(p + i, ' ');
+    }
+    for (size_t i = 0; s[i] && 2 * i + 1 < len; i++) {
+        put_be16(p + 2 * i, (uint8_t)s[i]);
+    }
+}
+
+/* MARK: - ISO 9660 / Joliet */
+
+/* Returns the sector after the volume descriptor set terminator */
+static uint32_t put_iso(image_t *image, const char *label, const char *joliet_label, uint32_t blocks) {
+    uint8_t *pvd = sector_at(image, 16);
+    pvd[0] = 1;
+    memcpy(pvd + 1, "CD001", 5);
+    pvd[6] = 1;
+    put_padded(pvd + 8, 32, "LINUX");
+    put_padded(pvd + 40, 32, label);
+    put_le32(pvd + 80, blocks);
+    put_be32(pvd + 84, blocks);
+    put_le16(pvd + 128, SECTOR);
+    put_be16(pvd + 130, SECTOR);
+    put_padded(pvd + 318, 128, "DISCBOT TESTS");
+    put_padded(pvd + 574, 128, "MKISOFS");
+    memcpy(pvd + 813, "2001090911000000", 16);
+
+    uint32_t next = 17;
+    if (joliet_label) {
+        uint8_t *svd = sector_at(image, next++);
+        svd[0] = 2;
+        memcpy(svd + 1, "CD001", 5);
+        svd[6] = 1;
+        put_utf16be(svd + 40, 32, joliet_label);
+        memcpy(svd + 88, "%/E", 3);
+    }
+
+    uint8_t *terminator = sector_at(image, next);
+    terminator[0] = 255;
+    memcpy(terminator + 1, "CD001", 5);
+    terminator[6] = 1;
+    return next + 1;
+}
+
+static void test_iso9660_and_joliet(void) {
+    image_t image = image_new(32);
+    put_iso(&image, "PLAIN_LABEL", "Long Joliet Name", 32);
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_INT(info.filesystems, VOLINFO_FS_ISO9660 | VOLINFO_FS_JOLIET);
+    CHECK_STR(info.iso_label, "PLAIN_LABEL");
+    CHECK_STR(info.joliet_label, "Long Joliet Name");
+    CHECK_STR(info.volume_label, "Long Joliet Name");
+    CHECK_STR(info.system_id, "LINUX");
+    CHECK_STR(info.publisher, "DISCBOT TESTS");
+    CHECK_STR(info.application, "MKISOFS");
+    CHECK_STR(info.creation_date, "2001090911000000");
+    CHECK_INT(info.block_size, SECTOR);
+    CHECK_INT(info.volume_size_bytes, 32 * SECTOR);
+    free(image.bytes);
+}
+
+static void test_iso9660_only(void) {
+    image_t image = image_new(20);
+    put_iso(&image, "DATA_DISC", NULL, 20);
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_INT(info.filesystems, VOLINFO_FS_ISO9660);
+    CHECK_STR(info.volume_label, "DATA_DISC");
+    CHECK_STR(info.joliet_label, "");
+    free(image.bytes);
+}
+
+/* MARK: - UDF */
+
+static void udf_tag(uint8_t *tag, uint16_t id, uint32_t location) {
+    put_le16(tag, id);
+    put_le16(tag + 2, 2);
+    put_le32(tag + 12, location);
+    uint8_t sum = 0;
+    for (int i = 0; i < 16; i++) {
+        if (i != 4) sum = (uint8_t)(sum + tag[i]);
+    }
+    tag[4] = sum;
+}
+
+/* 8-bit dstring: compression ID, characters, used length in the last byte */
+static void udf_dstring(uint8_t *field, size_t len, const char *s) {
+    field[0] = 8;
+    memcpy(field + 1, s, strlen(s));
+    field[len - 1] = (uint8_t)(strlen(s) + 1);
+}
+
+/* The volume recognition area starts at `area_start`, right after the ISO 9660 descriptors */
+static void put_udf(image_t *image, uint32_t area_start, const char *pvd_label, const char *lvd_label, uint32_t partition_blocks) {
+    const char *area[] = { "BEA01", "NSR02", "TEA01" };
+    for (uint32_t i = 0; i < 3; i++) {
+        uint8_t *descriptor = sector_at(image, area_start + i);
+        memcpy(descriptor + 1, area[i], 5);
+        descriptor[6] = 1;
+    }
+
+    uint32_t vds = 32;
+    uint8_t *anchor = sector_at(image, 256);
+    put_le32(anchor + 16, 4 * SECTOR);
+    put_le32(anchor + 20, vds);
+    udf_tag(anchor, 2, 256);
+
+    uint8_t *pvd = sector_at(image, vds);
+    udf_dstring(pvd + 24, 32, pvd_label);
+    udf_tag(pvd, 1, vds);
+
+    uint8_t *pd = sector_at(image, vds + 1);
+    put_le32(pd + 188, 272);
+    put_le32(pd + 192, partition_blocks);
+    udf_tag(pd, 5, vds + 1);
+
+    uint8_t *lvd = sector_at(image, vds + 2);
+    put_le32(lvd + 212, SECTOR);
+    if (lvd_label) udf_dstring(lvd + 84, 128, lvd_label);
+    udf_tag(lvd, 6, vds + 2);
+
+    udf_tag(sector_at(image, vds + 3), 8, vds + 3);
+}
+
+static void test_udf_bridge(void) {
+    image_t image = image_new(300);
+    uint32_t area = put_iso(&image, "DVD_VIDEO", NULL, 300);
+    put_udf(&image, area, "PVD_NAME", "My Movie", 28);
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_INT(info.filesystems, VOLINFO_FS_ISO9660 | VOLINFO_FS_UDF);
+    CHECK_STR(info.udf_label, "My Movie");
+    CHECK_STR(info.volume_label, "My Movie");
+    CHECK_STR(info.iso_label, "DVD_VIDEO");
+    CHECK_INT(info.block_size, SECTOR);
+    CHECK_INT(info.volume_size_bytes, (272 + 28) * SECTOR);
+    free(image.bytes);
+}
+
+static void test_udf_falls_back_to_primary_volume_name(void) {
+    image_t image = image_new(300);
+    uint32_t area = put_iso(&image, "DVD_VIDEO", NULL, 300);
+    put_udf(&image, area, "PVD_NAME", NULL, 28);
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_STR(info.udf_label, "PVD_NAME");
+    free(image.bytes);
+}
+
+static void test_udf_bad_checksum_is_ignored(void) {
+    image_t image = image_new(300);
+    uint32_t area = put_iso(&image, "DVD_VIDEO", NULL, 300);
+    put_udf(&image, area, "PVD_NAME", "My Movie", 28);
+    sector_at(&image, 256)[4] ^= 0xFF;
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_INT(info.filesystems, VOLINFO_FS_ISO9660);
+    CHECK_STR(info.volume_label, "DVD_VIDEO");
+    free(image.bytes);
+}
+
+/* MARK: - HFS / HFS+ */
+
+/* Apple partition map whose second entry is an HFS+ volume at byte `volume_offset` */
+static void put_partition_map(image_t *image, uint32_t volume_offset) {
+    uint8_t *block0 = image->bytes;
+    block0[0] = 'E';
+    block0[1] = 'R';
+    put_be16(block0 + 2, 512);
+
+    const char *types[] = { "Apple_partition_map", "Apple_HFS" };
+    for (uint32_t i = 1; i <= 2; i++) {
+        uint8_t *entry = image->bytes + i * 512;
+        entry[0] = 'P';
+        entry[1] = 'M';
+        put_be32(entry + 4, 2);
+        put_be32(entry + 8, i == 1 ? 1 : volume_offset / 512);
+        strcpy((char *)entry + 48, types[i - 1]);
+    }
+}
+
+/* HFS+ header plus a catalog whose first leaf record is the root folder's thread key */
+static void put_hfsplus(image_t *image, uint32_t volume_offset, const char *name) {
+    const uint32_t block_size = 4096, catalog_block = 2, node_size = 4096;
+    uint8_t *header = image->bytes + volume_offset + 1024;
+    header[0] = 'H';
+    header[1] = '+';
+    put_be32(header + 40, block_size);
+    put_be32(header + 44, 16);
+    put_be32(header + 288, catalog_block);
+    put_be32(header + 292, 2);
+
+    uint8_t *catalog = image->bytes + volume_offset + catalog_block * block_size;
+    put_be32(catalog + 14 + 10, 1);             /* First leaf node */
+    put_be16(catalog + 14 + 18, node_size);
+
+    uint8_t *leaf = catalog + node_size;
+    leaf[8] = 0xFF;                             /* Leaf node */
+    put_be16(leaf + node_size - 2, 14);         /* Record 0 follows the node descriptor */
+    uint8_t *key = leaf + 14;
+    size_t length = strlen(name);
+    put_be16(key, (uint16_t)(6 + 2 * length));
+    put_be32(key + 2, 1);
+    put_be16(key + 6, (uint16_t)length);
+    for (size_t i = 0; i < length; i++) {
+        put_be16(key + 8 + 2 * i, (uint8_t)name[i]);
+    }
+}
+
+static void test_hybrid_hfsplus(void) {
+    image_t image = image_new(64);
+    put_iso(&image, "HYBRID", "Hybrid Joliet", 64);
+    put_partition_map(&image, 64 * 1024);
+    put_hfsplus(&image, 64 * 1024, "Mac Side");
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_INT(info.filesystems, VOLINFO_FS_ISO9660 | VOLINFO_FS_JOLIET | VOLINFO_FS_HFSPLUS);
+    CHECK_STR(info.hfs_label, "Mac Side");
+    CHECK_STR(info.volume_label, "Mac Side");
+    CHECK_STR(info.joliet_label, "Hybrid Joliet");
+    CHECK_INT(info.block_size, 4096);
+    CHECK_INT(info.volume_size_bytes, 16 * 4096);
+    free(image.bytes);
+}
+
+static void test_classic_hfs_mac_roman(void) {
+    image_t image = image_new(4);
+    uint8_t *mdb = image.bytes + 1024;
+    mdb[0] = 'B';
+    mdb[1] = 'D';
+    put_be16(mdb + 18, 100);
+    put_be32(mdb + 20, 1024);
+    const uint8_t name[] = { 'C', 'a', 'f', 0x8E };    /* "Café" in Mac OS Roman */
+    mdb[36] = sizeof(name);
+    memcpy(mdb + 37, name, sizeof(name));
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), 0);
+    CHECK_INT(info.filesystems, VOLINFO_FS_HFS);
+    CHECK_STR(info.volume_label, "Caf\xC3\xA9");
+    CHECK_INT(info.volume_size_bytes, 100 * 1024);
+    free(image.bytes);
+}
+
+/* MARK: - Unrecognized and damaged media */
+
+static void test_blank_and_truncated(void) {
+    image_t blank = image_new(300);
+    volinfo_t info;
+    CHECK_INT(volinfo_probe(image_read, &blank, &info), -1);
+    CHECK_INT(info.filesystems, 0);
+    CHECK_STR(info.volume_label, "");
+    free(blank.bytes);
+
+    /* A disc that ends inside its own volume descriptor set */
+    image_t image = image_new(300);
+    put_iso(&image, "CUT_SHORT", NULL, 300);
+    image.size = 16 * SECTOR + 100;
+    CHECK_INT(volinfo_probe(image_read, &image, &info), -1);
+    free(image.bytes);
+
+    CHECK_INT(volinfo_probe(NULL, NULL, &info), -1);
+}
+
+static void test_probe_path(void) {
+    image_t image = image_new(20);
+    put_iso(&image, "FROM_FILE", "From File", 20);
+
+    char path[] = "/tmp/volinfo-test-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    CHECK_INT(write(fd, image.bytes, image.size), (long long)image.size);
+    close(fd);
+
+    volinfo_t info;
+    CHECK_INT(volinfo_probe_path(path, &info), 0);
+    CHECK_STR(info.volume_label, "From File");
+    CHECK_INT(volinfo_probe_path("/nonexistent/discbot.iso", &info), -1);
+    unlink(path);
+    free(image.bytes);
+}
+
+int main(void) {
+    test_iso9660_and_joliet();
+    test_iso9660_only();
+    test_udf_bridge();
+    test_udf_falls_back_to_primary_volume_name();
+    test_udf_bad_checksum_is_ignored();
+    test_hybrid_hfsplus();
+    test_classic_hfs_mac_roman();
+    test_blank_and_truncated();
+    test_probe_path();
+    return check_report("volinfo");
+}
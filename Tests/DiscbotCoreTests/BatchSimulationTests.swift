@@ -0,0 +1,99 @@
+//
+//  BatchSimulationTests.swift
+//  DiscbotCoreTests
+//
+//  Image All over the seeded 200-slot simulator, end to end through BatchOperationState
+//
+
+import XCTest
+@testable import DiscbotCore
+
+final class BatchSimulationTests: XCTestCase {
+    private struct Outcome: Equatable {
+        let attempted: Int
+        let completed: [Int]
+        let failed: [Int]
+        let backedUpSlots: Int
+        let simulatedSeconds: TimeInterval
+        let bytesRead: Int64
+        let loads: Int
+    }
+
+    private var workDirectory: URL!
+
+    override func setUpWithError() throws {
+        workDirectory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("discbot-tests-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true, attributes: nil)
+    }
+
+    override func tearDownWithError() throws {
+        try? FileManager.default.removeItem(at: workDirectory)
+    }
+
+    func testImageAllFullChanger() throws {
+        let outcome = try imageAll(scenario: "full-200", seed: 1, run: "first")
+
+        XCTAssertEqual(outcome.attempted, 200)
+        XCTAssertEqual(outcome.completed.count, 200)
+        XCTAssertEqual(Set(outcome.completed), Set(1...200))
+        XCTAssertEqual(outcome.failed, [])
+        XCTAssertEqual(outcome.backedUpSlots, 200)
+        XCTAssertEqual(outcome.loads, 200)
+        XCTAssertGreaterThan(outcome.bytesRead, 0)
+        XCTAssertGreaterThan(outcome.simulatedSeconds, 0)
+    }
+
+    func testImageAllIsDeterministicForASeed() throws {
+        let first = try imageAll(scenario: "high-error", seed: 7, run: "first")
+        let second = try imageAll(scenario: "high-error", seed: 7, run: "second")
+
+        XCTAssertEqual(first, second)
+        XCTAssertEqual(first.completed.count + first.failed.count, first.attempted)
+        XCTAssertEqual(first.backedUpSlots, first.completed.count)
+    }
+
+    /// Runs Image All the way `BenchmarkRunner` does, with every clock on simulated time.
+    private func imageAll(scenario name: String, seed: UInt64, run: String) throws -> Outcome {
+        let scenario = try XCTUnwrap(BenchmarkRunner.scenarios(seed: seed).first { $0.name == name })
+        let simulator = ChangerSimulator(configuration: scenario.configuration)
+        let changerService = SimulatedChangerService(simulator: simulator)
+        let database = Database(path: workDirectory.appendingPathComponent("\(name)-\(run).sqlite").path)
+        let clock = { Date(timeIntervalSince1970: simulator.currentTime) }
+
+        let state = BatchOperationState()
+        state.eventLog = EventLog(database: database, clock: clock)
+        state.jobQueue = JobQueue(database: database, clock: clock)
+        state.retrySleep = { simulator.sleep($0) }
+        state.retrySeed = seed
+
+        try changerService.connect()
+        let finished = expectation(description: "\(name) \(run)")
+        state.runImageAll(
+            slots: simulator.inventory().slots,
+            outputDirectory: workDirectory,
+            driveFallbackSourceSlot: nil,
+            changerService: changerService,
+            mountService: SimulatedMountService(simulator: simulator),
+            imagingService: SimulatedImagingService(simulator: simulator),
+            catalogService: CatalogService(database: database, musicBrainz: nil),
+            onUpdate: {},
+            onSlotLoaded: { _, _, _ in },
+            onSlotEjected: { _ in },
+            onComplete: { finished.fulfill() }
+        )
+        // The runner reports back on the main queue, which waiting keeps serviced
+        wait(for: [finished], timeout: 600)
+
+        let stats = simulator.snapshotStatistics()
+        return Outcome(
+            attempted: state.totalCount,
+            completed: state.completedSlots.sorted(),
+            failed: state.failedSlots.map { $0.slot }.sorted(),
+            backedUpSlots: database.getLatestBackups().filter { $0.backup != nil }.count,
+            simulatedSeconds: stats.elapsedSeconds,
+            bytesRead: stats.bytesRead,
+            loads: stats.loads
+        )
+    }
+}
@@ -0,0 +1,151 @@
+//
+//  CarouselSlotDiffTests.swift
+//  DiscbotCoreTests
+//
+//  Only the slots whose visual changed come back from each carousel update
+//
+
+import XCTest
+@testable import DiscbotCore
+
+final class CarouselSlotDiffTests: XCTestCase {
+    private static let slotCount = 200
+
+    private func makeSlots(_ count: Int = CarouselSlotDiffTests.slotCount) -> [Slot] {
+        (1...count).map { id in
+            Slot(id: id, address: UInt16(id), isFull: id % 3 != 0, discType: id % 2 == 0 ? .dvd : .dataCD)
+        }
+    }
+
+    private func loadedDiff(_ slots: [Slot], selectedSlotId: Int? = nil) -> CarouselSlotDiff {
+        var diff = CarouselSlotDiff()
+        _ = diff.update(slots: slots, selectedSlotId: selectedSlotId)
+        return diff
+    }
+
+    func testFirstUpdateReportsEverySlot() {
+        var diff = CarouselSlotDiff()
+        let changes = diff.update(slots: makeSlots(), selectedSlotId: nil)
+
+        XCTAssertEqual(changes.changed.count, Self.slotCount)
+        XCTAssertEqual(changes.removed, [])
+        XCTAssertEqual(diff.visuals.count, Self.slotCount)
+        XCTAssertEqual(changes.changed[3]?.divider, .empty)
+        XCTAssertNil(changes.changed[3]?.disc)
+        XCTAssertEqual(changes.changed[4]?.disc, CarouselDiscStyle(discType: .dvd, emphasis: .none))
+    }
+
+    func testUnchangedUpdateReportsNothing() {
+        let slots = makeSlots()
+        var diff = loadedDiff(slots, selectedSlotId: 10)
+
+        XCTAssertTrue(diff.update(slots: slots, selectedSlotId: 10).isEmpty)
+        XCTAssertTrue(diff.update(changed: Array(slots[20..<40])).isEmpty)
+    }
+
+    func testSelectChangesOnlyOldAndNewSlot() {
+        var diff = loadedDiff(makeSlots())
+
+        var changes = diff.select(4)
+        XCTAssertEqual(Set(changes.changed.keys), [4])
+        XCTAssertEqual(changes.changed[4]?.divider, .selected)
+        XCTAssertEqual(changes.changed[4]?.disc?.emphasis, .selected)
+
+        changes = diff.select(8)
+        XCTAssertEqual(Set(changes.changed.keys), [4, 8])
+        XCTAssertEqual(changes.changed[4]?.divider, .full)
+        XCTAssertEqual(changes.changed[8]?.divider, .selected)
+
+        XCTAssertTrue(diff.select(8).isEmpty)
+        changes = diff.select(nil)
+        XCTAssertEqual(Set(changes.changed.keys), [8])
+        XCTAssertNil(diff.selectedSlotId)
+    }
+
+    func testHoverChangesOnlyOldAndNewSlot() {
+        var diff = loadedDiff(makeSlots(), selectedSlotId: 5)
+
+        var changes = diff.hover(7)
+        XCTAssertEqual(Set(changes.changed.keys), [7])
+        XCTAssertEqual(changes.changed[7]?.divider, .hovered)
+        XCTAssertEqual(changes.changed[7]?.disc?.emphasis, .hovered)
+
+        changes = diff.hover(11)
+        XCTAssertEqual(Set(changes.changed.keys), [7, 11])
+
+        // Selection wins over hover, so hovering the selected slot changes nothing there
+        changes = diff.hover(5)
+        XCTAssertEqual(Set(changes.changed.keys), [11])
+        XCTAssertEqual(diff.visuals[5]?.divider, .selected)
+
+        // Slots the changer does not report are ignored
+        changes = diff.hover(Self.slotCount + 50)
+        XCTAssertTrue(changes.isEmpty)
+        XCTAssertEqual(diff.hoveredSlotId, Self.slotCount + 50)
+    }
+
+    func testChangedSlotUpdateReportsOnlyThatSlot() {
+        var slots = makeSlots()
+        var diff = loadedDiff(slots)
+
+        slots[0].isInDrive = true
+        var changes = diff.update(slots: slots, selectedSlotId: nil)
+        XCTAssertEqual(Set(changes.changed.keys), [1])
+        XCTAssertNil(changes.changed[1]?.disc)
+
+        slots[1].discType = .audioCDDA
+        changes = diff.update(changed: [slots[1]])
+        XCTAssertEqual(Set(changes.changed.keys), [2])
+        XCTAssertEqual(changes.changed[2]?.disc?.discType, .audioCDDA)
+
+        // A new volume label does not change how the slot is drawn
+        slots[3].volumeLabel = "ARCHIVE_2004"
+        XCTAssertTrue(diff.update(changed: [slots[3]]).isEmpty)
+    }
+
+    func testShrinkingChangerRemovesSlots() {
+        var diff = loadedDiff(makeSlots(), selectedSlotId: 199)
+        _ = diff.hover(150)
+
+        let changes = diff.update(slots: makeSlots(120), selectedSlotId: 199)
+        XCTAssertEqual(changes.changed, [:])
+        XCTAssertEqual(changes.removed.sorted(), Array(121...Self.slotCount))
+        XCTAssertEqual(diff.visuals.count, 120)
+
+        // Selection and hover on removed slots redraw nothing
+        XCTAssertTrue(diff.select(199).isEmpty)
+        XCTAssertTrue(diff.hover(160).isEmpty)
+
+        // Growing again brings the slots back as changes
+        let regrown = diff.update(slots: makeSlots(130), selectedSlotId: nil)
+        XCTAssertEqual(Set(regrown.changed.keys), Set(121...130))
+        XCTAssertEqual(regrown.removed, [])
+    }
+
+    // MARK: - Benchmark
+
+    /// Sweeping the hover across a 2000-slot changer: each step looks at two slots,
+    /// however many the changer has
+    func testHoverSweepPerformance() {
+        let slots = makeSlots(2000)
+        measure {
+            var diff = loadedDiff(slots)
+            var changed = 0
+            for id in slots.map(\.id) {
+                changed += diff.hover(id).changed.count
+            }
+            XCTAssertEqual(changed, 2 * slots.count - 1)
+        }
+    }
+
+    func testSingleSlotUpdatePerformance() {
+        var slots = makeSlots(2000)
+        var diff = loadedDiff(slots)
+        measure {
+            for index in stride(from: 0, to: slots.count, by: 10) {
+                slots[index].isFull.toggle()
+                XCTAssertEqual(diff.update(changed: [slots[index]]).changed.count, 1)
+            }
+        }
+    }
+}
@@ -0,0 +1,149 @@
+//
+//  DaemonRoundTripTests.swift
+//  DiscbotCoreTests
+//
+//  A control client against a daemon running the simulator backend, over a real socket
+//
+
+import XCTest
+@testable import DiscbotCore
+
+final class DaemonRoundTripTests: XCTestCase {
+    private struct RoundTrip {
+        let queued: ControlJob
+        let events: [ControlEvent]
+        let inventory: [ControlSlot]
+        let jobs: [ControlJob]
+    }
+
+    private struct UnexpectedReply: Error {
+        let reply: ControlResponse
+    }
+
+    private var workDirectory: URL!
+    private var socketPath: String!
+
+    override func setUpWithError() throws {
+        workDirectory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("discbot-tests-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true, attributes: nil)
+        // sun_path holds barely 100 bytes, which a temporary directory can use up
+        socketPath = "/tmp/discbot-\(ProcessInfo.processInfo.processIdentifier)-\(UUID().uuidString.prefix(8)).sock"
+    }
+
+    override func tearDownWithError() throws {
+        try? FileManager.default.removeItem(at: workDirectory)
+        try? FileManager.default.removeItem(atPath: socketPath)
+    }
+
+    func testQueueImageStreamsProgressAndAnswersInventory() throws {
+        let options = try XCTUnwrap(DaemonRunner.Options(arguments: [
+            "--daemon", "--simulate", "--slots", "12", "--seed", "5",
+            "--socket", socketPath,
+            "--database", workDirectory.appendingPathComponent("catalog.sqlite").path,
+            "--output", workDirectory.appendingPathComponent("images").path,
+        ]))
+        let daemon = DaemonRunner(options: options)
+        daemon.run()
+
+        // The daemon handles requests on the main queue, so the client gets its own thread
+        var result: Result<RoundTrip, Error>?
+        let finished = expectation(description: "round trip")
+        let socketPath = self.socketPath!
+        let client = Thread {
+            result = Result { try Self.roundTrip(socketPath: socketPath, slots: Array(1...6)) }
+            finished.fulfill()
+        }
+        client.start()
+        wait(for: [finished], timeout: 300)
+        let trip = try XCTUnwrap(result).get()
+        withExtendedLifetime(daemon) {}
+
+        XCTAssertEqual(trip.queued.kind, .imageAll)
+        XCTAssertEqual(trip.queued.state, .queued)
+        XCTAssertEqual(trip.queued.slots, Array(1...6))
+
+        XCTAssertEqual(trip.events.first?.kind, .jobQueued)
+        XCTAssertEqual(trip.events.dropFirst().first?.kind, .jobStarted)
+        XCTAssertEqual(trip.events.last?.kind, .jobFinished)
+        let finishedJob = try XCTUnwrap(trip.events.last?.job)
+        XCTAssertEqual(finishedJob.state, .completed)
+
+        // One slotFinished per disc, with progress rising as they arrive
+        let finishedSlots = finishedJob.completed + finishedJob.failed.map { $0.slot }
+        let slotEvents = trip.events.filter { $0.kind == .slotFinished }
+        XCTAssertFalse(finishedSlots.isEmpty)
+        XCTAssertEqual(slotEvents.compactMap { $0.slot }.sorted(), finishedSlots.sorted())
+        let progress = slotEvents.map { $0.job.progress }
+        XCTAssertEqual(progress, progress.sorted())
+
+        XCTAssertEqual(trip.inventory.count, 12)
+        let occupied = trip.inventory.filter { $0.isFull && (1...6).contains($0.id) }.map { $0.id }
+        XCTAssertEqual(Set(occupied), Set(finishedSlots))
+        for slot in trip.inventory where finishedJob.completed.contains(slot.id) {
+            XCTAssertEqual(slot.backupStatus, "backedUp", "slot \(slot.id)")
+        }
+        for slot in trip.inventory where slot.id > 6 {
+            XCTAssertEqual(slot.backupStatus, "notBackedUp", "slot \(slot.id)")
+        }
+
+        let listed = try XCTUnwrap(trip.jobs.first { $0.id == trip.queued.id })
+        XCTAssertEqual(listed.state, .completed)
+        XCTAssertEqual(listed.completed, finishedJob.completed)
+    }
+
+    func testSecondServerLeavesRunningSocketAlone() throws {
+        let first = ControlServer(path: socketPath, handlerQueue: DispatchQueue(label: "discbot.tests.echo"))
+        first.onLine = { line, channel in channel.send(line) }
+        try first.start()
+        defer { first.stop() }
+
+        let attributes = try FileManager.default.attributesOfItem(atPath: socketPath)
+        XCTAssertEqual((attributes[.posixPermissions] as? NSNumber)?.intValue, 0o600)
+
+        let second = ControlServer(path: socketPath)
+        XCTAssertThrowsError(try second.start()) { error in
+            guard case ControlSocketError.alreadyRunning = error else {
+                return XCTFail("unexpected error \(error)")
+            }
+        }
+
+        // The first server still owns the socket
+        let client = try ControlChannel.connect(path: socketPath)
+        defer { client.close() }
+        XCTAssertTrue(client.send(Data("ping".utf8)))
+        XCTAssertEqual(client.readLine(), Data("ping".utf8))
+    }
+
+    /// Subscribe, queue Image All over `slots`, follow its events to the end, then ask
+    /// for the inventory and the job list
+    private static func roundTrip(socketPath: String, slots: [Int]) throws -> RoundTrip {
+        let watcher = try ControlChannel.connect(path: socketPath)
+        defer { watcher.close() }
+        _ = try send(ControlRequest(id: 1, command: .subscribe), on: watcher)
+
+        let client = try ControlChannel.connect(path: socketPath)
+        defer { client.close() }
+        let queuedReply = try send(ControlRequest(id: 2, command: .queue, job: .imageAll, slots: slots), on: client)
+        guard let queued = queuedReply.job else { throw UnexpectedReply(reply: queuedReply) }
+
+        var events: [ControlEvent] = []
+        while let line = watcher.readLine() {
+            let message = try JSONDecoder.control.decode(ControlResponse.self, from: line)
+            guard let event = message.event, event.job.id == queued.id else { continue }
+            events.append(event)
+            if event.kind == .jobFinished { break }
+        }
+
+        let inventory = try send(ControlRequest(id: 3, command: .inventory), on: client)
+        let jobs = try send(ControlRequest(id: 4, command: .jobs), on: client)
+        return RoundTrip(queued: queued, events: events, inventory: inventory.inventory ?? [], jobs: jobs.jobs ?? [])
+    }
+
+    private static func send(_ request: ControlRequest, on channel: ControlChannel) throws -> ControlResponse {
+        guard channel.send(request), let line = channel.readLine() else { throw ControlSocketError.closed }
+        let reply = try JSONDecoder.control.decode(ControlResponse.self, from: line)
+        guard reply.ok, reply.id == request.id else { throw UnexpectedReply(reply: reply) }
+        return reply
+    }
+}
@@ -0,0 +1,170 @@
+//
+//  MusicBrainzServiceTests.swift
+//  DiscbotCoreTests
+//
+//  MusicBrainz lookups against a local stand-in: rate limiting, caching, Retry-After and back-fill
+//
+
+import XCTest
+@testable import DiscbotCore
+#if canImport(FoundationNetworking)
+import FoundationNetworking
+#endif
+
+final class MusicBrainzServiceTests: XCTestCase {
+    /// Shorter than MusicBrainz's one second so the tests run quickly
+    private static let requestInterval: TimeInterval = 0.25
+    /// Slack for loopback latency when comparing request arrival times
+    private static let tolerance: TimeInterval = 0.05
+
+    private var workDirectory: URL!
+    private var database: Database!
+    private var stub: MusicBrainzStub!
+
+    override func setUpWithError() throws {
+        workDirectory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("discbot-tests-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true, attributes: nil)
+        database = Database(path: workDirectory.appendingPathComponent("catalog.sqlite").path)
+        stub = MusicBrainzStub()
+        try stub.start()
+    }
+
+    override func tearDownWithError() throws {
+        stub.stop()
+        try? FileManager.default.removeItem(at: workDirectory)
+    }
+
+    func testRequestsAreSpacedByTheRateLimit() {
+        let discIds = (1...4).map { "disc-\($0)" }
+        for discId in discIds {
+            stub.respond(to: discId, with: .release(artist: "Artist \(discId)", album: "Album \(discId)", date: "2001-05-14"))
+        }
+
+        let found = lookUp(discIds, with: makeService())
+
+        XCTAssertEqual(Set(found.keys), Set(discIds))
+        XCTAssertEqual(found["disc-2"], DiscMetadata(
+            artist: "Artist disc-2", album: "Album disc-2", year: "2001", tracks: nil, source: .musicBrainz
+        ))
+        let arrivals = stub.requests.map { $0.arrivedAt }
+        XCTAssertEqual(arrivals.count, discIds.count)
+        for (earlier, later) in zip(arrivals, arrivals.dropFirst()) {
+            XCTAssertGreaterThanOrEqual(later - earlier, Self.requestInterval - Self.tolerance)
+        }
+    }
+
+    func testUnknownDiscIsCachedOnDisk() {
+        let service = makeService()
+        XCTAssertTrue(lookUp(["unknown"], with: service).isEmpty)
+        XCTAssertTrue(lookUp(["unknown"], with: service).isEmpty)
+        XCTAssertEqual(stub.requests(for: "unknown").count, 1)
+
+        // A new service finds the answer in the cache directory
+        XCTAssertTrue(lookUp(["unknown"], with: makeService()).isEmpty)
+        XCTAssertEqual(stub.requests(for: "unknown").count, 1)
+
+        // Once "not found" expires the disc is asked about again, in case it has since been submitted
+        stub.respond(to: "unknown", with: .release(artist: "Late Artist", album: "Late Album", date: nil))
+        let found = lookUp(["unknown"], with: makeService(negativeCacheLifetime: 0))
+        XCTAssertEqual(found["unknown"]?.album, "Late Album")
+        XCTAssertNil(found["unknown"]?.year)
+        XCTAssertEqual(stub.requests(for: "unknown").count, 2)
+    }
+
+    func testRetryAfterHoldsOffEveryRequest() {
+        stub.respond(to: "busy", with: .busy(retryAfter: "1"), .release(artist: "Artist", album: "Album", date: "1999"))
+        stub.respond(to: "other", with: .release(artist: "Other Artist", album: "Other Album", date: nil))
+
+        let found = lookUp(["busy", "other"], with: makeService())
+
+        XCTAssertEqual(found["busy"]?.album, "Album")
+        XCTAssertEqual(found["other"]?.album, "Other Album")
+        // The busy disc goes to the back of the queue, and nothing is sent until Retry-After has passed
+        let requests = stub.requests
+        XCTAssertEqual(requests.map { $0.discId }, ["busy", "other", "busy"])
+        guard requests.count == 3 else { return }
+        XCTAssertGreaterThanOrEqual(requests[1].arrivedAt - requests[0].arrivedAt, 1 - Self.tolerance)
+        XCTAssertGreaterThanOrEqual(requests[2].arrivedAt - requests[1].arrivedAt, Self.requestInterval - Self.tolerance)
+    }
+
+    func testServerThatStaysBusyIsNotCached() {
+        stub.respond(to: "busy", with: .busy(retryAfter: "0"))
+        let service = makeService()
+
+        XCTAssertTrue(lookUp(["busy"], with: service).isEmpty)
+        XCTAssertEqual(stub.requests(for: "busy").count, service.configuration.maxAttempts)
+
+        // Giving up is not an answer, so the next lookup asks again
+        stub.respond(to: "busy", with: .release(artist: "Artist", album: "Album", date: nil))
+        XCTAssertEqual(lookUp(["busy"], with: service)["busy"]?.album, "Album")
+        XCTAssertEqual(stub.requests(for: "busy").count, service.configuration.maxAttempts + 1)
+    }
+
+    func testBackfillWritesReleasesToCatalog() {
+        _ = database.insertOrUpdateDisc(DiscRecord(slotId: 1, discType: "audioCD", musicbrainzDiscId: "known"))
+        _ = database.insertOrUpdateDisc(DiscRecord(slotId: 2, discType: "audioCD", musicbrainzDiscId: "known"))
+        _ = database.insertOrUpdateDisc(DiscRecord(slotId: 3, discType: "audioCD", musicbrainzDiscId: "unknown"))
+        stub.respond(to: "known", with: .release(artist: "Artist", album: "Album", date: "1994-09-26"))
+
+        let service = makeService()
+        // The two disc IDs land in one batch: the queue only drains after the second answer
+        let applied = expectation(
+            forNotification: MusicBrainzService.lookupsAppliedNotification,
+            object: service
+        ) { notification in
+            notification.userInfo?["slotIds"] as? [Int] == [1, 2, 3]
+        }
+        service.backfillPending()
+        wait(for: [applied], timeout: 30)
+
+        XCTAssertEqual(stub.requests.map { $0.discId }, ["known", "unknown"])
+        for slotId in [1, 2] {
+            let disc = database.getDisc(slotId: slotId)
+            XCTAssertEqual(disc?.artist, "Artist", "slot \(slotId)")
+            XCTAssertEqual(disc?.album, "Album", "slot \(slotId)")
+            XCTAssertEqual(disc?.year, "1994", "slot \(slotId)")
+            XCTAssertEqual(disc?.metadataSource, "musicBrainz", "slot \(slotId)")
+        }
+        let unknown = database.getDisc(slotId: 3)
+        XCTAssertNil(unknown?.album)
+        XCTAssertNotNil(unknown?.metadataFetchedAt)
+        XCTAssertTrue(database.getPendingMusicBrainzLookups().isEmpty)
+    }
+
+    // MARK: - Helpers
+
+    private func makeService(negativeCacheLifetime: TimeInterval = 3600) -> MusicBrainzService {
+        var configuration = MusicBrainzService.Configuration(baseURL: stub.baseURL)
+        configuration.requestInterval = Self.requestInterval
+        configuration.requestTimeout = 10
+        configuration.negativeCacheLifetime = negativeCacheLifetime
+        configuration.cacheDirectory = workDirectory.appendingPathComponent("MusicBrainz", isDirectory: true)
+
+        // Every answer has to come from the stand-in, not from URLSession's own cache
+        let sessionConfiguration = URLSessionConfiguration.ephemeral
+        sessionConfiguration.urlCache = nil
+        sessionConfiguration.requestCachePolicy = .reloadIgnoringLocalCacheData
+        return MusicBrainzService(
+            configuration: configuration,
+            session: URLSession(configuration: sessionConfiguration),
+            database: database
+        )
+    }
+
+    /// Look up every disc ID at once and wait for all the answers; unknown discs are left out
+    private func lookUp(_ discIds: [String], with service: MusicBrainzService) -> [String: DiscMetadata] {
+        // Completions run one at a time on the service's queue
+        var found: [String: DiscMetadata] = [:]
+        let answered = expectation(description: "lookups")
+        answered.expectedFulfillmentCount = discIds.count
+        for discId in discIds {
+            service.lookup(discId: discId) { metadata in
+                found[discId] = metadata
+                answered.fulfill()
+            }
+        }
+        wait(for: [answered], timeout: 30)
+        return found
+    }
+}
@@ -0,0 +1,214 @@
+//
+//  MusicBrainzStub.swift
+//  DiscbotCoreTests
+//
+//  Local HTTP stand-in for the MusicBrainz disc ID endpoint
+//
+
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#else
+import Glibc
+#endif
+
+/// Answers `GET /ws/2/discid/<id>` on 127.0.0.1 with canned replies and records when
+/// each request arrived. One request per connection, served in arrival order.
+final class MusicBrainzStub {
+    enum Reply {
+        case release(artist: String, album: String, date: String?)
+        /// 404, what MusicBrainz answers for a disc ID it does not know
+        case notFound
+        /// 503, what MusicBrainz answers a client that is over its rate limit
+        case busy(retryAfter: String?)
+    }
+
+    struct Request {
+        let discId: String
+        /// `ProcessInfo.systemUptime` on arrival, the same clock the service's token bucket uses
+        let arrivedAt: TimeInterval
+    }
+
+    struct SocketError: Error {
+        let call: String
+        let code: Int32
+    }
+
+    private(set) var port: UInt16 = 0
+    private var listenFD: Int32 = -1
+    private let lock = NSLock()
+    private var replies: [String: [Reply]] = [:]
+    private var received: [Request] = []
+
+    var baseURL: URL {
+        URL(string: "http://127.0.0.1:\(port)")!
+    }
+
+    /// Every request so far, oldest first
+    var requests: [Request] {
+        lock.lock()
+        defer { lock.unlock() }
+        return received
+    }
+
+    func requests(for discId: String) -> [Request] {
+        requests.filter { $0.discId == discId }
+    }
+
+    /// Answer the next requests for `discId` with `replies` in turn; the last one repeats.
+    /// Disc IDs with no replies get `.notFound`.
+    func respond(to discId: String, with replies: Reply...) {
+        lock.lock()
+        defer { lock.unlock() }
+        self.replies[discId] = replies
+    }
+
+    /// Listen on an ephemeral loopback port
+    func start() throws {
+        signal(SIGPIPE, SIG_IGN)
+        #if canImport(Darwin)
+        let fd = socket(AF_INET, SOCK_STREAM, 0)
+        #else
+        let fd = socket(AF_INET, Int32(SOCK_STREAM.rawValue), 0)
+        #endif
+        guard fd >= 0 else { throw SocketError(call: "socket", code: errno) }
+
+        var address = sockaddr_in()
+        address.sin_family = sa_family_t(AF_INET)
+        address.sin_port = 0
+        address.sin_addr.s_addr = in_addr_t(0x7F00_0001).bigEndian
+        #if canImport(Darwin)
+        address.sin_len = UInt8(MemoryLayout<sockaddr_in>.size)
+        #endif
+        var length = socklen_t(MemoryLayout<sockaddr_in>.size)
+        let bound = withUnsafeMutablePointer(to: &address) {
+            $0.withMemoryRebound(to: sockaddr.self, capacity: 1) { pointer -> Bool in
+                bind(fd, pointer, length) == 0 && getsockname(fd, pointer, &length) == 0
+            }
+        }
+        guard bound, listen(fd, 8) == 0 else {
+            let code = errno
+            _ = close(fd)
+            throw SocketError(call: "bind", code: code)
+        }
+
+        port = UInt16(bigEndian: address.sin_port)
+        listenFD = fd
+        let thread = Thread { [weak self] in self?.acceptLoop(fd) }
+        thread.name = "discbot.tests.musicbrainz"
+        thread.start()
+    }
+
+    func stop() {
+        guard listenFD >= 0 else { return }
+        shutdown(listenFD, Int32(SHUT_RDWR))
+        _ = close(listenFD)
+        listenFD = -1
+    }
+
+    private func acceptLoop(_ fd: Int32) {
+        while true {
+            let clientFD = accept(fd, nil, nil)
+            if clientFD < 0 {
+                if errno == EINTR { continue }
+                return // listening socket closed by stop()
+            }
+            serve(clientFD)
+            _ = close(clientFD)
+        }
+    }
+
+    private func serve(_ fd: Int32) {
+        guard let head = readHead(fd), let discId = Self.discId(inRequestHead: head) else {
+            writeResponse(on: fd, status: "400 Bad Request", body: Data())
+            return
+        }
+
+        lock.lock()
+        received.append(Request(discId: discId, arrivedAt: ProcessInfo.processInfo.systemUptime))
+        var queued = replies[discId] ?? []
+        let reply = queued.first ?? .notFound
+        if queued.count > 1 {
+            queued.removeFirst()
+            replies[discId] = queued
+        }
+        lock.unlock()
+
+        switch reply {
+        case .release(let artist, let album, let date):
+            let artistCredit: [[String: Any]] = [
+                ["name": artist, "artist": ["id": UUID().uuidString.lowercased(), "name": artist]],
+            ]
+            var release: [String: Any] = [
+                "id": UUID().uuidString.lowercased(),
+                "title": album,
+                "artist-credit": artistCredit,
+            ]
+            if let date = date {
+                release["date"] = date
+            }
+            let body = (try? JSONSerialization.data(withJSONObject: ["releases": [release]])) ?? Data()
+            writeResponse(on: fd, status: "200 OK", body: body)
+        case .notFound:
+            writeResponse(on: fd, status: "404 Not Found", body: Data(#"{"error":"Not Found"}"#.utf8))
+        case .busy(let retryAfter):
+            writeResponse(
+                on: fd,
+                status: "503 Service Unavailable",
+                headers: retryAfter.map { ["Retry-After: \($0)"] } ?? [],
+                body: Data(#"{"error":"Your requests are exceeding the allowable rate limit."}"#.utf8)
+            )
+        }
+    }
+
+    /// The request line and headers; lookups are GETs, so there is no body to read
+    private func readHead(_ fd: Int32) -> String? {
+        let terminator = Data("\r\n\r\n".utf8)
+        var head = Data()
+        var chunk = [UInt8](repeating: 0, count: 1024)
+        while head.range(of: terminator) == nil {
+            let count = read(fd, &chunk, chunk.count)
+            if count < 0 && errno == EINTR { continue }
+            guard count > 0 else { return nil }
+            head.append(contentsOf: chunk[0..<count])
+        }
+        return String(data: head, encoding: .utf8)
+    }
+
+    /// `GET /ws/2/discid/<id>?fmt=json&inc=artists HTTP/1.1` -> `<id>`
+    static func discId(inRequestHead head: String) -> String? {
+        let prefix = "/ws/2/discid/"
+        let parts = head.components(separatedBy: "\r\n").first?.split(separator: " ") ?? []
+        guard
+            parts.count == 3, parts[0] == "GET",
+            let path = URLComponents(string: String(parts[1]))?.path,
+            path.hasPrefix(prefix), path.count > prefix.count
+        else {
+            return nil
+        }
+        return String(path.dropFirst(prefix.count))
+    }
+
+    private func writeResponse(on fd: Int32, status: String, headers: [String] = [], body: Data) {
+        let lines = [
+            "HTTP/1.1 \(status)",
+            "Content-Type: application/json",
+            "Content-Length: \(body.count)",
+            "Connection: close",
+        ] + headers
+        var data = Data((lines.joined(separator: "\r\n") + "\r\n\r\n").utf8)
+        data.append(body)
+        data.withUnsafeBytes { raw in
+            guard let base = raw.baseAddress else { return }
+            var offset = 0
+            while offset < raw.count {
+                let written = write(fd, base + offset, raw.count - offset)
+                if written < 0 {
+                    if errno == EINTR { continue }
+                    return
+                }
+                offset += written
+            }
+        }
+    }
+}